@@ -240,6 +240,10 @@ REGISTER_CLASS_NAME(Security,"flash.system")
 REGISTER_CLASS_NAME(SecurityDomain,"flash.system")
 REGISTER_CLASS_NAME(System,"flash.system")
 REGISTER_CLASS_NAME(ASWorker,"flash.system")
+REGISTER_CLASS_NAME(WorkerDomain,"flash.system")
+REGISTER_CLASS_NAME(WorkerState,"flash.system")
+REGISTER_CLASS_NAME(MessageChannel,"flash.system")
+REGISTER_CLASS_NAME(MessageChannelState,"flash.system")
 REGISTER_CLASS_NAME(ImageDecodingPolicy,"flash.system")
 
 //Text
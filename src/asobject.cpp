@@ -748,6 +748,16 @@ variable::variable(TRAIT_KIND _k, ASObject* _v, multiname* _t, const Type* _type
 	}
 }
 
+/*
+ * A bound method stored in a variable may be reachable from the object it is bound to.
+ * Methods are bound on every access, so they only become candidates here
+ */
+static inline void markStoredBoundMethod(ASObject* v)
+{
+	if(v && v->getObjectType()==T_FUNCTION && v->as<IFunction>()->isBound())
+		v->markCycleCandidate();
+}
+
 void variable::setVar(ASObject* v)
 {
 	//Resolve the typename if we have one
@@ -763,6 +773,7 @@ void variable::setVar(ASObject* v)
 	if((traitState&TYPE_RESOLVED) && type)
 		v = type->coerce(v);
 
+	markStoredBoundMethod(v);
 	if(var)
 		var->decRef();
 	var=v;
@@ -770,6 +781,7 @@ void variable::setVar(ASObject* v)
 
 void variable::setVarNoCoerce(ASObject* v)
 {
+	markStoredBoundMethod(v);
 	if(var)
 		var->decRef();
 	var=v;
@@ -1371,6 +1383,41 @@ bool ASObject::destruct()
 	return dodestruct;
 }
 
+bool ASObject::gcReleaseCandidate()
+{
+	if(sys==NULL)
+		return true;
+	return sys->getCycleCollector().releaseCandidate(this);
+}
+
+void ASObject::gcRemoveCandidate()
+{
+	if(sys)
+		sys->getCycleCollector().removeCandidate(this);
+}
+
+void ASObject::markCycleCandidate()
+{
+	if(sys)
+		sys->getCycleCollector().addCandidate(this);
+}
+
+void ASObject::gcTrace(CycleCollector& gc)
+{
+	variables_map::const_var_iterator it=Variables.Variables.cbegin();
+	for(;it!=Variables.Variables.cend();++it)
+	{
+		gc.visit(it->second.var);
+		gc.visit(it->second.setter);
+		gc.visit(it->second.getter);
+	}
+}
+
+void ASObject::gcClear()
+{
+	destroyContents();
+}
+
 void variables_map::initSlot(unsigned int n, var_iterator& it)
 {
 	if(n>slots_vars.size())
@@ -1476,16 +1523,16 @@ unsigned int ASObject::numVariables() const
 	return varcount;
 }
 
-void ASObject::serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap) const
+void ASObject::serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const
 {
 	Variables.serialize(out, stringMap, objMap, traitsMap);
 }
 
-void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap) const
+void variables_map::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const
 {
 	bool amf0 = out->getObjectEncoding() == ObjectEncoding::AMF0;
 	//Pairs of name, value
@@ -1506,9 +1553,42 @@ void variables_map::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& s
 	if (!amf0) out->writeStringVR(stringMap, "");
 }
 
-void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ASObject::describeAMF3Traits(Class_base* type) const
+{
+	//Check if an alias is registered
+	auto aliasIt=getSystemState()->aliasMap.begin();
+	const auto aliasEnd=getSystemState()->aliasMap.end();
+	//Linear search for alias
+	type->amf3Alias="";
+	for(;aliasIt!=aliasEnd;++aliasIt)
+	{
+		if(aliasIt->second==type)
+		{
+			type->amf3Alias=aliasIt->first;
+			break;
+		}
+	}
+	//All the instances have the same declared traits, in the same order
+	type->amf3TraitNames.clear();
+	variables_map::const_var_iterator varIt=Variables.Variables.begin();
+	for(;varIt!=Variables.Variables.end();++varIt)
+	{
+		if(varIt->second.kind==DECLARED_TRAIT)
+		{
+			if(!varIt->first.ns.hasEmptyName())
+			{
+				//Skip variable with a namespace, like protected ones
+				continue;
+			}
+			type->amf3TraitNames.push_back(varIt->first.nameId);
+		}
+	}
+	type->amf3TraitsCached=true;
+}
+
+void ASObject::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	bool amf0 = out->getObjectEncoding() == ObjectEncoding::AMF0;
 	if (amf0)
@@ -1536,19 +1616,9 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	Class_base* type=getClass();
 	assert_and_throw(type);
 
-	//Check if an alias is registered
-	auto aliasIt=getSystemState()->aliasMap.begin();
-	const auto aliasEnd=getSystemState()->aliasMap.end();
-	//Linear search for alias
-	tiny_string alias;
-	for(;aliasIt!=aliasEnd;++aliasIt)
-	{
-		if(aliasIt->second==type)
-		{
-			alias=aliasIt->first;
-			break;
-		}
-	}
+	if(!type->amf3TraitsCached)
+		describeAMF3Traits(type);
+	const tiny_string& alias=type->amf3Alias;
 	bool serializeTraits = alias.empty()==false;
 
 	if(type->isSubClass(InterfaceClass<IExternalizable>::getClass(getSystemState())))
@@ -1625,33 +1695,12 @@ void ASObject::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 	else
 	{
 		traitsMap.insert(make_pair(type, traitsMap.size()));
-		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
-		{
-			if(varIt->second.kind==DECLARED_TRAIT)
-			{
-				if(!varIt->first.ns.hasEmptyName())
-				{
-					//Skip variable with a namespace, like protected ones
-					continue;
-				}
-				traitsCount++;
-			}
-		}
+		traitsCount=type->amf3TraitNames.size();
 		uint32_t dynamicFlag=(type->isSealed)?0:(1 << 3);
 		out->writeU29((traitsCount << 4) | dynamicFlag | 0x03);
 		out->writeStringVR(stringMap, alias);
-		for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
-		{
-			if(varIt->second.kind==DECLARED_TRAIT)
-			{
-				if(!varIt->first.ns.hasEmptyName())
-				{
-					//Skip variable with a namespace, like protected ones
-					continue;
-				}
-				out->writeStringVR(stringMap, getSystemState()->getStringFromUniqueId(varIt->first.nameId));
-			}
-		}
+		for(uint32_t i=0;i<traitsCount;i++)
+			out->writeStringVR(stringMap, getSystemState()->getStringFromUniqueId(type->amf3TraitNames[i]));
 	}
 	for(variables_map::const_var_iterator varIt=beginIt; varIt != endIt; ++varIt)
 	{
@@ -26,6 +26,7 @@
 #include "threading.h"
 #include "memory_support.h"
 #include <map>
+#include <unordered_map>
 #include <boost/intrusive/list.hpp>
 
 #define ASFUNCTION(name) \
@@ -323,9 +324,9 @@ public:
 	int getNextEnumerable(unsigned int i) const;
 	~variables_map();
 	void check() const;
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap) const;
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const;
 	void dumpVariables() const;
 	void destroyContents();
 };
@@ -378,6 +379,9 @@ protected:
 	ASObject(const ASObject& o);
 	virtual ~ASObject()
 	{
+		//Objects can be deleted without going through decRef (e.g. during the final cleanup)
+		if(isCycleCandidate())
+			gcRemoveCandidate();
 		destroy();
 	}
 	uint32_t stringId;
@@ -387,10 +391,12 @@ protected:
 	bool traitsInitialized:1;
 	bool constructIndicator:1;
 	bool constructorCallComplete:1; // indicates that the constructor including all super constructors has been called
-	void serializeDynamicProperties(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t> traitsMap) const;
+	void serializeDynamicProperties(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap) const;
 	void setClass(Class_base* c);
+	/* Fills the AMF3 traits cache of the class, see Class_base::amf3TraitsCached */
+	void describeAMF3Traits(Class_base* type) const;
 	static variable* findSettableImpl(SystemState* sys,variables_map& map, const multiname& name, bool* has_getter);
 	inline static const variable* findGettableImpl(SystemState* sys,const variables_map& map, const multiname& name, uint32_t* nsRealId = NULL)
 	{
@@ -417,6 +423,8 @@ protected:
 	bool destruct();
 	// called when object is really destroyed
 	virtual void destroy(){}
+	bool gcReleaseCandidate();
+	void gcRemoveCandidate();
 public:
 	ASObject(Class_base* c,SWFOBJECT_TYPE t = T_OBJECT,CLASS_SUBTYPE subtype = SUBTYPE_NOT_SET);
 	
@@ -460,6 +468,11 @@ public:
 	   The finalize method must be callable multiple time with the same effects (no double frees).
 	*/
 	inline virtual void finalize() {}
+	/* Cycle collector support, see RefCountable. Subclasses must call the base implementation */
+	void gcTrace(CycleCollector& gc);
+	void gcClear();
+	/* Registers this object with the cycle collector, call it where a reference cycle may be formed */
+	void markCycleCandidate();
 
 	enum GET_VARIABLE_OPTION {NONE=0x00, SKIP_IMPL=0x01, XML_STRICT=0x02};
 
@@ -613,9 +626,9 @@ public:
 
 	  The various maps are used to implement reference type of the AMF3 spec
 	*/
-	virtual void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	virtual void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 
 	virtual ASObject *describeType() const;
 
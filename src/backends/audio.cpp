@@ -16,114 +16,189 @@
     You should have received a copy of the GNU Lesser General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **************************************************************************/
-
 #include "swf.h"
 #include "backends/audio.h"
 #include "backends/config.h"
+#include "backends/profiler.h"
 #include <iostream>
 #include "logger.h"
 #include <SDL2/SDL_mixer.h>
-#include <sys/time.h>
 
 #define LIGHTSPARK_AUDIO_SDL_BUFFERSIZE 8192
+#define LIGHTSPARK_AUDIO_RATE 44100
+//Frames mixed at each wake up of the headless output
+#define LIGHTSPARK_AUDIO_SINK_FRAMES 1024
 
 using namespace lightspark;
 using namespace std;
 
-void mixer_effect_ffmpeg_cb(int chan, void * stream, int len, void * udata)
+//Catmull-Rom interpolation between b and c
+static inline float interpolate(float a, float b, float c, float d, float t)
 {
-	AudioStream *s = (AudioStream*)udata;
-	if (!s)
-		return;
+	float c1=0.5f*(c-a);
+	float c2=a-2.5f*b+2.0f*c-0.5f*d;
+	float c3=0.5f*(d-a)+1.5f*(b-c);
+	return ((c3*t+c2)*t+c1)*t+b;
+}
 
-	uint32_t readcount = 0;
-	while (readcount < ((uint32_t)len))
+//Kept free of dependencies between iterations so that the compiler vectorizes them
+static void accumulate(float* __restrict dest, const float* __restrict src, uint32_t frames, float left, float right)
+{
+	for(uint32_t i=0;i<frames;i++)
 	{
-		uint32_t ret = s->getDecoder()->copyFrame((int16_t *)(((unsigned char*)stream)+readcount), ((uint32_t)len)-readcount);
-		if (!ret)
-			break;
-		readcount += ret;
+		dest[2*i]+=src[2*i]*left;
+		dest[2*i+1]+=src[2*i+1]*right;
 	}
 }
 
+static void clampToS16(int16_t* __restrict dest, const float* __restrict src, uint32_t samples)
+{
+	for(uint32_t i=0;i<samples;i++)
+	{
+		float v=src[i];
+		v=(v>32767.0f)?32767.0f:v;
+		v=(v<-32768.0f)?-32768.0f:v;
+		dest[i]=int16_t(v);
+	}
+}
 
-uint32_t AudioStream::getPlayedTime()
+AudioStream::AudioStream(AudioManager* _manager):manager(_manager),decoder(NULL),hasStarted(false),
+	paused(false),muted(false),volume(1.0),pan(0.0),sourcePos(0),sourceFrames(0),phase(1.0),consumedFrames(0),
+	prevMixStartFrames(0),mixStartFrames(0),mixEndFrames(0),mixTime(0)
 {
-	uint32_t ret;
-	struct timeval now;
-	gettimeofday(&now, NULL);
+	memset(history,0,sizeof(history));
+}
 
-	ret = playedtime + (now.tv_sec * 1000 + now.tv_usec / 1000) - (starttime.tv_sec * 1000 + starttime.tv_usec / 1000);
-	return ret;
+uint32_t AudioStream::getPlayedTime()
+{
+	Locker l(manager->streamMutex);
+	if(decoder->sampleRate==0)
+		return 0;
+	/*
+	 * The mixer pulls whole output buffers, so consumedFrames runs ahead of what is heard.
+	 * The last mix starts being audible after the output latency, advance from there
+	 * with the wall clock. The result stays between the previous mix and the end of the last one.
+	 */
+	int64_t elapsed=int64_t(compat_msectiming()-mixTime)-manager->outputLatency;
+	int64_t frames=int64_t(mixStartFrames)+elapsed*int64_t(decoder->sampleRate)/1000;
+	if(frames<int64_t(prevMixStartFrames))
+		frames=prevMixStartFrames;
+	if(frames>int64_t(mixEndFrames))
+		frames=mixEndFrames;
+	return frames*1000/decoder->sampleRate;
 }
+
 bool AudioStream::init()
 {
-	unmutevolume = curvolume = SDL_MIX_MAXVOLUME;
-	playedtime = 0;
-	gettimeofday(&starttime, NULL);
-	mixer_channel = -1;
-
-	uint32_t len = LIGHTSPARK_AUDIO_SDL_BUFFERSIZE;
-
-	uint8_t *buf = new uint8_t[len];
-	memset(buf,0,len);
-	Mix_Chunk* chunk = Mix_QuickLoad_RAW(buf, len);
-
-
-	mixer_channel = Mix_PlayChannel(-1, chunk, -1);
-	Mix_RegisterEffect(mixer_channel, mixer_effect_ffmpeg_cb, NULL, this);
-	Mix_Resume(mixer_channel);
-
-	return true;
+	return decoder->sampleRate!=0 && decoder->channelCount!=0;
 }
 
-void AudioStream::SetPause(bool pause_on)
+bool AudioStream::nextSourceFrame()
 {
-	if (pause_on)
+	uint32_t channels=decoder->channelCount;
+	if(sourcePos==sourceFrames)
 	{
-		playedtime = getPlayedTime();
-		if (mixer_channel != -1)
-			Mix_Pause(mixer_channel);
+		//Whole frames only, the decoder buffers never split a frame
+		uint32_t len=(sizeof(source)/(2*channels))*2*channels;
+		uint32_t bytes=decoder->copyFrame(source, len);
+		if(bytes==0)
+			return false;
+		sourcePos=0;
+		sourceFrames=bytes/(2*channels);
+		if(sourceFrames==0)
+			return false;
 	}
-	else
+	memmove(history[0],history[1],sizeof(history[0])*3);
+	const int16_t* frame=source+sourcePos*channels;
+	history[3][0]=frame[0];
+	history[3][1]=(channels>1)?frame[1]:frame[0];
+	sourcePos++;
+	consumedFrames++;
+	return true;
+}
+
+uint32_t AudioStream::resample(float* dest, uint32_t frames, uint32_t outputRate)
+{
+	const double step=double(decoder->sampleRate)/outputRate;
+	for(uint32_t i=0;i<frames;i++)
 	{
-		gettimeofday(&starttime, NULL);
-		if (mixer_channel != -1)
-			Mix_Resume(mixer_channel);
+		while(phase>=1.0)
+		{
+			//Underrun, the rest of the mix is silent for this stream
+			if(!nextSourceFrame())
+				return i;
+			phase-=1.0;
+		}
+		float t=phase;
+		dest[2*i]=interpolate(history[0][0],history[1][0],history[2][0],history[3][0],t);
+		dest[2*i+1]=interpolate(history[0][1],history[1][1],history[2][1],history[3][1],t);
+		phase+=step;
 	}
+	return frames;
+}
+
+void AudioStream::mixInto(float* dest, uint32_t frames, uint32_t outputRate)
+{
+	if(paused || decoder->sampleRate==0 || decoder->channelCount==0)
+		return;
+	if(resampled.size()<frames*2)
+		resampled.resize(frames*2);
+	prevMixStartFrames=mixStartFrames;
+	mixStartFrames=consumedFrames;
+	mixTime=manager->mixTime;
+	uint32_t produced=resample(&resampled[0], frames, outputRate);
+	mixEndFrames=consumedFrames;
+	//Muted streams are still consumed to keep them in time
+	if(muted || manager->muteAllStreams)
+		return;
+	float left=volume*((pan>0)?1.0f-pan:1.0f);
+	float right=volume*((pan<0)?1.0f+pan:1.0f);
+	accumulate(dest, &resampled[0], produced, left, right);
+}
+
+void AudioStream::SetPause(bool pause_on)
+{
+	paused=pause_on;
 }
 
 bool AudioStream::ispaused()
 {
-	return Mix_Paused(mixer_channel);
+	return paused;
 }
 
 void AudioStream::mute()
 {
-	unmutevolume = curvolume;
-	curvolume = 0;
+	muted=true;
 }
 void AudioStream::unmute()
 {
-	curvolume = unmutevolume;
+	muted=false;
 }
-void AudioStream::setVolume(double volume)
+void AudioStream::setVolume(double v)
 {
-	curvolume = SDL_MIX_MAXVOLUME * volume;
-	if (mixer_channel != -1)
-		Mix_Volume(mixer_channel, curvolume);
+	volume=v;
+}
+void AudioStream::setPan(double p)
+{
+	pan=dmin(dmax(p,-1.0),1.0);
 }
 
 AudioStream::~AudioStream()
 {
-	if (mixer_channel != -1)
-		Mix_HaltChannel(mixer_channel);
 	manager->removeStream(this);
 }
 
-AudioManager::AudioManager():muteAllStreams(false),sdl_available(0),mixeropened(0)
+AudioManager::AudioManager():sink(SDL_SINK),muteAllStreams(false),sdl_available(0),mixeropened(0),
+	outputRate(LIGHTSPARK_AUDIO_RATE),outputChannels(2),mixTime(0),outputLatency(0),sinkThread(NULL),sinkStopped(true),sinkFile(NULL)
 {
+	const string& output=Config::getConfig()->getAudioOutput();
+	if(output=="null")
+		sink=NULL_SINK;
+	else if(output=="file")
+		sink=FILE_SINK;
 	sdl_available = 0;
+	if(sink!=SDL_SINK)
+		return;
 	if (SDL_WasInit(0)) // some part of SDL already was initialized
 		sdl_available = !SDL_InitSubSystem ( SDL_INIT_AUDIO );
 	else
@@ -149,33 +224,159 @@ void AudioManager::unmuteAll()
 	}
 }
 
-void AudioManager::removeStream(AudioStream *s)
+void AudioManager::mix(int16_t* dest, uint32_t frames)
 {
 	Locker l(streamMutex);
-	streams.remove(s);
-	if (streams.empty())
+	if(mixBuffer.size()<frames*2)
+		mixBuffer.resize(frames*2);
+	float* buf=&mixBuffer[0];
+	memset(buf,0,frames*2*sizeof(float));
+	mixTime=compat_msectiming();
+	for(stream_iterator it=streams.begin();it!=streams.end();++it)
+		(*it)->mixInto(buf, frames, outputRate);
+	if(outputChannels==2)
 	{
-		Mix_CloseAudio();
-		mixeropened = false;
+		clampToS16(dest, buf, frames*2);
+		return;
+	}
+	//Downmix or spread the stereo mix over the output channels
+	for(uint32_t i=0;i<frames;i++)
+	{
+		if(outputChannels==1)
+			buf[i]=(buf[2*i]+buf[2*i+1])*0.5f;
+		else
+		{
+			for(uint32_t c=0;c<outputChannels;c++)
+				dest[i*outputChannels+c]=0;
+		}
+	}
+	if(outputChannels==1)
+		clampToS16(dest, buf, frames);
+	else
+	{
+		for(uint32_t i=0;i<frames;i++)
+			clampToS16(dest+i*outputChannels, buf+2*i, 2);
 	}
 }
 
-AudioStream* AudioManager::createStream(AudioDecoder* decoder, bool startpaused)
+void AudioManager::sdlMixCallback(void* udata, uint8_t* stream, int len)
 {
-	Locker l(streamMutex);
-	if (!sdl_available)
-		return NULL;
-	if (!mixeropened)
+	AudioManager* m=static_cast<AudioManager*>(udata);
+	m->mix((int16_t*)stream, len/(2*m->outputChannels));
+}
+
+void AudioManager::sinkWorker()
+{
+	ProfilerThreadScope profilerThread("audio");
+	vector<int16_t> buf(LIGHTSPARK_AUDIO_SINK_FRAMES*outputChannels);
+	uint64_t start=compat_msectiming();
+	uint64_t mixedFrames=0;
+	while(!sinkStopped)
 	{
-		if (Mix_OpenAudio (MIX_DEFAULT_FREQUENCY, AUDIO_S16, 2, LIGHTSPARK_AUDIO_SDL_BUFFERSIZE) < 0)
+		mix(&buf[0], LIGHTSPARK_AUDIO_SINK_FRAMES);
+		mixedFrames+=LIGHTSPARK_AUDIO_SINK_FRAMES;
+		if(sinkFile)
+			fwrite(&buf[0], sizeof(int16_t), buf.size(), sinkFile);
+		//Pace the mixer like a sound card would
+		uint64_t due=start+mixedFrames*1000/outputRate;
+		uint64_t now=compat_msectiming();
+		if(due>now)
+			compat_msleep(due-now);
+	}
+}
+
+bool AudioManager::openOutput()
+{
+	if(mixeropened)
+		return true;
+	if(sink==SDL_SINK)
+	{
+		if (!sdl_available)
+			return false;
+		if (Mix_OpenAudio (LIGHTSPARK_AUDIO_RATE, AUDIO_S16SYS, 2, LIGHTSPARK_AUDIO_SDL_BUFFERSIZE) < 0)
 		{
 			LOG(LOG_ERROR,"Couldn't open SDL_mixer");
 			sdl_available = 0;
-			return NULL;
+			return false;
+		}
+		int frequency;
+		uint16_t format;
+		int channels;
+		Mix_QuerySpec(&frequency, &format, &channels);
+		if(format!=AUDIO_S16SYS)
+		{
+			LOG(LOG_ERROR,"Unsupported audio output format " << format);
+			Mix_CloseAudio();
+			sdl_available = 0;
+			return false;
 		}
-		mixeropened = 1;
+		outputRate=frequency;
+		outputChannels=channels;
+		//SDL asks for the next buffer when it starts playing the previous one
+		outputLatency=LIGHTSPARK_AUDIO_SDL_BUFFERSIZE*1000/outputRate;
+		//Our mixer replaces the SDL_mixer channels
+		Mix_HookMusic(sdlMixCallback, this);
+	}
+	else
+	{
+		if(sink==FILE_SINK)
+		{
+			const string& path=Config::getConfig()->getAudioOutputFile();
+			sinkFile=fopen(path.c_str(), "wb");
+			if(sinkFile==NULL)
+				LOG(LOG_ERROR,"Couldn't open audio output file " << path);
+		}
+		//The sink thread mixes each buffer right before it is due
+		outputLatency=0;
+		sinkStopped=false;
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+		sinkThread = Thread::create(sigc::mem_fun(this,&AudioManager::sinkWorker));
+#else
+		sinkThread = Thread::create(sigc::mem_fun(this,&AudioManager::sinkWorker),true);
+#endif
+	}
+	LOG(LOG_INFO,"Audio output: " << outputRate << "Hz, " << outputChannels << " channels");
+	mixeropened = 1;
+	return true;
+}
+
+void AudioManager::closeOutput()
+{
+	if(!mixeropened)
+		return;
+	//The mixer takes streamMutex, it must not be held while waiting for it to stop
+	if(sink==SDL_SINK)
+	{
+		Mix_HookMusic(NULL, NULL);
+		Mix_CloseAudio();
 	}
+	else
+	{
+		sinkStopped=true;
+		sinkThread->join();
+		sinkThread=NULL;
+		if(sinkFile)
+			fclose(sinkFile);
+		sinkFile=NULL;
+	}
+	mixeropened = 0;
+}
 
+void AudioManager::removeStream(AudioStream *s)
+{
+	Locker o(outputMutex);
+	bool empty;
+	{
+		Locker l(streamMutex);
+		streams.remove(s);
+		empty=streams.empty();
+	}
+	if (empty)
+		closeOutput();
+}
+
+AudioStream* AudioManager::createStream(AudioDecoder* decoder, bool startpaused)
+{
 	AudioStream *stream = new AudioStream(this);
 	stream->decoder = decoder;
 	if (!stream->init())
@@ -187,7 +388,22 @@ AudioStream* AudioManager::createStream(AudioDecoder* decoder, bool startpaused)
 		stream->pause();
 	else
 		stream->hasStarted=true;
-	streams.push_back(stream);
+	bool opened;
+	{
+		Locker o(outputMutex);
+		opened=openOutput();
+		if (opened)
+		{
+			Locker l(streamMutex);
+			streams.push_back(stream);
+		}
+	}
+	if (!opened)
+	{
+		//Deleting takes outputMutex again
+		delete stream;
+		return NULL;
+	}
 
 	return stream;
 }
@@ -195,13 +411,18 @@ AudioStream* AudioManager::createStream(AudioDecoder* decoder, bool startpaused)
 
 AudioManager::~AudioManager()
 {
-	Locker l(streamMutex);
-	for (stream_iterator it = streams.begin(); it != streams.end(); ++it) {
+	list<AudioStream*> toDelete;
+	{
+		Locker l(streamMutex);
+		toDelete=streams;
+	}
+	//Streams remove themselves from the list
+	for (stream_iterator it = toDelete.begin(); it != toDelete.end(); ++it) {
 		delete *it;
 	}
-	if (mixeropened)
 	{
-		Mix_CloseAudio();
+		Locker o(outputMutex);
+		closeOutput();
 	}
 	if (sdl_available)
 	{
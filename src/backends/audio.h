@@ -24,21 +24,50 @@
 #include "compat.h"
 #include "backends/decoder.h"
 #include <iostream>
+#include <vector>
+#include "threading.h"
 
 namespace lightspark
 {
 class AudioStream;
 
+/*
+ * Mixes all the streams in process and feeds the result to a single output.
+ * The output is either SDL, or for headless runs a thread pacing the mixer in real time,
+ * optionally writing the mix to a file as raw signed 16 bit interleaved samples.
+ */
 class AudioManager
 {
 	friend class AudioStream;
 private:
+	enum SINK { SDL_SINK=0, NULL_SINK, FILE_SINK };
+	SINK sink;
 	bool muteAllStreams;
 	int sdl_available;
 	int mixeropened;
 	std::list<AudioStream *> streams;
 	typedef std::list<AudioStream *>::iterator stream_iterator;
+	//Protects the streams, taken by the mixer
 	Mutex streamMutex;
+	//Protects opening and closing the output, always taken before streamMutex
+	Mutex outputMutex;
+	//Format of the output
+	uint32_t outputRate;
+	uint32_t outputChannels;
+	//Stereo accumulation buffer
+	std::vector<float> mixBuffer;
+	//When the last mix was requested, in milliseconds
+	uint64_t mixTime;
+	//Milliseconds between a mix and the time it becomes audible
+	uint32_t outputLatency;
+	//Headless output
+	Thread* sinkThread;
+	volatile bool sinkStopped;
+	FILE* sinkFile;
+	bool openOutput();
+	void closeOutput();
+	void sinkWorker();
+	static void sdlMixCallback(void* udata, uint8_t* stream, int len);
 public:
 	AudioManager();
 
@@ -49,6 +78,8 @@ public:
 	void muteAll();
 	void unmuteAll();
 	void removeStream(AudioStream* s);
+	/* Mixes all the playing streams into frames of interleaved output samples */
+	void mix(int16_t* dest, uint32_t frames);
 	~AudioManager();
 };
 
@@ -60,16 +91,40 @@ private:
 	AudioManager* manager;
 	AudioDecoder *decoder;
 	bool hasStarted;
-	int curvolume;
-	int unmutevolume;
-	uint32_t playedtime;
-	struct timeval starttime;
-	int mixer_channel;
+	volatile bool paused;
+	volatile bool muted;
+	float volume;
+	float pan;
+	//Samples copied from the decoder and not resampled yet
+	int16_t source[4096];
+	uint32_t sourcePos;
+	uint32_t sourceFrames;
+	//Last four stereo source frames, the output is interpolated between the middle ones
+	float history[4][2];
+	//Position of the next output frame between history[1] and history[2]
+	double phase;
+	//Source frames consumed by the mixer
+	uint64_t consumedFrames;
+	//consumedFrames before the last two mixes and after the last one, and when the last one was requested
+	uint64_t prevMixStartFrames;
+	uint64_t mixStartFrames;
+	uint64_t mixEndFrames;
+	uint64_t mixTime;
+	//Resampled stereo frames of the current mix
+	std::vector<float> resampled;
+	bool nextSourceFrame();
+	uint32_t resample(float* dest, uint32_t frames, uint32_t outputRate);
+	/* Called by the mixer with streamMutex held */
+	void mixInto(float* dest, uint32_t frames, uint32_t outputRate);
 public:
 	bool init();
-	AudioStream(AudioManager* _manager):manager(_manager),decoder(NULL),hasStarted(false) { }
+	AudioStream(AudioManager* _manager);
 
 	void SetPause(bool pause_on);
+	/*
+	 * Milliseconds of audio heard since the stream was created, interpolated
+	 * from the last mix and the output latency
+	 */
 	uint32_t getPlayedTime();
 	bool ispaused();
 	void mute();
@@ -77,6 +132,8 @@ public:
 	void pause() { SetPause(true); }
 	void resume() { SetPause(false); }
 	void setVolume(double volume);
+	/* -1 is full left, 1 full right */
+	void setPan(double pan);
 	inline AudioDecoder *getDecoder() const { return decoder; }
 	~AudioStream();
 };
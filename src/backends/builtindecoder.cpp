@@ -25,7 +25,7 @@
 using namespace lightspark;
 
 BuiltinStreamDecoder::BuiltinStreamDecoder(std::istream& _s, NetStream* _ns):
-	stream(_s),prevSize(0),decodedAudioBytes(0),decodedVideoFrames(0),decodedTime(0),frameRate(0.0),netstream(_ns)
+	stream(_s),prevSize(0),decodedAudioBytes(0),decodedVideoFrames(0),decodedTime(0),frameRate(0.0),keyframes(0),netstream(_ns)
 {
 	STREAM_TYPE t=classifyStream(stream);
 	if(t==FLV_STREAM)
@@ -33,6 +33,7 @@ BuiltinStreamDecoder::BuiltinStreamDecoder(std::istream& _s, NetStream* _ns):
 		FLV_HEADER h(stream);
 		valid=h.isValid();
 		hasvideo=h.hasVideo();
+		keyframes=FLVKeyframeIndex(h.skipAmount());
 	}
 	else
 		valid=false;
@@ -54,6 +55,7 @@ BuiltinStreamDecoder::STREAM_TYPE BuiltinStreamDecoder::classifyStream(std::istr
 
 bool BuiltinStreamDecoder::decodeNextFrame()
 {
+	uint32_t offset=stream.tellg();
 	UI32_FLV PreviousTagSize;
 	stream >> PreviousTagSize;
 	// It seems that Adobe simply ignores invalid values for PreviousTagSize
@@ -68,6 +70,7 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 		{
 			AudioDataTag tag(stream);
 			prevSize=tag.getTotalLen();
+			keyframes.addTag(offset, offset+4+prevSize, false, 0);
 			if (tag.packetLen == 0)
 				return false;
 
@@ -122,6 +125,7 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 		{
 			VideoDataTag tag(stream);
 			prevSize=tag.getTotalLen();
+			keyframes.addTag(offset, offset+4+prevSize, tag.frameType==1 && !tag.isHeader(), tag.getTimestamp());
 			//If the framerate is known give the right timing, otherwise use decodedTime from audio
 			uint32_t frameTime=(frameRate!=0.0)?(decodedVideoFrames*1000/frameRate):decodedTime;
 
@@ -176,6 +180,9 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 		{
 			ScriptDataTag tag(stream);
 			prevSize=tag.getTotalLen();
+			keyframes.addTag(offset, offset+4+prevSize, false, 0);
+			if(tag.methodName=="onMetaData")
+				keyframes.addFromMetadata(tag.dataobjectlist);
 			netstream->sendClientNotification(tag.methodName,tag.dataobjectlist);
 			break;
 		}
@@ -185,3 +192,30 @@ bool BuiltinStreamDecoder::decodeNextFrame()
 	}
 	return true;
 }
+
+bool BuiltinStreamDecoder::seek(uint32_t time, uint32_t available, uint32_t& keyTime)
+{
+	uint32_t current=stream.tellg();
+	//Without metadata the index only knows the tags decoded so far, look further ahead
+	keyframes.scan(stream, available, time);
+	uint32_t offset;
+	if(!keyframes.find(time, available, keyTime, offset))
+	{
+		//Keep on decoding from where we were
+		stream.clear();
+		stream.seekg(current);
+		return false;
+	}
+	stream.clear();
+	stream.seekg(offset);
+	if(!stream)
+		return false;
+	prevSize=0;
+	//Restart the timing from the keyframe
+	decodedTime=keyTime;
+	if(frameRate!=0.0)
+		decodedVideoFrames=keyTime*frameRate/1000;
+	if(audioDecoder && audioDecoder->getBytesPerMSec())
+		decodedAudioBytes=keyTime*audioDecoder->getBytesPerMSec();
+	return true;
+}
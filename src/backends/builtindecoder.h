@@ -39,12 +39,14 @@ private:
 	uint32_t decodedTime;
 	double frameRate;
 	ScriptDataTag metadataTag;
+	FLVKeyframeIndex keyframes;
 	enum STREAM_TYPE { FLV_STREAM=0, UNKOWN_STREAM=1 };
 	STREAM_TYPE classifyStream(std::istream& s);
 	NetStream* netstream;
 public:
 	BuiltinStreamDecoder(std::istream& _s, NetStream* _ns);
 	bool decodeNextFrame();
+	bool seek(uint32_t time, uint32_t available, uint32_t& keyTime);
 };
 
 };
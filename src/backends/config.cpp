@@ -84,7 +84,9 @@ Config::Config():
 	//DEFAULT SETTINGS
 	defaultCacheDirectory((string) g_get_user_cache_dir() + "/lightspark"),
 	cacheDirectory(defaultCacheDirectory),cachePrefix("cache"),
-	renderingEnabled(true)
+	renderingEnabled(true),gpuVectorRendering(false),videoDecodingThreads(0),
+	audioOutput("sdl"),audioOutputFile("lightspark-audio.raw"),parsingReadAhead(1024*1024),
+	profilerInterval(1000),memoryReportSignal(false),memoryReportInterval(10),memoryReportTop(20)
 {
 #ifdef _WIN32
 	const char* exePath = getExectuablePath();
@@ -189,6 +191,33 @@ void Config::handleEntry()
 	//Rendering
 	if(group == "rendering" && key == "enabled")
 		renderingEnabled = atoi(value.c_str());
+	else if(group == "rendering" && key == "vector")
+		gpuVectorRendering = (value == "gpu");
+	//Video
+	else if(group == "video" && key == "threads")
+		videoDecodingThreads = max(0, atoi(value.c_str()));
+	//Audio
+	else if(group == "audio" && key == "output")
+		audioOutput = value;
+	else if(group == "audio" && key == "file")
+		audioOutputFile = value;
+	//Parsing
+	else if(group == "parsing" && key == "readahead")
+		parsingReadAhead = max(0, atoi(value.c_str()))*1024;
+	//Profiler
+	else if(group == "profiler" && key == "output")
+		profilerOutput = value;
+	else if(group == "profiler" && key == "interval")
+		profilerInterval = max(100, atoi(value.c_str()));
+	//Memory usage report
+	else if(group == "memory" && key == "report")
+		memoryReport = value;
+	else if(group == "memory" && key == "signal")
+		memoryReportSignal = atoi(value.c_str());
+	else if(group == "memory" && key == "interval")
+		memoryReportInterval = max(1, atoi(value.c_str()));
+	else if(group == "memory" && key == "top")
+		memoryReportTop = max(1, atoi(value.c_str()));
 	//Cache directory
 	else if(group == "cache" && key == "directory")
 		cacheDirectory = value;
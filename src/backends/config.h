@@ -48,6 +48,28 @@ namespace lightspark
 
 		//Specifies if rendering should be done
 		bool renderingEnabled;
+		//Specifies if vector shapes are tessellated and drawn by the GPU instead of cairo
+		bool gpuVectorRendering;
+		//Specifies how many threads decode each video, 0 means one per core
+		int videoDecodingThreads;
+		//Specifies where the audio mix goes: "sdl", "null" or "file"
+		std::string audioOutput;
+		//Specifies the file written by the "file" audio output
+		std::string audioOutputFile;
+		//Specifies how many uncompressed bytes of a SWF are prepared ahead of the parser, 0 disables it
+		unsigned int parsingReadAhead;
+		//Specifies where the sampling profiler writes its output, empty disables it
+		std::string profilerOutput;
+		//Specifies the microseconds of CPU time between two samples
+		unsigned int profilerInterval;
+		//Specifies where the memory usage report is written periodically, empty disables it
+		std::string memoryReport;
+		//Specifies if a memory usage report is written when the player gets SIGUSR1
+		bool memoryReportSignal;
+		//Specifies the seconds between two memory usage reports
+		unsigned int memoryReportInterval;
+		//Specifies how many accounts are listed in the memory usage reports
+		unsigned int memoryReportTop;
 		Config();
 		~Config();
 	public:
@@ -59,6 +81,20 @@ namespace lightspark
 		const std::string& getGnashPath() const { return gnashPath; }
 
 		bool isRenderingEnabled() const { return renderingEnabled; }
+		bool isGPUVectorRenderingEnabled() const { return gpuVectorRendering; }
+		/* Used by lightspark-bench to check the tessellated path without a GPU */
+		void setGPUVectorRendering(bool enabled) { gpuVectorRendering=enabled; }
+		int getVideoDecodingThreads() const { return videoDecodingThreads; }
+		const std::string& getAudioOutput() const { return audioOutput; }
+		const std::string& getAudioOutputFile() const { return audioOutputFile; }
+		unsigned int getParsingReadAhead() const { return parsingReadAhead; }
+		const std::string& getProfilerOutput() const { return profilerOutput; }
+		unsigned int getProfilerInterval() const { return profilerInterval; }
+		const std::string& getMemoryReport() const { return memoryReport; }
+		bool isMemoryReportSignalEnabled() const { return memoryReportSignal; }
+		bool isMemoryReportEnabled() const { return !memoryReport.empty() || memoryReportSignal; }
+		unsigned int getMemoryReportInterval() const { return memoryReportInterval; }
+		unsigned int getMemoryReportTop() const { return memoryReportTop; }
 	};
 }
 
@@ -25,7 +25,6 @@
 #include "platforms/fastpaths.h"
 #include "swf.h"
 #include "backends/rendering.h"
-#include "SDL2/SDL_mixer.h"
 
 #if LIBAVUTIL_VERSION_MAJOR < 51
 #define AVMEDIA_TYPE_VIDEO CODEC_TYPE_VIDEO
@@ -114,8 +113,18 @@ bool FFMpegVideoDecoder::fillDataAndCheckValidity()
 	return true;
 }
 
+void FFMpegVideoDecoder::setupThreads(AVCodecContext* c)
+{
+	//0 lets libavcodec use a thread per core
+	c->thread_count=Config::getConfig()->getVideoDecodingThreads();
+#ifdef FF_THREAD_FRAME
+	//Frame threading adds a frame of latency per thread, which buffering hides
+	c->thread_type=FF_THREAD_FRAME|FF_THREAD_SLICE;
+#endif
+}
+
 FFMpegVideoDecoder::FFMpegVideoDecoder(LS_VIDEO_CODEC codecId, uint8_t* initdata, uint32_t datalen, double frameRateHint):
-	ownedContext(true),curBuffer(0),codecContext(NULL),curBufferOffset(0)
+	ownedContext(true),curBuffer(0),codecContext(NULL),curBufferOffset(0),lastPacketTime(0)
 {
 	//The tag is the header, initialize decoding
 	switchCodec(codecId, initdata, datalen, frameRateHint);
@@ -170,6 +179,7 @@ void FFMpegVideoDecoder::switchCodec(LS_VIDEO_CODEC codecId, uint8_t *initdata,
 		codecContext->extradata=initdata;
 		codecContext->extradata_size=datalen;
 	}
+	setupThreads(codecContext);
 #ifdef HAVE_AVCODEC_OPEN2
 	if(avcodec_open2(codecContext, codec, NULL)<0)
 #else
@@ -184,7 +194,7 @@ void FFMpegVideoDecoder::switchCodec(LS_VIDEO_CODEC codecId, uint8_t *initdata,
 }
 #if LIBAVFORMAT_VERSION_MAJOR > 56
 FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecID codecID, double frameRateHint):
-	ownedContext(true),curBuffer(0),codecContext(NULL),curBufferOffset(0)
+	ownedContext(true),curBuffer(0),codecContext(NULL),curBufferOffset(0),lastPacketTime(0)
 {
 	status=INIT;
 #ifdef HAVE_AVCODEC_ALLOC_CONTEXT3
@@ -208,6 +218,7 @@ FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecID codecID, double frameRateHint):
 			return;
 	}
 	AVCodec* codec=avcodec_find_decoder(codecID);
+	setupThreads(codecContext);
 #ifdef HAVE_AVCODEC_OPEN2
 	if(avcodec_open2(codecContext, codec, NULL)<0)
 #else
@@ -224,7 +235,7 @@ FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecID codecID, double frameRateHint):
 }
 #else
 FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecContext* _c, double frameRateHint):
-	ownedContext(false),curBuffer(0),codecContext(_c),curBufferOffset(0)
+	ownedContext(false),curBuffer(0),codecContext(_c),curBufferOffset(0),lastPacketTime(0)
 {
 	status=INIT;
 	//The tag is the header, initialize decoding
@@ -243,6 +254,7 @@ FFMpegVideoDecoder::FFMpegVideoDecoder(AVCodecContext* _c, double frameRateHint)
 			return;
 	}
 	AVCodec* codec=avcodec_find_decoder(codecContext->codec_id);
+	setupThreads(codecContext);
 #ifdef HAVE_AVCODEC_OPEN2
 	if(avcodec_open2(codecContext, codec, NULL)<0)
 #else
@@ -291,7 +303,7 @@ void FFMpegVideoDecoder::skipUntil(uint32_t time)
 			break;
 		if(buffers.front().time>=time)
 			break;
-		discardFrame();
+		popFrame(true);
 	}
 }
 void FFMpegVideoDecoder::skipAll()
@@ -301,8 +313,14 @@ void FFMpegVideoDecoder::skipAll()
 }
 
 bool FFMpegVideoDecoder::discardFrame()
+{
+	return popFrame(false);
+}
+
+bool FFMpegVideoDecoder::popFrame(bool countDropped)
 {
 	Locker locker(mutex);
+	bool dropped=countDropped && !buffers.isEmpty() && !buffers.front().presented;
 	//We don't want ot block if no frame is available
 	bool ret=buffers.nonBlockingPopFront();
 	if(flushing && buffers.isEmpty()) //End of our work
@@ -310,98 +328,57 @@ bool FFMpegVideoDecoder::discardFrame()
 		status=FLUSHED;
 		flushed.signal();
 	}
-	framesdropped++;
+	if(ret && dropped)
+		framesdropped++;
 
 	return ret;
 }
 
-bool FFMpegVideoDecoder::decodeData(uint8_t* data, uint32_t datalen, uint32_t time)
-{
-	if(datalen==0)
-		return false;
 #if defined HAVE_AVCODEC_SEND_PACKET && defined HAVE_AVCODEC_RECEIVE_FRAME
-	AVPacket pkt;
-	av_init_packet(&pkt);
-	pkt.data=data;
-	pkt.size=datalen;
-	int ret = avcodec_send_packet(codecContext, &pkt);
-	while (ret == 0)
+bool FFMpegVideoDecoder::receiveFrames(uint32_t time)
+{
+	while(1)
 	{
-		ret = avcodec_receive_frame(codecContext,frameIn);
-		if (ret != 0)
+		int ret=avcodec_receive_frame(codecContext,frameIn);
+		if(ret==AVERROR(EAGAIN) || ret==AVERROR_EOF)
+			return true;
+		if(ret!=0)
 		{
-			if (ret != AVERROR(EAGAIN))
-			{
-				LOG(LOG_INFO,"not decoded:"<<ret);
-				return false;
-			}
-		}
-		else
-		{
-			if(status==INIT && fillDataAndCheckValidity())
-				status=VALID;
-	
-			assert(frameIn->pts==(int64_t)AV_NOPTS_VALUE || frameIn->pts==0);
-	
-			copyFrameToBuffers(frameIn, time);
+			LOG(LOG_INFO,"not decoded:"<<ret);
+			return false;
 		}
+		if(status==INIT && fillDataAndCheckValidity())
+			status=VALID;
+		//With frame threading the frame may come from an earlier packet
+		copyFrameToBuffers(frameIn, (frameIn->pts==(int64_t)AV_NOPTS_VALUE)?time:frameIn->pts);
 	}
-#else
-	int frameOk=0;
-#if HAVE_AVCODEC_DECODE_VIDEO2
+}
+#endif
+
+bool FFMpegVideoDecoder::decodeData(uint8_t* data, uint32_t datalen, uint32_t time)
+{
+	if(datalen==0)
+		return false;
 	AVPacket pkt;
 	av_init_packet(&pkt);
 	pkt.data=data;
 	pkt.size=datalen;
-	int ret=avcodec_decode_video2(codecContext, frameIn, &frameOk, &pkt);
-#else
-	int ret=avcodec_decode_video(codecContext, frameIn, &frameOk, data, datalen);
-#endif
-	if (ret < 0)
-	{
-		LOG(LOG_INFO,"not decoded:"<<ret<<" "<< frameOk);
-		return false;
-	}
-	if(frameOk)
-	{
-		//assert(codecContext->pix_fmt==PIX_FMT_YUV420P);
-
-		if(status==INIT && fillDataAndCheckValidity())
-			status=VALID;
-
-		assert(frameIn->pts==(int64_t)AV_NOPTS_VALUE || frameIn->pts==0);
-
-		copyFrameToBuffers(frameIn, time);
-	}
-#endif
-	return true;
+	return decodePacket(&pkt, time);
 }
 
 bool FFMpegVideoDecoder::decodePacket(AVPacket* pkt, uint32_t time)
 {
+	//The time is carried by the packet, the decoder returns it with the frame
+	pkt->pts=time;
+	lastPacketTime=time;
 #if defined HAVE_AVCODEC_SEND_PACKET && defined HAVE_AVCODEC_RECEIVE_FRAME
-	int ret = avcodec_send_packet(codecContext, pkt);
-	while (ret == 0)
+	int ret=avcodec_send_packet(codecContext, pkt);
+	if(ret<0)
 	{
-		ret = avcodec_receive_frame(codecContext,frameIn);
-		if (ret != 0)
-		{
-			if (ret != AVERROR(EAGAIN))
-			{
-				LOG(LOG_INFO,"not decoded:"<<ret);
-				return false;
-			}
-		}
-		else
-		{
-			if(status==INIT && fillDataAndCheckValidity())
-				status=VALID;
-	
-			assert(frameIn->pts==(int64_t)AV_NOPTS_VALUE || frameIn->pts==0);
-	
-			copyFrameToBuffers(frameIn, time);
-		}
+		LOG(LOG_INFO,"not decoded:"<<ret);
+		return false;
 	}
+	return receiveFrames(time);
 #else
 	int frameOk=0;
 
@@ -424,12 +401,53 @@ bool FFMpegVideoDecoder::decodePacket(AVPacket* pkt, uint32_t time)
 		if(status==INIT && fillDataAndCheckValidity())
 			status=VALID;
 
-		assert(frameIn->pts==(int64_t)AV_NOPTS_VALUE || frameIn->pts==0);
-
+#if HAVE_AVCODEC_DECODE_VIDEO2
+		//With frame threading the frame may come from an earlier packet
+		copyFrameToBuffers(frameIn, (frameIn->pkt_pts==(int64_t)AV_NOPTS_VALUE)?time:frameIn->pkt_pts);
+#else
 		copyFrameToBuffers(frameIn, time);
-	}
 #endif
+	}
 	return true;
+#endif
+}
+
+void FFMpegVideoDecoder::flushDelayedFrames()
+{
+	if(status!=VALID)
+		return;
+#if defined HAVE_AVCODEC_SEND_PACKET && defined HAVE_AVCODEC_RECEIVE_FRAME
+	if(avcodec_send_packet(codecContext, NULL)==0)
+		receiveFrames(lastPacketTime);
+#elif HAVE_AVCODEC_DECODE_VIDEO2
+	//Empty packets make the decoder output the frames it is still holding
+	AVPacket pkt;
+	av_init_packet(&pkt);
+	pkt.data=NULL;
+	pkt.size=0;
+	int frameOk=1;
+	while(frameOk)
+	{
+		frameOk=0;
+		if(avcodec_decode_video2(codecContext, frameIn, &frameOk, &pkt)<0)
+			break;
+		if(frameOk)
+			copyFrameToBuffers(frameIn, (frameIn->pkt_pts==(int64_t)AV_NOPTS_VALUE)?lastPacketTime:frameIn->pkt_pts);
+	}
+#endif
+	avcodec_flush_buffers(codecContext);
+}
+
+void FFMpegVideoDecoder::discardDelayedFrames()
+{
+	if(status==VALID)
+		avcodec_flush_buffers(codecContext);
+}
+
+uint32_t FFMpegVideoDecoder::getQueuedBytes() const
+{
+	//Y plane and the two quarter size chroma planes
+	return buffers.len()*(frameWidth*frameHeight*3/2);
 }
 
 void FFMpegVideoDecoder::copyFrameToBuffers(const AVFrame* frameIn, uint32_t time)
@@ -450,12 +468,15 @@ void FFMpegVideoDecoder::copyFrameToBuffers(const AVFrame* frameIn, uint32_t tim
 		offset[2]+=frameWidth/2;
 	}
 	curTail.time=time;
+	curTail.presented=false;
 
 	buffers.commitLast();
 }
 
 void FFMpegVideoDecoder::upload(uint8_t* data, uint32_t w, uint32_t h) const
 {
+	//The front frame must not be popped while it is converted
+	Locker l(mutex);
 	if(buffers.isEmpty())
 		return;
 	//Verify that the size are right
@@ -463,6 +484,7 @@ void FFMpegVideoDecoder::upload(uint8_t* data, uint32_t w, uint32_t h) const
 	//At least a frame is available
 	const YUVBuffer& cur=buffers.front();
 	fastYUV420ChannelsToYUV0Buffer(cur.ch[0],cur.ch[1],cur.ch[2],data,frameWidth,frameHeight);
+	cur.presented=true;
 }
 
 void FFMpegVideoDecoder::YUVBufferGenerator::init(YUVBuffer& buf) const
@@ -740,7 +762,12 @@ bool FFMpegAudioDecoder::fillDataAndCheckValidity()
 	if(codecContext->channels!=0)
 	{
 		LOG(LOG_INFO, _("AUDIO DEC: Audio channels ") << codecContext->channels);
+#if defined HAVE_AVCODEC_DECODE_AUDIO4 || (defined HAVE_AVCODEC_SEND_PACKET && defined HAVE_AVCODEC_RECEIVE_FRAME)
+		//Frames are converted to interleaved stereo
+		channelCount=2;
+#else
 		channelCount=codecContext->channels;
+#endif
 	}
 	else
 		return false;
@@ -967,14 +994,15 @@ uint32_t FFMpegAudioDecoder::decodePacket(AVPacket* pkt, uint32_t time)
 #if defined HAVE_AVCODEC_DECODE_AUDIO4 || (defined HAVE_AVCODEC_SEND_PACKET && defined HAVE_AVCODEC_RECEIVE_FRAME)
 int FFMpegAudioDecoder::resampleFrameToS16(FrameSamples& curTail)
 {
-	int sample_rate = MIX_DEFAULT_FREQUENCY;
 	unsigned int channel_layout = AV_CH_LAYOUT_STEREO;
 #ifdef HAVE_AV_FRAME_GET_SAMPLE_RATE
  	int framesamplerate = av_frame_get_sample_rate(frameIn);
 #else
 	int framesamplerate = frameIn->sample_rate;
 #endif
-	if(frameIn->format == AV_SAMPLE_FMT_S16 && sample_rate == framesamplerate && channel_layout == frameIn->channel_layout)
+	//Only the sample format and the channels are converted, the audio mixer converts the rate
+	int sample_rate = framesamplerate;
+	if(frameIn->format == AV_SAMPLE_FMT_S16 && channel_layout == frameIn->channel_layout)
 	{
 		//This is suboptimal but equivalent to what libavcodec
 		//does for the compatibility version of avcodec_decode_audio3
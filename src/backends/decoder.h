@@ -101,6 +101,15 @@ public:
 	virtual bool discardFrame()=0;
 	virtual void skipUntil(uint32_t time)=0;
 	virtual void skipAll()=0;
+	/*
+	   Outputs the frames still held by the decoder at the end of the stream,
+	   must be called from the decoding thread
+	*/
+	virtual void flushDelayedFrames() {}
+	/* Drops the frames still held by the decoder, must be called from the decoding thread */
+	virtual void discardDelayedFrames() {}
+	/* Bytes of the decoded frames waiting to be presented */
+	virtual uint32_t getQueuedBytes() const { return 0; }
 	uint32_t getWidth()
 	{
 		return frameWidth;
@@ -111,6 +120,7 @@ public:
 	}
 	double frameRate;
 	uint32_t framesdecoded;
+	//Decoded frames that were skipped without being presented
 	uint32_t framesdropped;
 	/*
 		Useful to avoid destruction of the object while a pending upload is waiting
@@ -165,7 +175,9 @@ private:
 	public:
 		uint8_t* ch[3];
 		uint32_t time;
-		YUVBuffer():time(0){ch[0]=NULL;ch[1]=NULL;ch[2]=NULL;}
+		//Set by the render thread when the frame is uploaded, protected by mutex
+		mutable bool presented;
+		YUVBuffer():time(0),presented(false){ch[0]=NULL;ch[1]=NULL;ch[2]=NULL;}
 		~YUVBuffer()
 		{
 			if(ch[0])
@@ -188,12 +200,23 @@ private:
 	uint32_t curBuffer;
 	AVCodecContext* codecContext;
 	BlockingCircularQueue<YUVBuffer,80> buffers;
-	Mutex mutex;
+	//Protects popping the frames and their presented flag
+	mutable Mutex mutex;
 	AVFrame* frameIn;
 	void copyFrameToBuffers(const AVFrame* frameIn, uint32_t time);
 	void setSize(uint32_t w, uint32_t h);
 	bool fillDataAndCheckValidity();
+	/* Configures the frame and slice threads of libavcodec, must be called before opening the codec */
+	static void setupThreads(AVCodecContext* c);
+	/*
+	 * Gets all the frames the decoder can output, the time of each frame travels in its pts.
+	 * time is used for the frames without one
+	 */
+	bool receiveFrames(uint32_t time);
+	bool popFrame(bool countDropped);
 	uint32_t curBufferOffset;
+	//Time of the last packet, used for the delayed frames without a time
+	uint32_t lastPacketTime;
 public:
 	FFMpegVideoDecoder(LS_VIDEO_CODEC codec, uint8_t* initdata, uint32_t datalen, double frameRateHint);
 	/*
@@ -214,6 +237,9 @@ public:
 	bool discardFrame();
 	void skipUntil(uint32_t time);
 	void skipAll();
+	void flushDelayedFrames();
+	void discardDelayedFrames();
+	uint32_t getQueuedBytes() const;
 	void setFlushing()
 	{
 		flushing=true;
@@ -351,6 +377,11 @@ public:
 	StreamDecoder():audioDecoder(NULL),videoDecoder(NULL),valid(false),hasvideo(false){}
 	virtual ~StreamDecoder();
 	virtual bool decodeNextFrame() = 0;
+	/*
+	   Moves the stream to the last keyframe not after time, without going past the
+	   available bytes. Returns false if seeking is not supported or no keyframe is known
+	*/
+	virtual bool seek(uint32_t time, uint32_t available, uint32_t& keyTime) { return false; }
 	bool isValid() const { return valid; }
 	AudioDecoder* audioDecoder;
 	VideoDecoder* videoDecoder;
@@ -210,3 +210,518 @@ void ShapesBuilder::outputTokens(const std::list<FILLSTYLE>& styles, tokensVecto
 	}
 }
 
+
+void TokenHitTester::EdgeBands::build(const std::vector<Edge>& edges, bool padWithWidth)
+{
+	bands.clear();
+	if(edges.empty())
+		return;
+	float ymaxEdges=-numeric_limits<float>::infinity();
+	ymin=numeric_limits<float>::infinity();
+	for(uint32_t i=0;i<edges.size();i++)
+	{
+		float pad=padWithWidth?edges[i].halfWidth:0;
+		ymin=min(ymin,min(edges[i].y0,edges[i].y1)-pad);
+		ymaxEdges=max(ymaxEdges,max(edges[i].y0,edges[i].y1)+pad);
+	}
+	uint32_t count=min<uint32_t>(64,edges.size()/4+1);
+	bandHeight=(ymaxEdges-ymin)/count;
+	if(bandHeight<=0)
+	{
+		count=1;
+		bandHeight=1;
+	}
+	bands.resize(count);
+	for(uint32_t i=0;i<edges.size();i++)
+	{
+		float pad=padWithWidth?edges[i].halfWidth:0;
+		int32_t first=(min(edges[i].y0,edges[i].y1)-pad-ymin)/bandHeight;
+		int32_t last=(max(edges[i].y0,edges[i].y1)+pad-ymin)/bandHeight;
+		first=max(first,0);
+		last=min<int32_t>(last,count-1);
+		for(int32_t j=first;j<=last;j++)
+			bands[j].push_back(i);
+	}
+}
+
+const std::vector<uint32_t>* TokenHitTester::EdgeBands::find(float y) const
+{
+	if(bands.empty() || y<ymin)
+		return NULL;
+	uint32_t index=(y-ymin)/bandHeight;
+	if(index>=bands.size())
+		index=bands.size()-1;
+	return &bands[index];
+}
+
+void TokenFlattener::flattenQuadratic(std::vector<Vector2f>& points, const Vector2f& p0, const Vector2f& p1,
+				      const Vector2f& p2, double tolerance)
+{
+	//The distance from the chords is at most |p0-2p1+p2|/(4n^2)
+	double ddx=p0.x-2*p1.x+p2.x;
+	double ddy=p0.y-2*p1.y+p2.y;
+	double dd=sqrt(ddx*ddx+ddy*ddy);
+	uint32_t n=ceil(sqrt(dd/(4*tolerance)));
+	n=max<uint32_t>(1,min<uint32_t>(n,256));
+	for(uint32_t i=1;i<=n;i++)
+	{
+		double t=double(i)/n;
+		double a=(1-t)*(1-t);
+		double b=2*(1-t)*t;
+		double c=t*t;
+		points.push_back(Vector2f(a*p0.x+b*p1.x+c*p2.x, a*p0.y+b*p1.y+c*p2.y));
+	}
+}
+
+void TokenFlattener::flattenCubic(std::vector<Vector2f>& points, const Vector2f& p0, const Vector2f& p1,
+				  const Vector2f& p2, const Vector2f& p3, double tolerance)
+{
+	//The distance from the chords is at most 3*max(|p0-2p1+p2|,|p1-2p2+p3|)/(4n^2)
+	double ddx1=p0.x-2*p1.x+p2.x;
+	double ddy1=p0.y-2*p1.y+p2.y;
+	double ddx2=p1.x-2*p2.x+p3.x;
+	double ddy2=p1.y-2*p2.y+p3.y;
+	double dd=sqrt(max(ddx1*ddx1+ddy1*ddy1, ddx2*ddx2+ddy2*ddy2));
+	uint32_t n=ceil(sqrt(3*dd/(4*tolerance)));
+	n=max<uint32_t>(1,min<uint32_t>(n,256));
+	for(uint32_t i=1;i<=n;i++)
+	{
+		double t=double(i)/n;
+		double a=(1-t)*(1-t)*(1-t);
+		double b=3*(1-t)*(1-t)*t;
+		double c=3*(1-t)*t*t;
+		double d=t*t*t;
+		points.push_back(Vector2f(a*p0.x+b*p1.x+c*p2.x+d*p3.x, a*p0.y+b*p1.y+c*p2.y+d*p3.y));
+	}
+}
+
+void TokenHitTester::extendBounds(float x, float y, float pad)
+{
+	xmin=min(xmin,x-pad);
+	xmax=max(xmax,x+pad);
+	ymin=min(ymin,y-pad);
+	ymax=max(ymax,y+pad);
+}
+
+void TokenFlattener::flatten(const tokensVector& tokens, double tolerance)
+{
+	fillEdges.clear();
+	strokeEdges.clear();
+
+	std::vector<Edge> pendingFill;
+	std::vector<Edge> pendingStroke;
+	PathState fillPath;
+	PathState strokePath;
+	bool fillActive=false;
+	bool strokeActive=false;
+	float strokeHalfWidth=0;
+	uint32_t fillIndex=0;
+	uint32_t fillStyle=0;
+	uint32_t strokeStyle=0;
+	std::vector<Vector2f> points;
+
+	auto addEdge=[](std::vector<Edge>& edges, const Vector2f& a, const Vector2f& b)
+	{
+		Edge e;
+		e.x0=a.x;
+		e.y0=a.y;
+		e.x1=b.x;
+		e.y1=b.y;
+		e.fill=0;
+		e.style=0;
+		e.halfWidth=0;
+		edges.push_back(e);
+	};
+	auto addPoints=[&addEdge,&points](PathState& path, std::vector<Edge>& edges)
+	{
+		for(uint32_t j=0;j<points.size();j++)
+		{
+			addEdge(edges, path.current, points[j]);
+			path.current=points[j];
+		}
+	};
+	//Fills implicitly close all the subpaths
+	auto closeFill=[&]()
+	{
+		if(fillPath.hasPoint && fillPath.current!=fillPath.start)
+			addEdge(pendingFill, fillPath.current, fillPath.start);
+		fillPath.current=fillPath.start;
+	};
+	auto flushFill=[&]()
+	{
+		closeFill();
+		if(fillActive && !pendingFill.empty())
+		{
+			for(uint32_t j=0;j<pendingFill.size();j++)
+			{
+				pendingFill[j].fill=fillIndex;
+				pendingFill[j].style=fillStyle;
+				fillEdges.push_back(pendingFill[j]);
+			}
+			fillIndex++;
+		}
+		pendingFill.clear();
+		fillPath.hasPoint=false;
+	};
+	auto flushStroke=[&]()
+	{
+		if(strokeActive)
+		{
+			for(uint32_t j=0;j<pendingStroke.size();j++)
+			{
+				pendingStroke[j].halfWidth=strokeHalfWidth;
+				pendingStroke[j].style=strokeStyle;
+				strokeEdges.push_back(pendingStroke[j]);
+			}
+		}
+		pendingStroke.clear();
+		strokePath.hasPoint=false;
+	};
+
+	for(uint32_t i=0;i<tokens.size();i++)
+	{
+		const GeomToken& t=tokens[i];
+		switch(t.type)
+		{
+			case MOVE:
+				closeFill();
+				fillPath.start=fillPath.current=t.p1;
+				fillPath.hasPoint=true;
+				strokePath.start=strokePath.current=t.p1;
+				strokePath.hasPoint=true;
+				break;
+			case STRAIGHT:
+			case CURVE_QUADRATIC:
+			case CURVE_CUBIC:
+			{
+				PathState* paths[2]={&fillPath, &strokePath};
+				std::vector<Edge>* pending[2]={&pendingFill, &pendingStroke};
+				for(uint32_t j=0;j<2;j++)
+				{
+					PathState& path=*paths[j];
+					//Without a current point the segment starts from its first point
+					if(!path.hasPoint)
+					{
+						path.start=path.current=t.p1;
+						path.hasPoint=true;
+					}
+					points.clear();
+					if(t.type==STRAIGHT)
+						points.push_back(t.p1);
+					else if(t.type==CURVE_QUADRATIC)
+						flattenQuadratic(points, path.current, t.p1, t.p2, tolerance);
+					else
+						flattenCubic(points, path.current, t.p1, t.p2, t.p3, tolerance);
+					addPoints(path, *pending[j]);
+				}
+				break;
+			}
+			case SET_FILL:
+				flushFill();
+				fillActive=true;
+				fillStyle=i;
+				break;
+			case CLEAR_FILL:
+				flushFill();
+				fillActive=false;
+				break;
+			case FILL_KEEP_SOURCE:
+			case FILL_TRANSFORM_TEXTURE:
+				flushFill();
+				break;
+			case SET_STROKE:
+				flushStroke();
+				strokeActive=true;
+				strokeStyle=i;
+				//Width 0 is an hairline, drawn 1 unit wide
+				strokeHalfWidth=(t.lineStyle.Width==0)?0.5:(t.lineStyle.Width/20.0)/2;
+				break;
+			case CLEAR_STROKE:
+				flushStroke();
+				strokeActive=false;
+				break;
+		}
+	}
+	flushFill();
+	flushStroke();
+}
+
+void TokenHitTester::build(const tokensVector& tokens, float _scaling)
+{
+	xmin=ymin=numeric_limits<float>::infinity();
+	xmax=ymax=-numeric_limits<float>::infinity();
+	tokenCount=tokens.size();
+	scaling=_scaling;
+	valid=true;
+	//Flatten curves to a quarter of pixel
+	outlines.flatten(tokens, (scaling>0)?0.25/scaling:0.25);
+
+	for(uint32_t i=0;i<outlines.fillEdges.size();i++)
+		extendBounds(outlines.fillEdges[i].x0, outlines.fillEdges[i].y0, 0);
+	for(uint32_t i=0;i<outlines.strokeEdges.size();i++)
+	{
+		const Edge& e=outlines.strokeEdges[i];
+		extendBounds(e.x0, e.y0, e.halfWidth);
+		extendBounds(e.x1, e.y1, e.halfWidth);
+	}
+
+	fillBands.build(outlines.fillEdges, false);
+	strokeBands.build(outlines.strokeEdges, true);
+}
+
+bool TokenHitTester::hitTest(number_t x, number_t y) const
+{
+	if(x<xmin || x>xmax || y<ymin || y>ymax)
+		return false;
+
+	const std::vector<uint32_t>* band=fillBands.find(y);
+	if(band)
+	{
+		//The edges are sorted by fill, each fill uses the even-odd rule
+		uint32_t currentFill=UINT32_MAX;
+		bool inside=false;
+		for(uint32_t i=0;i<band->size();i++)
+		{
+			const Edge& e=outlines.fillEdges[(*band)[i]];
+			if(e.fill!=currentFill)
+			{
+				if(inside)
+					return true;
+				currentFill=e.fill;
+			}
+			if((e.y0>y)!=(e.y1>y))
+			{
+				number_t xcross=e.x0+(y-e.y0)*(e.x1-e.x0)/(e.y1-e.y0);
+				if(x<xcross)
+					inside=!inside;
+			}
+		}
+		if(inside)
+			return true;
+	}
+
+	band=strokeBands.find(y);
+	if(band)
+	{
+		for(uint32_t i=0;i<band->size();i++)
+		{
+			const Edge& e=outlines.strokeEdges[(*band)[i]];
+			number_t dx=e.x1-e.x0;
+			number_t dy=e.y1-e.y0;
+			number_t len2=dx*dx+dy*dy;
+			number_t t=0;
+			if(len2>0)
+				t=dmax(0,dmin(1,((x-e.x0)*dx+(y-e.y0)*dy)/len2));
+			number_t px=e.x0+t*dx-x;
+			number_t py=e.y0+t*dy-y;
+			if(px*px+py*py<=e.halfWidth*e.halfWidth)
+				return true;
+		}
+	}
+	return false;
+}
+
+void TokenTessellator::addTriangle(float x0, float y0, float x1, float y1, float x2, float y2, const float* color)
+{
+	const float v[6]={x0,y0,x1,y1,x2,y2};
+	vertices.insert(vertices.end(), v, v+6);
+	for(uint32_t i=0;i<3;i++)
+		colors.insert(colors.end(), color, color+4);
+}
+
+bool TokenTessellator::tessellateFill(const std::vector<TokenFlattener::Edge>& edges, uint32_t first, uint32_t last, const float* color)
+{
+	//Edges going downwards, horizontal edges do not contribute to the even-odd rule
+	struct Span
+	{
+		double xt,yt,xb,yb;
+		double xAt(double y) const { return xt+(y-yt)*(xb-xt)/(yb-yt); }
+	};
+	std::vector<Span> spans;
+	std::vector<double> ys;
+	for(uint32_t i=first;i<last;i++)
+	{
+		const TokenFlattener::Edge& e=edges[i];
+		if(e.y0==e.y1)
+			continue;
+		Span s;
+		if(e.y0<e.y1)
+		{
+			s.xt=e.x0; s.yt=e.y0; s.xb=e.x1; s.yb=e.y1;
+		}
+		else
+		{
+			s.xt=e.x1; s.yt=e.y1; s.xb=e.x0; s.yb=e.y0;
+		}
+		spans.push_back(s);
+		ys.push_back(s.yt);
+		ys.push_back(s.yb);
+	}
+	if(spans.empty())
+		return true;
+	sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) { return a.yt<b.yt; });
+	sort(ys.begin(), ys.end());
+	ys.erase(unique(ys.begin(), ys.end()), ys.end());
+
+	//Sweep the bands between the vertices, splitting them where edges cross
+	std::vector<uint32_t> active;
+	std::vector<double> xTop(spans.size());
+	std::vector<double> xBottom(spans.size());
+	uint32_t nextSpan=0;
+	for(uint32_t b=0;b+1<ys.size();b++)
+	{
+		const double bandTop=ys[b];
+		const double bandBottom=ys[b+1];
+		uint32_t j=0;
+		for(uint32_t i=0;i<active.size();i++)
+		{
+			if(spans[active[i]].yb>bandTop)
+				active[j++]=active[i];
+		}
+		active.resize(j);
+		while(nextSpan<spans.size() && spans[nextSpan].yt<=bandTop)
+		{
+			if(spans[nextSpan].yb>bandTop)
+				active.push_back(nextSpan);
+			nextSpan++;
+		}
+
+		double y0=bandTop;
+		while(y0<bandBottom)
+		{
+			double y1=bandBottom;
+			for(uint32_t i=0;i<active.size();i++)
+			{
+				xTop[active[i]]=spans[active[i]].xAt(y0);
+				xBottom[active[i]]=spans[active[i]].xAt(y1);
+			}
+			sort(active.begin(), active.end(), [&](uint32_t a, uint32_t c)
+				{ return xTop[a]<xTop[c] || (xTop[a]==xTop[c] && xBottom[a]<xBottom[c]); });
+			//The first crossing is between two edges adjacent at the top of the band
+			for(uint32_t i=0;i+1<active.size();i++)
+			{
+				const uint32_t a=active[i];
+				const uint32_t c=active[i+1];
+				if(xBottom[a]<=xBottom[c])
+					continue;
+				double d=(xTop[c]-xTop[a])-(xBottom[c]-xBottom[a]);
+				double t=(d>0)?(xTop[c]-xTop[a])/d:0;
+				double y=y0+t*(y1-y0);
+				if(y>y0 && y<y1)
+					y1=y;
+			}
+			if(y1-y0<1e-6*(bandBottom-bandTop))
+				y1=bandBottom;
+			if(y1!=bandBottom)
+			{
+				for(uint32_t i=0;i<active.size();i++)
+					xBottom[active[i]]=spans[active[i]].xAt(y1);
+			}
+			for(uint32_t i=0;i+1<active.size();i+=2)
+			{
+				const uint32_t a=active[i];
+				const uint32_t c=active[i+1];
+				addTriangle(xTop[a], y0, xTop[c], y0, xBottom[c], y1, color);
+				addTriangle(xTop[a], y0, xBottom[c], y1, xBottom[a], y1, color);
+			}
+			y0=y1;
+			//Give up on pathological shapes, cairo will draw them
+			if(vertices.size()>MAX_VERTICES*2)
+				return false;
+		}
+	}
+	return true;
+}
+
+void TokenTessellator::tessellateStroke(const TokenFlattener::Edge& e, const float* color)
+{
+	double dx=e.x1-e.x0;
+	double dy=e.y1-e.y0;
+	double len=sqrt(dx*dx+dy*dy);
+	if(len==0)
+		return;
+	//Extending the segments by half of the width covers the joins
+	double ux=dx/len*e.halfWidth;
+	double uy=dy/len*e.halfWidth;
+	float ax=e.x0-ux, ay=e.y0-uy;
+	float bx=e.x1+ux, by=e.y1+uy;
+	float nx=-uy, ny=ux;
+	addTriangle(ax+nx, ay+ny, bx+nx, by+ny, bx-nx, by-ny, color);
+	addTriangle(ax+nx, ay+ny, bx-nx, by-ny, ax-nx, ay-ny, color);
+}
+
+bool TokenTessellator::build(const tokensVector& tokens, float _scaling, uint64_t hash, const std::vector<uint8_t>& content)
+{
+	invalidate();
+	tokensHash=hash;
+	tokensContent=content;
+	scaling=_scaling;
+	built=true;
+
+	auto solidColor=[](const FILLSTYLE& style, float* color)
+	{
+		if(style.FillStyleType!=SOLID_FILL)
+			return false;
+		const RGBA& c=style.Color;
+		//Premultiplied, like the textures
+		color[3]=c.af();
+		color[0]=c.rf()*color[3];
+		color[1]=c.gf()*color[3];
+		color[2]=c.bf()*color[3];
+		return true;
+	};
+
+	TokenFlattener outlines;
+	outlines.flatten(tokens, (scaling>0)?0.25/scaling:0.25);
+
+	float color[4];
+	const std::vector<TokenFlattener::Edge>& fills=outlines.fillEdges;
+	for(uint32_t first=0;first<fills.size();)
+	{
+		uint32_t last=first+1;
+		while(last<fills.size() && fills[last].fill==fills[first].fill)
+			last++;
+		if(!solidColor(tokens[fills[first].style].fillStyle, color) ||
+		   !tessellateFill(fills, first, last, color))
+		{
+			vertices.clear();
+			colors.clear();
+			return false;
+		}
+		first=last;
+	}
+	const std::vector<TokenFlattener::Edge>& strokes=outlines.strokeEdges;
+	for(uint32_t i=0;i<strokes.size();i++)
+	{
+		const LINESTYLE2& style=tokens[strokes[i].style].lineStyle;
+		if(style.HasFillFlag)
+		{
+			if(!solidColor(style.FillType, color))
+			{
+				vertices.clear();
+				colors.clear();
+				return false;
+			}
+		}
+		else
+		{
+			color[3]=style.Color.af();
+			color[0]=style.Color.rf()*color[3];
+			color[1]=style.Color.gf()*color[3];
+			color[2]=style.Color.bf()*color[3];
+		}
+		tessellateStroke(strokes[i], color);
+	}
+	if(vertices.size()>MAX_VERTICES*2)
+	{
+		vertices.clear();
+		colors.clear();
+		return false;
+	}
+
+	//The vertices are in token coordinates, move them to pixels
+	for(uint32_t i=0;i<vertices.size();i++)
+		vertices[i]*=scaling;
+	valid=true;
+	return true;
+}
@@ -87,6 +87,137 @@ public:
 
 typedef std::vector<GeomToken, reporter_allocator<GeomToken>> tokensVector;
 
+/*
+ * Flattens the paths of a tokensVector into segments.
+ * Like in CairoTokenRenderer, the path is shared between fills and strokes,
+ * the segments are drawn with the style active when the fill or the stroke is flushed
+ */
+class TokenFlattener
+{
+public:
+	struct Edge
+	{
+		float x0,y0,x1,y1;
+		//Running index of the fill for fill edges, the edges of a fill are consecutive
+		uint32_t fill;
+		//Index of the SET_FILL or SET_STROKE token of the edge
+		uint32_t style;
+		//Half of the width for stroke edges
+		float halfWidth;
+	};
+private:
+	struct PathState
+	{
+		Vector2f start;
+		Vector2f current;
+		bool hasPoint;
+		PathState():hasPoint(false){}
+	};
+	static void flattenQuadratic(std::vector<Vector2f>& points, const Vector2f& p0, const Vector2f& p1,
+				     const Vector2f& p2, double tolerance);
+	static void flattenCubic(std::vector<Vector2f>& points, const Vector2f& p0, const Vector2f& p1,
+				 const Vector2f& p2, const Vector2f& p3, double tolerance);
+public:
+	std::vector<Edge> fillEdges;
+	std::vector<Edge> strokeEdges;
+	/* Curves are approximated within tolerance, in token coordinates */
+	void flatten(const tokensVector& tokens, double tolerance);
+};
+
+/*
+ * Flattened outlines of a tokensVector, used to hit test points without rendering.
+ * Each fill is tested with the even-odd rule, strokes are tested against their width.
+ * Coordinates are the ones of the tokens
+ */
+class TokenHitTester
+{
+private:
+	typedef TokenFlattener::Edge Edge;
+	/*
+	 * Edges sorted in horizontal bands, so that a query only
+	 * looks at the edges spanning its y coordinate
+	 */
+	class EdgeBands
+	{
+	private:
+		std::vector<std::vector<uint32_t>> bands;
+		float ymin;
+		float bandHeight;
+	public:
+		EdgeBands():ymin(0),bandHeight(0){}
+		void build(const std::vector<Edge>& edges, bool padWithWidth);
+		const std::vector<uint32_t>* find(float y) const;
+		void clear() { bands.clear(); }
+	};
+	TokenFlattener outlines;
+	EdgeBands fillBands;
+	EdgeBands strokeBands;
+	float xmin,xmax,ymin,ymax;
+	size_t tokenCount;
+	float scaling;
+	bool valid;
+	void extendBounds(float x, float y, float pad);
+public:
+	TokenHitTester():xmin(0),xmax(0),ymin(0),ymax(0),tokenCount(0),scaling(0),valid(false){}
+	/*
+	   @param tokens The tokens of the shape
+	   @param scaling The scale factor from token coordinates to pixels, used for the flattening tolerance
+	*/
+	void build(const tokensVector& tokens, float scaling);
+	bool isValidFor(const tokensVector& tokens, float _scaling) const
+	{
+		return valid && tokenCount==tokens.size() && scaling==_scaling;
+	}
+	void invalidate() { valid=false; }
+	/* The point is in token coordinates */
+	bool hitTest(number_t x, number_t y) const;
+};
+
+/*
+ * Triangles covering the fills and the strokes of a tokensVector, so that
+ * shapes can be drawn by the GPU at any scale without rasterizing them.
+ * Fills are split in trapezoids with the even-odd rule, strokes become
+ * one quad per flattened segment. Only solid colors are supported.
+ * Vertices are in pixels before the transformation of the shape
+ */
+class TokenTessellator
+{
+private:
+	/* Shapes needing more vertices are left to cairo */
+	static const uint32_t MAX_VERTICES = 1<<20;
+	std::vector<float> vertices;
+	std::vector<float> colors;
+	uint64_t tokensHash;
+	/* The hashed bytes of the tokens, compared on a hash match to rule out collisions */
+	std::vector<uint8_t> tokensContent;
+	float scaling;
+	bool built;
+	bool valid;
+	void addTriangle(float x0, float y0, float x1, float y1, float x2, float y2, const float* color);
+	bool tessellateFill(const std::vector<TokenFlattener::Edge>& edges, uint32_t first, uint32_t last, const float* color);
+	void tessellateStroke(const TokenFlattener::Edge& e, const float* color);
+public:
+	TokenTessellator():tokensHash(0),scaling(0),built(false),valid(false){}
+	/*
+	   Returns false if the tokens use styles that can't be drawn with plain triangles
+	   @param hash A hash of the tokens content, used to avoid building the same triangles again
+	   @param content The bytes the hash is computed on
+	*/
+	bool build(const tokensVector& tokens, float scaling, uint64_t hash, const std::vector<uint8_t>& content);
+	/* Also true if the last build for these tokens failed */
+	bool isBuiltFor(uint64_t hash, const std::vector<uint8_t>& content, float _scaling) const
+	{
+		return built && tokensHash==hash && scaling==_scaling && tokensContent==content;
+	}
+	void invalidate() { built=false; valid=false; vertices.clear(); colors.clear(); tokensContent.clear(); }
+	bool isValid() const { return valid; }
+	/* 2 floats per vertex */
+	const std::vector<float>& getVertices() const { return vertices; }
+	/* 4 floats of premultiplied RGBA per vertex */
+	const std::vector<float>& getColors() const { return colors; }
+	uint32_t getVertexCount() const { return vertices.size()/2; }
+};
+
 enum SHAPE_PATH_SEGMENT_TYPE { PATH_START=0, PATH_STRAIGHT, PATH_CURVE_QUADRATIC };
 
 class ShapePathSegment {
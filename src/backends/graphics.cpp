@@ -448,6 +448,11 @@ void CairoTokenRenderer::executeDraw(cairo_t* cr)
 	cairoPathFromTokens(cr, tokens, scaleFactor, false);
 }
 
+bool CairoTokenRenderer::getRasterCacheKey(RasterCache::Key& key, const MATRIX& m) const
+{
+	return RasterCache::computeKey(key, tokens, m, scaleFactor, width, height);
+}
+
 #ifdef HAVE_NEW_GLIBMM_THREAD_API
 StaticRecMutex CairoRenderer::cairoMutex;
 #else
@@ -456,7 +461,6 @@ StaticRecMutex CairoRenderer::cairoMutex = GLIBMM_STATIC_REC_MUTEX_INIT;
 
 uint8_t* CairoRenderer::getPixelBuffer()
 {
-	RecMutex::Lock l(cairoMutex);
 	if(width==0 || height==0 || !Config::getConfig()->isRenderingEnabled())
 		return NULL;
 
@@ -471,22 +475,51 @@ uint8_t* CairoRenderer::getPixelBuffer()
 		return NULL;
 	}
 
+	//Only the pixels of shapes that are fully visible are cached
+	bool clipped=false;
 	if(xOffset<0)
 	{
 		width+=xOffset;
 		xOffset=0;
+		clipped=true;
 	}
 	if(yOffset<0)
 	{
 		height+=yOffset;
 		yOffset=0;
+		clipped=true;
 	}
 
 	//Clip the size to the screen borders
 	if((xOffset>0) && (width+xOffset) > windowWidth)
+	{
 		width=windowWidth-xOffset;
+		clipped=true;
+	}
 	if((yOffset>0) && (height+yOffset) > windowHeight)
+	{
 		height=windowHeight-yOffset;
+		clipped=true;
+	}
+
+	RasterCache::Key cacheKey;
+	bool cacheable=false;
+	if(!clipped && masks.empty())
+	{
+		MATRIX surfaceMatrix=matrix;
+		surfaceMatrix.x0-=xOffset;
+		surfaceMatrix.y0-=yOffset;
+		cacheable=getRasterCacheKey(cacheKey, surfaceMatrix);
+	}
+	if(cacheable)
+	{
+		//Cache hits do not need the cairo lock
+		uint8_t* cached=getSys()->getRasterCache().lookup(cacheKey, rasterId);
+		if(cached)
+			return cached;
+	}
+
+	RecMutex::Lock l(cairoMutex);
 	uint8_t* ret=NULL;
 	cairo_surface_t* cairoSurface=allocateSurface(ret);
 
@@ -562,28 +595,8 @@ uint8_t* CairoRenderer::getPixelBuffer()
 	}
 
 	cairo_destroy(cr);
-	return ret;
-}
-
-bool CairoTokenRenderer::hitTest(const tokensVector& tokens, float scaleFactor, number_t x, number_t y)
-{
-	cairo_surface_t* cairoSurface=cairo_image_surface_create_for_data(NULL, CAIRO_FORMAT_ARGB32, 0, 0, 0);
-	cairo_t *cr=cairo_create(cairoSurface);
-	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-	cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
-
-	bool empty=cairoPathFromTokens(cr, tokens, scaleFactor, true);
-	bool ret=false;
-	if(!empty)
-	{
-		/* reset the matrix so x and y are not scaled
-		 * by the current cairo transformation
-		 */
-		cairo_identity_matrix(cr);
-		ret=cairo_in_fill(cr, x, y);
-	}
-	cairo_destroy(cr);
-	cairo_surface_destroy(cairoSurface);
+	if(cacheable)
+		rasterId=getSys()->getRasterCache().insert(cacheKey, ret);
 	return ret;
 }
 
@@ -734,19 +747,22 @@ void CairoPangoRenderer::executeDraw(cairo_t* cr)
 		cairo_paint(cr);
 	}
 
-	/* text scroll position */
-	int32_t translateX = textData.scrollH;
-	int32_t translateY = 0;
-	if (textData.scrollV > 1)
-	{
-		translateY = -PANGO_PIXELS(lineExtents(layout, textData.scrollV-1).y);
-	}
-
 	/* draw the text */
 	cairo_set_source_rgb (cr, textData.textColor.Red/255., textData.textColor.Green/255., textData.textColor.Blue/255.);
-	cairo_translate(cr, translateX, translateY);
-	pango_cairo_show_layout(cr, layout);
-	cairo_translate(cr, -translateX, -translateY);
+	if(!drawVisibleParagraphs(cr, layout))
+	{
+		/* text scroll position */
+		int32_t translateX = textData.scrollH;
+		int32_t translateY = 0;
+		if (textData.scrollV > 1)
+		{
+			translateY = -PANGO_PIXELS(lineExtents(layout, textData.scrollV-1).y);
+		}
+
+		cairo_translate(cr, translateX, translateY);
+		pango_cairo_show_layout(cr, layout);
+		cairo_translate(cr, -translateX, -translateY);
+	}
 
 	if(textData.border)
 	{
@@ -812,50 +828,215 @@ PangoRectangle CairoPangoRenderer::lineExtents(PangoLayout *layout, int lineNumb
 	return rect;
 }
 
-std::vector<LineData> CairoPangoRenderer::getLineData(const TextData& _textData)
+/*
+ * Uses the cached layout to shape and draw only the paragraphs
+ * intersecting the visible area. Returns false if the cache can't be used
+ */
+bool CairoPangoRenderer::drawVisibleParagraphs(cairo_t* cr, PangoLayout* layout)
+{
+	if(layoutCache.isNull() || !layoutCache->isCurrent(textData) || !layoutCache->paragraphsIndependent())
+		return false;
+	const std::vector<TextLayoutCache::LineInfo>& lines=layoutCache->lines;
+	if(lines.empty())
+		return true;
+
+	int32_t scrollY=0;
+	if (textData.scrollV > 1 && textData.scrollV-1 < (int32_t)lines.size())
+		scrollY=lines[textData.scrollV-1].logical.y;
+	int32_t visibleEnd=scrollY+PANGO_SCALE*textData.height;
+
+	uint32_t first=0;
+	while(first+1<lines.size() && lines[first].logical.y+lines[first].logical.height<=scrollY)
+		first++;
+	while(first>0 && !lines[first].paragraphStart)
+		first--;
+	uint32_t end=first+1;
+	while(end<lines.size() && (lines[end].logical.y<visibleEnd || !lines[end].paragraphStart))
+		end++;
+
+	uint32_t startByte=lines[first].startByte;
+	uint32_t endByte=(end<lines.size())?lines[end].startByte:textData.text.numBytes();
+	pango_layout_set_text(layout, textData.text.raw_buf()+startByte, endByte-startByte);
+
+	int32_t translateX = textData.scrollH;
+	int32_t translateY = PANGO_PIXELS(lines[first].logical.y-scrollY);
+	cairo_translate(cr, translateX, translateY);
+	pango_cairo_show_layout(cr, layout);
+	cairo_translate(cr, -translateX, -translateY);
+	return true;
+}
+
+void CairoPangoRenderer::applyCairoMask(cairo_t* cr, int32_t xOffset, int32_t yOffset) const
+{
+	assert(false);
+}
+
+bool TextLayoutCache::sameParameters(const TextData& data) const
+{
+	return valid && font==data.font && fontSize==data.fontSize &&
+		autoSize==data.autoSize && wordWrap==data.wordWrap &&
+		(!wordWrap || width==data.width);
+}
+
+bool TextLayoutCache::isCurrent(const TextData& data) const
+{
+	return sameParameters(data) && text==data.text;
+}
+
+void TextLayoutCache::layoutFrom(const TextData& data, uint32_t startByte, int32_t y)
 {
-	//TODO:check locking
-	Locker l(pangoMutex);
 	cairo_surface_t* cairoSurface=cairo_image_surface_create_for_data(NULL, CAIRO_FORMAT_ARGB32, 0, 0, 0);
 	cairo_t *cr=cairo_create(cairoSurface);
+	PangoLayout* layout=pango_cairo_create_layout(cr);
+	CairoPangoRenderer::pangoLayoutFromData(layout, data);
+	const char* buf=data.text.raw_buf();
+	pango_layout_set_text(layout, buf+startByte, data.text.numBytes()-startByte);
 
-	PangoLayout* layout;
-	layout = pango_cairo_create_layout(cr);
-	pangoLayoutFromData(layout, _textData);
-
-	int XOffset = _textData.scrollH;
-	int YOffset = PANGO_PIXELS(lineExtents(layout, _textData.scrollV-1).y);
-	std::vector<LineData> data;
-	data.reserve(pango_layout_get_line_count(layout));
+	uint32_t charOffset=g_utf8_pointer_to_offset(buf, buf+startByte);
+	uint32_t lastByte=0;
 	PangoLayoutIter* lineIter = pango_layout_get_iter(layout);
 	do
 	{
-		PangoRectangle rect;
-		pango_layout_iter_get_line_extents(lineIter, NULL, &rect);
+		LineInfo info;
+		pango_layout_iter_get_line_extents(lineIter, &info.ink, &info.logical);
+		info.ink.y+=y;
+		info.logical.y+=y;
 		PangoLayoutLine* line = pango_layout_iter_get_line(lineIter);
-		data.emplace_back(PANGO_PIXELS(rect.x) - XOffset,
-				  PANGO_PIXELS(rect.y) - YOffset,
-				  PANGO_PIXELS(rect.width),
-				  PANGO_PIXELS(rect.height),
-				  _textData.text.bytePosToIndex(line->start_index),
-				  _textData.text.substr_bytes(line->start_index, line->length).numChars(),
-				  PANGO_PIXELS(PANGO_ASCENT(rect)),
-				  PANGO_PIXELS(PANGO_DESCENT(rect)),
-				  PANGO_PIXELS(PANGO_LBEARING(rect)),
-				  0); // FIXME
+		charOffset+=g_utf8_pointer_to_offset(buf+startByte+lastByte, buf+startByte+line->start_index);
+		lastByte=line->start_index;
+		info.startByte=startByte+line->start_index;
+		info.firstChar=charOffset;
+		info.numChars=g_utf8_pointer_to_offset(buf+info.startByte, buf+info.startByte+line->length);
+		info.paragraphStart=(info.startByte==0 || buf[info.startByte-1]=='\n' || buf[info.startByte-1]=='\r');
+		lines.push_back(info);
 	} while (pango_layout_iter_next_line(lineIter));
 	pango_layout_iter_free(lineIter);
 
 	g_object_unref(layout);
 	cairo_destroy(cr);
 	cairo_surface_destroy(cairoSurface);
+}
 
-	return data;
+void TextLayoutCache::update(const TextData& data)
+{
+	if(sameParameters(data))
+	{
+		if(text==data.text)
+			return;
+		const uint32_t oldBytes=text.numBytes();
+		if(paragraphsIndependent() && !lines.empty() && data.text.numBytes()>oldBytes &&
+		   memcmp(data.text.raw_buf(), text.raw_buf(), oldBytes)==0)
+		{
+			//Text has been appended, lay out again only the last paragraph
+			uint32_t first=lines.size()-1;
+			while(first>0 && !lines[first].paragraphStart)
+				first--;
+			uint32_t startByte=lines[first].startByte;
+			int32_t y=lines[first].logical.y;
+			lines.resize(first);
+			layoutFrom(data, startByte, y);
+			text=data.text;
+			return;
+		}
+	}
+	font=data.font;
+	fontSize=data.fontSize;
+	width=data.width;
+	autoSize=data.autoSize;
+	wordWrap=data.wordWrap;
+	text=data.text;
+	lines.clear();
+	layoutFrom(data, 0, 0);
+	valid=true;
 }
 
-void CairoPangoRenderer::applyCairoMask(cairo_t* cr, int32_t xOffset, int32_t yOffset) const
+std::vector<LineData> TextLayoutCache::getLineData(const TextData& data)
 {
-	assert(false);
+	Locker l(CairoPangoRenderer::pangoMutex);
+	update(data);
+
+	int XOffset = data.scrollH;
+	int YOffset = 0;
+	if (data.scrollV-1 >= 0 && data.scrollV-1 < (int32_t)lines.size())
+		YOffset = PANGO_PIXELS(lines[data.scrollV-1].logical.y);
+	std::vector<LineData> ret;
+	ret.reserve(lines.size());
+	for(uint32_t i=0;i<lines.size();i++)
+	{
+		const PangoRectangle& rect=lines[i].logical;
+		ret.emplace_back(PANGO_PIXELS(rect.x) - XOffset,
+				 PANGO_PIXELS(rect.y) - YOffset,
+				 PANGO_PIXELS(rect.width),
+				 PANGO_PIXELS(rect.height),
+				 lines[i].firstChar,
+				 lines[i].numChars,
+				 PANGO_PIXELS(PANGO_ASCENT(rect)),
+				 PANGO_PIXELS(PANGO_DESCENT(rect)),
+				 PANGO_PIXELS(PANGO_LBEARING(rect)),
+				 0); // FIXME
+	}
+	return ret;
+}
+
+uint32_t TextLayoutCache::getLineCount(const TextData& data)
+{
+	Locker l(CairoPangoRenderer::pangoMutex);
+	update(data);
+	return lines.size();
+}
+
+void TextLayoutCache::getBounds(const TextData& data, uint32_t& w, uint32_t& h, uint32_t& tw, uint32_t& th)
+{
+	Locker l(CairoPangoRenderer::pangoMutex);
+	update(data);
+
+	//The extents of the layout are the union of the extents of the lines
+	PangoRectangle ink={0,0,0,0};
+	PangoRectangle logical={0,0,0,0};
+	bool firstInk=true;
+	for(uint32_t i=0;i<lines.size();i++)
+	{
+		const PangoRectangle& lr=lines[i].logical;
+		if(i==0)
+			logical=lr;
+		else
+		{
+			int32_t x1=imax(logical.x+logical.width, lr.x+lr.width);
+			int32_t y1=imax(logical.y+logical.height, lr.y+lr.height);
+			logical.x=imin(logical.x, lr.x);
+			logical.y=imin(logical.y, lr.y);
+			logical.width=x1-logical.x;
+			logical.height=y1-logical.y;
+		}
+		const PangoRectangle& r=lines[i].ink;
+		if(r.width==0 || r.height==0)
+			continue;
+		if(firstInk)
+		{
+			ink=r;
+			firstInk=false;
+		}
+		else
+		{
+			int32_t x1=imax(ink.x+ink.width, r.x+r.width);
+			int32_t y1=imax(ink.y+ink.height, r.y+r.height);
+			ink.x=imin(ink.x, r.x);
+			ink.y=imin(ink.y, r.y);
+			ink.width=x1-ink.x;
+			ink.height=y1-ink.y;
+		}
+	}
+	pango_extents_to_pixels(&ink, NULL);
+	pango_extents_to_pixels(&logical, NULL);
+
+	tw = ink.width;
+	th = ink.height;
+	if(data.autoSize != TextData::AUTO_SIZE::AS_NONE)
+	{
+		h = logical.height;
+		if(!data.wordWrap)
+			w = logical.width;
+	}
 }
 
 AsyncDrawJob::AsyncDrawJob(IDrawable* d, _R<DisplayObject> o):drawable(d),owner(o),surfaceBytes(NULL),uploadNeeded(false)
@@ -915,9 +1096,17 @@ const TextureChunk& AsyncDrawJob::getTexture()
 	surface.xOffset=drawable->getXOffset();
 	surface.yOffset=drawable->getYOffset();
 	surface.alpha=drawable->getAlpha();
+	surface.rasterId=drawable->getRasterId();
 	return surface.tex;
 }
 
+bool AsyncDrawJob::isAlreadyUploaded() const
+{
+	//Render thread only, like getTexture
+	const CachedSurface& surface=owner->cachedSurface;
+	return drawable->getRasterId()!=0 && surface.rasterId==drawable->getRasterId() && surface.tex.isValid();
+}
+
 void AsyncDrawJob::uploadFence()
 {
 	delete this;
@@ -29,6 +29,7 @@
 #include <cairo.h>
 #include <pango/pango.h>
 #include "backends/geometry.h"
+#include "backends/rastercache.h"
 #include "memory_support.h"
 
 namespace lightspark
@@ -68,11 +69,13 @@ public:
 class CachedSurface
 {
 public:
-	CachedSurface():xOffset(0),yOffset(0),alpha(1.0){}
+	CachedSurface():xOffset(0),yOffset(0),alpha(1.0),rasterId(0){}
 	TextureChunk tex;
 	int32_t xOffset;
 	int32_t yOffset;
 	float alpha;
+	/* The raster cache entry whose pixels are in tex, 0 if they are not cached */
+	uint64_t rasterId;
 };
 
 class ITextureUploadable
@@ -86,6 +89,11 @@ public:
 	*/
 	virtual void upload(uint8_t* data, uint32_t w, uint32_t h) const=0;
 	virtual const TextureChunk& getTexture()=0;
+	/*
+		Returns true if the texture already holds the data, upload is then skipped
+		and only getTexture and uploadFence are called
+	*/
+	virtual bool isAlreadyUploaded() const { return false; }
 	/*
 		Signal the completion of the upload to the texture
 		NOTE: fence may be called on shutdown even if the upload has not happen, so be ready for this event
@@ -119,9 +127,13 @@ protected:
 	*/
 	int32_t yOffset;
 	float alpha;
+	/*
+	   The raster cache entry the pixels come from or have been stored in, 0 if none
+	*/
+	uint64_t rasterId;
 public:
 	IDrawable(int32_t w, int32_t h, int32_t x, int32_t y, float a, const std::vector<MaskData>& m):
-		masks(m),width(w),height(h),xOffset(x),yOffset(y),alpha(a){}
+		masks(m),width(w),height(h),xOffset(x),yOffset(y),alpha(a),rasterId(0){}
 	virtual ~IDrawable(){}
 	/*
 	 * This method returns a raster buffer of the image
@@ -139,6 +151,7 @@ public:
 	int32_t getXOffset() const { return xOffset; }
 	int32_t getYOffset() const { return yOffset; }
 	float getAlpha() const { return alpha; }
+	uint64_t getRasterId() const { return rasterId; }
 };
 
 class AsyncDrawJob: public IThreadJob, public ITextureUploadable
@@ -169,6 +182,7 @@ public:
 	void upload(uint8_t* data, uint32_t w, uint32_t h) const;
 	void sizeNeeded(uint32_t& w, uint32_t& h) const;
 	const TextureChunk& getTexture();
+	bool isAlreadyUploaded() const;
 	void uploadFence();
 };
 
@@ -199,6 +213,11 @@ protected:
 	static void cairoClean(cairo_t* cr);
 	cairo_surface_t* allocateSurface(uint8_t*& buf);
 	virtual void executeDraw(cairo_t* cr)=0;
+	/*
+	 * Fills the key of the pixels in the raster cache, the matrix is
+	 * already in surface coordinates. Returns false if they must not be cached
+	 */
+	virtual bool getRasterCacheKey(RasterCache::Key& key, const MATRIX& m) const { return false; }
 	static void copyRGB15To24(uint8_t* dest, uint8_t* src);
 	static void copyRGB24To24(uint8_t* dest, uint8_t* src);
 public:
@@ -231,6 +250,7 @@ private:
 	 * This is run by CairoRenderer::execute()
 	 */
 	void executeDraw(cairo_t* cr);
+	bool getRasterCacheKey(RasterCache::Key& key, const MATRIX& m) const;
 	void applyCairoMask(cairo_t* cr, int32_t offsetX, int32_t offsetY) const;
 public:
 	/*
@@ -248,15 +268,6 @@ public:
 			int32_t _x, int32_t _y, int32_t _w, int32_t _h,
 		    float _s, float _a, const std::vector<MaskData>& _ms)
 		: CairoRenderer(_m,_x,_y,_w,_h,_s,_a,_ms),tokens(_g){}
-	/*
-	   Hit testing helper. Uses cairo to find if a point in inside the shape
-
-	   @param tokens The tokens of the shape being tested
-	   @param scaleFactor The scale factor to be applied
-	   @param x The X in local coordinates
-	   @param y The Y in local coordinates
-	*/
-	static bool hitTest(const tokensVector& tokens, float scaleFactor, number_t x, number_t y);
 };
 
 class TextData
@@ -308,28 +319,77 @@ public:
 	number_t indent;
 };
 
+/*
+ * Line layout of a TextData, shared by the metrics queries, the bounds
+ * computation and the rendering of a TextField. The text is shaped again
+ * only when it or the layout parameters change. When text is appended
+ * and the paragraphs can be laid out independently, only the last
+ * paragraph is shaped again.
+ */
+class TextLayoutCache: public RefCountable
+{
+friend class CairoPangoRenderer;
+private:
+	struct LineInfo
+	{
+		//In Pango units, relative to the whole layout
+		PangoRectangle logical;
+		PangoRectangle ink;
+		uint32_t startByte;
+		uint32_t firstChar;
+		uint32_t numChars;
+		bool paragraphStart;
+	};
+	std::vector<LineInfo> lines;
+	tiny_string text;
+	tiny_string font;
+	uint32_t fontSize;
+	uint32_t width;
+	TextData::AUTO_SIZE autoSize;
+	bool wordWrap;
+	bool valid;
+	bool sameParameters(const TextData& data) const;
+	bool isCurrent(const TextData& data) const;
+	/* Paragraphs are aligned independently only if the alignment does not depend on the longest line */
+	bool paragraphsIndependent() const { return wordWrap || autoSize==TextData::AS_NONE || autoSize==TextData::AS_LEFT; }
+	void layoutFrom(const TextData& data, uint32_t startByte, int32_t y);
+	/* Must be called with CairoPangoRenderer::pangoMutex held */
+	void update(const TextData& data);
+public:
+	TextLayoutCache():fontSize(0),width(0),autoSize(TextData::AS_NONE),wordWrap(false),valid(false){}
+	std::vector<LineData> getLineData(const TextData& data);
+	uint32_t getLineCount(const TextData& data);
+	void getBounds(const TextData& data, uint32_t& w, uint32_t& h, uint32_t& tw, uint32_t& th);
+};
+
 class CairoPangoRenderer : public CairoRenderer
 {
+friend class TextLayoutCache;
 	static StaticMutex pangoMutex;
 	/*
 	 * This is run by CairoRenderer::execute()
 	 */
 	void executeDraw(cairo_t* cr);
 	TextData textData;
+	_NR<TextLayoutCache> layoutCache;
 	static void pangoLayoutFromData(PangoLayout* layout, const TextData& tData);
+	bool drawVisibleParagraphs(cairo_t* cr, PangoLayout* layout);
 	void applyCairoMask(cairo_t* cr, int32_t offsetX, int32_t offsetY) const;
 	static PangoRectangle lineExtents(PangoLayout *layout, int lineNumber);
 public:
+	/*
+	   @param _c The layout of the text, if it is cached by the owner
+	*/
 	CairoPangoRenderer(const TextData& _textData, const MATRIX& _m,
-			int32_t _x, int32_t _y, int32_t _w, int32_t _h, float _s, float _a, const std::vector<MaskData>& _ms)
-		: CairoRenderer(_m,_x,_y,_w,_h,_s,_a,_ms), textData(_textData) {}
+			int32_t _x, int32_t _y, int32_t _w, int32_t _h, float _s, float _a, const std::vector<MaskData>& _ms,
+			_NR<TextLayoutCache> _c=NullRef)
+		: CairoRenderer(_m,_x,_y,_w,_h,_s,_a,_ms), textData(_textData), layoutCache(_c) {}
 	/**
 		Helper. Uses Pango to find the size of the textdata
 		@param _texttData The textData being tested
 		@param w,h,tw,th are the (text)width and (text)height of the textData.
 	*/
 	static bool getBounds(const TextData& _textData, uint32_t& w, uint32_t& h, uint32_t& tw, uint32_t& th);
-	static std::vector<LineData> getLineData(const TextData& _textData);
 };
 
 class InvalidateQueue
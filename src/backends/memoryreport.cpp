@@ -0,0 +1,247 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <glib.h>
+#include "backends/memoryreport.h"
+#include "memory_support.h"
+#include "threading.h"
+#include "logger.h"
+#ifndef _WIN32
+#include <cstring>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace lightspark;
+
+namespace
+{
+/* Milliseconds between two checks for a SIGUSR1 */
+const uint32_t POLL_INTERVAL=250;
+
+Mutex reportMutex;
+Cond reportCond;
+Thread* reportThread=NULL;
+uint32_t users=0;
+string outputFile;
+uint32_t reportInterval;
+uint32_t reportTop;
+bool snapshotsEnabled;
+//Incremented by the signal handler
+volatile sig_atomic_t requestedSnapshots=0;
+#ifndef _WIN32
+struct sigaction previousAction;
+#endif
+
+struct accountUsage
+{
+	string name;
+	int64_t bytes;
+	int64_t objects;
+};
+
+bool moreBytes(const accountUsage& a, const accountUsage& b)
+{
+	return a.bytes>b.bytes;
+}
+
+bool moreObjects(const accountUsage& a, const accountUsage& b)
+{
+	return a.objects>b.objects;
+}
+
+void writeList(ostream& out, const char* name, const vector<accountUsage>& usage, uint32_t top, bool last)
+{
+	out << "  \"" << name << "\": [";
+	for(uint32_t i=0;i<min(top, uint32_t(usage.size()));i++)
+	{
+		out << (i?",":"") << endl << "    { \"name\": " << MemoryReport::jsonString(usage[i].name) <<
+			", \"bytes\": " << usage[i].bytes << ", \"objects\": " << usage[i].objects << " }";
+	}
+	out << (usage.empty()?"":"\n  ") << "]" << (last?"":",") << endl;
+}
+
+/* Writes to a temporary file first, so that readers never see a partial report */
+void writeReportFile(const string& path)
+{
+	string tmp=path+".tmp";
+	{
+		ofstream f(tmp.c_str());
+		MemoryReport::writeReport(f, reportTop);
+		if(!f)
+		{
+			LOG(LOG_ERROR,"Could not write memory report to " << tmp);
+			return;
+		}
+	}
+	if(rename(tmp.c_str(), path.c_str())!=0)
+		LOG(LOG_ERROR,"Could not write memory report to " << path);
+}
+
+#ifndef _WIN32
+void snapshotHandler(int)
+{
+	requestedSnapshots=requestedSnapshots+1;
+}
+#endif
+
+void reportWorker()
+{
+	Locker l(reportMutex);
+	sig_atomic_t handledSnapshots=requestedSnapshots;
+	uint32_t snapshotCount=0;
+	uint32_t sinceReport=0;
+	while(users)
+	{
+		//Without snapshots there is nothing to poll between two reports
+		uint32_t wait=snapshotsEnabled?POLL_INTERVAL:reportInterval*1000;
+		CondTime(wait).wait(reportMutex, reportCond);
+		if(users==0)
+			break;
+		if(requestedSnapshots!=handledSnapshots)
+		{
+			handledSnapshots=requestedSnapshots;
+			ostringstream path;
+			path << g_get_tmp_dir() << G_DIR_SEPARATOR_S << "lightspark-memory-";
+#ifndef _WIN32
+			path << getpid() << "-";
+#endif
+			path << snapshotCount++ << ".json";
+			writeReportFile(path.str());
+			LOG(LOG_INFO,"Memory report written to " << path.str());
+		}
+		sinceReport+=wait;
+		if(!outputFile.empty() && sinceReport>=reportInterval*1000)
+		{
+			sinceReport=0;
+			writeReportFile(outputFile);
+		}
+	}
+}
+}
+
+void MemoryReport::start(const string& output, uint32_t interval, uint32_t top, bool signal)
+{
+	Locker l(reportMutex);
+	users++;
+	if(reportThread)
+		return;
+	outputFile=output;
+	reportInterval=max(interval, 1u);
+	reportTop=max(top, 1u);
+	snapshotsEnabled=signal;
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+	reportThread=Thread::create(sigc::ptr_fun(&reportWorker));
+#else
+	reportThread=Thread::create(sigc::ptr_fun(&reportWorker),true);
+#endif
+#ifndef _WIN32
+	if(snapshotsEnabled)
+	{
+		struct sigaction sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler=snapshotHandler;
+		sa.sa_flags=SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGUSR1, &sa, &previousAction);
+	}
+#endif
+}
+
+void MemoryReport::stop()
+{
+	Thread* t;
+	{
+		Locker l(reportMutex);
+		if(users==0 || --users)
+			return;
+		reportCond.signal();
+		t=reportThread;
+		reportThread=NULL;
+#ifndef _WIN32
+		if(snapshotsEnabled)
+			sigaction(SIGUSR1, &previousAction, NULL);
+#endif
+	}
+	t->join();
+	//The last report, with what is left after the movies are gone
+	if(!outputFile.empty())
+		writeReportFile(outputFile);
+}
+
+void MemoryReport::writeReport(ostream& out, uint32_t top)
+{
+	vector<MemoryAccount::Usage> accounts;
+	MemoryAccount::listUsage(accounts);
+	map<string, accountUsage> merged;
+	int64_t total=0;
+	for(uint32_t i=0;i<accounts.size();i++)
+	{
+		string name(accounts[i].name);
+		accountUsage& u=merged[name];
+		u.name=name;
+		u.bytes+=accounts[i].bytes;
+		u.objects+=accounts[i].objects;
+		total+=accounts[i].bytes;
+	}
+	vector<accountUsage> usage;
+	for(auto it=merged.begin();it!=merged.end();++it)
+		usage.push_back(it->second);
+
+	out << "{" << endl;
+	out << "  \"time\": " << time(NULL) << "," << endl;
+	out << "  \"total_bytes\": " << max(total, int64_t(0)) << "," << endl;
+	out << "  \"resident_bytes\": " << getResidentMemory() << "," << endl;
+	out << "  \"accounts\": " << usage.size() << "," << endl;
+	sort(usage.begin(), usage.end(), moreBytes);
+	writeList(out, "top_by_bytes", usage, top, false);
+	sort(usage.begin(), usage.end(), moreObjects);
+	writeList(out, "top_by_objects", usage, top, true);
+	out << "}" << endl;
+}
+
+string MemoryReport::jsonString(const string& s)
+{
+	ostringstream ret;
+	ret << '"';
+	for(uint32_t i=0;i<s.size();i++)
+	{
+		unsigned char c=s[i];
+		if(c=='"' || c=='\\')
+			ret << '\\' << c;
+		else if(c<0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			ret << buf;
+		}
+		else
+			ret << c;
+	}
+	ret << '"';
+	return ret.str();
+}
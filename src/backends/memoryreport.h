@@ -0,0 +1,56 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_MEMORYREPORT_H
+#define BACKENDS_MEMORYREPORT_H 1
+
+#include "compat.h"
+#include <ostream>
+#include <string>
+
+namespace lightspark
+{
+
+/*
+ * Reports of the live memory accounts of the process, as JSON.
+ *
+ * Accounts with the same name, like the same class in two workers, are merged. The
+ * report lists the total, the resident memory and the top accounts by bytes and by
+ * live objects. It is written periodically to the configured file and, if enabled
+ * and except on Windows, to a new file in the temporary directory when the process
+ * gets SIGUSR1.
+ */
+class MemoryReport
+{
+public:
+	/*
+	 * Starts the reporting thread, or only counts one more user if it is running.
+	 * If output is empty reports are only written on SIGUSR1. interval is in seconds.
+	 * If signal is set the SIGUSR1 handler is installed until the thread stops
+	 */
+	static void start(const std::string& output, uint32_t interval, uint32_t top, bool signal) DLL_PUBLIC;
+	/* The thread is stopped when the last user calls this */
+	static void stop() DLL_PUBLIC;
+	static void writeReport(std::ostream& out, uint32_t top) DLL_PUBLIC;
+	/* Quotes and escapes s as a JSON string, also used by lightspark-bench */
+	static std::string jsonString(const std::string& s) DLL_PUBLIC;
+};
+
+};
+#endif /* BACKENDS_MEMORYREPORT_H */
@@ -0,0 +1,486 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <map>
+#include <vector>
+#include <fstream>
+#include "backends/profiler.h"
+#include "scripting/abc.h"
+#include "threading.h"
+#include "logger.h"
+#ifndef _WIN32
+#include <csignal>
+#include <cerrno>
+#include <pthread.h>
+#include <sys/time.h>
+#endif
+
+using namespace std;
+using namespace lightspark;
+
+volatile bool SamplingProfiler::running=false;
+
+#ifdef _WIN32
+
+void SamplingProfiler::start(const std::string& output, uint32_t interval)
+{
+	LOG(LOG_ERROR,"The sampling profiler is not supported on this platform");
+}
+
+void SamplingProfiler::stop()
+{
+}
+
+void SamplingProfiler::registerThread(const char* name, ABCVm* vm)
+{
+}
+
+void SamplingProfiler::unregisterThread()
+{
+}
+
+const char* SamplingProfiler::internName(const tiny_string& name)
+{
+	return "";
+}
+
+void SamplingProfiler::pushScope(const char* label)
+{
+}
+
+void SamplingProfiler::popScope()
+{
+}
+
+#else
+
+namespace
+{
+
+const uint32_t MAX_THREADS=32;
+const uint32_t MAX_SCOPES=16;
+const uint32_t MAX_DEPTH=64;
+const int32_t RING_SIZE=256;
+
+struct Sample
+{
+	uint32_t depth;
+	//Leaf first
+	const char* frames[MAX_DEPTH];
+};
+
+/*
+ * The sampling state of a thread. Everything but the ring tail is only written
+ * by the thread itself, so the signal handler always sees consistent values.
+ * A slot is reused only once the collector has drained its ring
+ */
+struct ProfiledThread
+{
+	ATOMIC_INT32(inUse);
+	pthread_t id;
+	const char* name;
+	ABCVm* vm;
+	const char* scopes[MAX_SCOPES];
+	volatile uint32_t scopeDepth;
+	Sample* ring;
+	//Written by the signal handler
+	ATOMIC_INT32(head);
+	//Written by the collector
+	ATOMIC_INT32(tail);
+};
+
+ProfiledThread threads[MAX_THREADS];
+ATOMIC_INT32(otherSamples);
+ATOMIC_INT32(droppedSamples);
+DEFINE_AND_INITIALIZE_TLS(currentThread);
+
+Mutex profilerMutex;
+Cond collectorCond;
+Thread* collector=NULL;
+std::string outputFile;
+uint32_t samplingInterval;
+//Interned names, never freed so that samples can point to them
+std::set<std::string> names;
+//Root first
+std::map<std::vector<const char*>, uint64_t> stacks;
+
+ProfiledThread* findThread()
+{
+	pthread_t self=pthread_self();
+	for(uint32_t i=0;i<MAX_THREADS;i++)
+	{
+		if(threads[i].inUse && pthread_equal(threads[i].id, self))
+			return &threads[i];
+	}
+	return NULL;
+}
+
+/* Only async signal safe operations here */
+void sampleHandler(int)
+{
+	int savedErrno=errno;
+	ProfiledThread* t=findThread();
+	if(t==NULL)
+	{
+		ATOMIC_INCREMENT(otherSamples);
+		errno=savedErrno;
+		return;
+	}
+	int32_t h=t->head;
+	if(h-t->tail>=RING_SIZE)
+	{
+		ATOMIC_INCREMENT(droppedSamples);
+		errno=savedErrno;
+		return;
+	}
+	Sample& s=t->ring[h%RING_SIZE];
+	uint32_t depth=0;
+	uint32_t scopeDepth=min(uint32_t(t->scopeDepth), MAX_SCOPES);
+	//Room left for the ActionScript frames
+	uint32_t limit=MAX_DEPTH-1-scopeDepth;
+	if(t->vm)
+	{
+		for(call_context* cc=t->vm->currentCallContext;cc;cc=cc->parent)
+		{
+			if(depth==limit-1 && cc->parent)
+			{
+				s.frames[depth++]="[truncated]";
+				break;
+			}
+			const char* n=cc->mi->sampleName;
+			s.frames[depth++]=n?n:"[unknown]";
+		}
+	}
+	for(uint32_t i=scopeDepth;i>0;i--)
+		s.frames[depth++]=t->scopes[i-1];
+	s.frames[depth++]=t->name;
+	s.depth=depth;
+	t->head=h+1;
+	errno=savedErrno;
+}
+
+/* Must be called with profilerMutex locked */
+void drainSamples()
+{
+	for(uint32_t i=0;i<MAX_THREADS;i++)
+	{
+		ProfiledThread& t=threads[i];
+		int32_t h=t.head;
+		for(int32_t j=t.tail;j!=h;j++)
+		{
+			const Sample& s=t.ring[j%RING_SIZE];
+			std::vector<const char*> stack(s.frames, s.frames+s.depth);
+			reverse(stack.begin(), stack.end());
+			stacks[stack]++;
+		}
+		t.tail=h;
+	}
+	int32_t others=otherSamples.exchange(0);
+	if(others)
+		stacks[std::vector<const char*>(1,"[other threads]")]+=others;
+}
+
+void collectorWorker()
+{
+	//Samples of this thread are not interesting
+	sigset_t set;
+	sigemptyset(&set);
+	sigaddset(&set, SIGPROF);
+	pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+	Locker l(profilerMutex);
+	while(SamplingProfiler::running)
+	{
+		CondTime(50).wait(profilerMutex, collectorCond);
+		drainSamples();
+	}
+}
+
+std::string foldedFrame(const char* f)
+{
+	std::string ret(f);
+	for(uint32_t i=0;i<ret.size();i++)
+	{
+		if(ret[i]==';' || ret[i]=='\n')
+			ret[i]=':';
+	}
+	return ret;
+}
+
+void writeFolded(ostream& o)
+{
+	for(auto it=stacks.begin();it!=stacks.end();++it)
+	{
+		for(uint32_t i=0;i<it->first.size();i++)
+		{
+			if(i)
+				o << ';';
+			o << foldedFrame(it->first[i]);
+		}
+		o << ' ' << it->second << '\n';
+	}
+}
+
+/* Minimal protocol buffers encoder for the pprof profile.proto format */
+class ProtoWriter
+{
+public:
+	std::string buf;
+	void varint(uint64_t v)
+	{
+		while(v>=0x80)
+		{
+			buf+=char((v&0x7f)|0x80);
+			v>>=7;
+		}
+		buf+=char(v);
+	}
+	void intField(uint32_t field, uint64_t v)
+	{
+		varint(field<<3);
+		varint(v);
+	}
+	void bytesField(uint32_t field, const std::string& v)
+	{
+		varint((field<<3)|2);
+		varint(v.size());
+		buf+=v;
+	}
+	void packedField(uint32_t field, const std::vector<uint64_t>& v)
+	{
+		ProtoWriter p;
+		for(uint32_t i=0;i<v.size();i++)
+			p.varint(v[i]);
+		bytesField(field, p.buf);
+	}
+};
+
+void writePprof(ostream& o)
+{
+	//Entry 0 of the string table must be the empty string
+	std::vector<std::string> strings(1);
+	std::map<std::string, uint64_t> stringIds;
+	auto stringId=[&](const std::string& s) -> uint64_t
+	{
+		auto it=stringIds.find(s);
+		if(it!=stringIds.end())
+			return it->second;
+		strings.push_back(s);
+		stringIds[s]=strings.size()-1;
+		return strings.size()-1;
+	};
+	//Every frame gets a function and a location with the same id
+	std::map<const char*, uint64_t> frameIds;
+	std::vector<const char*> frames;
+
+	ProtoWriter profile;
+	auto valueType=[&](uint32_t field, const char* type, const char* unit)
+	{
+		ProtoWriter v;
+		v.intField(1, stringId(type));
+		v.intField(2, stringId(unit));
+		profile.bytesField(field, v.buf);
+	};
+	valueType(1, "samples", "count");
+	valueType(1, "cpu", "nanoseconds");
+	for(auto it=stacks.begin();it!=stacks.end();++it)
+	{
+		std::vector<uint64_t> locations;
+		//pprof wants the leaf first
+		for(uint32_t i=it->first.size();i>0;i--)
+		{
+			const char* f=it->first[i-1];
+			auto fit=frameIds.find(f);
+			if(fit==frameIds.end())
+			{
+				frames.push_back(f);
+				fit=frameIds.insert(make_pair(f, frames.size())).first;
+			}
+			locations.push_back(fit->second);
+		}
+		std::vector<uint64_t> values;
+		values.push_back(it->second);
+		values.push_back(it->second*samplingInterval*1000);
+		ProtoWriter sample;
+		sample.packedField(1, locations);
+		sample.packedField(2, values);
+		profile.bytesField(2, sample.buf);
+	}
+	for(uint32_t i=0;i<frames.size();i++)
+	{
+		ProtoWriter line;
+		line.intField(1, i+1);
+		ProtoWriter location;
+		location.intField(1, i+1);
+		location.bytesField(4, line.buf);
+		profile.bytesField(4, location.buf);
+	}
+	for(uint32_t i=0;i<frames.size();i++)
+	{
+		ProtoWriter function;
+		function.intField(1, i+1);
+		function.intField(2, stringId(frames[i]));
+		profile.bytesField(5, function.buf);
+	}
+	//The period type needs the strings, so emit them last
+	ProtoWriter period;
+	period.intField(1, stringId("cpu"));
+	period.intField(2, stringId("nanoseconds"));
+	for(uint32_t i=0;i<strings.size();i++)
+		profile.bytesField(6, strings[i]);
+	profile.bytesField(11, period.buf);
+	profile.intField(12, uint64_t(samplingInterval)*1000);
+	o.write(profile.buf.data(), profile.buf.size());
+}
+
+}
+
+void SamplingProfiler::start(const std::string& output, uint32_t interval)
+{
+	Locker l(profilerMutex);
+	if(running)
+		return;
+	outputFile=output;
+	samplingInterval=max(interval, 100u);
+	stacks.clear();
+	otherSamples=0;
+	droppedSamples=0;
+	running=true;
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+	collector=Thread::create(sigc::ptr_fun(&collectorWorker));
+#else
+	collector=Thread::create(sigc::ptr_fun(&collectorWorker),true);
+#endif
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler=sampleHandler;
+	sa.sa_flags=SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGPROF, &sa, NULL);
+
+	struct itimerval timer;
+	timer.it_interval.tv_sec=samplingInterval/1000000;
+	timer.it_interval.tv_usec=samplingInterval%1000000;
+	timer.it_value=timer.it_interval;
+	setitimer(ITIMER_PROF, &timer, NULL);
+	LOG(LOG_INFO,"Sampling profiler started, writing to " << outputFile);
+}
+
+void SamplingProfiler::stop()
+{
+	Thread* t;
+	{
+		Locker l(profilerMutex);
+		if(!running)
+			return;
+		struct itimerval timer;
+		memset(&timer, 0, sizeof(timer));
+		setitimer(ITIMER_PROF, &timer, NULL);
+		//A signal may still be pending
+		signal(SIGPROF, SIG_IGN);
+		running=false;
+		collectorCond.signal();
+		t=collector;
+		collector=NULL;
+	}
+	t->join();
+
+	Locker l(profilerMutex);
+	drainSamples();
+	uint64_t total=0;
+	for(auto it=stacks.begin();it!=stacks.end();++it)
+		total+=it->second;
+	ofstream f(outputFile.c_str(), ios::binary);
+	if(!f)
+	{
+		LOG(LOG_ERROR,"Could not write profile to " << outputFile);
+		return;
+	}
+	if(outputFile.size()>3 && outputFile.compare(outputFile.size()-3, 3, ".pb")==0)
+		writePprof(f);
+	else
+		writeFolded(f);
+	LOG(LOG_INFO,"Sampling profiler wrote " << total << " samples to " << outputFile <<
+		", " << droppedSamples << " dropped");
+}
+
+void SamplingProfiler::registerThread(const char* name, ABCVm* vm)
+{
+	Locker l(profilerMutex);
+	for(uint32_t i=0;i<MAX_THREADS;i++)
+	{
+		ProfiledThread& t=threads[i];
+		//The samples of the previous thread must be drained first
+		if(t.inUse || t.head!=t.tail)
+			continue;
+		if(t.ring==NULL)
+			t.ring=new Sample[RING_SIZE];
+		t.id=pthread_self();
+		t.name=name;
+		t.vm=vm;
+		t.scopeDepth=0;
+		t.inUse=1;
+		tls_set(&currentThread, &t);
+		return;
+	}
+	LOG(LOG_INFO,"Too many threads for the sampling profiler, " << name << " is not tracked");
+}
+
+void SamplingProfiler::unregisterThread()
+{
+	ProfiledThread* t=(ProfiledThread*)tls_get(&currentThread);
+	if(t==NULL)
+		return;
+	tls_set(&currentThread, NULL);
+	Locker l(profilerMutex);
+	t->inUse=0;
+}
+
+const char* SamplingProfiler::internName(const tiny_string& name)
+{
+	Locker l(profilerMutex);
+	return names.insert(std::string(name.raw_buf())).first->c_str();
+}
+
+void SamplingProfiler::pushScope(const char* label)
+{
+	ProfiledThread* t=(ProfiledThread*)tls_get(&currentThread);
+	if(t==NULL)
+		return;
+	//Deeper scopes are counted but not recorded
+	if(t->scopeDepth<MAX_SCOPES)
+		t->scopes[t->scopeDepth]=label;
+	//Do not let the compiler publish the depth before the label
+	std::atomic_signal_fence(std::memory_order_release);
+	t->scopeDepth++;
+}
+
+void SamplingProfiler::popScope()
+{
+	ProfiledThread* t=(ProfiledThread*)tls_get(&currentThread);
+	if(t==NULL)
+		return;
+	t->scopeDepth--;
+}
+
+#endif
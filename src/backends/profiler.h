@@ -0,0 +1,81 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_PROFILER_H
+#define BACKENDS_PROFILER_H 1
+
+#include "compat.h"
+#include <string>
+#include "tiny_string.h"
+
+namespace lightspark
+{
+
+class ABCVm;
+
+/*
+ * Sampling profiler, enabled at runtime.
+ *
+ * While it runs, a SIGPROF is delivered to one of the busy threads every interval of
+ * CPU time. The handler records the stack of the interrupted thread: the ActionScript
+ * frames of the VM running on it, found walking the call_context chain, then the native
+ * scopes opened on the thread with ProfilerScope, then the name of the thread.
+ * Samples are queued per thread and aggregated by a collector thread. On stop the
+ * stacks are written as folded stacks for flamegraph.pl or, if the output file name
+ * ends with .pb, as an uncompressed pprof profile.
+ */
+class SamplingProfiler
+{
+public:
+	static volatile bool running;
+	/* Does nothing if the profiler is already running. interval is in microseconds */
+	static void start(const std::string& output, uint32_t interval) DLL_PUBLIC;
+	/* Stops sampling and writes the output file */
+	static void stop() DLL_PUBLIC;
+	static bool isRunning() { return running; }
+	/*
+	 * Samples of the calling thread are rooted at name, which must be a literal.
+	 * If vm is set, the thread runs its ActionScript code
+	 */
+	static void registerThread(const char* name, ABCVm* vm=NULL);
+	static void unregisterThread();
+	/* Returns a copy of name that lives as long as the process */
+	static const char* internName(const tiny_string& name);
+	static void pushScope(const char* label);
+	static void popScope();
+};
+
+/* Registers the calling thread while it is alive */
+class ProfilerThreadScope
+{
+public:
+	ProfilerThreadScope(const char* name, ABCVm* vm=NULL) { SamplingProfiler::registerThread(name, vm); }
+	~ProfilerThreadScope() { SamplingProfiler::unregisterThread(); }
+};
+
+/* Native frame of the samples taken while it is alive, label must be a literal */
+class ProfilerScope
+{
+public:
+	ProfilerScope(const char* label) { SamplingProfiler::pushScope(label); }
+	~ProfilerScope() { SamplingProfiler::popScope(); }
+};
+
+};
+#endif /* BACKENDS_PROFILER_H */
@@ -0,0 +1,279 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include "backends/rastercache.h"
+#include "logger.h"
+
+using namespace std;
+using namespace lightspark;
+
+//FNV-1a of the token content, optionally keeping a copy of the hashed bytes
+struct Signature
+{
+	uint64_t h;
+	std::vector<uint8_t>* content;
+	Signature(std::vector<uint8_t>* c):h(14695981039346656037ULL),content(c) {}
+};
+
+static inline void hashBytes(Signature& s, const void* p, size_t len)
+{
+	const uint8_t* b=static_cast<const uint8_t*>(p);
+	for(size_t i=0;i<len;i++)
+	{
+		s.h^=b[i];
+		s.h*=1099511628211ULL;
+	}
+	if(s.content)
+		s.content->insert(s.content->end(), b, b+len);
+}
+
+template<class T>
+static inline void hashValue(Signature& s, const T& v)
+{
+	hashBytes(s, &v, sizeof(T));
+}
+
+static inline void hashColor(Signature& s, const RGBA& c)
+{
+	uint32_t v=(uint8_t(c.Red)<<24)|(uint8_t(c.Green)<<16)|(uint8_t(c.Blue)<<8)|uint8_t(c.Alpha);
+	hashValue(s, v);
+}
+
+static inline void hashMatrix(Signature& s, const MATRIX& m)
+{
+	const double v[6]={m.xx,m.yx,m.xy,m.yy,m.x0,m.y0};
+	hashValue(s, v);
+}
+
+static inline void hashGradient(Signature& s, int spread, int interpolation, const std::vector<GRADRECORD>& records)
+{
+	hashValue(s, spread);
+	hashValue(s, interpolation);
+	for(uint32_t i=0;i<records.size();i++)
+	{
+		hashValue(s, uint8_t(records[i].Ratio));
+		hashColor(s, records[i].Color);
+	}
+}
+
+static bool hashFill(Signature& s, const FILLSTYLE& fill)
+{
+	hashValue(s, uint32_t(fill.FillStyleType));
+	switch(fill.FillStyleType)
+	{
+		case SOLID_FILL:
+			hashColor(s, fill.Color);
+			return true;
+		case LINEAR_GRADIENT:
+		case RADIAL_GRADIENT:
+			hashMatrix(s, fill.Matrix);
+			hashGradient(s, fill.Gradient.SpreadMode, fill.Gradient.InterpolationMode, fill.Gradient.GradientRecords);
+			return true;
+		case FOCAL_RADIAL_GRADIENT:
+			hashMatrix(s, fill.Matrix);
+			hashGradient(s, fill.FocalGradient.SpreadMode, fill.FocalGradient.InterpolationMode, fill.FocalGradient.GradientRecords);
+			hashValue(s, fill.FocalGradient.FocalPoint);
+			return true;
+		default:
+			//Bitmap contents may change without the tokens changing
+			return false;
+	}
+}
+
+static bool hashTokenContent(Signature& s, const tokensVector& tokens, float scaleFactor)
+{
+	hashValue(s, scaleFactor);
+	for(uint32_t i=0;i<tokens.size();i++)
+	{
+		const GeomToken& t=tokens[i];
+		hashValue(s, uint32_t(t.type));
+		switch(t.type)
+		{
+			case STRAIGHT:
+			case CURVE_QUADRATIC:
+			case MOVE:
+			case CURVE_CUBIC:
+			{
+				const int32_t p[6]={t.p1.x,t.p1.y,t.p2.x,t.p2.y,t.p3.x,t.p3.y};
+				hashValue(s, p);
+				break;
+			}
+			case SET_FILL:
+				if(!hashFill(s, t.fillStyle))
+					return false;
+				break;
+			case SET_STROKE:
+			{
+				const LINESTYLE2& l=t.lineStyle;
+				const int32_t st[6]={l.StartCapStyle,l.EndCapStyle,l.JointStyle,l.HasFillFlag,
+					uint16_t(l.Width),uint16_t(l.MiterLimitFactor)};
+				hashValue(s, st);
+				hashColor(s, l.Color);
+				if(l.HasFillFlag && !hashFill(s, l.FillType))
+					return false;
+				break;
+			}
+			case FILL_TRANSFORM_TEXTURE:
+				hashMatrix(s, t.textureTransform);
+				break;
+			case CLEAR_FILL:
+			case CLEAR_STROKE:
+			case FILL_KEEP_SOURCE:
+				break;
+		}
+	}
+	return true;
+}
+
+static inline int32_t quantize(double v, double steps)
+{
+	return lround(v*steps);
+}
+
+bool RasterCache::Key::operator==(const Key& r) const
+{
+	return shape==r.shape && xx==r.xx && yx==r.yx && xy==r.xy && yy==r.yy &&
+		phaseX==r.phaseX && phaseY==r.phaseY && width==r.width && height==r.height &&
+		content==r.content;
+}
+
+size_t RasterCache::KeyHash::operator()(const Key& k) const
+{
+	//The content is already covered by the shape hash
+	Signature s(NULL);
+	s.h=k.shape;
+	hashValue(s, k.xx);
+	hashValue(s, k.yx);
+	hashValue(s, k.xy);
+	hashValue(s, k.yy);
+	hashValue(s, k.phaseX);
+	hashValue(s, k.phaseY);
+	hashValue(s, k.width);
+	hashValue(s, k.height);
+	return s.h;
+}
+
+RasterCache::RasterCache(uint64_t size):usedBytes(0),maxBytes(size),hits(0),misses(0),evictions(0),nextId(1)
+{
+}
+
+RasterCache::~RasterCache()
+{
+	if(hits || misses)
+		LOG(LOG_INFO,"Raster cache: " << hits << " hits, " << misses << " misses, " << evictions << " evictions");
+	clear();
+}
+
+bool RasterCache::hashTokens(uint64_t& h, const tokensVector& tokens, float scaleFactor, std::vector<uint8_t>* content)
+{
+	if(content)
+		content->clear();
+	Signature s(content);
+	bool ret=hashTokenContent(s, tokens, scaleFactor);
+	h=s.h;
+	return ret;
+}
+
+bool RasterCache::computeKey(Key& key, const tokensVector& tokens, const MATRIX& m, float scaleFactor, int32_t width, int32_t height)
+{
+	//Keep the hashed bytes too, two shapes with the same hash must not share pixels
+	if(!hashTokens(key.shape, tokens, scaleFactor, &key.content))
+		return false;
+	//Scale and rotation are bucketed, a difference below the bucket is not visible
+	key.xx=quantize(m.xx, 4096);
+	key.yx=quantize(m.yx, 4096);
+	key.xy=quantize(m.xy, 4096);
+	key.yy=quantize(m.yy, 4096);
+	//Shapes moved by whole pixels have the same phase, fractional moves snap to a quarter of pixel
+	key.phaseX=quantize(m.x0, 4);
+	key.phaseY=quantize(m.y0, 4);
+	key.width=width;
+	key.height=height;
+	return true;
+}
+
+uint8_t* RasterCache::lookup(const Key& key, uint64_t& id)
+{
+	Locker l(mutex);
+	auto it=index.find(key);
+	if(it==index.end())
+	{
+		misses++;
+		return NULL;
+	}
+	hits++;
+	//Move to the most recently used end
+	lru.splice(lru.end(), lru, it->second);
+	const Entry& e=*it->second;
+	id=e.id;
+	uint8_t* ret=new uint8_t[e.size];
+	memcpy(ret, e.data, e.size);
+	return ret;
+}
+
+uint64_t RasterCache::insert(const Key& key, const uint8_t* data)
+{
+	uint32_t size=key.width*key.height*4;
+	if(size>MAX_ENTRY_SIZE || size+key.content.size()>maxBytes)
+		return 0;
+	Locker l(mutex);
+	//Another thread may have rendered the same shape meanwhile
+	auto existing=index.find(key);
+	if(existing!=index.end())
+		return existing->second->id;
+	//The copy of the tokens is accounted too
+	evict(size+key.content.size());
+	auto it=index.insert(make_pair(key, lru.end())).first;
+	Entry e;
+	e.key=&it->first;
+	e.data=new uint8_t[size];
+	e.size=size;
+	e.id=nextId++;
+	memcpy(e.data, data, size);
+	lru.push_back(e);
+	it->second=--lru.end();
+	usedBytes+=size+key.content.size();
+	return e.id;
+}
+
+void RasterCache::evict(uint64_t needed)
+{
+	while(!lru.empty() && usedBytes+needed>maxBytes)
+	{
+		Entry& e=lru.front();
+		usedBytes-=e.size+e.key->content.size();
+		delete[] e.data;
+		//The key is owned by the index
+		index.erase(index.find(*e.key));
+		lru.pop_front();
+		evictions++;
+	}
+}
+
+void RasterCache::clear()
+{
+	Locker l(mutex);
+	for(auto it=lru.begin();it!=lru.end();++it)
+		delete[] it->data;
+	lru.clear();
+	index.clear();
+	usedBytes=0;
+}
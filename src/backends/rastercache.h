@@ -0,0 +1,112 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_RASTERCACHE_H
+#define BACKENDS_RASTERCACHE_H 1
+
+#include "compat.h"
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include "threading.h"
+#include "backends/geometry.h"
+
+namespace lightspark
+{
+
+/*
+ * Rasterized shapes, shared between all the instances of a shape and across frames.
+ *
+ * Entries are keyed on the content of the tokens, the linear part of the transformation
+ * and the position of the shape relative to the pixel grid, so moving a shape by whole
+ * pixels, or showing it again in a later frame, reuses the same pixels. Alpha and color
+ * transforms are applied when compositing, so they are not part of the key.
+ * The least recently used entries are evicted when the cache grows past its size.
+ * Hits still copy the pixels out of the cache, but they are not uploaded again when
+ * the texture of the object already holds the same entry.
+ */
+class RasterCache
+{
+public:
+	struct Key
+	{
+		uint64_t shape;
+		/* A full copy of what the hash covers, compared on hits to rule out collisions */
+		std::vector<uint8_t> content;
+		int32_t xx,yx,xy,yy;
+		int32_t phaseX,phaseY;
+		int32_t width,height;
+		bool operator==(const Key& r) const;
+	};
+private:
+	struct KeyHash
+	{
+		size_t operator()(const Key& k) const;
+	};
+	struct Entry
+	{
+		/* Points to the key stored in the index */
+		const Key* key;
+		uint8_t* data;
+		uint32_t size;
+		/* Unique for the life of the cache, so equal ids mean equal pixels */
+		uint64_t id;
+	};
+	Mutex mutex;
+	std::list<Entry> lru;
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+	uint64_t usedBytes;
+	uint64_t maxBytes;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t nextId;
+	void evict(uint64_t needed);
+public:
+	/* Shapes larger than this are not worth keeping around */
+	static const uint32_t MAX_ENTRY_SIZE = 4*1024*1024;
+	RasterCache(uint64_t size=32*1024*1024);
+	~RasterCache();
+	/*
+	 * Hashes the content of the tokens, returns false if they draw mutable bitmaps.
+	 * The hashed bytes are also stored in content when it is not NULL
+	 */
+	static bool hashTokens(uint64_t& h, const tokensVector& tokens, float scaleFactor, std::vector<uint8_t>* content=NULL);
+	/*
+	 * Computes the key of the tokens drawn with the given matrix on a width x height surface.
+	 * The matrix must be expressed in surface coordinates. Returns false if the tokens
+	 * cannot be cached, for example because they draw mutable bitmaps
+	 */
+	static bool computeKey(Key& key, const tokensVector& tokens, const MATRIX& m, float scaleFactor, int32_t width, int32_t height);
+	/*
+	 * Returns a copy of the cached pixels, owned by the caller, or NULL.
+	 * id is set to the id of the entry, a texture holding the same id already has these pixels
+	 */
+	uint8_t* lookup(const Key& key, uint64_t& id);
+	/* Stores a copy of width*height*4 bytes of pixels, returns the id of the entry or 0 */
+	uint64_t insert(const Key& key, const uint8_t* data);
+	void clear();
+	uint64_t getHits() const { return hits; }
+	uint64_t getMisses() const { return misses; }
+	uint64_t getEvictions() const { return evictions; }
+	uint64_t getUsedBytes() const { return usedBytes; }
+};
+
+};
+#endif /* BACKENDS_RASTERCACHE_H */
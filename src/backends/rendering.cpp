@@ -20,6 +20,7 @@
 #include "scripting/abc.h"
 #include "parsing/textfile.h"
 #include "backends/rendering.h"
+#include "backends/profiler.h"
 #include "compat.h"
 #include <sstream>
 
@@ -136,6 +137,13 @@ void RenderThread::handleUpload()
 {
 	ITextureUploadable* u=getUploadJob();
 	assert(u);
+	if(u->isAlreadyUploaded())
+	{
+		//Pixels coming from the raster cache that the texture already holds, only the position may change
+		u->getTexture();
+		u->uploadFence();
+		return;
+	}
 	uint32_t w,h;
 	u->sizeNeeded(w,h);
 	if(w>pixelBufferWidth || h>pixelBufferHeight)
@@ -196,6 +204,7 @@ void RenderThread::worker()
 	setTLSSys(m_sys);
 	/* set TLS variable for getRenderThread() */
 	tls_set(&renderThread, this);
+	ProfilerThreadScope profilerThread("render");
 
 	ThreadProfile* profile=m_sys->allocateProfiler(RGB(200,0,0));
 	profile->setTag("Render");
@@ -539,6 +548,7 @@ void RenderThread::plotProfilingData()
 	cairo_t *cr = getCairoContext(windowWidth, windowHeight);
 
 	engineData->exec_glUniform1f(directUniform, 1);
+	engineData->exec_glUniform1f(alphaUniform, 1);
 
 	char frameBuf[20];
 	snprintf(frameBuf,20,"Frame %u",m_sys->mainClip->state.FP);
@@ -221,6 +221,40 @@ void GLRenderContext::renderTextured(const TextureChunk& chunk, int32_t x, int32
 	handleGLErrors();
 }
 
+bool GLRenderContext::renderTriangles(const float* vertices, const float* colors, uint32_t count,
+			const MATRIX& m, float alpha)
+{
+	//The transformation is applied by the GPU, the triangles are not touched
+	const float modelview[16] = {
+					float(m.xx), float(m.yx), 0, 0,
+					float(m.xy), float(m.yy), 0, 0,
+					0, 0, 1, 0,
+					float(m.x0), float(m.y0), 0, 1
+					};
+	//Textured objects drawn later upload the current matrix, so restore it afterwards
+	float saved[16];
+	memcpy(saved, lsMVPMatrix, LSGL_MATRIX_SIZE);
+	lsglLoadIdentity();
+	lsglMultMatrixf(modelview);
+	setMatrixUniform(LSGL_MODELVIEW);
+	engineData->exec_glUniform1f(alphaUniform, alpha);
+	engineData->exec_glUniform1f(directUniform, 1);
+
+	engineData->exec_glVertexAttribPointer(VERTEX_ATTRIB, 2, 0, vertices);
+	engineData->exec_glVertexAttribPointer(COLOR_ATTRIB, 4, 0, colors);
+	engineData->exec_glEnableVertexAttribArray(VERTEX_ATTRIB);
+	engineData->exec_glEnableVertexAttribArray(COLOR_ATTRIB);
+	engineData->exec_glDrawArrays_GL_TRIANGLES(0, count);
+	engineData->exec_glDisableVertexAttribArray(VERTEX_ATTRIB);
+	engineData->exec_glDisableVertexAttribArray(COLOR_ATTRIB);
+
+	engineData->exec_glUniform1f(directUniform, 0);
+	lsglLoadMatrixf(saved);
+	setMatrixUniform(LSGL_MODELVIEW);
+	handleGLErrors();
+	return true;
+}
+
 int GLRenderContext::errorCount = 0;
 bool GLRenderContext::handleGLErrors() const
 {
@@ -60,6 +60,14 @@ public:
 	*/
 	virtual void renderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h,
 			float alpha, COLOR_MODE colorMode)=0;
+	/**
+		Render colored triangles, the vertices are transformed by the given matrix
+		@param vertices 2 floats per vertex
+		@param colors 4 floats of premultiplied RGBA per vertex
+		@return false if the context can't draw triangles, the caller then uses the cached surface
+	*/
+	virtual bool renderTriangles(const float* vertices, const float* colors, uint32_t count,
+			const MATRIX& m, float alpha) { return false; }
 	/**
 	 * Get the right CachedSurface from an object
 	 */
@@ -77,6 +85,8 @@ protected:
 
 	int yuvUniform;
 	int alphaUniform;
+	//The uniform that tells to draw directly using the vertex colors
+	int directUniform;
 
 	/* Textures */
 	Mutex mutexLargeTexture;
@@ -107,6 +117,8 @@ public:
 
 	void renderTextured(const TextureChunk& chunk, int32_t x, int32_t y, uint32_t w, uint32_t h,
 			float alpha, COLOR_MODE colorMode);
+	bool renderTriangles(const float* vertices, const float* colors, uint32_t count,
+			const MATRIX& m, float alpha);
 	/**
 	 * Get the right CachedSurface from an object
 	 * In the OpenGL case we just get the CachedSurface inside the object itself
@@ -121,7 +133,9 @@ class CairoRenderContext: public RenderContext
 {
 private:
 	std::map<const DisplayObject*, CachedSurface> customSurfaces;
+protected:
 	cairo_t* cr;
+private:
 	static cairo_surface_t* getCairoSurfaceForData(uint8_t* buf, uint32_t width, uint32_t height);
 	/*
 	 * An invalid surface to be returned for objects with no content
@@ -45,13 +45,20 @@ size_t StreamCache::markFinished(bool _failed)
 	return receivedLength;
 }
 
-void StreamCache::waitForData(size_t currentOffset)
+void StreamCache::waitForData(size_t currentOffset, const std::atomic_bool* interrupted)
 {
 	Locker locker(stateMutex);
-	while (receivedLength <= currentOffset && !terminated)
+	while (receivedLength <= currentOffset && !terminated &&
+	       !(interrupted && ACQUIRE_READ((*interrupted))))
 		stateCond.wait(stateMutex);
 }
 
+void StreamCache::wakeReaders()
+{
+	Locker locker(stateMutex);
+	stateCond.broadcast();
+}
+
 void StreamCache::waitForTermination()
 {
 	Locker locker(stateMutex);
@@ -175,11 +182,17 @@ std::streambuf *MemoryStreamCache::createReader()
 }
 
 MemoryStreamCache::Reader::Reader(_R<MemoryStreamCache> b) :
-	buffer(b), chunkIndex(0), chunkStartOffset(0)
+	buffer(b), interrupted(false), chunkIndex(0), chunkStartOffset(0)
 {
 	setg(NULL, NULL, NULL);
 }
 
+void MemoryStreamCache::Reader::interrupt()
+{
+	RELEASE_WRITE(interrupted, true);
+	buffer->wakeReaders();
+}
+
 /**
  * \brief Called by the streambuf API
  *
@@ -196,10 +209,13 @@ int MemoryStreamCache::Reader::underflow()
 	if (!buffer->hasTerminated() && !hasMoreChunks && !lastChunkHasBytes)
 	{
 		locker.release();
-		buffer->waitForData(getOffset());
+		buffer->waitForData(getOffset(), &interrupted);
 		locker.acquire();
 	}
 
+	if (ACQUIRE_READ(interrupted))
+		return EOF;
+
 	if (chunkIndex >= buffer->chunks.size())
 	{
 		// This can only happen if the stream is terminated
@@ -475,14 +491,22 @@ std::streambuf *FileStreamCache::createReader()
 	return fbuf;
 }
 
-FileStreamCache::Reader::Reader(_R<FileStreamCache> b) : buffer(b)
+FileStreamCache::Reader::Reader(_R<FileStreamCache> b) : buffer(b), interrupted(false)
 {
 }
 
+void FileStreamCache::Reader::interrupt()
+{
+	RELEASE_WRITE(interrupted, true);
+	buffer->wakeReaders();
+}
+
 int FileStreamCache::Reader::underflow()
 {
 	if (!buffer->hasTerminated())
-		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in));
+		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in), &interrupted);
+	if (ACQUIRE_READ(interrupted))
+		return EOF;
 
 	return filebuf::underflow();
 }
@@ -494,7 +518,9 @@ streamsize FileStreamCache::Reader::xsgetn(char* s, streamsize n)
 	// If not enough data was available, wait for writer
 	while (read < n)
 	{
-		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in));
+		buffer->waitForData(seekoff(0, ios_base::cur, ios_base::in), &interrupted);
+		if (ACQUIRE_READ(interrupted))
+			return read;
 
 		streamsize b = filebuf::xsgetn(s+read, n-read);
 
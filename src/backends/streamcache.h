@@ -32,6 +32,17 @@
 namespace lightspark
 {
 
+/*
+ * Implemented by the stream readers, so that a thread blocked waiting
+ * for data can be released. The reader then reports the end of the stream.
+ */
+class DLL_PUBLIC InterruptibleReader
+{
+public:
+	virtual ~InterruptibleReader() {}
+	virtual void interrupt()=0;
+};
+
 /*
  * A single-writer-multiple-reader buffer for downloaded streams.
  *
@@ -58,8 +69,11 @@ protected:
 	bool terminated:1;
 
 	// Wait until more than currentOffset bytes has been received
-	// or until terminated
-	void waitForData(size_t currentOffset) DLL_LOCAL;
+	// or until terminated or interrupted
+	void waitForData(size_t currentOffset, const std::atomic_bool* interrupted=NULL) DLL_LOCAL;
+	// Wakes up the readers waiting for data, so that they check
+	// their interrupted flag
+	void wakeReaders() DLL_LOCAL;
 
 	// Derived class implements this to store received data
 	virtual void handleAppend(const unsigned char* buffer, size_t length)=0;
@@ -102,9 +116,10 @@ class MemoryChunk;
  */
 class DLL_PUBLIC MemoryStreamCache : public StreamCache {
 private:
-	class DLL_LOCAL Reader : public std::streambuf {
+	class DLL_LOCAL Reader : public std::streambuf, public InterruptibleReader {
 	private:
 		_R<MemoryStreamCache> buffer;
+		ACQUIRE_RELEASE_FLAG(interrupted);
 		// The chunk that is currently being read
 		unsigned int chunkIndex;
 		// Offset at the start of current chunk
@@ -120,6 +135,7 @@ private:
 		std::streampos getOffset() const;
 	public:
 		Reader(_R<MemoryStreamCache> b);
+		void interrupt();
 	};
 
 	// Stream is stored into a sequence of memory chunks. The
@@ -159,13 +175,15 @@ private:
 	 * Extends filebuf to wait for writer thread to supply more
 	 * data when the end of temporary file is reached.
 	 */
-	class DLL_LOCAL Reader : public std::filebuf {
+	class DLL_LOCAL Reader : public std::filebuf, public InterruptibleReader {
 	private:
 		_R<FileStreamCache> buffer;
+		ACQUIRE_RELEASE_FLAG(interrupted);
 		virtual int underflow();
 		virtual std::streamsize xsgetn(char* s, std::streamsize n);
 	public:
 		Reader(_R<FileStreamCache> buffer);
+		void interrupt();
 	};
 
 	//Cache filename
@@ -0,0 +1,424 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include <istream>
+#include "backends/workers.h"
+#include "backends/netutils.h"
+#include "parsing/streams.h"
+#include "scripting/abc.h"
+#include "swf.h"
+#include "logger.h"
+
+using namespace std;
+using namespace lightspark;
+
+SharedBuffer::~SharedBuffer()
+{
+	free(bytes);
+}
+
+void WorkerMutex::lock()
+{
+	Locker l(mutex);
+	Thread* self=Thread::self();
+	if(owner==self)
+	{
+		count++;
+		return;
+	}
+	while(owner)
+		released.wait(mutex);
+	owner=self;
+	count=1;
+}
+
+bool WorkerMutex::trylock()
+{
+	Locker l(mutex);
+	Thread* self=Thread::self();
+	if(owner && owner!=self)
+		return false;
+	owner=self;
+	count++;
+	return true;
+}
+
+bool WorkerMutex::unlock()
+{
+	Locker l(mutex);
+	if(owner!=Thread::self())
+		return false;
+	count--;
+	if(count==0)
+	{
+		owner=NULL;
+		released.signal();
+	}
+	return true;
+}
+
+uint32_t WorkerMutex::getLockCount()
+{
+	Locker l(mutex);
+	return (owner==Thread::self())?count:0;
+}
+
+bool WorkerCondition::wait(int32_t timeout)
+{
+	WorkerMutex* m=mutex.getPtr();
+	Locker l(m->mutex);
+	Thread* self=Thread::self();
+	assert(m->owner==self);
+	//Release the mutex completely, whatever the recursion level
+	uint32_t savedCount=m->count;
+	m->owner=NULL;
+	m->count=0;
+	m->released.signal();
+
+	waiters++;
+	bool notified=true;
+	if(timeout<0)
+	{
+		while(wakeups==0)
+			cond.wait(m->mutex);
+	}
+	else
+	{
+		CondTime deadline(timeout);
+		while(wakeups==0)
+		{
+			if(!deadline.wait(m->mutex, cond))
+			{
+				notified=(wakeups!=0);
+				break;
+			}
+		}
+	}
+	if(notified)
+		wakeups--;
+	waiters--;
+
+	//Lock the mutex again
+	while(m->owner)
+		m->released.wait(m->mutex);
+	m->owner=self;
+	m->count=savedCount;
+	return notified;
+}
+
+void WorkerCondition::notify()
+{
+	Locker l(mutex->mutex);
+	if(wakeups<waiters)
+	{
+		wakeups++;
+		cond.signal();
+	}
+}
+
+void WorkerCondition::notifyAll()
+{
+	Locker l(mutex->mutex);
+	if(wakeups<waiters)
+	{
+		wakeups=waiters;
+		cond.broadcast();
+	}
+}
+
+ChannelQueue::ChannelQueue(_R<WorkerInstance> s, _R<WorkerInstance> r):state(OPEN),sender(s),receiver(r)
+{
+}
+
+ChannelQueue::STATE ChannelQueue::getState()
+{
+	Locker l(mutex);
+	return state;
+}
+
+bool ChannelQueue::messageAvailable()
+{
+	Locker l(mutex);
+	return !messages.empty();
+}
+
+void ChannelQueue::setState(STATE s)
+{
+	state=s;
+	sender->notify(WorkerInstance::CHANNEL_STATE, NULL, this);
+	if(receiver!=sender)
+		receiver->notify(WorkerInstance::CHANNEL_STATE, NULL, this);
+}
+
+bool ChannelQueue::send(const WorkerValue& v)
+{
+	{
+		Locker l(mutex);
+		if(state!=OPEN)
+			return false;
+		messages.push_back(v);
+		available.signal();
+	}
+	receiver->notify(WorkerInstance::CHANNEL_MESSAGE, NULL, this);
+	return true;
+}
+
+bool ChannelQueue::receive(WorkerValue& v, bool block)
+{
+	Locker l(mutex);
+	while(messages.empty())
+	{
+		if(!block || state!=OPEN || receiver->getState()==WorkerInstance::TERMINATED)
+			return false;
+		//Poll the receiver state, terminating a worker does not know about its channels
+		CondTime(100).wait(mutex, available);
+	}
+	v=messages.front();
+	messages.pop_front();
+	if(state==CLOSING && messages.empty())
+		setState(CLOSED);
+	return true;
+}
+
+void ChannelQueue::close()
+{
+	Locker l(mutex);
+	if(state!=OPEN)
+		return;
+	setState(messages.empty()?CLOSED:CLOSING);
+	available.broadcast();
+}
+
+WorkerInstance::WorkerInstance(SystemState* s):state(RUNNING),primordial(true),sys(s),thread(NULL),completed(false),
+	flashMode(s->flashMode),useInterpreter(true),useFastInterpreter(false),useJit(false),
+	sandboxType(SecurityManager::LOCAL_TRUSTED)
+{
+}
+
+WorkerInstance::WorkerInstance(SystemState* creator, const uint8_t* data, uint32_t len):
+	state(NEW),primordial(false),sys(NULL),thread(NULL),completed(false),swf(data, data+len),
+	flashMode(creator->flashMode),useInterpreter(creator->useInterpreter),useFastInterpreter(creator->useFastInterpreter),
+	useJit(creator->useJit),origin(creator->mainClip->getOrigin().getURL()),sandboxType(creator->securityManager->getSandboxType())
+{
+	WorkerInstance* creatorWorker=creator->getWorker();
+	if(creatorWorker->primordial)
+	{
+		creatorWorker->incRef();
+		domain=_MR(creatorWorker);
+	}
+	else
+		domain=creatorWorker->domain;
+	domain->pruneWorkers();
+	Locker l(domain->mutex);
+	this->incRef();
+	domain->workers.push_back(_MR(this));
+}
+
+WorkerInstance::~WorkerInstance()
+{
+	assert(thread==NULL);
+}
+
+WorkerInstance::STATE WorkerInstance::getState()
+{
+	Locker l(mutex);
+	return state;
+}
+
+void WorkerInstance::setState(STATE s)
+{
+	{
+		Locker l(mutex);
+		if(state==s)
+			return;
+		state=s;
+	}
+	//Let every worker of the domain know
+	vector<_R<WorkerInstance>> all;
+	listWorkers(all);
+	for(uint32_t i=0;i<all.size();i++)
+		all[i]->notify(WORKER_STATE, this, NULL);
+}
+
+bool WorkerInstance::start()
+{
+	{
+		Locker l(mutex);
+		if(primordial || state!=NEW || thread)
+			return false;
+		//The thread holds a reference until it is joined
+		this->incRef();
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+		thread = Thread::create(sigc::mem_fun(this,&WorkerInstance::run));
+#else
+		thread = Thread::create(sigc::mem_fun(this,&WorkerInstance::run),true);
+#endif
+	}
+	setState(RUNNING);
+	return true;
+}
+
+bool WorkerInstance::terminate()
+{
+	{
+		Locker l(mutex);
+		if(primordial || state==TERMINATED)
+			return false;
+		//If the SystemState does not exist yet, run will notice the state
+		if(sys)
+			sys->setShutdownFlag();
+		//A worker that has never been started will not need its SWF anymore
+		if(state==NEW && thread==NULL)
+			std::vector<uint8_t>().swap(swf);
+	}
+	setState(TERMINATED);
+	return true;
+}
+
+void WorkerInstance::detach()
+{
+	list<_R<WorkerInstance>> toJoin;
+	{
+		Locker l(mutex);
+		sys=NULL;
+		if(primordial)
+			toJoin.swap(workers);
+	}
+	for(auto it=toJoin.begin();it!=toJoin.end();++it)
+	{
+		(*it)->terminate();
+		(*it)->join();
+	}
+}
+
+void WorkerInstance::join()
+{
+	Thread* t;
+	{
+		Locker l(mutex);
+		t=thread;
+		thread=NULL;
+	}
+	if(t)
+	{
+		t->join();
+		//Release the reference of the thread
+		decRef();
+	}
+}
+
+void WorkerInstance::pruneWorkers()
+{
+	assert(primordial);
+	list<_R<WorkerInstance>> done;
+	{
+		Locker l(mutex);
+		for(auto it=workers.begin();it!=workers.end();)
+		{
+			WorkerInstance* w=it->getPtr();
+			bool finished;
+			{
+				Locker l2(w->mutex);
+				finished=(w->state==TERMINATED && (w->thread==NULL || w->completed));
+			}
+			if(finished)
+			{
+				done.push_back(*it);
+				it=workers.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+	for(auto it=done.begin();it!=done.end();++it)
+		(*it)->join();
+}
+
+void WorkerInstance::run()
+{
+	LOG(LOG_INFO,"Starting worker " << this);
+	SystemState* s=new SystemState(swf.size(), (SystemState::FLASH_MODE)flashMode, this);
+	s->useInterpreter=useInterpreter;
+	s->useFastInterpreter=useFastInterpreter;
+	s->useJit=useJit;
+	s->securityManager->setSandboxType(sandboxType);
+	if(!origin.empty())
+		s->mainClip->setOrigin(origin);
+	s->downloadManager=new StandaloneDownloadManager();
+
+	bytes_buf sb(swf.data(), swf.size());
+	istream in(&sb);
+	ParseThread pt(in, s->mainClip);
+	{
+		Locker l(mutex);
+		sys=s;
+		//terminate may have been called before the SystemState existed
+		if(state==TERMINATED)
+			s->setShutdownFlag();
+	}
+	s->addJob(&pt);
+
+	//Blocks until the worker is terminated
+	s->destroy();
+	delete s->downloadManager;
+	delete s;
+	setState(TERMINATED);
+	{
+		Locker l(mutex);
+		std::vector<uint8_t>().swap(swf);
+		completed=true;
+	}
+	LOG(LOG_INFO,"Worker " << this << " terminated");
+}
+
+void WorkerInstance::setSharedProperty(const tiny_string& key, const WorkerValue& v)
+{
+	Locker l(mutex);
+	sharedProperties[key]=v;
+}
+
+bool WorkerInstance::getSharedProperty(const tiny_string& key, WorkerValue& v)
+{
+	Locker l(mutex);
+	auto it=sharedProperties.find(key);
+	if(it==sharedProperties.end())
+		return false;
+	v=it->second;
+	return true;
+}
+
+void WorkerInstance::listWorkers(vector<_R<WorkerInstance>>& out)
+{
+	WorkerInstance* root=primordial?this:domain.getPtr();
+	root->pruneWorkers();
+	root->incRef();
+	out.push_back(_MR(root));
+	Locker l(root->mutex);
+	for(auto it=root->workers.begin();it!=root->workers.end();++it)
+		out.push_back(*it);
+}
+
+void WorkerInstance::notify(NOTIFICATION n, WorkerInstance* w, ChannelQueue* c)
+{
+	Locker l(mutex);
+	//The SystemState is detached before its VM is destroyed
+	if(sys==NULL || sys->currentVm==NULL)
+		return;
+	sys->currentVm->addEvent(NullRef, _MR(new (sys->unaccountedMemory) WorkerNotificationEvent(n, w, c)));
+}
@@ -0,0 +1,202 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef BACKENDS_WORKERS_H
+#define BACKENDS_WORKERS_H 1
+
+#include "compat.h"
+#include <deque>
+#include <list>
+#include <map>
+#include <vector>
+#include "threading.h"
+#include "smartrefs.h"
+#include "tiny_string.h"
+#include "backends/security.h"
+
+namespace lightspark
+{
+
+/*
+ * Background workers.
+ *
+ * Every worker runs its SWF in its own SystemState, with its own VM and event loop
+ * thread, so no ActionScript object is ever touched by two workers. The classes here
+ * are the only state shared between workers: values crossing a worker boundary are
+ * copied as AMF3, except for the objects backed by one of these classes, which are
+ * passed by reference.
+ */
+
+class SystemState;
+class WorkerInstance;
+
+/* The bytes of a shareable ByteArray, seen by the ByteArray objects of every worker it was sent to */
+class SharedBuffer: public RefCountable
+{
+public:
+	Mutex mutex;
+	uint8_t* bytes;
+	uint32_t len;
+	uint32_t real_len;
+	SharedBuffer(uint8_t* b, uint32_t l, uint32_t rl):bytes(b),len(l),real_len(rl){}
+	~SharedBuffer();
+};
+
+/* Recursive mutex behind flash.concurrent.Mutex, owned by a thread */
+class WorkerMutex: public RefCountable
+{
+friend class WorkerCondition;
+private:
+	Mutex mutex;
+	Cond released;
+	Thread* owner;
+	uint32_t count;
+public:
+	WorkerMutex():owner(NULL),count(0){}
+	void lock();
+	bool trylock();
+	/* Returns false if the calling thread does not own the mutex */
+	bool unlock();
+	/* How many times the calling thread has locked the mutex, 0 if it does not own it */
+	uint32_t getLockCount();
+};
+
+/* Condition variable behind flash.concurrent.Condition */
+class WorkerCondition: public RefCountable
+{
+private:
+	_R<WorkerMutex> mutex;
+	Cond cond;
+	uint32_t waiters;
+	uint32_t wakeups;
+public:
+	WorkerCondition(_R<WorkerMutex> m):mutex(m),waiters(0),wakeups(0){}
+	_R<WorkerMutex> getMutex() const { return mutex; }
+	/*
+	 * Releases the mutex, waits to be notified and locks the mutex again.
+	 * The caller must own the mutex. timeout is in milliseconds, a negative
+	 * value waits forever. Returns false if the timeout has expired
+	 */
+	bool wait(int32_t timeout);
+	void notify();
+	void notifyAll();
+};
+
+/* A value crossing a worker boundary */
+struct WorkerValue
+{
+	enum TYPE { AMF=0, BYTEARRAY, CHANNEL, WORKER, MUTEX, CONDITION };
+	TYPE type;
+	//AMF3 serialization of the value, deserialized again by each receiver
+	std::vector<uint8_t> amf;
+	//The shared object for the other types
+	_NR<RefCountable> ref;
+	WorkerValue():type(AMF){}
+};
+
+/* One way queue of messages between two workers, behind flash.system.MessageChannel */
+class ChannelQueue: public RefCountable
+{
+public:
+	enum STATE { OPEN=0, CLOSING, CLOSED };
+private:
+	Mutex mutex;
+	Cond available;
+	std::deque<WorkerValue> messages;
+	STATE state;
+	_R<WorkerInstance> sender;
+	_R<WorkerInstance> receiver;
+	void setState(STATE s);
+public:
+	ChannelQueue(_R<WorkerInstance> s, _R<WorkerInstance> r);
+	WorkerInstance* getSender() const { return sender.getPtr(); }
+	WorkerInstance* getReceiver() const { return receiver.getPtr(); }
+	STATE getState();
+	bool messageAvailable();
+	/* Returns false if the channel has been closed */
+	bool send(const WorkerValue& v);
+	/*
+	 * Pops the oldest message. If block is set it waits for one until the channel
+	 * is closed or the receiver is terminated. Returns false if there is no message
+	 */
+	bool receive(WorkerValue& v, bool block);
+	/* No more messages may be sent, the channel is closed once the pending ones are received */
+	void close();
+};
+
+class WorkerInstance: public RefCountable
+{
+public:
+	enum STATE { NEW=0, RUNNING, TERMINATED };
+	enum NOTIFICATION { WORKER_STATE=0, CHANNEL_MESSAGE, CHANNEL_STATE };
+private:
+	Mutex mutex;
+	STATE state;
+	const bool primordial;
+	//The primordial worker of the domain, NULL for the primordial worker itself
+	_NR<WorkerInstance> domain;
+	//The background workers of the domain, only used by the primordial worker
+	std::list<_R<WorkerInstance>> workers;
+	//The SystemState running this worker, NULL when it is not running
+	SystemState* sys;
+	Thread* thread;
+	//Set when run has returned, the thread can then be joined without blocking
+	bool completed;
+	//Released once the worker can not run anymore
+	std::vector<uint8_t> swf;
+	//Execution settings inherited from the creator
+	int flashMode;
+	bool useInterpreter;
+	bool useFastInterpreter;
+	bool useJit;
+	tiny_string origin;
+	SecurityManager::SANDBOXTYPE sandboxType;
+	std::map<tiny_string, WorkerValue> sharedProperties;
+	void run();
+	void setState(STATE s);
+	/* Joins the thread, if any, and drops its reference */
+	void join();
+	/* Releases the background workers that have completed, only used by the primordial worker */
+	void pruneWorkers();
+public:
+	/* The worker running the main SWF of s */
+	WorkerInstance(SystemState* s);
+	/* A background worker running a copy of the given SWF, created from the worker of creator */
+	WorkerInstance(SystemState* creator, const uint8_t* data, uint32_t len);
+	~WorkerInstance();
+	bool isPrimordial() const { return primordial; }
+	STATE getState();
+	/* Returns false if the worker has already been started */
+	bool start();
+	/* Returns false if the worker was not running */
+	bool terminate();
+	/*
+	 * Called when the SystemState running this worker is being destroyed.
+	 * For the primordial worker it also terminates all the background workers
+	 */
+	void detach();
+	void setSharedProperty(const tiny_string& key, const WorkerValue& v);
+	bool getSharedProperty(const tiny_string& key, WorkerValue& v);
+	void listWorkers(std::vector<_R<WorkerInstance>>& out);
+	/* Queues a notification in the event loop of this worker, c is the channel involved, if any */
+	void notify(NOTIFICATION n, WorkerInstance* w, ChannelQueue* c);
+};
+
+};
+#endif /* BACKENDS_WORKERS_H */
@@ -21,19 +21,34 @@
 #define BACKENDS_XML_SUPPORT_H 1
 
 #include "tiny_string.h"
+#include "smartrefs.h"
 #include <3rdparty/pugixml/src/pugixml.hpp>
 namespace lightspark
 {
 
 
+/*
+ * A parsed document, shared by the nodes created from it.
+ * Names and values of the pugixml nodes point inside the document buffer,
+ * so XML objects can be created lazily while the store is alive
+ */
+class XMLDocumentStore: public RefCountable
+{
+public:
+	//The parser will destroy the document and all the childs on destruction
+	pugi::xml_document doc;
+	//Value of XML.ignoreWhitespace when the document was parsed
+	bool ignoreWhitespace;
+	XMLDocumentStore():ignoreWhitespace(true){}
+};
+
 /*
  * Base class for both XML and XMLNode
  */
 class XMLBase
 {
 protected:
-	//The parser will destroy the document and all the childs on destruction
-	pugi::xml_document xmldoc;
+	_NR<XMLDocumentStore> xmldoc;
 	const pugi::xml_node buildFromString(const tiny_string& str,
 										unsigned int xmlparsemode,
 										const tiny_string& default_ns=tiny_string());
@@ -0,0 +1,455 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "version.h"
+#include "swf.h"
+#include "logger.h"
+#include "backends/netutils.h"
+#include "backends/graphics.h"
+#include "backends/rendering_context.h"
+#include "backends/security.h"
+#include "backends/config.h"
+#include "backends/memoryreport.h"
+#include "scripting/abc.h"
+#include "scripting/flash/display/flashdisplay.h"
+#include "scripting/flash/events/flashevents.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "compat.h"
+
+using namespace std;
+using namespace lightspark;
+
+/*
+ * Headless benchmark runner.
+ *
+ * The SWF runs on a virtual clock that moves by exactly one frame interval per frame,
+ * so timers and getTimer() see the same times on every run. After each frame the VM
+ * is parked and the whole stage is drawn in software on an offscreen CairoRenderContext,
+ * timing invalidation, rasterization and the upload to the target separately.
+ * The timings, the memory peaks and a hash of the last frame are written as JSON,
+ * to be compared between builds.
+ * With --gpu-vector the shapes go through the tessellator, and the triangles are filled
+ * by cairo without antialiasing, so the frame hash checks the tessellation headless.
+ * It only matches other --gpu-vector runs.
+ */
+
+class PhaseStats
+{
+public:
+	//Microseconds
+	vector<uint64_t> samples;
+	void add(uint64_t us) { samples.push_back(us); }
+	void write(ostream& out) const
+	{
+		vector<uint64_t> sorted(samples);
+		sort(sorted.begin(), sorted.end());
+		uint64_t total=0;
+		for(uint32_t i=0;i<sorted.size();i++)
+			total+=sorted[i];
+		out << "{\"count\": " << sorted.size() << ", \"total_us\": " << total;
+		if(!sorted.empty())
+		{
+			out << ", \"mean_us\": " << total/sorted.size()
+			    << ", \"min_us\": " << sorted.front()
+			    << ", \"median_us\": " << sorted[sorted.size()/2]
+			    << ", \"p95_us\": " << sorted[(sorted.size()*95)/100]
+			    << ", \"max_us\": " << sorted.back();
+		}
+		out << "}";
+	}
+};
+
+enum PHASE { PARSE=0, ABC_INIT, SCRIPT, INVALIDATION, RASTERIZATION, UPLOAD, PHASE_COUNT };
+static const char* phaseNames[PHASE_COUNT] = { "parse", "abc_init", "script", "invalidation", "rasterization", "upload" };
+
+/* Draws the tessellated shapes in software, like the GL context does on the GPU */
+class TessellationRenderContext: public CairoRenderContext
+{
+public:
+	TessellationRenderContext(uint8_t* buf, uint32_t width, uint32_t height):CairoRenderContext(buf, width, height){}
+	bool renderTriangles(const float* vertices, const float* colors, uint32_t count,
+			const MATRIX& m, float alpha)
+	{
+		cairo_save(cr);
+		cairo_set_matrix(cr, &m);
+		cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+		for(uint32_t i=0;i+2<count;i+=3)
+		{
+			const float* c=colors+i*4;
+			if(c[3]==0)
+				continue;
+			cairo_move_to(cr, vertices[i*2], vertices[i*2+1]);
+			cairo_line_to(cr, vertices[i*2+2], vertices[i*2+3]);
+			cairo_line_to(cr, vertices[i*2+4], vertices[i*2+5]);
+			cairo_close_path(cr);
+			//The colors are premultiplied
+			cairo_set_source_rgba(cr, c[0]/c[3], c[1]/c[3], c[2]/c[3], c[3]*alpha);
+			cairo_fill(cr);
+		}
+		cairo_restore(cr);
+		return true;
+	}
+};
+
+/* Lets the VM handle all the events queued so far, then keeps it parked until sync->release is signaled */
+static bool parkVm(SystemState* sys, _R<SynchronizationEvent> sync)
+{
+	if(!sys->currentVm->addEvent(NullRef, sync))
+		return false;
+	sync->reached.wait();
+	return true;
+}
+
+/* Draws the whole stage on pixels, the VM must be parked */
+static void renderStage(SystemState* sys, vector<uint8_t>& pixels, uint32_t width, uint32_t height, PhaseStats* phases)
+{
+	//Through the base class, like BitmapData.draw does
+	DisplayObject* stage=sys->stage;
+	uint64_t start=g_get_monotonic_time();
+	SoftwareInvalidateQueue queue;
+	stage->requestInvalidation(&queue);
+	vector<pair<DisplayObject*, IDrawable*>> drawables;
+	for(auto it=queue.queue.begin();it!=queue.queue.end();++it)
+	{
+		IDrawable* d=(*it)->invalidate(stage, MATRIX());
+		if(d)
+			drawables.push_back(make_pair(it->getPtr(), d));
+	}
+	uint64_t invalidated=g_get_monotonic_time();
+	phases[INVALIDATION].add(invalidated-start);
+
+	vector<uint8_t*> buffers(drawables.size());
+	for(uint32_t i=0;i<drawables.size();i++)
+		buffers[i]=drawables[i].second->getPixelBuffer();
+	uint64_t rasterized=g_get_monotonic_time();
+	phases[RASTERIZATION].add(rasterized-invalidated);
+
+	//Cairo uses native endian ARGB
+	RGB bg=sys->mainClip->getBackground();
+	uint32_t color=0xff000000|(uint32_t(bg.Red)<<16)|(uint32_t(bg.Green)<<8)|uint32_t(bg.Blue);
+	uint32_t* p=reinterpret_cast<uint32_t*>(pixels.data());
+	fill(p, p+width*height, color);
+	{
+		TessellationRenderContext ctxt(pixels.data(), width, height);
+		for(uint32_t i=0;i<drawables.size();i++)
+		{
+			IDrawable* d=drawables[i].second;
+			//The context takes the ownership of the buffer
+			CachedSurface& surface=ctxt.allocateCustomSurface(drawables[i].first, buffers[i]);
+			surface.tex.width=d->getWidth();
+			surface.tex.height=d->getHeight();
+			surface.xOffset=d->getXOffset();
+			surface.yOffset=d->getYOffset();
+			delete d;
+		}
+		stage->Render(ctxt);
+	}
+	phases[UPLOAD].add(g_get_monotonic_time()-rasterized);
+}
+
+static void sampleMemory(SystemState* sys, map<string, uint64_t>& peaks)
+{
+	vector<const MemoryAccount*> accounts;
+	sys->listMemoryAccounts(accounts);
+	for(uint32_t i=0;i<accounts.size();i++)
+	{
+		int64_t bytes=accounts[i]->getBytes();
+		//Most classes never have an instance
+		if(bytes<=0)
+			continue;
+		uint64_t& peak=peaks[string(accounts[i]->name)];
+		peak=max(peak, uint64_t(bytes));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	char* fileName=NULL;
+	char* outputFileName=NULL;
+	uint32_t frames=300;
+	uint32_t seed=1;
+	bool render=true;
+	bool perFrame=false;
+	bool useInterpreter=true;
+	bool useFastInterpreter=false;
+	bool useJit=false;
+	bool gpuVector=false;
+	LOG_LEVEL log_level=LOG_ERROR;
+	bool error=false;
+
+	for(int i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"-n")==0 ||
+			strcmp(argv[i],"--frames")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				error=true;
+				break;
+			}
+			frames=atoi(argv[i]);
+		}
+		else if(strcmp(argv[i],"-o")==0 ||
+			strcmp(argv[i],"--output")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				error=true;
+				break;
+			}
+			outputFileName=argv[i];
+		}
+		else if(strcmp(argv[i],"--seed")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				error=true;
+				break;
+			}
+			seed=atoi(argv[i]);
+		}
+		else if(strcmp(argv[i],"--no-render")==0)
+			render=false;
+		else if(strcmp(argv[i],"--per-frame")==0)
+			perFrame=true;
+		else if(strcmp(argv[i],"--gpu-vector")==0)
+			gpuVector=true;
+		else if(strcmp(argv[i],"-ni")==0 ||
+			strcmp(argv[i],"--disable-interpreter")==0)
+			useInterpreter=false;
+		else if(strcmp(argv[i],"-fi")==0 ||
+			strcmp(argv[i],"--enable-fast-interpreter")==0)
+			useFastInterpreter=true;
+		else if(strcmp(argv[i],"-j")==0 ||
+			strcmp(argv[i],"--enable-jit")==0)
+			useJit=true;
+		else if(strcmp(argv[i],"-l")==0 ||
+			strcmp(argv[i],"--log-level")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				error=true;
+				break;
+			}
+			log_level=(LOG_LEVEL)atoi(argv[i]);
+		}
+		else
+		{
+			if(fileName)
+			{
+				error=true;
+				break;
+			}
+			fileName=argv[i];
+		}
+	}
+
+	if(fileName==NULL || error)
+	{
+		LOG(LOG_ERROR, "Usage: " << argv[0] << " [--frames|-n frames] [--output|-o report.json]" <<
+			" [--seed seed] [--no-render] [--per-frame] [--gpu-vector]" <<
+			" [--disable-interpreter|-ni] [--enable-fast-interpreter|-fi] [--enable-jit|-j]" <<
+			" [--log-level|-l 0-4] <file.swf>");
+		exit(1);
+	}
+	//One of useInterpreter or useJit must be enabled
+	if(!(useInterpreter || useJit))
+	{
+		LOG(LOG_ERROR,_("No execution model enabled"));
+		exit(1);
+	}
+
+	Log::setLogLevel(log_level);
+	if(gpuVector)
+		Config::getConfig()->setGPUVectorRendering(true);
+	ifstream f(fileName, ios::in|ios::binary);
+	f.seekg(0, ios::end);
+	uint32_t fileSize=f.tellg();
+	f.seekg(0, ios::beg);
+	if(!f)
+	{
+		LOG(LOG_ERROR, argv[0] << ": " << fileName << ": No such file or directory");
+		exit(2);
+	}
+
+	SystemState::staticInit();
+	//Math.random must return the same sequence on every run
+	srand(seed);
+	//NOTE: see SystemState declaration
+	SystemState* sys=new SystemState(fileSize, SystemState::FLASH);
+	setTLSSys(sys);
+	sys->enableVirtualClock();
+	sys->setDownloadedPath(fileName);
+	sys->mainClip->setOrigin(string("file://") + fileName);
+	sys->useInterpreter=useInterpreter;
+	sys->useFastInterpreter=useFastInterpreter;
+	sys->useJit=useJit;
+	sys->securityManager->setSandboxType(SecurityManager::LOCAL_WITH_FILE);
+	sys->downloadManager=new StandaloneDownloadManager();
+
+	PhaseStats phases[PHASE_COUNT];
+	map<string, uint64_t> memoryPeaks;
+	uint32_t framesRun=0;
+	uint32_t interval=0;
+	uint32_t width=0;
+	uint32_t height=0;
+	uint64_t frameHash=0;
+	string failure;
+
+	//Parse the whole file before running any code, so that parsing does not compete with the VM
+	ParseThread pt(f, sys->mainClip);
+	uint64_t start=g_get_monotonic_time();
+	pt.execute();
+	phases[PARSE].add(g_get_monotonic_time()-start);
+
+	if(sys->currentVm==NULL)
+		failure="not an AVM2 movie";
+	else if(sys->mainClip->getFrameRate()==0)
+		failure="no frame rate";
+	else
+	{
+		interval=1000/sys->mainClip->getFrameRate();
+		width=sys->mainClip->getFrameSize().Xmax/20;
+		height=sys->mainClip->getFrameSize().Ymax/20;
+		vector<uint8_t> pixels(render?width*height*4:0);
+
+		//Background workers start their VM at once, the others wait for the rendering engines
+		start=g_get_monotonic_time();
+		if(!sys->currentVm->hasEverStarted())
+			sys->currentVm->start();
+		_R<SynchronizationEvent> init=_MR(new (sys->unaccountedMemory) SynchronizationEvent);
+		if(parkVm(sys, init))
+			init->release.signal();
+		phases[ABC_INIT].add(g_get_monotonic_time()-start);
+		sampleMemory(sys, memoryPeaks);
+
+		for(;framesRun<frames;framesRun++)
+		{
+			if(sys->shouldTerminate())
+				break;
+			//Fires the frame tick and the timers due in this frame, the tick waits for the frame scripts
+			start=g_get_monotonic_time();
+			sys->advanceVirtualClock(interval);
+			_R<SynchronizationEvent> sync=_MR(new (sys->unaccountedMemory) SynchronizationEvent);
+			bool parked=parkVm(sys, sync);
+			phases[SCRIPT].add(g_get_monotonic_time()-start);
+			if(parked)
+			{
+				if(render && !sys->shouldTerminate())
+					renderStage(sys, pixels, width, height, phases);
+				sync->release.signal();
+			}
+			sampleMemory(sys, memoryPeaks);
+		}
+		if(sys->isOnError())
+			failure=sys->getErrorCause();
+
+		//FNV-1a of the last frame, to notice rendering changes between builds
+		frameHash=14695981039346656037ULL;
+		for(uint32_t i=0;i<pixels.size();i++)
+			frameHash=(frameHash^pixels[i])*1099511628211ULL;
+	}
+
+	ostringstream report;
+	report << "{" << endl;
+	report << "  \"version\": " << MemoryReport::jsonString(VERSION) << "," << endl;
+	report << "  \"swf\": " << MemoryReport::jsonString(fileName) << "," << endl;
+	report << "  \"execution\": " << MemoryReport::jsonString(useJit?"jit":(useFastInterpreter?"fast-interpreter":"interpreter")) << "," << endl;
+	report << "  \"seed\": " << seed << "," << endl;
+	report << "  \"vector_rendering\": " << MemoryReport::jsonString(Config::getConfig()->isGPUVectorRenderingEnabled()?"gpu":"cairo") << "," << endl;
+	report << "  \"frame_interval_ms\": " << interval << "," << endl;
+	report << "  \"width\": " << width << "," << endl;
+	report << "  \"height\": " << height << "," << endl;
+	report << "  \"frames_requested\": " << frames << "," << endl;
+	report << "  \"frames_run\": " << framesRun << "," << endl;
+	report << "  \"error\": " << (failure.empty()?string("null"):MemoryReport::jsonString(failure)) << "," << endl;
+	if(render)
+	{
+		ostringstream hash;
+		hash << hex << frameHash;
+		report << "  \"last_frame_hash\": " << MemoryReport::jsonString(hash.str()) << "," << endl;
+	}
+	report << "  \"phases\": {" << endl;
+	for(uint32_t i=0;i<PHASE_COUNT;i++)
+	{
+		report << "    " << MemoryReport::jsonString(phaseNames[i]) << ": ";
+		phases[i].write(report);
+		report << (i+1<PHASE_COUNT?",":"") << endl;
+	}
+	report << "  }," << endl;
+	if(perFrame)
+	{
+		report << "  \"per_frame_us\": {" << endl;
+		for(uint32_t i=SCRIPT;i<PHASE_COUNT;i++)
+		{
+			const vector<uint64_t>& samples=phases[i].samples;
+			report << "    " << MemoryReport::jsonString(phaseNames[i]) << ": [";
+			for(uint32_t j=0;j<samples.size();j++)
+				report << (j?", ":"") << samples[j];
+			report << "]" << (i+1<PHASE_COUNT?",":"") << endl;
+		}
+		report << "  }," << endl;
+	}
+	report << "  \"memory\": {" << endl;
+#ifndef _WIN32
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	report << "    \"peak_rss_kb\": " << usage.ru_maxrss << "," << endl;
+#endif
+	//Sampled at frame boundaries
+	report << "    \"accounts_peak_bytes\": {";
+	for(auto it=memoryPeaks.begin();it!=memoryPeaks.end();++it)
+		report << (it==memoryPeaks.begin()?"":",") << endl << "      " << MemoryReport::jsonString(it->first) << ": " << it->second;
+	report << (memoryPeaks.empty()?"":"\n    ") << "}" << endl;
+	report << "  }" << endl;
+	report << "}" << endl;
+
+	if(outputFileName)
+	{
+		ofstream out(outputFileName);
+		out << report.str();
+		if(!out)
+		{
+			LOG(LOG_ERROR, "Cannot write " << outputFileName);
+			failure="cannot write the report";
+		}
+	}
+	else
+		cout << report.str();
+
+	sys->setShutdownFlag();
+	sys->destroy();
+	delete sys->downloadManager;
+	delete sys;
+	SystemState::staticDeinit();
+
+	return failure.empty()?0:3;
+}
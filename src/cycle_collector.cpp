@@ -0,0 +1,256 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#include "cycle_collector.h"
+#include "logger.h"
+#include "backends/profiler.h"
+
+using namespace std;
+using namespace lightspark;
+
+CycleCollector::CycleCollector():phase(IDLE),framesSinceCollection(0),collectionRequested(false),collectionCount(0),freedCount(0)
+{
+}
+
+CycleCollector::~CycleCollector()
+{
+	Locker l(mutex);
+	for(auto it=candidates.begin();it!=candidates.end();++it)
+		RELEASE_WRITE((*it)->gcCandidate,false);
+	candidates.clear();
+}
+
+void CycleCollector::addCandidate(RefCountable* o)
+{
+	//Only the VM thread sets the flag, so it is safe to check it without locking
+	if(o->getConstant() || ACQUIRE_READ(o->gcCandidate))
+		return;
+	Locker l(mutex);
+	RELEASE_WRITE(o->gcCandidate,true);
+	candidates.insert(o);
+}
+
+bool CycleCollector::releaseCandidate(RefCountable* o)
+{
+	Locker l(mutex);
+	if(o->gcPinned)
+	{
+		/*
+		 * collect took its reference after the caller found ref_count at 1,
+		 * so this is not the last reference anymore. Drop it while holding the
+		 * mutex, the object is freed when the collector releases the pin.
+		 */
+		assert(o->ref_count>1);
+		--o->ref_count;
+		RELEASE_WRITE(o->gcPurple,true);
+		return false;
+	}
+	candidates.erase(o);
+	RELEASE_WRITE(o->gcCandidate,false);
+	RELEASE_WRITE(o->gcPurple,false);
+	return true;
+}
+
+void CycleCollector::removeCandidate(RefCountable* o)
+{
+	Locker l(mutex);
+	if(o->gcPinned)
+	{
+		//Only possible if the object is deleted directly while collecting, forget the pin
+		LOG(LOG_ERROR,"Cycle collector: a pinned object has been deleted");
+		for(auto it=roots.begin();it!=roots.end();++it)
+		{
+			if(*it==o)
+			{
+				roots.erase(it);
+				break;
+			}
+		}
+		o->gcPinned=false;
+	}
+	candidates.erase(o);
+	RELEASE_WRITE(o->gcCandidate,false);
+	RELEASE_WRITE(o->gcPurple,false);
+}
+
+uint32_t CycleCollector::getCandidateCount()
+{
+	Locker l(mutex);
+	return candidates.size();
+}
+
+void CycleCollector::visit(RefCountable* child)
+{
+	if(child==NULL || child->getConstant())
+		return;
+	switch(phase)
+	{
+		case GATHER:
+		{
+			if(nodes.size()>=MAX_NODES)
+				return;
+			nodeData d;
+			d.refs=child->ref_count;
+			d.reachable=false;
+			if(nodes.insert(make_pair(child,d)).second)
+				workList.push_back(child);
+			break;
+		}
+		case SUBTRACT:
+		{
+			auto it=nodes.find(child);
+			if(it!=nodes.end())
+				it->second.refs--;
+			break;
+		}
+		case PROPAGATE:
+		{
+			auto it=nodes.find(child);
+			if(it!=nodes.end() && !it->second.reachable)
+			{
+				it->second.reachable=true;
+				workList.push_back(child);
+			}
+			break;
+		}
+		default:
+			assert(false);
+	}
+}
+
+void CycleCollector::frameBoundary()
+{
+	framesSinceCollection++;
+	if(framesSinceCollection<COLLECTION_INTERVAL)
+		return;
+	framesSinceCollection=0;
+	uint32_t freed=collect();
+	if(freed)
+		LOG(LOG_INFO,"Cycle collector freed " << freed << " objects");
+}
+
+void CycleCollector::eventBoundary()
+{
+	if(!collectionRequested)
+		return;
+	collectionRequested=false;
+	framesSinceCollection=0;
+	uint32_t freed=collect();
+	LOG(LOG_CALLS,"Requested collection freed " << freed << " objects");
+}
+
+uint32_t CycleCollector::collect()
+{
+	ProfilerScope profilerScope("[gc]");
+	{
+		Locker l(mutex);
+		assert(roots.empty());
+		for(auto it=candidates.begin();it!=candidates.end();++it)
+		{
+			RefCountable* o=*it;
+			if(!ACQUIRE_READ(o->gcPurple))
+				continue;
+			RELEASE_WRITE(o->gcPurple,false);
+			//Keep the root alive while tracing, see releaseCandidate
+			o->gcPinned=true;
+			o->incRef();
+			roots.push_back(o);
+		}
+	}
+	if(roots.empty())
+		return 0;
+	collectionCount++;
+
+	//Find the subgraph reachable from the roots, the pin reference is not accounted
+	phase=GATHER;
+	for(uint32_t i=0;i<roots.size();i++)
+	{
+		nodeData d;
+		d.refs=roots[i]->ref_count-1;
+		d.reachable=false;
+		nodes.insert(make_pair(roots[i],d));
+		workList.push_back(roots[i]);
+	}
+	while(!workList.empty())
+	{
+		RefCountable* o=workList.back();
+		workList.pop_back();
+		o->gcTrace(*this);
+	}
+
+	//Remove the references coming from inside the subgraph
+	phase=SUBTRACT;
+	for(auto it=nodes.begin();it!=nodes.end();++it)
+		it->first->gcTrace(*this);
+
+	//Objects still referenced are alive, and so is everything they reach
+	phase=PROPAGATE;
+	bool consistent=true;
+	for(auto it=nodes.begin();it!=nodes.end();++it)
+	{
+		if(it->second.refs<0)
+			consistent=false;
+		if(it->second.refs>0 && !it->second.reachable)
+		{
+			it->second.reachable=true;
+			workList.push_back(it->first);
+		}
+	}
+	while(!workList.empty())
+	{
+		RefCountable* o=workList.back();
+		workList.pop_back();
+		o->gcTrace(*this);
+	}
+	phase=IDLE;
+
+	std::vector<RefCountable*> garbage;
+	if(consistent)
+	{
+		for(auto it=nodes.begin();it!=nodes.end();++it)
+		{
+			if(!it->second.reachable)
+				garbage.push_back(it->first);
+		}
+	}
+	else
+		LOG(LOG_ERROR,"Cycle collector: an object reported more references than it holds, skipping collection");
+	nodes.clear();
+
+	//Break the cycles, the objects are kept alive until all of them have been cleared
+	for(uint32_t i=0;i<garbage.size();i++)
+		garbage[i]->incRef();
+	for(uint32_t i=0;i<garbage.size();i++)
+		garbage[i]->gcClear();
+
+	std::vector<RefCountable*> pinned;
+	{
+		Locker l(mutex);
+		for(uint32_t i=0;i<roots.size();i++)
+			roots[i]->gcPinned=false;
+		pinned.swap(roots);
+	}
+	for(uint32_t i=0;i<pinned.size();i++)
+		pinned[i]->decRef();
+	for(uint32_t i=0;i<garbage.size();i++)
+		garbage[i]->decRef();
+
+	freedCount+=garbage.size();
+	return garbage.size();
+}
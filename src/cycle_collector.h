@@ -0,0 +1,105 @@
+/**************************************************************************
+    Lightspark, a free flash player implementation
+
+    Copyright (C) 2009-2013  Alessandro Pignotti (a.pignotti@sssup.it)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**************************************************************************/
+
+#ifndef CYCLE_COLLECTOR_H
+#define CYCLE_COLLECTOR_H 1
+
+#include "compat.h"
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+#include "threading.h"
+#include "smartrefs.h"
+
+namespace lightspark
+{
+
+class ASObject;
+
+/*
+ * Synchronous collector for reference cycles, in the spirit of Bacon and Rajan.
+ *
+ * Objects that may close a cycle (closures, captured scopes, event dispatchers,
+ * display objects) are registered as candidates. When a reference to a candidate
+ * is dropped without freeing it the candidate is marked purple. At frame boundaries
+ * the VM thread runs a trial deletion on the subgraph reachable from purple candidates:
+ * references coming from inside the subgraph are subtracted from a copy of the reference
+ * counts, whatever is still referenced from outside is alive, together with everything
+ * it reaches. The rest is garbage: the references between those objects are dropped
+ * with gcClear and the objects are then freed by the regular reference counting.
+ *
+ * Reference counts are not modified during the trial, so other threads can keep
+ * running. Only the VM thread may call collect, frameBoundary and eventBoundary,
+ * and only between events, when no call_context holds references that are not counted.
+ */
+class CycleCollector
+{
+private:
+	struct nodeData
+	{
+		int32_t refs;
+		bool reachable;
+	};
+	enum PHASE { IDLE=0, GATHER, SUBTRACT, PROPAGATE };
+	PHASE phase;
+	//Protects candidates and the gcCandidate/gcPinned flags
+	Mutex mutex;
+	std::unordered_set<RefCountable*> candidates;
+	/* Candidates pinned by the running collection, protected by mutex */
+	std::vector<RefCountable*> roots;
+	std::unordered_map<RefCountable*, nodeData> nodes;
+	std::vector<RefCountable*> workList;
+	uint32_t framesSinceCollection;
+	/* Set by System.gc, honoured after the current event */
+	bool collectionRequested;
+	uint32_t collectionCount;
+	uint64_t freedCount;
+	/* Stop gathering after this many objects, the result is still correct but may miss garbage */
+	static const uint32_t MAX_NODES = 200000;
+	/* Collect at most once every COLLECTION_INTERVAL frames */
+	static const uint32_t COLLECTION_INTERVAL = 30;
+public:
+	CycleCollector();
+	~CycleCollector();
+	/* Registers an object as a possible root of a cycle, VM thread only */
+	void addCandidate(RefCountable* o);
+	/*
+	 * Called when the last reference to a candidate is dropped.
+	 * Returns false if the collector is holding a reference, the dropped one is then released here.
+	 */
+	bool releaseCandidate(RefCountable* o);
+	/* Called when a candidate is deleted without going through decRef */
+	void removeCandidate(RefCountable* o);
+	/* Used by gcTrace implementations to report a counted reference */
+	void visit(RefCountable* child);
+	/* Runs a collection if enough frames have passed since the last one */
+	void frameBoundary();
+	/* Asks for a collection once the current event has been handled, VM thread only */
+	void requestCollection() { collectionRequested=true; }
+	/* Runs the requested collection, if any */
+	void eventBoundary();
+	/* Returns the number of objects found in garbage cycles */
+	uint32_t collect();
+	uint32_t getCandidateCount();
+	uint32_t getCollectionCount() const { return collectionCount; }
+	uint64_t getFreedCount() const { return freedCount; }
+};
+
+};
+#endif /* CYCLE_COLLECTOR_H */
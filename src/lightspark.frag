@@ -25,7 +25,7 @@ void main()
 
 	//Select the right value
 	if (direct == 1.0) {
-		gl_FragColor = ls_FrontColor;
+		gl_FragColor = ls_FrontColor*alpha;
 	} else {
 		gl_FragColor=(vbase*(1.0-yuv))+(val*yuv);
 	}
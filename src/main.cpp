@@ -19,6 +19,8 @@
 
 #include "version.h"
 #include "backends/security.h"
+#include "backends/config.h"
+#include "backends/profiler.h"
 #include "swf.h"
 #include "logger.h"
 #include "platforms/engineutils.h"
@@ -122,6 +124,7 @@ int main(int argc, char* argv[])
 	char* profilingFileName=NULL;
 #endif
 	char *HTTPcookie=NULL;
+	char* sampleProfileFileName=NULL;
 	SecurityManager::SANDBOXTYPE sandboxType=SecurityManager::LOCAL_WITH_FILE;
 	bool useInterpreter=true;
 	bool useFastInterpreter=false;
@@ -200,6 +203,17 @@ int main(int argc, char* argv[])
 			profilingFileName=argv[i];
 		}
 #endif
+		else if(strcmp(argv[i],"-sp")==0 ||
+			strcmp(argv[i],"--sampling-profile")==0)
+		{
+			i++;
+			if(i==argc)
+			{
+				fileName=NULL;
+				break;
+			}
+			sampleProfileFileName=argv[i];
+		}
 		else if(strcmp(argv[i],"-s")==0 || 
 			strcmp(argv[i],"--security-sandbox")==0)
 		{
@@ -255,6 +269,7 @@ int main(int argc, char* argv[])
 			" [--disable-interpreter|-ni] [--enable-fast-interpreter|-fi] [--enable-jit|-j]" <<
 			" [--log-level|-l 0-4] [--parameters-file|-p params-file] [--security-sandbox|-s sandbox]" <<
 			" [--exit-on-error] [--HTTP-cookies cookie] [--air] [--avmplus]" <<
+			" [--sampling-profile|-sp profile-file]" <<
 #ifdef PROFILING_SUPPORT
 			" [--profiling-output|-o profiling-file]" <<
 #endif
@@ -283,6 +298,9 @@ int main(int argc, char* argv[])
 		SystemState::staticDeinit();
 		exit(3);
 	}
+	//Overrides the profiler output of the configuration file
+	if(sampleProfileFileName)
+		SamplingProfiler::start(sampleProfileFileName, Config::getConfig()->getProfilerInterval());
 	//NOTE: see SystemState declaration
 	SystemState* sys = new SystemState(fileSize, flashMode);
 	ParseThread* pt = new ParseThread(f, sys->mainClip);
@@ -18,10 +18,450 @@
 **************************************************************************/
 
 #include "memory_support.h"
+#include "threading.h"
 #include "swf.h"
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 using namespace lightspark;
-#ifdef MEMORY_USAGE_PROFILING
+using namespace std;
+
+namespace
+{
+struct freeChunk
+{
+	freeChunk* next;
+};
+
+struct freeList
+{
+	freeChunk* head;
+	uint32_t count;
+	void push(freeChunk* c)
+	{
+		c->next=head;
+		head=c;
+		count++;
+	}
+	freeChunk* pop()
+	{
+		freeChunk* ret=head;
+		head=ret->next;
+		count--;
+		return ret;
+	}
+};
+
+/* Number of chunks moved at once between a thread cache and the depot */
+const uint32_t BATCH_SIZE = 64;
+/* A thread cache gives back a batch when it holds more than this */
+const uint32_t CACHE_LIMIT = 4*BATCH_SIZE;
+
+struct threadCache
+{
+	freeList lists[SlabAllocator::CLASS_COUNT];
+};
+
+/* Blocks and chunks that are not in any thread cache, protected by depotMutex */
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+StaticMutex depotMutex;
+#else
+StaticMutex depotMutex = GLIBMM_STATIC_MUTEX_INIT;
+#endif
+freeList depot[SlabAllocator::CLASS_COUNT];
+std::vector<char*> blocks[SlabAllocator::CLASS_COUNT];
+
+inline uint32_t chunkSize(uint32_t sizeClass)
+{
+	return (sizeClass+1)*SlabAllocator::GRANULARITY;
+}
+
+inline uint32_t chunksPerBlock(uint32_t sizeClass)
+{
+	return SlabAllocator::BLOCK_SIZE/chunkSize(sizeClass);
+}
+
+/* depotMutex must be held */
+void refillDepot(uint32_t sizeClass)
+{
+	void* mem;
+	aligned_malloc(&mem, SlabAllocator::BLOCK_SIZE, SlabAllocator::BLOCK_SIZE);
+	char* block=(char*)mem;
+	blocks[sizeClass].push_back(block);
+	const uint32_t size=chunkSize(sizeClass);
+	//Push in reverse order, so that chunks are handed out in address order
+	for(int32_t i=chunksPerBlock(sizeClass)-1;i>=0;i--)
+		depot[sizeClass].push(reinterpret_cast<freeChunk*>(block+i*size));
+}
+
+/* depotMutex must be held */
+void moveChunks(freeList& from, freeList& to, uint32_t count)
+{
+	while(count && from.head)
+	{
+		to.push(from.pop());
+		count--;
+	}
+}
+
+void destroyThreadCache(gpointer p)
+{
+	threadCache* cache=reinterpret_cast<threadCache*>(p);
+	Locker l(depotMutex);
+	for(uint32_t i=0;i<SlabAllocator::CLASS_COUNT;i++)
+		moveChunks(cache->lists[i], depot[i], cache->lists[i].count);
+	free(cache);
+}
+
+#if GLIB_CHECK_VERSION(2, 32, 0)
+GPrivate cacheKey = G_PRIVATE_INIT(destroyThreadCache);
+
+threadCache* getThreadCache()
+{
+	threadCache* ret=reinterpret_cast<threadCache*>(g_private_get(&cacheKey));
+	if(ret==NULL)
+	{
+		ret=reinterpret_cast<threadCache*>(calloc(1,sizeof(threadCache)));
+		g_private_set(&cacheKey, ret);
+	}
+	return ret;
+}
+#else
+//Thread local storage with destructors is not available, always use the depot
+threadCache* getThreadCache()
+{
+	return NULL;
+}
+#endif
+}
+
+void* SlabAllocator::allocateSmall(uint32_t sizeClass)
+{
+	threadCache* cache=getThreadCache();
+	if(cache==NULL)
+	{
+		Locker l(depotMutex);
+		if(depot[sizeClass].head==NULL)
+			refillDepot(sizeClass);
+		return depot[sizeClass].pop();
+	}
+	freeList& list=cache->lists[sizeClass];
+	if(list.head==NULL)
+	{
+		Locker l(depotMutex);
+		if(depot[sizeClass].head==NULL)
+			refillDepot(sizeClass);
+		moveChunks(depot[sizeClass], list, BATCH_SIZE);
+	}
+	return list.pop();
+}
+
+void SlabAllocator::deallocateSmall(void* p, uint32_t sizeClass)
+{
+	threadCache* cache=getThreadCache();
+	if(cache==NULL)
+	{
+		Locker l(depotMutex);
+		depot[sizeClass].push(reinterpret_cast<freeChunk*>(p));
+		return;
+	}
+	freeList& list=cache->lists[sizeClass];
+	list.push(reinterpret_cast<freeChunk*>(p));
+	if(list.count>CACHE_LIMIT)
+	{
+		Locker l(depotMutex);
+		moveChunks(list, depot[sizeClass], BATCH_SIZE);
+	}
+}
+
+void SlabAllocator::trim()
+{
+	threadCache* cache=getThreadCache();
+	Locker l(depotMutex);
+	uint32_t released=0;
+	for(uint32_t i=0;i<CLASS_COUNT;i++)
+	{
+		if(cache)
+			moveChunks(cache->lists[i], depot[i], cache->lists[i].count);
+		if(blocks[i].empty())
+			continue;
+		//Count the free chunks of each block
+		std::sort(blocks[i].begin(), blocks[i].end());
+		std::vector<uint32_t> freeCount(blocks[i].size(), 0);
+		for(freeChunk* c=depot[i].head;c;c=c->next)
+		{
+			char* block=(char*)(uintptr_t(c)&~uintptr_t(BLOCK_SIZE-1));
+			auto it=std::lower_bound(blocks[i].begin(), blocks[i].end(), block);
+			assert(it!=blocks[i].end() && *it==block);
+			freeCount[it-blocks[i].begin()]++;
+		}
+		//Unlink the chunks of the blocks that are going to be released
+		const uint32_t total=chunksPerBlock(i);
+		freeList remaining={NULL,0};
+		freeChunk* c=depot[i].head;
+		while(c)
+		{
+			freeChunk* next=c->next;
+			char* block=(char*)(uintptr_t(c)&~uintptr_t(BLOCK_SIZE-1));
+			auto it=std::lower_bound(blocks[i].begin(), blocks[i].end(), block);
+			if(freeCount[it-blocks[i].begin()]!=total)
+				remaining.push(c);
+			c=next;
+		}
+		depot[i]=remaining;
+		std::vector<char*> used;
+		for(uint32_t j=0;j<blocks[i].size();j++)
+		{
+			if(freeCount[j]==total)
+			{
+				aligned_free(blocks[i][j]);
+				released++;
+			}
+			else
+				used.push_back(blocks[i][j]);
+		}
+		blocks[i].swap(used);
+	}
+	if(released)
+		LOG(LOG_INFO,"Released " << released << " slab blocks");
+}
+namespace
+{
+struct accountCounters
+{
+	//Only written by the thread owning them, with relaxed atomics so that they can be read by the others
+	std::atomic<int64_t> bytes;
+	std::atomic<int64_t> objects;
+};
+
+const uint32_t COUNTERS_PER_PAGE = 256;
+const uint32_t MAX_PAGES = 1024;
+
+/* The counters of one thread, pages are allocated when an id is first used by the thread */
+struct threadCounters
+{
+	std::atomic<accountCounters*> pages[MAX_PAGES];
+	threadCounters* prev;
+	threadCounters* next;
+};
+
+/* Protects the list of threads, the retired counters and the accounts */
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+StaticMutex countersMutex;
+#else
+StaticMutex countersMutex = GLIBMM_STATIC_MUTEX_INIT;
+#endif
+threadCounters* liveThreads=NULL;
+//Counters of the threads that have exited, also used when thread local storage is not available
+threadCounters retiredCounters;
+//Indexed by id, NULL for the free ids. Id 0 is never used
+std::vector<const MemoryAccount*> accounts(1, NULL);
+//Ids of the destroyed accounts, some memory counted on them may still be alive
+std::deque<uint32_t> releasedIds;
+/* How many released ids are checked for reuse when an account is created */
+const uint32_t REUSE_CHECKS = 8;
+
+accountCounters* getCounters(threadCounters* t, uint32_t id)
+{
+	std::atomic<accountCounters*>& page=t->pages[id/COUNTERS_PER_PAGE];
+	accountCounters* ret=page.load(std::memory_order_acquire);
+	if(ret==NULL)
+	{
+		ret=new accountCounters[COUNTERS_PER_PAGE]();
+		page.store(ret, std::memory_order_release);
+	}
+	return ret+(id%COUNTERS_PER_PAGE);
+}
+
+inline void addCounter(std::atomic<int64_t>& c, int64_t v)
+{
+	c.store(c.load(std::memory_order_relaxed)+v, std::memory_order_relaxed);
+}
+
+/* countersMutex must be held */
+void sumCounters(uint32_t id, int64_t& bytes, int64_t& objects)
+{
+	bytes=0;
+	objects=0;
+	for(threadCounters* t=&retiredCounters;t;t=(t==&retiredCounters)?liveThreads:t->next)
+	{
+		accountCounters* page=t->pages[id/COUNTERS_PER_PAGE].load(std::memory_order_acquire);
+		if(page==NULL)
+			continue;
+		bytes+=page[id%COUNTERS_PER_PAGE].bytes.load(std::memory_order_relaxed);
+		objects+=page[id%COUNTERS_PER_PAGE].objects.load(std::memory_order_relaxed);
+	}
+}
+
+/* Returns a released id whose memory has all been freed, or 0. countersMutex must be held */
+uint32_t findReusableId()
+{
+	for(uint32_t i=0;i<REUSE_CHECKS && !releasedIds.empty();i++)
+	{
+		uint32_t id=releasedIds.front();
+		releasedIds.pop_front();
+		int64_t bytes, objects;
+		sumCounters(id, bytes, objects);
+		if(bytes==0 && objects==0)
+			return id;
+		//Still in use, check it again later
+		releasedIds.push_back(id);
+	}
+	return 0;
+}
+
+void retireThreadCounters(gpointer p)
+{
+	threadCounters* t=reinterpret_cast<threadCounters*>(p);
+	Locker l(countersMutex);
+	if(t->prev)
+		t->prev->next=t->next;
+	else
+		liveThreads=t->next;
+	if(t->next)
+		t->next->prev=t->prev;
+	for(uint32_t i=0;i<MAX_PAGES;i++)
+	{
+		accountCounters* page=t->pages[i].load(std::memory_order_relaxed);
+		if(page==NULL)
+			continue;
+		for(uint32_t j=0;j<COUNTERS_PER_PAGE;j++)
+		{
+			accountCounters* c=getCounters(&retiredCounters, i*COUNTERS_PER_PAGE+j);
+			addCounter(c->bytes, page[j].bytes.load(std::memory_order_relaxed));
+			addCounter(c->objects, page[j].objects.load(std::memory_order_relaxed));
+		}
+		delete[] page;
+	}
+	delete t;
+}
+
+#if GLIB_CHECK_VERSION(2, 32, 0)
+GPrivate countersKey = G_PRIVATE_INIT(retireThreadCounters);
+
+threadCounters* getThreadCounters()
+{
+	threadCounters* ret=reinterpret_cast<threadCounters*>(g_private_get(&countersKey));
+	if(ret==NULL)
+	{
+		ret=new threadCounters();
+		Locker l(countersMutex);
+		ret->next=liveThreads;
+		if(liveThreads)
+			liveThreads->prev=ret;
+		liveThreads=ret;
+		g_private_set(&countersKey, ret);
+	}
+	return ret;
+}
+#else
+threadCounters* getThreadCounters()
+{
+	return NULL;
+}
+#endif
+}
+
+MemoryAccount::MemoryAccount(const tiny_string& n):name(n)
+{
+	Locker l(countersMutex);
+	id=findReusableId();
+	if(id)
+		accounts[id]=this;
+	else
+	{
+		id=accounts.size();
+		if(id>=MAX_PAGES*COUNTERS_PER_PAGE)
+		{
+			//Out of ids, do not account this one
+			id=0;
+		}
+		else
+			accounts.push_back(this);
+	}
+}
+
+MemoryAccount::~MemoryAccount()
+{
+	if(id==0)
+		return;
+	Locker l(countersMutex);
+	accounts[id]=NULL;
+	releasedIds.push_back(id);
+}
+
+void MemoryAccount::count(uint32_t id, int64_t bytes, int64_t objects)
+{
+	if(id==0)
+		return;
+	threadCounters* t=getThreadCounters();
+	if(t==NULL)
+	{
+		Locker l(countersMutex);
+		accountCounters* c=getCounters(&retiredCounters, id);
+		addCounter(c->bytes, bytes);
+		addCounter(c->objects, objects);
+		return;
+	}
+	accountCounters* c=getCounters(t, id);
+	addCounter(c->bytes, bytes);
+	addCounter(c->objects, objects);
+}
+
+int64_t MemoryAccount::getBytes() const
+{
+	if(id==0)
+		return 0;
+	int64_t bytes, objects;
+	Locker l(countersMutex);
+	sumCounters(id, bytes, objects);
+	return bytes;
+}
+
+int64_t MemoryAccount::getObjects() const
+{
+	if(id==0)
+		return 0;
+	int64_t bytes, objects;
+	Locker l(countersMutex);
+	sumCounters(id, bytes, objects);
+	return objects;
+}
+
+void MemoryAccount::listUsage(std::vector<Usage>& out)
+{
+	Locker l(countersMutex);
+	for(uint32_t i=1;i<accounts.size();i++)
+	{
+		const MemoryAccount* a=accounts[i];
+		if(a==NULL)
+			continue;
+		Usage u;
+		u.name=a->name;
+		sumCounters(i, u.bytes, u.objects);
+		out.push_back(u);
+	}
+}
+
+uint64_t MemoryAccount::getTotalBytes()
+{
+	int64_t ret=0;
+	Locker l(countersMutex);
+	for(uint32_t i=1;i<accounts.size();i++)
+	{
+		if(accounts[i]==NULL)
+			continue;
+		int64_t bytes, objects;
+		sumCounters(i, bytes, objects);
+		ret+=bytes;
+	}
+	return max(ret, int64_t(0));
+}
+
 MemoryAccount* lightspark::getUnaccountedMemoryAccount()
 {
 	if(getSys())
@@ -29,4 +469,25 @@ MemoryAccount* lightspark::getUnaccountedMemoryAccount()
 	else
 		return NULL;
 }
+
+uint64_t lightspark::getResidentMemory()
+{
+#ifdef __linux__
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size=0;
+	uint64_t resident=0;
+	statm >> size >> resident;
+	if(!statm)
+		return 0;
+	return resident*sysconf(_SC_PAGESIZE);
+#else
+	return 0;
 #endif
+}
+
+void tiny_string::reportMemoryChange(int32_t change) const
+{
+	SystemState* sys=getSys();
+	if(sys && sys->stringMemory)
+		MemoryAccount::count(sys->stringMemory->getId(), change, 0);
+}
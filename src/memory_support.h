@@ -23,28 +23,91 @@
 #include "compat.h"
 #include "tiny_string.h"
 #include <malloc.h>
+#include <vector>
 
 namespace lightspark
 {
 
-#ifdef MEMORY_USAGE_PROFILING
-class MemoryAccount
+/*
+ * Allocator for small objects, sizes are rounded up to a multiple of GRANULARITY
+ * and each size class is carved from BLOCK_SIZE aligned blocks.
+ * Every thread keeps a cache of free chunks for each size class, chunks are moved
+ * in batches between the thread caches and a global depot, so the common path
+ * does not take any lock. Requests larger than MAX_SIZE are forwarded to malloc.
+ * Since chunks do not carry a header the size must be passed back on deallocation.
+ */
+class DLL_PUBLIC SlabAllocator
 {
 public:
-	tiny_string name;
-	ATOMIC_INT32(bytes);
+	static const uint32_t GRANULARITY = 16;
+	static const uint32_t MAX_SIZE = 512;
+	static const uint32_t CLASS_COUNT = MAX_SIZE/GRANULARITY;
+	static const uint32_t BLOCK_SIZE = 64*1024;
+	static void* allocate(size_t size)
+	{
+		if(size>MAX_SIZE || size==0)
+			return malloc(size);
+		return allocateSmall((size-1)/GRANULARITY);
+	}
+	static void deallocate(void* p, size_t size)
+	{
+		if(p==NULL)
+			return;
+		if(size>MAX_SIZE || size==0)
+			free(p);
+		else
+			deallocateSmall(p, (size-1)/GRANULARITY);
+	}
 	/*
-	 * The name pointer is not copied and must survive
+	 * Returns the blocks that are completely free to the system.
+	 * Only the cache of the calling thread is considered.
 	 */
-	MemoryAccount(const tiny_string& n):name(n),bytes(0){}
+	static void trim();
+private:
+	static void* allocateSmall(uint32_t sizeClass);
+	static void deallocateSmall(void* p, uint32_t sizeClass);
+};
+
+/*
+ * Live memory accounting.
+ *
+ * Every account has an id, which indexes the counters of each thread. A thread only
+ * writes its own counters, so counting does not need any lock or atomic operation.
+ * The counters of all the threads are summed when the usage of an account is read.
+ * Memory may outlive its account and is still counted on the id when it is freed,
+ * so the id of a destroyed account is only reused once its counters are back to zero.
+ */
+class DLL_PUBLIC MemoryAccount
+{
+private:
+	uint32_t id;
+public:
+	tiny_string name;
+	MemoryAccount(const tiny_string& n);
+	~MemoryAccount();
+	uint32_t getId() const { return id; }
 	void addBytes(uint32_t b)
 	{
-		ATOMIC_ADD(this->bytes, b);
+		count(id, b, 0);
 	}
 	void removeBytes(uint32_t b)
 	{
-		ATOMIC_SUB(this->bytes, b);
+		count(id, -int64_t(b), 0);
 	}
+	int64_t getBytes() const;
+	int64_t getObjects() const;
+	/* Adds bytes and objects to the counters of the calling thread, id 0 is not accounted */
+	static void count(uint32_t id, int64_t bytes, int64_t objects);
+	struct Usage
+	{
+		tiny_string name;
+		int64_t bytes;
+		int64_t objects;
+	};
+	/* Appends the usage of every live account */
+	static void listUsage(std::vector<Usage>& out);
+	/* Bytes of all the live accounts */
+	static uint64_t getTotalBytes();
 };
 
 //Since global overloaded delete can't be called explicitly, memory reporting is only
@@ -52,10 +115,11 @@ public:
 class memory_reporter
 {
 private:
+	//Keeps the objects 8 bytes aligned
 	struct objData
 	{
 		uint32_t objSize;
-		MemoryAccount* memoryAccount;
+		uint32_t accountId;
 	};
 public:
 	//Placement new and delete
@@ -72,22 +136,24 @@ public:
 		//Prepend some internal data.
 		//Adding the data to the object itself would not work
 		//since it can be reset by the constructors
-		objData* ret=reinterpret_cast<objData*>(malloc(size+sizeof(objData)));
-		m->addBytes(size);
+		objData* ret=reinterpret_cast<objData*>(SlabAllocator::allocate(size+sizeof(objData)));
 		ret->objSize = size;
-		ret->memoryAccount = m;
+		ret->accountId = m ? m->getId() : 0;
+		MemoryAccount::count(ret->accountId, size, 1);
 		return ret+1;
 	}
 	inline void operator delete( void* obj )
 	{
 		//Get back the metadata
 		objData* th=reinterpret_cast<objData*>(obj)-1;
-		th->memoryAccount->removeBytes(th->objSize);
-		free(th);
+		MemoryAccount::count(th->accountId, -int64_t(th->objSize), -1);
+		SlabAllocator::deallocate(th, th->objSize+sizeof(objData));
 	}
 };
 
 DLL_PUBLIC MemoryAccount* getUnaccountedMemoryAccount();
+/* Resident memory of the process, 0 if it is not known */
+DLL_PUBLIC uint64_t getResidentMemory();
 
 template<class T>
 class reporter_allocator: protected std::allocator<T>
@@ -100,6 +166,8 @@ template<class U, class V>
 friend bool operator!=(const reporter_allocator<U>& a, const reporter_allocator<V>& b);
 private:
 	MemoryAccount* memoryAccount;
+	//Accounts may be destroyed before the containers using them, only the id is used to count
+	uint32_t accountId;
 	reporter_allocator();
 public:
 	typedef typename std::allocator<T>::size_type size_type;
@@ -114,24 +182,27 @@ public:
 	{
 		typedef reporter_allocator<U> other;
 	};
-	reporter_allocator(MemoryAccount* m):memoryAccount(m)
+	reporter_allocator(MemoryAccount* m):memoryAccount(m),accountId(m ? m->getId() : 0)
 	{
 	}
 	template<class U>
-	reporter_allocator(const reporter_allocator<U>& o):std::allocator<T>(o), memoryAccount(o.memoryAccount)
+	reporter_allocator(const reporter_allocator<U>& o):std::allocator<T>(o), memoryAccount(o.memoryAccount), accountId(o.accountId)
 	{
 	}
 	pointer allocate(size_type n, std::allocator<void>::const_pointer hint=0)
 	{
 		if(memoryAccount==NULL)
+		{
 			memoryAccount=getUnaccountedMemoryAccount();
-		memoryAccount->addBytes(n*sizeof(T));
-		return (pointer)malloc(n*sizeof(T));
+			accountId=memoryAccount ? memoryAccount->getId() : 0;
+		}
+		MemoryAccount::count(accountId, n*sizeof(T), 0);
+		return (pointer)SlabAllocator::allocate(n*sizeof(T));
 	}
 	void deallocate(pointer p, size_type n)
 	{
-		memoryAccount->removeBytes(n*sizeof(T));
-		free(p);
+		MemoryAccount::count(accountId, -int64_t(n*sizeof(T)), 0);
+		SlabAllocator::deallocate(p, n*sizeof(T));
 	}
 	template<class... args>
 	void construct(pointer p, args&&... vals)
@@ -162,51 +233,5 @@ bool operator!=(const reporter_allocator<T>& a,
 	return a.memoryAccount != b.memoryAccount;
 }
 
-#else //MEMORY_USAGE_PROFILING
-
-class MemoryAccount;
-
-class memory_reporter
-{
-public:
-	//Placement new and delete
-	inline void* operator new( size_t size, void *p )
-	{
-		return p;
-	}
-	inline void operator delete( void*, void* )
-	{
-	}
-	//Regular allocator
-	inline void* operator new( size_t size, MemoryAccount* m)
-	{
-		return malloc(size);
-	}
-	inline void operator delete( void* obj )
-	{
-		free(obj);
-	}
-};
-
-template<class T>
-class reporter_allocator: public std::allocator<T>
-{
-public:
-	template<class U>
-	struct rebind
-	{
-		typedef reporter_allocator<U> other;
-	};
-	reporter_allocator(MemoryAccount* m)
-	{
-	}
-	template<class U>
-	reporter_allocator(const reporter_allocator<U>& o):std::allocator<T>(o)
-	{
-	}
-};
-
-#endif //MEMORY_USAGE_PROFILING
-
 };
 #endif /* MEMORY_SUPPORT_H */
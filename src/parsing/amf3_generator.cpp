@@ -57,13 +57,10 @@ _R<ASObject> Amf3Deserializer::parseDouble() const
 		uint64_t dummy;
 		double val;
 	} tmp;
-	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
-
-	for(uint32_t i=0;i<8;i++)
-	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse double");
-	}
+	const uint8_t* src=input->readRawBytes(8);
+	if(src==NULL)
+		throw ParseException("Not enough data to parse double");
+	memcpy(&tmp.dummy,src,8);
 	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
 	return _MR(abstract_d(input->getSystemState(),tmp.val));
 }
@@ -75,13 +72,10 @@ _R<ASObject> Amf3Deserializer::parseDate() const
 		uint64_t dummy;
 		double val;
 	} tmp;
-	uint8_t* tmpPtr=reinterpret_cast<uint8_t*>(&tmp.dummy);
-
-	for(uint32_t i=0;i<8;i++)
-	{
-		if(!input->readByte(tmpPtr[i]))
-			throw ParseException("Not enough data to parse date");
-	}
+	const uint8_t* src=input->readRawBytes(8);
+	if(src==NULL)
+		throw ParseException("Not enough data to parse date");
+	memcpy(&tmp.dummy,src,8);
 	tmp.dummy=GINT64_FROM_BE(tmp.dummy);
 	Date* dt = Class<Date>::getInstanceS(input->getSystemState());
 	dt->MakeDateFromMilliseconds((int64_t)tmp.val);
@@ -103,16 +97,12 @@ tiny_string Amf3Deserializer::parseStringVR(std::vector<tiny_string>& stringMap)
 	}
 
 	uint32_t strLen=strRef>>1;
-	string retStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		retStr.push_back(c);
-	}
+	const uint8_t* src=input->readRawBytes(strLen);
+	if(src==NULL)
+		throw ParseException("Not enough data to parse string");
+	tiny_string retStr=tiny_string::fromBytes(reinterpret_cast<const char*>(src),strLen);
 	//Add string to the map, if it's not the empty one
-	if(retStr.size())
+	if(strLen)
 		stringMap.emplace_back(retStr);
 	return retStr;
 }
@@ -463,14 +453,10 @@ _R<ASObject> Amf3Deserializer::parseXML(std::vector<ASObject*>& objMap, bool leg
 	}
 
 	uint32_t strLen=xmlRef>>1;
-	string xmlStr;
-	for(uint32_t i=0;i<strLen;i++)
-	{
-		uint8_t c;
-		if(!input->readByte(c))
-			throw ParseException("Not enough data to parse string");
-		xmlStr.push_back(c);
-	}
+	const uint8_t* src=input->readRawBytes(strLen);
+	if(src==NULL)
+		throw ParseException("Not enough data to parse string");
+	string xmlStr(reinterpret_cast<const char*>(src),strLen);
 
 	ASObject *xmlObj;
 	if(legacyXML)
@@ -24,6 +24,7 @@
 #include "scripting/flash/utils/ByteArray.h"
 #include "scripting/class.h"
 #include "scripting/toplevel/toplevel.h"
+#include "scripting/toplevel/Array.h"
 #include "amf3_generator.h"
 
 using namespace lightspark;
@@ -255,3 +256,79 @@ AudioDataTag::~AudioDataTag()
 	if (packetData)
 		aligned_free(packetData);
 }
+
+bool FLVKeyframeIndex::addFromMetadata(const std::list<_NR<ASObject> >& dataobjectlist)
+{
+	if(dataobjectlist.empty() || dataobjectlist.front().isNull())
+		return false;
+	_NR<ASObject> table=dataobjectlist.front()->getVariableByMultiname("keyframes",{""});
+	if(table.isNull())
+		return false;
+	_NR<ASObject> positions=table->getVariableByMultiname("filepositions",{""});
+	_NR<ASObject> times=table->getVariableByMultiname("times",{""});
+	if(positions.isNull() || times.isNull() || !positions->is<Array>() || !times->is<Array>())
+		return false;
+	Array* p=positions->as<Array>();
+	Array* t=times->as<Array>();
+	uint64_t count=std::min(p->size(),t->size());
+	for(uint64_t i=0;i<count;i++)
+	{
+		number_t position=p->at(i)->toNumber();
+		number_t time=t->at(i)->toNumber();
+		//File positions point to the tag, step back to its PreviousTagSize
+		if(position<4 || time<0)
+			continue;
+		keyframes[time*1000]=position-4;
+	}
+	LOG(LOG_INFO,"FLV: " << keyframes.size() << " keyframes in metadata");
+	return count!=0;
+}
+
+void FLVKeyframeIndex::addTag(uint32_t offset, uint32_t nextOffset, bool keyframe, uint32_t time)
+{
+	if(offset!=scannedUntil)
+		return;
+	if(keyframe)
+		keyframes.insert(make_pair(time, offset));
+	scannedUntil=nextOffset;
+}
+
+void FLVKeyframeIndex::scan(std::istream& s, uint32_t limit, uint32_t time)
+{
+	//PreviousTagSize, tag header and the video frame type
+	const uint32_t headerLen=4+11+1;
+	while(scannedUntil+headerLen<=limit && !covers(time))
+	{
+		s.clear();
+		s.seekg(scannedUntil);
+		uint8_t header[headerLen];
+		s.read((char*)header,headerLen);
+		if(!s)
+			break;
+		uint32_t dataSize=(header[5]<<16)|(header[6]<<8)|header[7];
+		uint32_t timestamp=(header[8]<<16)|(header[9]<<8)|header[10]|(uint32_t(header[11])<<24);
+		bool keyframe=(header[4]==9) && (header[15]>>4)==1;
+		addTag(scannedUntil, scannedUntil+11+dataSize+4, keyframe, timestamp);
+	}
+}
+
+bool FLVKeyframeIndex::find(uint32_t time, uint32_t limit, uint32_t& keyTime, uint32_t& offset) const
+{
+	auto it=keyframes.upper_bound(time);
+	while(it!=keyframes.begin())
+	{
+		--it;
+		if(it->second<limit)
+		{
+			keyTime=it->first;
+			offset=it->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FLVKeyframeIndex::covers(uint32_t time) const
+{
+	return !keyframes.empty() && keyframes.rbegin()->first>time;
+}
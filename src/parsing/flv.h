@@ -57,6 +57,7 @@ public:
 	VideoTag(std::istream& s);
 	uint32_t getDataSize() const { return dataSize; }
 	uint32_t getTotalLen() const { return totalLen; }
+	uint32_t getTimestamp() const { return timestamp; }
 };
 
 class ScriptDataTag: public VideoTag
@@ -87,6 +88,34 @@ public:
 	bool isHeader() const { return _isHeader; }
 };
 
+/*
+   Positions of the keyframes of a FLV stream, indexed by their time in milliseconds.
+   Positions are the offsets of the PreviousTagSize field before the keyframe tag,
+   where the stream decoder can resume reading.
+*/
+class FLVKeyframeIndex
+{
+private:
+	std::map<uint32_t, uint32_t> keyframes;
+	//All the keyframes before this offset are known
+	uint32_t scannedUntil;
+public:
+	FLVKeyframeIndex(uint32_t dataOffset):scannedUntil(dataOffset){}
+	/* Reads the keyframes table found in onMetaData, if any */
+	bool addFromMetadata(const std::list<_NR<ASObject> >& dataobjectlist);
+	/* Records a tag found while decoding, only contiguous tags extend the scanned range */
+	void addTag(uint32_t offset, uint32_t nextOffset, bool keyframe, uint32_t time);
+	/*
+	   Reads only the tag headers from the end of the scanned range up to limit,
+	   stops early when a keyframe after time is found
+	*/
+	void scan(std::istream& s, uint32_t limit, uint32_t time);
+	/* Finds the last keyframe not after time whose data is before limit */
+	bool find(uint32_t time, uint32_t limit, uint32_t& keyTime, uint32_t& offset) const;
+	/* True if a keyframe after time is known, so time is inside the indexed range */
+	bool covers(uint32_t time) const;
+};
+
 class AudioDataTag: public VideoTag
 {
 private:
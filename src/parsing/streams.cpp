@@ -23,6 +23,7 @@
 #include "compat.h"
 #include "class.h"
 #include "toplevel/Error.h"
+#include "backends/streamcache.h"
 #include <cstdlib>
 #include <cstring>
 #include <assert.h>
@@ -50,6 +51,9 @@ int uncompressing_filter::underflow()
 
 	int available=fillBuffer();
 	setg(buffer,buffer,buffer+available);
+	//The stream may end right at the end of the previous buffer
+	if(available==0)
+		return -1;
 	
 	//Cast to unsigned, otherwise 0xff would become eof
 	return (unsigned char)buffer[0];
@@ -115,6 +119,127 @@ int zlib_filter::fillBuffer()
 	return sizeof(buffer) - strm.avail_out;
 }
 
+readahead_filter::readahead_filter(uncompressing_filter* s, unsigned int readAhead):
+	source(s),head(0),count(0),reading(false),eof(false),stopped(false),consumed(0)
+{
+	//Two chunks at least, so that the worker can fill one while the other is read
+	unsigned int chunks=max(2u, (readAhead+CHUNK_LENGTH-1)/CHUNK_LENGTH);
+	ring.resize(chunks);
+	for(unsigned int i=0;i<chunks;i++)
+	{
+		ring[i].data=new char[CHUNK_LENGTH];
+		ring[i].len=0;
+	}
+	setg(NULL,NULL,NULL);
+#ifdef HAVE_NEW_GLIBMM_THREAD_API
+	thread = lightspark::Thread::create(sigc::mem_fun(this,&readahead_filter::worker));
+#else
+	thread = lightspark::Thread::create(sigc::mem_fun(this,&readahead_filter::worker),true);
+#endif
+}
+
+readahead_filter::~readahead_filter()
+{
+	mutex.lock();
+	stopped=true;
+	bool running=!eof && error.empty();
+	freed.signal();
+	mutex.unlock();
+	//The worker may be waiting for compressed data of a stalled download, make the source end
+	if(running)
+	{
+		lightspark::InterruptibleReader* r=dynamic_cast<lightspark::InterruptibleReader*>(source->getBackend());
+		if(r)
+			r->interrupt();
+	}
+	thread->join();
+	for(unsigned int i=0;i<ring.size();i++)
+		delete[] ring[i].data;
+	delete source;
+}
+
+void readahead_filter::worker()
+{
+	while(1)
+	{
+		mutex.lock();
+		while(count==ring.size() && !stopped)
+			freed.wait(mutex);
+		if(stopped)
+		{
+			mutex.unlock();
+			return;
+		}
+		chunk& c=ring[(head+count)%ring.size()];
+		mutex.unlock();
+
+		//The consumer does not touch chunks past the filled ones, so no lock is needed
+		streamsize len=0;
+		string failure;
+		try
+		{
+			len=source->sgetn(c.data, CHUNK_LENGTH);
+		}
+		catch(lightspark::LightsparkException& e)
+		{
+			failure=e.cause;
+		}
+
+		lightspark::Locker l(mutex);
+		if(!failure.empty())
+		{
+			error=failure;
+			filled.signal();
+			return;
+		}
+		if(len!=0)
+		{
+			c.len=len;
+			count++;
+		}
+		if(len<(streamsize)CHUNK_LENGTH)
+			eof=true;
+		filled.signal();
+		if(eof)
+			return;
+	}
+}
+
+int readahead_filter::underflow()
+{
+	lightspark::Locker l(mutex);
+	if(reading)
+	{
+		//Give back the chunk that has been read
+		consumed+=(egptr()-eback());
+		head=(head+1)%ring.size();
+		count--;
+		reading=false;
+		setg(NULL,NULL,NULL);
+		freed.signal();
+	}
+	while(count==0 && !eof && error.empty())
+		filled.wait(mutex);
+	if(count==0)
+	{
+		if(!error.empty())
+			throw lightspark::ParseException(error);
+		return -1;
+	}
+	chunk& c=ring[head];
+	reading=true;
+	setg(c.data,c.data,c.data+c.len);
+	//Cast to unsigned, otherwise 0xff would become eof
+	return (unsigned char)c.data[0];
+}
+
+streampos readahead_filter::seekoff(off_type off, ios_base::seekdir dir,ios_base::openmode mode)
+{
+	assert(off==0);
+	assert(dir==ios_base::cur);
+	return consumed+(gptr()-eback());
+}
+
 bytes_buf::bytes_buf(const uint8_t* b, int l):buf(b),len(l)
 {
 	setg((char*)buf,(char*)buf,(char*)buf+len);
@@ -26,6 +26,9 @@
 #include <streambuf>
 #include <fstream>
 #include <cinttypes>
+#include <string>
+#include <vector>
+#include "threading.h"
 #include <zlib.h>
 #include <lzma.h>
 
@@ -51,6 +54,7 @@ protected:
 	virtual int fillBuffer()=0;
 public:
 	uncompressing_filter(std::streambuf* b);
+	std::streambuf* getBackend() const { return backend; }
 };
 
 
@@ -80,6 +84,49 @@ public:
 	~liblzma_filter();
 };
 
+/*
+ * Runs an uncompressing_filter on its own thread, ahead of the reader, so that
+ * decompression overlaps with parsing. The uncompressed data goes into a bounded
+ * ring of chunks, which the reader accesses in place without copying.
+ * Takes the ownership of the source filter.
+ */
+class readahead_filter: public std::streambuf
+{
+private:
+	static const unsigned int CHUNK_LENGTH = 64*1024;
+	struct chunk
+	{
+		char* data;
+		unsigned int len;
+	};
+	uncompressing_filter* source;
+	std::vector<chunk> ring;
+	// The chunk being read by the consumer, or the next one
+	unsigned int head;
+	// Filled chunks, including the one being read
+	unsigned int count;
+	bool reading;
+	bool eof;
+	bool stopped;
+	// Set by the worker when decompression fails, thrown to the reader
+	std::string error;
+	lightspark::Mutex mutex;
+	lightspark::Cond filled;
+	lightspark::Cond freed;
+	lightspark::Thread* thread;
+	// Total number of bytes in the chunks already given back
+	int consumed;
+	void worker();
+protected:
+	virtual int underflow();
+	virtual std::streampos seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode);
+public:
+	// readAhead is the amount of uncompressed bytes to keep ready
+	readahead_filter(uncompressing_filter* s, unsigned int readAhead);
+	// Interrupts the source if it is a stream cache reader, as the worker may be waiting for data
+	~readahead_filter();
+};
+
 class bytes_buf:public std::streambuf
 {
 private:
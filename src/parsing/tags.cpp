@@ -1730,7 +1730,9 @@ void StartSoundTag::play(const DefineSoundTag *soundTag) const
 		soundTag->getSoundData(),
 		AudioFormat(soundTag->getAudioCodec(),
 			    soundTag->getSampleRate(),
-			    soundTag->getChannels()));
+			    soundTag->getChannels()),
+		NullRef,
+		SoundInfo.HasLoops ? int32_t(SoundInfo.LoopCount) : 1);
 
 	// SoundChannel thread keeps one reference, which will be
 	// removed thread is finished
@@ -128,6 +128,7 @@
 #include "scripting/class.h"
 #include "exceptions.h"
 #include "scripting/abc.h"
+#include "backends/profiler.h"
 
 using namespace std;
 using namespace lightspark;
@@ -153,14 +154,10 @@ DoABCTag::DoABCTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 
 	RootMovieClip* root=getParseThread()->getRootMovie();
 	root->incRef();
-	context=new ABCContext(_MR(root), in, getVm(root->getSystemState()));
-
-	int pos=in.tellg();
-	if(dest!=pos)
-	{
-		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << dest-in.tellg());
+	int len=dest-in.tellg();
+	if(len<0)
 		throw ParseException("Not complete ABC data");
-	}
+	context=new ABCContext(_MR(root), in, len, getVm(root->getSystemState()));
 }
 
 void DoABCTag::execute(RootMovieClip* root) const
@@ -179,14 +176,10 @@ DoABCDefineTag::DoABCDefineTag(RECORDHEADER h, std::istream& in):ControlTag(h)
 
 	RootMovieClip* root=getParseThread()->getRootMovie();
 	root->incRef();
-	context=new ABCContext(_MR(root), in, getVm(root->getSystemState()));
-
-	int pos=in.tellg();
-	if(dest!=pos)
-	{
-		LOG(LOG_ERROR,_("Corrupted ABC data: missing ") << dest-in.tellg());
+	int len=dest-in.tellg();
+	if(len<0)
 		throw ParseException("Not complete ABC data");
-	}
+	context=new ABCContext(_MR(root), in, len, getVm(root->getSystemState()));
 }
 
 void DoABCDefineTag::execute(RootMovieClip* root) const
@@ -493,6 +486,10 @@ void ABCVm::registerClasses()
 	builtin->registerBuiltin("LoaderContext","flash.system",Class<LoaderContext>::getRef(m_sys));
 	builtin->registerBuiltin("System","flash.system",Class<System>::getRef(m_sys));
 	builtin->registerBuiltin("Worker","flash.system",Class<ASWorker>::getRef(m_sys));
+	builtin->registerBuiltin("WorkerDomain","flash.system",Class<WorkerDomain>::getRef(m_sys));
+	builtin->registerBuiltin("WorkerState","flash.system",Class<WorkerState>::getRef(m_sys));
+	builtin->registerBuiltin("MessageChannel","flash.system",Class<MessageChannel>::getRef(m_sys));
+	builtin->registerBuiltin("MessageChannelState","flash.system",Class<MessageChannelState>::getRef(m_sys));
 	builtin->registerBuiltin("ImageDecodingPolicy","flash.system",Class<ImageDecodingPolicy>::getRef(m_sys));
 	
 
@@ -912,7 +909,8 @@ multiname* ABCContext::getMultinameImpl(ASObject* n, ASObject* n2, unsigned int
 	return ret;
 }
 
-ABCContext::ABCContext(_R<RootMovieClip> r, istream& in, ABCVm* vm):root(r),constant_pool(vm->vmDataMemory),
+ABCContext::ABCContext(_R<RootMovieClip> r, istream& stream, uint32_t len, ABCVm* vm):
+	data(len, 0, reporter_allocator<uint8_t>(vm->vmDataMemory)),root(r),constant_pool(vm->vmDataMemory),
 	methods(reporter_allocator<method_info>(vm->vmDataMemory)),
 	metadata(reporter_allocator<metadata_info>(vm->vmDataMemory)),
 	instances(reporter_allocator<instance_info>(vm->vmDataMemory)),
@@ -920,6 +918,11 @@ ABCContext::ABCContext(_R<RootMovieClip> r, istream& in, ABCVm* vm):root(r),cons
 	scripts(reporter_allocator<script_info>(vm->vmDataMemory)),
 	method_body(reporter_allocator<method_body_info>(vm->vmDataMemory))
 {
+	if(len)
+		stream.read((char*)&data[0],len);
+	if(uint32_t(stream.gcount())!=len)
+		throw ParseException("Truncated ABC data");
+	abc_reader in(data.data(),len);
 	in >> minor >> major;
 	LOG(LOG_CALLS,_("ABCVm version ") << major << '.' << minor);
 	in >> constant_pool;
@@ -982,11 +985,18 @@ ABCContext::ABCContext(_R<RootMovieClip> r, istream& in, ABCVm* vm):root(r),cons
 		in >> method_body[i];
 
 		//Link method body with method signature
+		if(method_body[i].method>=method_count)
+			throw ParseException("Body of a non existent method");
 		if(methods[method_body[i].method].body!=NULL)
 			throw ParseException("Duplicated body for function");
 		else
 			methods[method_body[i].method].body=&method_body[i];
 	}
+	if(in.remaining())
+	{
+		LOG(LOG_ERROR,_("Corrupted ABC data: ") << in.remaining() << _(" bytes left"));
+		throw ParseException("Not complete ABC data");
+	}
 
 	hasRunScriptInit.resize(scripts.size(),false);
 #ifdef PROFILING_SUPPORT
@@ -1029,10 +1039,11 @@ void ABCContext::dumpProfilingData(ostream& f) const
 /*
  * nextNamespaceBase is set to 2 since 0 is the empty namespace and 1 is the AS3 namespace
  */
-ABCVm::ABCVm(SystemState* s, MemoryAccount* m):m_sys(s),status(CREATED),shuttingdown(false),
-	events_queue(reporter_allocator<eventType>(m)),nextNamespaceBase(2),currentCallContext(NULL),
-	vmDataMemory(m),cur_recursion(0)
+ABCVm::ABCVm(SystemState* s, MemoryAccount* m):m_sys(s),status(CREATED),events_consumer_waiting(false),shuttingdown(false),
+	events_queue(reporter_allocator<queuedEvent>(m)),events_batch(NULL),events_queue_depth(0),events_producers(0),
+	nextNamespaceBase(2),currentCallContext(NULL),vmDataMemory(m),cur_recursion(0)
 {
+	memset(eventStats,0,sizeof(eventStats));
 	limits.max_recursion = 256;
 	limits.script_timeout = 20;
 	m_sys=s;
@@ -1068,7 +1079,14 @@ void ABCVm::finalize()
 	//The event queue may be not empty if the VM has been been started
 	if(status==CREATED && !events_queue.empty())
 		LOG(LOG_ERROR, "Events queue is not empty as expected");
-	events_queue.clear();
+	eventQueue::Node* n=events_queue.popAll();
+	while(n)
+	{
+		eventQueue::Node* next=n->next;
+		events_queue.release(n);
+		n=next;
+	}
+	events_queue_depth=0;
 }
 
 
@@ -1080,7 +1098,23 @@ ABCVm::~ABCVm()
 
 int ABCVm::getEventQueueSize()
 {
-	return events_queue.size();
+	return events_queue_depth;
+}
+
+void ABCVm::dumpEventQueueStats(std::ostream& out) const
+{
+	static const char* names[EVENT_TYPE_COUNT] = { "EVENT", "BIND_CLASS", "SHUTDOWN", "SYNC", "MOUSE_EVENT",
+		"FUNCTION", "EXTERNAL_CALL", "CONTEXT_INIT", "INIT_FRAME",
+		"FLUSH_INVALIDATION_QUEUE", "ADVANCE_FRAME", "PARSE_RPC_MESSAGE", "WORKER_NOTIFICATION" };
+	for(int i=0;i<EVENT_TYPE_COUNT;i++)
+	{
+		const EventTypeStats& st=eventStats[i];
+		if(st.handled==0 && st.coalesced==0)
+			continue;
+		out << names[i] << ": handled " << st.handled << " coalesced " << st.coalesced
+			<< " avg latency " << (st.handled ? st.totalLatency/st.handled : 0) << "us"
+			<< " max latency " << st.maxLatency << "us" << endl;
+	}
 }
 
 void ABCVm::publicHandleEvent(_R<EventDispatcher> dispatcher, _R<Event> event)
@@ -1270,6 +1304,8 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 				try
 				{
 					*(ev->result) = ev->f->call(m_sys->getNullRef(),ev->args,ev->numArgs);
+					//The result is consumed by the thread that made the call
+					(*(ev->result))->clearThreadConfined();
 				}
 				catch(ASObject* exception)
 				{
@@ -1314,6 +1350,14 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 				m_sys->flushInvalidationQueue();
 				break;
 			}
+			case SYNC:
+			{
+				SynchronizationEvent* ev=static_cast<SynchronizationEvent*>(e.second.getPtr());
+				//Nothing runs on the VM until the other side is done
+				ev->reached.signal();
+				ev->release.wait();
+				break;
+			}
 			case PARSE_RPC_MESSAGE:
 			{
 				ParseRPCMessageEvent* ev=static_cast<ParseRPCMessageEvent*>(e.second.getPtr());
@@ -1331,6 +1375,12 @@ void ABCVm::handleEvent(std::pair<_NR<EventDispatcher>, _R<Event> > e)
 				}
 				break;
 			}
+			case WORKER_NOTIFICATION:
+			{
+				WorkerNotificationEvent* ev=static_cast<WorkerNotificationEvent*>(e.second.getPtr());
+				ASWorker::handleNotification(m_sys, ev);
+				break;
+			}
 			default:
 				assert(false);
 		}
@@ -1356,18 +1406,105 @@ bool ABCVm::addEvent(_NR<EventDispatcher> obj ,_R<Event> ev)
 		return true;
 	}
 
-
-	Mutex::Lock l(event_queue_mutex);
-
+	/* The producer count is raised before checking shuttingdown,
+	 * so the VM thread can wait for pending pushes before draining the queue */
+	ATOMIC_INCREMENT(events_producers);
 	//If the system should terminate new events are not accepted
 	if(shuttingdown)
+	{
+		ATOMIC_DECREMENT(events_producers);
 		return false;
+	}
 
-	events_queue.push_back(pair<_NR<EventDispatcher>,_R<Event>>(obj, ev));
-	sem_event_cond.signal();
+	events_queue.push(queuedEvent(eventType(obj, ev), g_get_monotonic_time()));
+	ATOMIC_INCREMENT(events_queue_depth);
+	ATOMIC_DECREMENT(events_producers);
+	//Only take the lock if the VM thread may be sleeping
+	if(events_consumer_waiting)
+	{
+		Mutex::Lock l(event_queue_mutex);
+		sem_event_cond.signal();
+	}
 	return true;
 }
 
+/* Consecutive events that make the older one redundant */
+bool ABCVm::canCoalesce(const eventType& older, const eventType& newer)
+{
+	if(older.first!=newer.first)
+		return false;
+	EVENT_TYPE t=older.second->getEventType();
+	if(t!=newer.second->getEventType() || older.second->is<WaitableEvent>())
+		return false;
+	switch(t)
+	{
+		case FLUSH_INVALIDATION_QUEUE:
+			return true;
+		case MOUSE_EVENT:
+			//Only the last position of a run of moves is interesting
+			return older.second->type=="mouseMove" && newer.second->type=="mouseMove";
+		default:
+			return false;
+	}
+}
+
+void ABCVm::accountEventLatency(const queuedEvent& ev)
+{
+	EventTypeStats& st=eventStats[ev.e.second->getEventType()];
+	int64_t latency=g_get_monotonic_time()-ev.enqueueTime;
+	if(latency<0)
+		latency=0;
+	st.handled++;
+	st.totalLatency+=latency;
+	if((uint64_t)latency>st.maxLatency)
+		st.maxLatency=latency;
+}
+
+/*! \brief get the next event to handle, coalescing redundant ones
+ * Sleeps when the queue is empty.
+ * \return the node of the event, to be released by the caller, or NULL if the VM should stop */
+ABCVm::eventQueue::Node* ABCVm::nextEvent(bool& firstMissingEvents)
+{
+	while(events_batch==NULL)
+	{
+		events_batch=events_queue.popAll();
+		if(events_batch)
+			break;
+		if(shuttingdown)
+		{
+			//Producers that already passed the shuttingdown check may still be pushing
+			if(events_producers==0 && events_queue.empty())
+				return NULL;
+			Thread::yield();
+			continue;
+		}
+		Mutex::Lock l(event_queue_mutex);
+		events_consumer_waiting=true;
+		while(events_queue.empty() && !shuttingdown)
+			sem_event_cond.wait(event_queue_mutex);
+		events_consumer_waiting=false;
+	}
+
+	if(shuttingdown && firstMissingEvents)
+	{
+		LOG(LOG_INFO,events_queue_depth << _(" events missing before exit"));
+		firstMissingEvents = false;
+	}
+
+	eventQueue::Node* ret=events_batch;
+	while(ret->next && canCoalesce(ret->value.e,ret->next->value.e))
+	{
+		eventQueue::Node* next=ret->next;
+		eventStats[ret->value.e.second->getEventType()].coalesced++;
+		ATOMIC_DECREMENT(events_queue_depth);
+		events_queue.release(ret);
+		ret=next;
+	}
+	events_batch=ret->next;
+	ret->next=NULL;
+	return ret;
+}
+
 Class_inherit* ABCVm::findClassInherit(const string& s, RootMovieClip* root)
 {
 	LOG(LOG_CALLS,_("Setting class name to ") << s);
@@ -1437,6 +1574,17 @@ void ABCVm::not_impl(int n)
 	throw UnsupportedException("Not implemented opcode");
 }
 
+void scope_entry_list::gcTrace(CycleCollector& gc)
+{
+	for(uint32_t i=0;i<scope.size();i++)
+		gc.visit(scope[i].object.getPtr());
+}
+
+void scope_entry_list::gcClear()
+{
+	scope.clear();
+}
+
 call_context::~call_context()
 {
 	//The stack may be not clean, is this a programmer/compiler error?
@@ -1572,6 +1720,9 @@ void ABCContext::runScriptInit(unsigned int i, ASObject* g)
 
 	assert(!hasRunScriptInit[i]);
 	hasRunScriptInit[i] = true;
+	//The script init defines its classes, their slots must exist
+	if(g->is<Global>())
+		g->as<Global>()->definePendingClasses();
 
 	method_info* m=get_method(scripts[i].init);
 	SyntheticFunction* entry=Class<IFunction>::getSyntheticFunction(g->getSystemState(),m);
@@ -1595,6 +1746,7 @@ void ABCVm::Run(ABCVm* th)
 	//Spin wait until the VM is aknowledged by the SystemState
 	setTLSSys(th->m_sys);
 	while(getVm(th->m_sys)!=th);
+	ProfilerThreadScope profilerThread(th->m_sys->isBackgroundWorker()?"worker":"vm", th);
 
 	/* set TLS variable for isVmThread() */
         tls_set(&is_vm_thread, GINT_TO_POINTER(1));
@@ -1682,35 +1834,24 @@ void ABCVm::Run(ABCVm* th)
 #endif
 	while(true)
 	{
-		th->event_queue_mutex.lock();
-		while(th->events_queue.empty() && !th->shuttingdown)
-			th->sem_event_cond.wait(th->event_queue_mutex);
-
-		if(th->shuttingdown)
-		{
-			//If the queue is empty stop immediately
-			if(th->events_queue.empty())
-			{
-				th->event_queue_mutex.unlock();
-				break;
-			}
-			else if(firstMissingEvents)
-			{
-				LOG(LOG_INFO,th->events_queue.size() << _(" events missing before exit"));
-				firstMissingEvents = false;
-			}
-		}
+		//If the VM is shutting down and the queue is empty stop immediately
+		eventQueue::Node* node=th->nextEvent(firstMissingEvents);
+		if(node==NULL)
+			break;
 		Chronometer chronometer;
-		pair<_NR<EventDispatcher>,_R<Event>> e=th->events_queue.front();
-		th->events_queue.pop_front();
-
-		th->event_queue_mutex.unlock();
+		th->accountEventLatency(node->value);
+		pair<_NR<EventDispatcher>,_R<Event>> e=node->value.e;
+		th->events_queue.release(node);
+		ATOMIC_DECREMENT(th->events_queue_depth);
 		try
 		{
-			//handle event without lock
 			th->handleEvent(e);
 			//Flush the invalidation queue
 			th->m_sys->flushInvalidationQueue();
+			//No AS code is running between events, look for garbage cycles once in a while
+			if(e.second->getEventType()==ADVANCE_FRAME)
+				th->m_sys->getCycleCollector().frameBoundary();
+			th->m_sys->getCycleCollector().eventBoundary();
 			profile->accountTime(chronometer.checkpoint());
 #ifdef MEMORY_USAGE_PROFILING
 			if((snapshotCount%100)==0)
@@ -1747,6 +1888,11 @@ void ABCVm::Run(ABCVm* th)
 			break;
 		}
 	}
+	{
+		std::ostringstream stats;
+		th->dumpEventQueueStats(stats);
+		LOG(LOG_INFO,_("Event queue statistics:\n") << stats.str());
+	}
 	if(th->m_sys->useJit)
 	{
 		th->ex->clearAllGlobalMappings();
@@ -1761,13 +1907,23 @@ void ABCVm::Run(ABCVm* th)
 void ABCVm::signalEventWaiters()
 {
 	assert(shuttingdown);
-	//we do not need a lock because th->shuttingdown keeps other events from being enqueued
-	while(!events_queue.empty())
+	//shuttingdown keeps other events from being enqueued, wait for the pushes already in progress
+	while(events_producers!=0)
+		Thread::yield();
+	if(events_batch==NULL)
+		events_batch=events_queue.popAll();
+	while(events_batch)
 	{
-		pair<_NR<EventDispatcher>,_R<Event>> e=events_queue.front();
-                events_queue.pop_front();
-		if(e.second->is<WaitableEvent>())
-			e.second->as<WaitableEvent>()->done.signal();
+		eventQueue::Node* n=events_batch;
+		if(n->value.e.second->is<WaitableEvent>())
+			n->value.e.second->as<WaitableEvent>()->done.signal();
+		else if(n->value.e.second->getEventType()==SYNC)
+			static_cast<SynchronizationEvent*>(n->value.e.second.getPtr())->reached.signal();
+		events_batch=n->next;
+		events_queue.release(n);
+		ATOMIC_DECREMENT(events_queue_depth);
+		if(events_batch==NULL)
+			events_batch=events_queue.popAll();
 	}
 }
 
@@ -1881,6 +2037,31 @@ _R<ApplicationDomain> ABCVm::getCurrentApplicationDomain(call_context* th)
 	return th->context->root->applicationDomain;
 }
 
+void ABCVm::refreshDomainMemory(call_context* th)
+{
+	//Read the generation first, changes after this point are caught by the next access
+	th->domainMemoryGeneration=ByteArray::domainMemoryGeneration;
+	_R<ApplicationDomain> appDomain=getCurrentApplicationDomain(th);
+	if(appDomain->domainMemory.isNull() || appDomain->domainMemory->isShareable())
+	{
+		th->domainMemoryBase=NULL;
+		th->domainMemoryLength=0;
+		return;
+	}
+	th->domainMemoryBase=appDomain->domainMemory->getBufferNoCheck();
+	th->domainMemoryLength=appDomain->domainMemory->getLength();
+}
+
+void ABCVm::domainMemorySlowAccess(call_context* th, uint32_t addr, void* val, uint32_t size, bool write)
+{
+	_NR<ByteArray> mem=getCurrentApplicationDomain(th)->domainMemory;
+	//Accesses are ignored when there is no domain memory
+	if(mem.isNull())
+		return;
+	if(!mem->copyLocked(addr, val, size, write))
+		throwError<RangeError>(kInvalidRangeError);
+}
+
 _R<SecurityDomain> ABCVm::getCurrentSecurityDomain(call_context* th)
 {
 	return th->context->root->securityDomain;
@@ -2050,6 +2231,96 @@ ASObject* ABCContext::getConstant(int kind, int index)
 	}
 }
 
+void ABCContext::defineClass(ASObject* obj, const traits_info* t)
+{
+	multiname* mname=getMultiname(t->name,NULL);
+	ASObject* ret;
+
+	QName className(mname->name_s_id,mname->ns[0].nsNameId);
+	//check if this class has the 'interface' flag, i.e. it is an interface
+	if((instances[t->classi].flags)&0x04)
+	{
+
+		Class_inherit* ci=new (obj->getSystemState()->unaccountedMemory) Class_inherit(className, obj->getSystemState()->unaccountedMemory);
+		ci->isInterface = true;
+		ci->setDeclaredMethodByQName("toString",AS3,Class<IFunction>::getFunction(obj->getSystemState(),Class_base::_toString),NORMAL_METHOD,false);
+		LOG(LOG_CALLS,_("Building class traits"));
+		for(unsigned int i=0;i<classes[t->classi].trait_count;i++)
+			buildTrait(ci,&classes[t->classi].traits[i],false);
+		//Add protected namespace if needed
+		if((instances[t->classi].flags)&0x08)
+		{
+			ci->use_protected=true;
+			int ns=instances[t->classi].protectedNs;
+			const namespace_info& ns_info=constant_pool.namespaces[ns];
+			ci->initializeProtectedNamespace(getString(ns_info.name),ns_info);
+		}
+		LOG(LOG_CALLS,_("Adding immutable object traits to class"));
+		//Class objects also contains all the methods/getters/setters declared for instances
+		for(unsigned int i=0;i<instances[t->classi].trait_count;i++)
+		{
+			int kind=instances[t->classi].traits[i].kind&0xf;
+			if(kind==traits_info::Method || kind==traits_info::Setter || kind==traits_info::Getter)
+				buildTrait(ci,&instances[t->classi].traits[i],true);
+		}
+
+		//add implemented interfaces
+		for(unsigned int i=0;i<instances[t->classi].interface_count;i++)
+		{
+			multiname* name=getMultiname(instances[t->classi].interfaces[i],NULL);
+			ci->addImplementedInterface(*name);
+		}
+
+		ci->class_index=t->classi;
+		ci->context = this;
+
+		//can an interface derive from an other interface?
+		//can an interface derive from an non interface class?
+		assert(instances[t->classi].supername == 0);
+		//do interfaces have cinit methods?
+		//TODO: call them, set constructor property, do something
+		if(classes[t->classi].cinit != 0)
+		{
+			method_info* m=&methods[classes[t->classi].cinit];
+			if (m->body)
+				LOG(LOG_NOT_IMPLEMENTED,"Interface cinit (static):"<<className);
+		}
+		if(instances[t->classi].init != 0)
+		{
+			method_info* m=&methods[instances[t->classi].init];
+			if (m->body)
+				LOG(LOG_NOT_IMPLEMENTED,"Interface cinit (constructor):"<<className);
+		}
+		ret = ci;
+	}
+	else
+	{
+		Class_inherit* c=new (obj->getSystemState()->unaccountedMemory) Class_inherit(className, obj->getSystemState()->allocateMemoryAccount(className.getQualifiedName(obj->getSystemState())));
+		c->context = this;
+
+		if(instances[t->classi].supername)
+		{
+			// set superclass for classes that are not instantiated by newClass opcode (e.g. buttons)
+			multiname mnsuper = *getMultiname(instances[t->classi].supername,NULL);
+			ASObject* superclass=root->applicationDomain->getVariableByMultinameOpportunistic(mnsuper);
+			if(superclass && superclass->is<Class_base>() && !superclass->is<Class_inherit>())
+			{
+				superclass->incRef();
+				c->setSuper(_MR(superclass->as<Class_base>()));
+			}
+		}
+		root->applicationDomain->classesBeingDefined.insert(make_pair(mname, c));
+		ret=c;
+	}
+
+
+	obj->setVariableByQName(mname->name_s_id,mname->ns[0],ret,DECLARED_TRAIT);
+
+	LOG(LOG_CALLS,_("Class slot ")<< t->slot_id << _(" type Class name ") << *mname << _(" id ") << t->classi);
+	if(t->slot_id)
+		obj->initSlot(t->slot_id, *mname);
+}
+
 void ABCContext::buildTrait(ASObject* obj, const traits_info* t, bool isBorrowed, int scriptid, bool checkExisting)
 {
 	multiname* mname=getMultiname(t->name,NULL);
@@ -2086,91 +2357,13 @@ void ABCContext::buildTrait(ASObject* obj, const traits_info* t, bool isBorrowed
 				return;
 			}
 			
-			ASObject* ret;
-
-			QName className(mname->name_s_id,mname->ns[0].nsNameId);
-			//check if this class has the 'interface' flag, i.e. it is an interface
-			if((instances[t->classi].flags)&0x04)
-			{
-
-				Class_inherit* ci=new (obj->getSystemState()->unaccountedMemory) Class_inherit(className, obj->getSystemState()->unaccountedMemory);
-				ci->isInterface = true;
-				ci->setDeclaredMethodByQName("toString",AS3,Class<IFunction>::getFunction(obj->getSystemState(),Class_base::_toString),NORMAL_METHOD,false);
-				LOG(LOG_CALLS,_("Building class traits"));
-				for(unsigned int i=0;i<classes[t->classi].trait_count;i++)
-					buildTrait(ci,&classes[t->classi].traits[i],false);
-				//Add protected namespace if needed
-				if((instances[t->classi].flags)&0x08)
-				{
-					ci->use_protected=true;
-					int ns=instances[t->classi].protectedNs;
-					const namespace_info& ns_info=constant_pool.namespaces[ns];
-					ci->initializeProtectedNamespace(getString(ns_info.name),ns_info);
-				}
-				LOG(LOG_CALLS,_("Adding immutable object traits to class"));
-				//Class objects also contains all the methods/getters/setters declared for instances
-				for(unsigned int i=0;i<instances[t->classi].trait_count;i++)
-				{
-					int kind=instances[t->classi].traits[i].kind&0xf;
-					if(kind==traits_info::Method || kind==traits_info::Setter || kind==traits_info::Getter)
-						buildTrait(ci,&instances[t->classi].traits[i],true);
-				}
-
-				//add implemented interfaces
-				for(unsigned int i=0;i<instances[t->classi].interface_count;i++)
-				{
-					multiname* name=getMultiname(instances[t->classi].interfaces[i],NULL);
-					ci->addImplementedInterface(*name);
-				}
-
-				ci->class_index=t->classi;
-				ci->context = this;
-
-				//can an interface derive from an other interface?
-				//can an interface derive from an non interface class?
-				assert(instances[t->classi].supername == 0);
-				//do interfaces have cinit methods?
-				//TODO: call them, set constructor property, do something
-				if(classes[t->classi].cinit != 0)
-				{
-					method_info* m=&methods[classes[t->classi].cinit];
-					if (m->body)
-						LOG(LOG_NOT_IMPLEMENTED,"Interface cinit (static):"<<className);
-				}
-				if(instances[t->classi].init != 0)
-				{
-					method_info* m=&methods[instances[t->classi].init];
-					if (m->body)
-						LOG(LOG_NOT_IMPLEMENTED,"Interface cinit (constructor):"<<className);
-				}
-				ret = ci;
-			}
-			else
+			//Classes declared by scripts are only defined when their name is first looked up
+			if(scriptid!=-1 && obj->is<Global>())
 			{
-				Class_inherit* c=new (obj->getSystemState()->unaccountedMemory) Class_inherit(className, obj->getSystemState()->unaccountedMemory);
-				c->context = this;
-
-				if(instances[t->classi].supername)
-				{
-					// set superclass for classes that are not instantiated by newClass opcode (e.g. buttons)
-					multiname mnsuper = *getMultiname(instances[t->classi].supername,NULL);
-					ASObject* superclass=root->applicationDomain->getVariableByMultinameOpportunistic(mnsuper);
-					if(superclass && superclass->is<Class_base>() && !superclass->is<Class_inherit>())
-					{
-						superclass->incRef();
-						c->setSuper(_MR(superclass->as<Class_base>()));
-					}
-				}
-				root->applicationDomain->classesBeingDefined.insert(make_pair(mname, c));
-				ret=c;
+				obj->as<Global>()->addPendingClass(mname->name_s_id,t);
+				break;
 			}
-
-
-			obj->setVariableByQName(mname->name_s_id,mname->ns[0],ret,DECLARED_TRAIT);
-
-			LOG(LOG_CALLS,_("Class slot ")<< t->slot_id << _(" type Class name ") << *mname << _(" id ") << t->classi);
-			if(t->slot_id)
-				obj->initSlot(t->slot_id, *mname);
+			defineClass(obj,t);
 			break;
 		}
 		case traits_info::Getter:
@@ -2289,7 +2482,20 @@ const multiname* method_info::returnTypeName() const
 	return context->getMultiname(info.return_type,NULL);
 }
 
-istream& lightspark::operator>>(istream& in, method_info& v)
+void method_info::ensureBodyParsed() const
+{
+	try
+	{
+		body->ensureParsed();
+	}
+	catch(ParseException& e)
+	{
+		LOG(LOG_ERROR,_("Malformed method body: ") << e.cause);
+		throwError<VerifyError>(kCorruptABCError);
+	}
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, method_info& v)
 {
 	return in >> v.info;
 }
@@ -71,7 +71,7 @@ inline stack_entry make_stack_entry(llvm::Value* v, STACK_TYPE t)
 
 class method_info
 {
-friend std::istream& operator>>(std::istream& in, method_info& v);
+friend abc_reader& operator>>(abc_reader& in, method_info& v);
 friend struct block_info;
 friend class SyntheticFunction;
 private:
@@ -103,6 +103,8 @@ public:
 	SyntheticFunction::synt_function f;
 	ABCContext* context;
 	method_body_info* body;
+	//Name of the frames in the samples of SamplingProfiler, set on the first call while it runs
+	const char* sampleName;
 	SyntheticFunction::synt_function synt_method(SystemState* sys);
 	bool needsArgs() { return info.needsArgs(); }
 	bool needsActivation() { return info.needsActivation(); }
@@ -115,6 +117,8 @@ public:
 	uint32_t numArgs() { return info.param_count; }
 	const multiname* paramTypeName(uint32_t i) const;
 	const multiname* returnTypeName() const;
+	//Parses the body on first use, malformed bodies raise a VerifyError
+	void ensureBodyParsed() const;
 
 	std::vector<const Type*> paramTypes;
 	const Type* returnType;
@@ -125,7 +129,7 @@ public:
 		profTime(0),
 		validProfName(false),
 #endif
-		f(NULL),context(NULL),body(NULL),returnType(NULL),hasExplicitTypes(false)
+		f(NULL),context(NULL),body(NULL),sampleName(NULL),returnType(NULL),hasExplicitTypes(false)
 	{
 	}
 };
@@ -139,7 +143,7 @@ struct opcode_handler
 enum ARGS_TYPE { ARGS_OBJ_OBJ=0, ARGS_OBJ_INT, ARGS_OBJ, ARGS_INT, ARGS_OBJ_OBJ_INT, ARGS_NUMBER, ARGS_OBJ_NUMBER,
 	ARGS_BOOL, ARGS_INT_OBJ, ARGS_NONE, ARGS_NUMBER_OBJ, ARGS_INT_INT, ARGS_CONTEXT, ARGS_CONTEXT_INT, ARGS_CONTEXT_INT_INT,
 	ARGS_CONTEXT_INT_INT_INT, ARGS_CONTEXT_INT_INT_INT_BOOL, ARGS_CONTEXT_OBJ_OBJ_INT, ARGS_CONTEXT_OBJ, ARGS_CONTEXT_OBJ_OBJ,
-	ARGS_CONTEXT_OBJ_OBJ_OBJ, ARGS_OBJ_OBJ_OBJ_INT, ARGS_OBJ_OBJ_OBJ };
+	ARGS_CONTEXT_OBJ_OBJ_OBJ, ARGS_OBJ_OBJ_OBJ_INT, ARGS_OBJ_OBJ_OBJ, ARGS_CONTEXT_INT_NUMBER };
 
 struct typed_opcode_handler
 {
@@ -152,6 +156,9 @@ class ABCContext
 {
 friend class ABCVm;
 friend class method_info;
+private:
+	//The ABC block, method bodies are decoded from it when first needed
+	std::vector<uint8_t, reporter_allocator<uint8_t>> data;
 public:
 	_R<RootMovieClip> root;
 
@@ -188,6 +195,8 @@ public:
 		@param deferred_initialization A pointer to a function that can be used to build the given trait later
 	*/
 	void buildTrait(ASObject* obj, const traits_info* t, bool isBorrowed, int scriptid=-1, bool checkExisting=true);
+	/* Creates the object of a class trait, the class itself is defined by the newclass opcode */
+	void defineClass(ASObject* obj, const traits_info* t);
 	void runScriptInit(unsigned int scriptid, ASObject* g);
 
 	void linkTrait(Class_base* obj, const traits_info* t);
@@ -227,7 +236,8 @@ public:
 	multiname* getMultiname(unsigned int m, call_context* th);
 	multiname* getMultinameImpl(ASObject* rt1, ASObject* rt2, unsigned int m);
 	void buildInstanceTraits(ASObject* obj, int class_index);
-	ABCContext(_R<RootMovieClip> r, std::istream& in, ABCVm* vm) DLL_PUBLIC;
+	/* Reads an ABC block of len bytes from in */
+	ABCContext(_R<RootMovieClip> r, std::istream& in, uint32_t len, ABCVm* vm) DLL_PUBLIC;
 	void exec(bool lazy);
 
 	bool isinstance(ASObject* obj, multiname* name);
@@ -240,6 +250,30 @@ public:
 struct BasicBlock;
 struct InferenceData;
 
+/*
+ * Internal opcodes of the code rewritten by the optimizer, see ABCVm::executeFunctionFast.
+ * The *_NUMERIC opcodes have the same layout as the generic ones they replace, the fast
+ * interpreter switches between the two depending on the types of the operands it sees.
+ * The *_CACHED opcodes carry an inline cache of the class of the last object accessed.
+ * The superinstructions GET_LOCAL_PROPERTY_CACHED and IF_LOCALS_NUMERIC are never emitted,
+ * the fast interpreter rewrites a getlocal to them when it is followed by instructions
+ * that can read the local directly. The fused instructions are left in place after them
+ */
+enum SPECIAL_OPCODES { ADD_NUMERIC = 0xe0, LESS_THAN_NUMERIC, LESS_EQUALS_NUMERIC, GREATER_THAN_NUMERIC,
+	GREATER_EQUALS_NUMERIC, IF_NLT_NUMERIC, IF_NLE_NUMERIC, IF_NGT_NUMERIC, IF_NGE_NUMERIC, IF_LT_NUMERIC,
+	IF_LE_NUMERIC, IF_GT_NUMERIC, IF_GE_NUMERIC, GET_LOCAL_PROPERTY_CACHED = 0xf4, IF_LOCALS_NUMERIC = 0xf5,
+	GET_PROPERTY_CACHED = 0xf7, SET_PROPERTY_CACHED = 0xf8, CALL_PROPERTY_CACHED = 0xf9, CALL_PROPVOID_CACHED = 0xfa,
+	SET_SLOT_NO_COERCE = 0xfb, COERCE_EARLY = 0xfc, GET_SCOPE_AT_INDEX = 0xfd, GET_LEX_ONCE = 0xfe, PUSH_EARLY = 0xff };
+
+struct EventTypeStats
+{
+	uint64_t handled;
+	uint64_t coalesced;
+	//Time spent in the event queue, in microseconds
+	uint64_t totalLatency;
+	uint64_t maxLatency;
+};
+
 class ABCVm
 {
 friend class ABCContext;
@@ -259,15 +293,81 @@ private:
 	//Interpreted AS instructions
 	//If you change a definition here, update the opcode_table_* entry in abc_codesynth
 	static bool hasNext2(call_context* th, int n, int m); 
+	/* Reloads the domain memory buffer cached in th */
+	static void refreshDomainMemory(call_context* th);
+	/*
+	 * Domain memory access outside of the cached buffer: goes through the lock of
+	 * a shareable ByteArray, throws if out of bounds, unless there is no domain memory at all
+	 */
+	static void domainMemorySlowAccess(call_context* th, uint32_t addr, void* val, uint32_t size, bool write);
+	template<class T>
+	static T readDomainMemory(call_context* th, uint32_t addr)
+	{
+		if(th->domainMemoryGeneration!=ByteArray::domainMemoryGeneration)
+			refreshDomainMemory(th);
+		if(uint64_t(addr)+sizeof(T)>th->domainMemoryLength)
+		{
+			T ret=0;
+			domainMemorySlowAccess(th, addr, &ret, sizeof(T), false);
+			return ret;
+		}
+		return *reinterpret_cast<T*>(th->domainMemoryBase+addr);
+	}
+	template<class T>
+	static void writeDomainMemory(call_context* th, uint32_t addr, T val)
+	{
+		if(th->domainMemoryGeneration!=ByteArray::domainMemoryGeneration)
+			refreshDomainMemory(th);
+		if(uint64_t(addr)+sizeof(T)>th->domainMemoryLength)
+		{
+			domainMemorySlowAccess(th, addr, &val, sizeof(T), true);
+			return;
+		}
+		*reinterpret_cast<T*>(th->domainMemoryBase+addr)=val;
+	}
+	//Unboxed versions of the Alchemy opcodes, used by the JIT
+	template<class T>
+	static int32_t loadIntN_i(call_context* th, uint32_t addr)
+	{
+		return readDomainMemory<T>(th, addr);
+	}
+	template<class T>
+	static void storeIntN_i(call_context* th, uint32_t addr, int32_t val)
+	{
+		writeDomainMemory<T>(th, addr, val);
+	}
+	static number_t loadFloat_d(call_context* th, uint32_t addr)
+	{
+		return readDomainMemory<float>(th, addr);
+	}
+	static number_t loadDouble_d(call_context* th, uint32_t addr)
+	{
+		return readDomainMemory<double>(th, addr);
+	}
+	static void storeFloat_d(call_context* th, uint32_t addr, number_t val)
+	{
+		writeDomainMemory<float>(th, addr, val);
+	}
+	static void storeDouble_d(call_context* th, uint32_t addr, number_t val)
+	{
+		writeDomainMemory<double>(th, addr, val);
+	}
 	template<class T>
 	static void loadIntN(call_context* th)
 	{
+		//The address is usually an int nobody else references, store the result in it
+		ASObject* top=th->runtime_stack_peek();
+		if(top->is<Integer>() && top->isLastRef())
+		{
+			Integer* i=top->as<Integer>();
+			i->val=readDomainMemory<T>(th, i->val);
+			return;
+		}
 		ASObject* arg1=th->runtime_stack_pop();
 		uint32_t addr=arg1->toUInt();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		T ret=appDomain->readFromDomainMemory<T>(addr);
-		th->runtime_stack_push(abstract_i(arg1->getSystemState(),ret));
+		SystemState* sys=arg1->getSystemState();
 		arg1->decRef();
+		th->runtime_stack_push(abstract_i(sys,readDomainMemory<T>(th, addr)));
 	}
 	template<class T>
 	static void storeIntN(call_context* th)
@@ -278,49 +378,43 @@ private:
 		arg1->decRef();
 		int32_t val=arg2->toInt();
 		arg2->decRef();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		appDomain->writeToDomainMemory<T>(addr, val);
+		writeDomainMemory<T>(th, addr, val);
 	}
 	static void loadFloat(call_context* th)
 	{
 		ASObject* arg1=th->runtime_stack_pop();
-		float addr=arg1->toNumber();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		number_t ret=appDomain->readFromDomainMemory<float>(addr);
-		th->runtime_stack_push(abstract_d(arg1->getSystemState(),ret));
+		uint32_t addr=arg1->toUInt();
+		SystemState* sys=arg1->getSystemState();
 		arg1->decRef();
+		th->runtime_stack_push(abstract_d(sys,readDomainMemory<float>(th, addr)));
 	}
-
 	static void loadDouble(call_context* th)
 	{
 		ASObject* arg1=th->runtime_stack_pop();
-		double addr=arg1->toNumber();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		number_t ret=appDomain->readFromDomainMemory<double>(addr);
-		th->runtime_stack_push(abstract_d(arg1->getSystemState(),ret));
+		uint32_t addr=arg1->toUInt();
+		SystemState* sys=arg1->getSystemState();
 		arg1->decRef();
+		th->runtime_stack_push(abstract_d(sys,readDomainMemory<double>(th, addr)));
 	}
 	static void storeFloat(call_context* th)
 	{
 		ASObject* arg1=th->runtime_stack_pop();
 		ASObject* arg2=th->runtime_stack_pop();
-		number_t addr=arg1->toNumber();
+		uint32_t addr=arg1->toUInt();
 		arg1->decRef();
 		float val=(float)arg2->toNumber();
 		arg2->decRef();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		appDomain->writeToDomainMemory<float>(addr, val);
+		writeDomainMemory<float>(th, addr, val);
 	}
 	static void storeDouble(call_context* th)
 	{
 		ASObject* arg1=th->runtime_stack_pop();
 		ASObject* arg2=th->runtime_stack_pop();
-		number_t addr=arg1->toNumber();
+		uint32_t addr=arg1->toUInt();
 		arg1->decRef();
 		double val=arg2->toNumber();
 		arg2->decRef();
-		_R<ApplicationDomain> appDomain = getCurrentApplicationDomain(th);
-		appDomain->writeToDomainMemory<double>(addr, val);
+		writeDomainMemory<double>(th, addr, val);
 	}
 
 	static void callStatic(call_context* th, int n, int m, method_info** called_mi, bool keepReturn);
@@ -493,13 +587,34 @@ private:
 
 
 	//Synchronization
+	//The mutex and the condition are only used to put the VM thread to sleep when it's idle
 	Mutex event_queue_mutex;
 	Cond sem_event_cond;
+	ACQUIRE_RELEASE_FLAG(events_consumer_waiting);
 
 	//Event handling
-	volatile bool shuttingdown;
+	ACQUIRE_RELEASE_FLAG(shuttingdown);
 	typedef std::pair<_NR<EventDispatcher>,_R<Event>> eventType;
-	std::deque<eventType, reporter_allocator<eventType>> events_queue;
+	struct queuedEvent
+	{
+		eventType e;
+		//Monotonic time (in microseconds) of the enqueuing
+		int64_t enqueueTime;
+		queuedEvent(const eventType& _e, int64_t t):e(_e),enqueueTime(t){}
+	};
+	typedef MPSCQueue<queuedEvent, reporter_allocator<queuedEvent>> eventQueue;
+	eventQueue events_queue;
+	//Events already detached from events_queue and not yet handled, owned by the VM thread
+	eventQueue::Node* events_batch;
+	//Number of events enqueued and not yet handled
+	ATOMIC_INT32(events_queue_depth);
+	//Number of threads currently inside addEvent, used to drain the queue safely on shutdown
+	ATOMIC_INT32(events_producers);
+	//Only accessed by the VM thread
+	EventTypeStats eventStats[EVENT_TYPE_COUNT];
+	eventQueue::Node* nextEvent(bool& firstMissingEvents);
+	static bool canCoalesce(const eventType& older, const eventType& newer);
+	void accountEventLatency(const queuedEvent& ev);
 	void handleEvent(std::pair<_NR<EventDispatcher>,_R<Event> > e);
 	void signalEventWaiters();
 	void buildClassAndInjectBase(const std::string& s, _R<RootMovieClip> base);
@@ -538,6 +653,12 @@ public:
 	static ASObject* executeFunction(const SyntheticFunction* function, call_context* context, ASObject *caller);
 	static ASObject* executeFunctionFast(const SyntheticFunction* function, call_context* context, ASObject *caller);
 	static void optimizeFunction(SyntheticFunction* function);
+	/*
+	 * Fill the inline caches of the fast interpreter. They return 0 or NULL
+	 * if accesses to name on objects of the class of obj can not be cached
+	 */
+	static uint32_t getCacheableSlot(ASObject* obj, const multiname* name);
+	static IFunction* getCacheableMethod(ASObject* obj, const multiname* name);
 	static void verifyBranch(std::set<uint32_t>& pendingBlock,std::map<uint32_t,BasicBlock>& basicBlocks,
 			int oldStart, int here, int offset, int code_len);
 	static void writeBranchAddress(std::map<uint32_t,BasicBlock>& basicBlocks, int here, int offset, std::ostream& out);
@@ -555,6 +676,8 @@ public:
 
 	bool addEvent(_NR<EventDispatcher>,_R<Event> ) DLL_PUBLIC;
 	int getEventQueueSize();
+	/* Logged when the VM thread exits */
+	void dumpEventQueueStats(std::ostream& out) const;
 	void shutdown();
 	bool hasEverStarted() const { return status!=CREATED; }
 
@@ -625,7 +748,7 @@ inline ABCVm* getVm(SystemState* sys)
 	return sys->currentVm;
 }
 
-std::istream& operator>>(std::istream& in, method_info& v);
+abc_reader& operator>>(abc_reader& in, method_info& v);
 
 };
 
@@ -153,6 +153,9 @@ typed_opcode_handler ABCVm::opcode_table_uint32_t[]={
 	{"getProperty_i",(void*)&ABCVm::getProperty_i,ARGS_OBJ_OBJ},
 	{"convert_i",(void*)&ABCVm::convert_i,ARGS_OBJ},
 	{"convert_u",(void*)&ABCVm::convert_u,ARGS_OBJ},
+	{"li8",(void*)&ABCVm::loadIntN_i<uint8_t>,ARGS_CONTEXT_INT},
+	{"li16",(void*)&ABCVm::loadIntN_i<uint16_t>,ARGS_CONTEXT_INT},
+	{"li32",(void*)&ABCVm::loadIntN_i<uint32_t>,ARGS_CONTEXT_INT},
 };
 
 typed_opcode_handler ABCVm::opcode_table_number_t[]={
@@ -167,6 +170,8 @@ typed_opcode_handler ABCVm::opcode_table_number_t[]={
 	{"subtract_do",(void*)&ABCVm::subtract_do,ARGS_NUMBER_OBJ},
 	{"convert_d",(void*)&ABCVm::convert_d,ARGS_OBJ},
 	{"negate",(void*)&ABCVm::negate,ARGS_OBJ},
+	{"lf32",(void*)&ABCVm::loadFloat_d,ARGS_CONTEXT_INT},
+	{"lf64",(void*)&ABCVm::loadDouble_d,ARGS_CONTEXT_INT},
 };
 
 typed_opcode_handler ABCVm::opcode_table_void[]={
@@ -218,6 +223,11 @@ typed_opcode_handler ABCVm::opcode_table_void[]={
 	{"wrong_exec_pos",(void*)&ABCVm::wrong_exec_pos,ARGS_NONE},
 	{"dxns",(void*)&ABCVm::dxns,ARGS_CONTEXT_INT},
 	{"dxnslate",(void*)&ABCVm::dxnslate,ARGS_CONTEXT_OBJ},
+	{"si8",(void*)&ABCVm::storeIntN_i<uint8_t>,ARGS_CONTEXT_INT_INT},
+	{"si16",(void*)&ABCVm::storeIntN_i<uint16_t>,ARGS_CONTEXT_INT_INT},
+	{"si32",(void*)&ABCVm::storeIntN_i<uint32_t>,ARGS_CONTEXT_INT_INT},
+	{"sf32",(void*)&ABCVm::storeFloat_d,ARGS_CONTEXT_INT_NUMBER},
+	{"sf64",(void*)&ABCVm::storeDouble_d,ARGS_CONTEXT_INT_NUMBER},
 };
 
 typed_opcode_handler ABCVm::opcode_table_voidptr[]={
@@ -449,6 +459,11 @@ void ABCVm::register_table(LLVMTYPE ret_type,typed_opcode_handler* table, int ta
 	sig_context_int_int.push_back(int_type);
 	sig_context_int_int.push_back(int_type);
 
+	vector<LLVMTYPE> sig_context_int_number;
+	sig_context_int_number.push_back(context_type);
+	sig_context_int_number.push_back(int_type);
+	sig_context_int_number.push_back(number_type);
+
 	vector<LLVMTYPE> sig_context_int_int_int;
 	sig_context_int_int_int.push_back(context_type);
 	sig_context_int_int_int.push_back(int_type);
@@ -539,6 +554,9 @@ void ABCVm::register_table(LLVMTYPE ret_type,typed_opcode_handler* table, int ta
 			case ARGS_CONTEXT_INT_INT:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int), false);
 				break;
+			case ARGS_CONTEXT_INT_NUMBER:
+				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_number), false);
+				break;
 			case ARGS_CONTEXT_INT_INT_INT:
 				FT=llvm::FunctionType::get(ret_type, LLVMMAKEARRAYREF(sig_context_int_int_int), false);
 				break;
@@ -804,6 +822,25 @@ static llvm::Value* llvm_ToNumber(llvm::ExecutionEngine* ex, llvm::IRBuilder<>&
 	}
 }
 
+/* Implements ECMA's ToInt32 and ToUint32, both have the same llvm representation */
+static llvm::Value* llvm_ToInt(llvm::ExecutionEngine* ex, llvm::IRBuilder<>& Builder, stack_entry& e, bool isUnsigned)
+{
+	switch(e.second)
+	{
+	case STACK_BOOLEAN:
+		return Builder.CreateZExt(e.first,int_type);
+	case STACK_INT:
+	case STACK_UINT:
+		return e.first;
+	case STACK_NUMBER:
+		if(isUnsigned)
+			return Builder.CreateFPToUI(e.first,int_type);
+		return Builder.CreateFPToSI(e.first,int_type);
+	default:
+		return Builder.CreateCall(ex->FindFunctionNamed(isUnsigned?"convert_u":"convert_i"), e.first);
+	}
+}
+
 /* Adds instructions to the builder to resolve the given multiname */
 inline llvm::Value* getMultiname(llvm::ExecutionEngine* ex,llvm::IRBuilder<>& Builder, vector<stack_entry>& static_stack,
 				llvm::Value* dynamic_stack,llvm::Value* dynamic_stack_index,
@@ -1267,6 +1304,33 @@ void method_info::doAnalysis(std::map<unsigned int,block_info>& blocks, BuilderW
 					cur_block->checkProactiveCasting(local_ip,STACK_BOOLEAN);
 					break;
 				}
+				case 0x35: //li8
+				case 0x36: //li16
+				case 0x37: //li32
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					static_stack_types.push_back(make_pair(local_ip,STACK_INT));
+					cur_block->checkProactiveCasting(local_ip,STACK_INT);
+					break;
+				}
+				case 0x38: //lf32
+				case 0x39: //lf64
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					static_stack_types.push_back(make_pair(local_ip,STACK_NUMBER));
+					cur_block->checkProactiveCasting(local_ip,STACK_NUMBER);
+					break;
+				}
+				case 0x3a: //si8
+				case 0x3b: //si16
+				case 0x3c: //si32
+				case 0x3d: //sf32
+				case 0x3e: //sf64
+				{
+					popTypeFromStack(static_stack_types,local_ip);
+					popTypeFromStack(static_stack_types,local_ip);
+					break;
+				}
 				case 0x40: //newfunction
 				{
 					u30 t;
@@ -3172,6 +3236,63 @@ SyntheticFunction::synt_function method_info::synt_method(SystemState* sys)
 				static_stack_push(static_stack,stack_entry(value,STACK_BOOLEAN));
 				break;
 			}
+			case 0x35:
+			case 0x36:
+			case 0x37:
+			{
+				//li8, li16, li32
+				static const char* const names[]={"li8","li16","li32"};
+				LOG(LOG_TRACE, _("synt ") << names[opcode-0x35] );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1,true);
+#ifdef LLVM_37
+				value=Builder.CreateCall(ex->FindFunctionNamed(names[opcode-0x35]), {context, addr});
+#else
+				value=Builder.CreateCall2(ex->FindFunctionNamed(names[opcode-0x35]), context, addr);
+#endif
+				static_stack_push(static_stack,stack_entry(value,STACK_INT));
+				break;
+			}
+			case 0x38:
+			case 0x39:
+			{
+				//lf32, lf64
+				const char* name=(opcode==0x38)?"lf32":"lf64";
+				LOG(LOG_TRACE, _("synt ") << name );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1,true);
+#ifdef LLVM_37
+				value=Builder.CreateCall(ex->FindFunctionNamed(name), {context, addr});
+#else
+				value=Builder.CreateCall2(ex->FindFunctionNamed(name), context, addr);
+#endif
+				static_stack_push(static_stack,stack_entry(value,STACK_NUMBER));
+				break;
+			}
+			case 0x3a:
+			case 0x3b:
+			case 0x3c:
+			case 0x3d:
+			case 0x3e:
+			{
+				//si8, si16, si32, sf32, sf64
+				static const char* const names[]={"si8","si16","si32","sf32","sf64"};
+				LOG(LOG_TRACE, _("synt ") << names[opcode-0x3a] );
+				stack_entry v1=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				stack_entry v2=static_stack_pop(Builder,static_stack,dynamic_stack,dynamic_stack_index);
+				llvm::Value* addr=llvm_ToInt(ex,Builder,v1,true);
+				llvm::Value* val;
+				if(opcode>=0x3d)
+					val=llvm_ToNumber(ex,Builder,v2);
+				else
+					val=llvm_ToInt(ex,Builder,v2,false);
+#ifdef LLVM_37
+				Builder.CreateCall(ex->FindFunctionNamed(names[opcode-0x3a]), {context, addr, val});
+#else
+				Builder.CreateCall3(ex->FindFunctionNamed(names[opcode-0x3a]), context, addr, val);
+#endif
+				break;
+			}
 			case 0x40:
 			{
 				//newfunction
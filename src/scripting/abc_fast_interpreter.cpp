@@ -21,6 +21,10 @@
 #include "compat.h"
 #include "exceptions.h"
 #include "abcutils.h"
+#include "scripting/toplevel/Integer.h"
+#include "scripting/toplevel/UInteger.h"
+#include "scripting/toplevel/Number.h"
+#include <cstring>
 #include <string>
 #include <sstream>
 
@@ -40,6 +44,144 @@ struct OpcodeData
 	};
 };
 
+/*
+ * With GCC and clang the handler of each instruction jumps directly to the handler of
+ * the next one through a table of label addresses, which the compiler replicates at the
+ * end of every handler, instead of going back to the switch
+ */
+#ifdef __GNUC__
+#define THREADED_DISPATCH 1
+#define OPCODE_LABEL(op) op_##op:
+//A label missing from the table is a build error
+#pragma GCC diagnostic error "-Wunused-label"
+#else
+#define OPCODE_LABEL(op)
+#endif
+
+static inline bool isNumeric(ASObject* o)
+{
+	SWFOBJECT_TYPE t=o->getObjectType();
+	return t==T_INTEGER || t==T_UINTEGER || t==T_NUMBER;
+}
+
+/* Only valid for numeric objects */
+static inline number_t numericValue(ASObject* o)
+{
+	switch(o->getObjectType())
+	{
+		case T_INTEGER:
+			return static_cast<Integer*>(o)->val;
+		case T_UINTEGER:
+			return static_cast<UInteger*>(o)->val;
+		default:
+			return static_cast<Number*>(o)->toNumber();
+	}
+}
+
+static inline bool isIntegral(ASObject* o)
+{
+	return o->getObjectType()!=T_NUMBER || !static_cast<Number*>(o)->isfloat;
+}
+
+static inline int64_t integralValue(ASObject* o)
+{
+	switch(o->getObjectType())
+	{
+		case T_INTEGER:
+			return static_cast<Integer*>(o)->val;
+		case T_UINTEGER:
+			return static_cast<UInteger*>(o)->val;
+		default:
+			return static_cast<Number*>(o)->ival;
+	}
+}
+
+/*
+ * Switch the instruction at pos between a generic opcode and its numeric variant,
+ * which have the same layout, according to the operands seen at runtime
+ */
+static inline void rewriteOpcode(method_info* mi, uint32_t pos, uint8_t opcode)
+{
+	mi->body->code[pos]=opcode;
+}
+
+static inline bool isNumericIf(uint8_t opcode)
+{
+	return opcode>=IF_NLT_NUMERIC && opcode<=IF_GE_NUMERIC;
+}
+
+/* a and b are the values of the first and second operand of the comparison */
+static bool numericIfTaken(uint8_t opcode, number_t a, number_t b)
+{
+	switch(opcode)
+	{
+		case IF_NLT_NUMERIC:
+			return !(a<b);
+		case IF_NLE_NUMERIC:
+			return !(a<=b);
+		case IF_NGT_NUMERIC:
+			return !(a>b);
+		case IF_NGE_NUMERIC:
+			return !(a>=b);
+		case IF_LT_NUMERIC:
+			return a<b;
+		case IF_LE_NUMERIC:
+			return a<=b;
+		case IF_GT_NUMERIC:
+			return a>b;
+		default:
+			return a>=b;
+	}
+}
+
+/*
+ * The caches of the *_PROPERTY_CACHED opcodes are bound to the class of the first
+ * object seen, if another class is seen the generic path is always taken from then on.
+ * Classes and methods are cached without a reference: only Class_inherit objects are
+ * cached, the SystemState owns them until it is destroyed, they keep their methods
+ * as long as they live and sealed classes never change them
+ */
+#define MEGAMORPHIC_SLOT 0xffffffff
+#define MEGAMORPHIC_METHOD reinterpret_cast<IFunction*>(-1)
+
+/*
+ * The cached class and method are stored after two 32 bit operands, at the byte offsets
+ * written by the optimizer. Indexing the pointer members of OpcodeData would overlap
+ * the operands on 32 bit targets
+ */
+#define CACHE_CLASS_OFFSET 8
+#define CACHE_METHOD_OFFSET 16
+template<class T>
+static inline T readCachePtr(const OpcodeData* data, uint32_t offset)
+{
+	T ret;
+	memcpy(&ret, reinterpret_cast<const char*>(data)+offset, sizeof(T));
+	return ret;
+}
+
+template<class T>
+static inline void writeCachePtr(OpcodeData* data, uint32_t offset, T val)
+{
+	memcpy(reinterpret_cast<char*>(data)+offset, &val, sizeof(T));
+}
+
+static void updateSlotCache(method_info* mi, uint32_t pos, ASObject* obj, const multiname* name)
+{
+	OpcodeData* cache=reinterpret_cast<OpcodeData*>(&(mi->body->code[0])+pos+1);
+	if(cache->uints[1]==0)
+	{
+		uint32_t slot=ABCVm::getCacheableSlot(obj,name);
+		if(slot)
+		{
+			cache->uints[1]=slot;
+			writeCachePtr<Class_base*>(cache,CACHE_CLASS_OFFSET,obj->getClass());
+			return;
+		}
+	}
+	cache->uints[1]=MEGAMORPHIC_SLOT;
+	writeCachePtr<Class_base*>(cache,CACHE_CLASS_OFFSET,NULL);
+}
+
 ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_context* context, ASObject *caller)
 {
 	method_info* mi=function->mi;
@@ -63,64 +205,105 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 #define PROF_IGNORE_TIME(a) do{ ; } while(0)
 #endif
 
+#ifdef THREADED_DISPATCH
+	//Handlers of all the opcodes, the ones without a label go through the switch,
+	//which also handles the unknown ones
+	static const void* const dispatchTable[256]={
+		&&op_switch, &&op_0x01, &&op_0x02, &&op_0x03, &&op_0x04, &&op_0x05, &&op_0x06, &&op_0x07,
+		&&op_0x08, &&op_switch, &&op_switch, &&op_switch, &&op_0x0c, &&op_0x0d, &&op_0x0e, &&op_0x0f,
+		&&op_0x10, &&op_0x11, &&op_0x12, &&op_0x13, &&op_0x14, &&op_0x15, &&op_0x16, &&op_0x17,
+		&&op_0x18, &&op_0x19, &&op_0x1a, &&op_0x1b, &&op_0x1c, &&op_0x1d, &&op_0x1e, &&op_switch,
+		&&op_0x20, &&op_0x21, &&op_switch, &&op_0x23, &&op_0x24, &&op_0x25, &&op_0x26, &&op_0x27,
+		&&op_0x28, &&op_0x29, &&op_0x2a, &&op_0x2b, &&op_0x2c, &&op_0x2d, &&op_0x2e, &&op_0x2f,
+		&&op_0x30, &&op_0x31, &&op_0x32, &&op_switch, &&op_switch, &&op_0x35, &&op_0x36, &&op_0x37,
+		&&op_0x38, &&op_0x39, &&op_0x3a, &&op_0x3b, &&op_0x3c, &&op_0x3d, &&op_0x3e, &&op_switch,
+		&&op_0x40, &&op_0x41, &&op_0x42, &&op_switch, &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+		&&op_0x48, &&op_0x49, &&op_0x4a, &&op_switch, &&op_0x4c, &&op_switch, &&op_0x4e, &&op_0x4f,
+		&&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&op_switch, &&op_0x55, &&op_0x56, &&op_0x57,
+		&&op_0x58, &&op_0x59, &&op_0x5a, &&op_switch, &&op_switch, &&op_0x5d, &&op_0x5e, &&op_0x5f,
+		&&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63, &&op_0x64, &&op_0x65, &&op_0x66, &&op_switch,
+		&&op_0x68, &&op_switch, &&op_0x6a, &&op_switch, &&op_0x6c, &&op_0x6d, &&op_0x6e, &&op_0x6f,
+		&&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73, &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+		&&op_0x78, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch,
+		&&op_0x80, &&op_switch, &&op_0x82, &&op_switch, &&op_switch, &&op_0x85, &&op_0x86, &&op_0x87,
+		&&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch,
+		&&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+		&&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch,
+		&&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3, &&op_0xa4, &&op_0xa5, &&op_0xa6, &&op_0xa7,
+		&&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab, &&op_0xac, &&op_0xad, &&op_0xae, &&op_0xaf,
+		&&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3, &&op_0xb4, &&op_switch, &&op_switch, &&op_switch,
+		&&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch,
+		&&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3, &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+		&&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch,
+		&&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3, &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+		&&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch, &&op_switch,
+		&&op_ADD_NUMERIC, &&op_LESS_THAN_NUMERIC, &&op_LESS_EQUALS_NUMERIC, &&op_GREATER_THAN_NUMERIC, &&op_GREATER_EQUALS_NUMERIC, &&op_IF_NLT_NUMERIC, &&op_IF_NLE_NUMERIC, &&op_IF_NGT_NUMERIC,
+		&&op_IF_NGE_NUMERIC, &&op_IF_LT_NUMERIC, &&op_IF_LE_NUMERIC, &&op_IF_GT_NUMERIC, &&op_IF_GE_NUMERIC, &&op_switch, &&op_switch, &&op_switch,
+		&&op_switch, &&op_switch, &&op_0xf2, &&op_0xf3, &&op_GET_LOCAL_PROPERTY_CACHED, &&op_IF_LOCALS_NUMERIC, &&op_switch, &&op_GET_PROPERTY_CACHED,
+		&&op_SET_PROPERTY_CACHED, &&op_CALL_PROPERTY_CACHED, &&op_CALL_PROPVOID_CACHED, &&op_0xfb, &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+	};
+#endif
+
 	//Each case block builds the correct parameters for the interpreter function and call it
 	while(1)
 	{
 		assert(instructionPointer<code_len);
 		uint8_t opcode=code[instructionPointer];
-		//Save ip for exception handling in SyntheticFunction::callImpl
+		//Save ip for exception handling in SyntheticFunction::callImpl,
+		//almost every handler may throw so it can not be saved lazily
 		context->exec_pos = instructionPointer;
 		instructionPointer++;
 		const OpcodeData* data=reinterpret_cast<const OpcodeData*>(code+instructionPointer);
 
+		OPCODE_LABEL(switch)
 		switch(opcode)
 		{
-			case 0x01:
+			case 0x01: OPCODE_LABEL(0x01)
 			{
 				//bkpt
 				LOG_CALL( _("bkpt") );
 				break;
 			}
-			case 0x02:
+			case 0x02: OPCODE_LABEL(0x02)
 			{
 				//nop
 				break;
 			}
-			case 0x03:
+			case 0x03: OPCODE_LABEL(0x03)
 			{
 				//throw
 				_throw(context);
 				break;
 			}
-			case 0x04:
+			case 0x04: OPCODE_LABEL(0x04)
 			{
 				//getsuper
 				getSuper(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x05:
+			case 0x05: OPCODE_LABEL(0x05)
 			{
 				//setsuper
 				setSuper(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x06:
+			case 0x06: OPCODE_LABEL(0x06)
 			{
 				//dxns
 				dxns(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x07:
+			case 0x07: OPCODE_LABEL(0x07)
 			{
 				//dxnslate
 				ASObject* v=context->runtime_stack_pop();
 				dxnslate(context, v);
 				break;
 			}
-			case 0x08:
+			case 0x08: OPCODE_LABEL(0x08)
 			{
 				//kill
 				uint32_t t=data->uints[0];
@@ -131,13 +314,15 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->locals[t]=function->getSystemState()->getUndefinedRef();
 				break;
 			}
-			case 0x0c:
+			case 0x0c: OPCODE_LABEL(0x0c)
 			{
 				//ifnlt
 				uint32_t dest=data->uints[0];
 				instructionPointer+=4;
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_NLT_NUMERIC);
 				bool cond=ifNLT(v1, v2);
 				if(cond)
 				{
@@ -146,13 +331,15 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x0d:
+			case 0x0d: OPCODE_LABEL(0x0d)
 			{
 				//ifnle
 				uint32_t dest=data->uints[0];
 				instructionPointer+=4;
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_NLE_NUMERIC);
 				bool cond=ifNLE(v1, v2);
 				if(cond)
 				{
@@ -161,13 +348,15 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x0e:
+			case 0x0e: OPCODE_LABEL(0x0e)
 			{
 				//ifngt
 				uint32_t dest=data->uints[0];
 				instructionPointer+=4;
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_NGT_NUMERIC);
 				bool cond=ifNGT(v1, v2);
 				if(cond)
 				{
@@ -176,13 +365,15 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x0f:
+			case 0x0f: OPCODE_LABEL(0x0f)
 			{
 				//ifnge
 				uint32_t dest=data->uints[0];
 				instructionPointer+=4;
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_NGE_NUMERIC);
 				bool cond=ifNGE(v1, v2);
 				if(cond)
 				{
@@ -191,7 +382,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x10:
+			case 0x10: OPCODE_LABEL(0x10)
 			{
 				//jump
 				uint32_t dest=data->uints[0];
@@ -201,7 +392,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer=dest;
 				break;
 			}
-			case 0x11:
+			case 0x11: OPCODE_LABEL(0x11)
 			{
 				//iftrue
 				uint32_t dest=data->uints[0];
@@ -216,7 +407,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x12:
+			case 0x12: OPCODE_LABEL(0x12)
 			{
 				//iffalse
 				uint32_t dest=data->uints[0];
@@ -231,7 +422,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x13:
+			case 0x13: OPCODE_LABEL(0x13)
 			{
 				//ifeq
 				uint32_t dest=data->uints[0];
@@ -247,7 +438,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x14:
+			case 0x14: OPCODE_LABEL(0x14)
 			{
 				//ifne
 				uint32_t dest=data->uints[0];
@@ -263,7 +454,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x15:
+			case 0x15: OPCODE_LABEL(0x15)
 			{
 				//iflt
 				uint32_t dest=data->uints[0];
@@ -271,6 +462,8 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_LT_NUMERIC);
 				bool cond=ifLT(v1, v2);
 				if(cond)
 				{
@@ -279,7 +472,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x16:
+			case 0x16: OPCODE_LABEL(0x16)
 			{
 				//ifle
 				uint32_t dest=data->uints[0];
@@ -287,6 +480,8 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_LE_NUMERIC);
 				bool cond=ifLE(v1, v2);
 				if(cond)
 				{
@@ -295,7 +490,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x17:
+			case 0x17: OPCODE_LABEL(0x17)
 			{
 				//ifgt
 				uint32_t dest=data->uints[0];
@@ -303,6 +498,8 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_GT_NUMERIC);
 				bool cond=ifGT(v1, v2);
 				if(cond)
 				{
@@ -311,7 +508,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x18:
+			case 0x18: OPCODE_LABEL(0x18)
 			{
 				//ifge
 				uint32_t dest=data->uints[0];
@@ -319,6 +516,8 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 
 				ASObject* v1=context->runtime_stack_pop();
 				ASObject* v2=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,IF_GE_NUMERIC);
 				bool cond=ifGE(v1, v2);
 				if(cond)
 				{
@@ -327,7 +526,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x19:
+			case 0x19: OPCODE_LABEL(0x19)
 			{
 				//ifstricteq
 				uint32_t dest=data->uints[0];
@@ -343,7 +542,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x1a:
+			case 0x1a: OPCODE_LABEL(0x1a)
 			{
 				//ifstrictne
 				uint32_t dest=data->uints[0];
@@ -359,7 +558,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x1b:
+			case 0x1b: OPCODE_LABEL(0x1b)
 			{
 				//lookupswitch
 				uint32_t defaultdest=data->uints[0];
@@ -379,19 +578,19 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer=dest;
 				break;
 			}
-			case 0x1c:
+			case 0x1c: OPCODE_LABEL(0x1c)
 			{
 				//pushwith
 				pushWith(context);
 				break;
 			}
-			case 0x1d:
+			case 0x1d: OPCODE_LABEL(0x1d)
 			{
 				//popscope
 				popScope(context);
 				break;
 			}
-			case 0x1e:
+			case 0x1e: OPCODE_LABEL(0x1e)
 			{
 				//nextname
 				ASObject* v1=context->runtime_stack_pop();
@@ -399,19 +598,19 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(nextName(v1,v2));
 				break;
 			}
-			case 0x20:
+			case 0x20: OPCODE_LABEL(0x20)
 			{
 				//pushnull
 				context->runtime_stack_push(pushNull());
 				break;
 			}
-			case 0x21:
+			case 0x21: OPCODE_LABEL(0x21)
 			{
 				//pushundefined
 				context->runtime_stack_push(pushUndefined());
 				break;
 			}
-			case 0x23:
+			case 0x23: OPCODE_LABEL(0x23)
 			{
 				//nextvalue
 				ASObject* v1=context->runtime_stack_pop();
@@ -419,7 +618,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(nextValue(v1,v2));
 				break;
 			}
-			case 0x24:
+			case 0x24: OPCODE_LABEL(0x24)
 			{
 				//pushbyte
 				int8_t t=code[instructionPointer];
@@ -428,7 +627,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				pushByte(t);
 				break;
 			}
-			case 0x25:
+			case 0x25: OPCODE_LABEL(0x25)
 			{
 				//pushshort
 				// specs say pushshort is a u30, but it's really a u32
@@ -439,25 +638,25 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				pushShort(t);
 				break;
 			}
-			case 0x26:
+			case 0x26: OPCODE_LABEL(0x26)
 			{
 				//pushtrue
 				context->runtime_stack_push(abstract_b(function->getSystemState(),pushTrue()));
 				break;
 			}
-			case 0x27:
+			case 0x27: OPCODE_LABEL(0x27)
 			{
 				//pushfalse
 				context->runtime_stack_push(abstract_b(function->getSystemState(),pushFalse()));
 				break;
 			}
-			case 0x28:
+			case 0x28: OPCODE_LABEL(0x28)
 			{
 				//pushnan
 				context->runtime_stack_push(pushNaN());
 				break;
 			}
-			case 0x29:
+			case 0x29: OPCODE_LABEL(0x29)
 			{
 				//pop
 				pop();
@@ -466,7 +665,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 					o->decRef();
 				break;
 			}
-			case 0x2a:
+			case 0x2a: OPCODE_LABEL(0x2a)
 			{
 				//dup
 				dup();
@@ -475,7 +674,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(o);
 				break;
 			}
-			case 0x2b:
+			case 0x2b: OPCODE_LABEL(0x2b)
 			{
 				//swap
 				swap();
@@ -486,14 +685,14 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(v2);
 				break;
 			}
-			case 0x2c:
+			case 0x2c: OPCODE_LABEL(0x2c)
 			{
 				//pushstring
 				context->runtime_stack_push(pushString(context,data->uints[0]));
 				instructionPointer+=4;
 				break;
 			}
-			case 0x2d:
+			case 0x2d: OPCODE_LABEL(0x2d)
 			{
 				//pushint
 				int32_t t=data->ints[0];
@@ -503,7 +702,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(i);
 				break;
 			}
-			case 0x2e:
+			case 0x2e: OPCODE_LABEL(0x2e)
 			{
 				//pushuint
 				uint32_t t=data->uints[0];
@@ -514,7 +713,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(i);
 				break;
 			}
-			case 0x2f:
+			case 0x2f: OPCODE_LABEL(0x2f)
 			{
 				//pushdouble
 				double t=data->doubles[0];
@@ -525,20 +724,20 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(d);
 				break;
 			}
-			case 0x30:
+			case 0x30: OPCODE_LABEL(0x30)
 			{
 				//pushscope
 				pushScope(context);
 				break;
 			}
-			case 0x31:
+			case 0x31: OPCODE_LABEL(0x31)
 			{
 				//pushnamespace
 				context->runtime_stack_push( pushNamespace(context, data->uints[0]) );
 				instructionPointer+=4;
 				break;
 			}
-			case 0x32:
+			case 0x32: OPCODE_LABEL(0x32)
 			{
 				//hasnext2
 				uint32_t t=data->uints[0];
@@ -550,84 +749,84 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				break;
 			}
 			//Alchemy opcodes
-			case 0x35:
+			case 0x35: OPCODE_LABEL(0x35)
 			{
 				//li8
 				LOG_CALL( "li8");
 				loadIntN<uint8_t>(context);
 				break;
 			}
-			case 0x36:
+			case 0x36: OPCODE_LABEL(0x36)
 			{
 				//li16
 				LOG_CALL( "li16");
 				loadIntN<uint16_t>(context);
 				break;
 			}
-			case 0x37:
+			case 0x37: OPCODE_LABEL(0x37)
 			{
 				//li32
 				LOG_CALL( "li32");
 				loadIntN<uint32_t>(context);
 				break;
 			}
-			case 0x38:
+			case 0x38: OPCODE_LABEL(0x38)
 			{
 				//lf32
 				LOG_CALL( "lf32");
 				loadFloat(context);
 				break;
 			}
-			case 0x39:
+			case 0x39: OPCODE_LABEL(0x39)
 			{
 				//lf32
 				LOG_CALL( "lf64");
 				loadDouble(context);
 				break;
 			}
-			case 0x3a:
+			case 0x3a: OPCODE_LABEL(0x3a)
 			{
 				//si8
 				LOG_CALL( "si8");
 				storeIntN<uint8_t>(context);
 				break;
 			}
-			case 0x3b:
+			case 0x3b: OPCODE_LABEL(0x3b)
 			{
 				//si16
 				LOG_CALL( "si16");
 				storeIntN<uint16_t>(context);
 				break;
 			}
-			case 0x3c:
+			case 0x3c: OPCODE_LABEL(0x3c)
 			{
 				//si32
 				LOG_CALL( "si32");
 				storeIntN<uint32_t>(context);
 				break;
 			}
-			case 0x3d:
+			case 0x3d: OPCODE_LABEL(0x3d)
 			{
 				//sf32
 				LOG_CALL( "sf32");
 				storeFloat(context);
 				break;
 			}
-			case 0x3e:
+			case 0x3e: OPCODE_LABEL(0x3e)
 			{
 				//sf32
 				LOG_CALL( "sf64");
 				storeDouble(context);
 				break;
 			}
-			case 0x40:
+			case 0x40: OPCODE_LABEL(0x40)
 			{
 				//newfunction
 				context->runtime_stack_push(newFunction(context,data->uints[0]));
 				instructionPointer+=4;
 				break;
 			}
-			case 0x41:
+			case 0x41: OPCODE_LABEL(0x41)
 			{
 				//call
 				uint32_t t=data->uints[0];
@@ -641,14 +840,14 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=4;
 				break;
 			}
-			case 0x42:
+			case 0x42: OPCODE_LABEL(0x42)
 			{
 				//construct
 				construct(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x44:
+			case 0x44: OPCODE_LABEL(0x44)
 			{
 				//callstatic
 				uint32_t t=data->uints[0];
@@ -662,7 +861,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
 				break;
 			}
-			case 0x45:
+			case 0x45: OPCODE_LABEL(0x45)
 			{
 				//callsuper
 				uint32_t t=data->uints[0];
@@ -677,8 +876,8 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
-			case 0x46:
-			case 0x4c: //callproplex seems to be exactly like callproperty
+			case 0x46: OPCODE_LABEL(0x46)
+			case 0x4c: OPCODE_LABEL(0x4c) //callproplex seems to be exactly like callproperty
 			{
 				//callproperty
 				uint32_t t=data->uints[0];
@@ -693,14 +892,14 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
-			case 0x47:
+			case 0x47: OPCODE_LABEL(0x47)
 			{
 				//returnvoid
 				LOG_CALL(_("returnVoid"));
 				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
 				return NULL;
 			}
-			case 0x48:
+			case 0x48: OPCODE_LABEL(0x48)
 			{
 				//returnvalue
 				ASObject* ret=context->runtime_stack_pop();
@@ -708,14 +907,14 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
 				return ret;
 			}
-			case 0x49:
+			case 0x49: OPCODE_LABEL(0x49)
 			{
 				//constructsuper
 				constructSuper(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x4a:
+			case 0x4a: OPCODE_LABEL(0x4a)
 			{
 				//constructprop
 				uint32_t t=data->uints[0];
@@ -724,7 +923,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				constructProp(context,t,t2);
 				break;
 			}
-			case 0x4e:
+			case 0x4e: OPCODE_LABEL(0x4e)
 			{
 				//callsupervoid
 				uint32_t t=data->uints[0];
@@ -739,7 +938,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
-			case 0x4f:
+			case 0x4f: OPCODE_LABEL(0x4f)
 			{
 				//callpropvoid
 				uint32_t t=data->uints[0];
@@ -754,7 +953,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
-			case 0x50:
+			case 0x50: OPCODE_LABEL(0x50)
 			{
 				//sxi1
 				LOG_CALL( "sxi1");
@@ -764,7 +963,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
 				break;
 			}
-			case 0x51:
+			case 0x51: OPCODE_LABEL(0x51)
 			{
 				//sxi8
 				LOG_CALL( "sxi8");
@@ -774,7 +973,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
 				break;
 			}
-			case 0x52:
+			case 0x52: OPCODE_LABEL(0x52)
 			{
 				//sxi16
 				LOG_CALL( "sxi16");
@@ -784,55 +983,55 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(abstract_i(function->getSystemState(),ret));
 				break;
 			}
-			case 0x53:
+			case 0x53: OPCODE_LABEL(0x53)
 			{
 				//constructgenerictype
 				constructGenericType(context, data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x55:
+			case 0x55: OPCODE_LABEL(0x55)
 			{
 				//newobject
 				newObject(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x56:
+			case 0x56: OPCODE_LABEL(0x56)
 			{
 				//newarray
 				newArray(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x57:
+			case 0x57: OPCODE_LABEL(0x57)
 			{
 				//newactivation
 				context->runtime_stack_push(newActivation(context, mi,caller));
 				break;
 			}
-			case 0x58:
+			case 0x58: OPCODE_LABEL(0x58)
 			{
 				//newclass
 				newClass(context,data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x59:
+			case 0x59: OPCODE_LABEL(0x59)
 			{
 				//getdescendants
 				getDescendants(context, data->uints[0]);
 				instructionPointer+=4;
 				break;
 			}
-			case 0x5a:
+			case 0x5a: OPCODE_LABEL(0x5a)
 			{
 				//newcatch
 				context->runtime_stack_push(newCatch(context,data->uints[0]));
 				instructionPointer+=4;
 				break;
 			}
-			case 0x5d:
+			case 0x5d: OPCODE_LABEL(0x5d)
 			{
 				//findpropstrict
 				uint32_t t=data->uints[0];
@@ -842,7 +1041,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				name->resetNameIfObject();
 				break;
 			}
-			case 0x5e:
+			case 0x5e: OPCODE_LABEL(0x5e)
 			{
 				//findproperty
 				uint32_t t=data->uints[0];
@@ -852,7 +1051,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				name->resetNameIfObject();
 				break;
 			}
-			case 0x5f:
+			case 0x5f: OPCODE_LABEL(0x5f)
 			{
 				//finddef
 				uint32_t t=data->uints[0];
@@ -863,7 +1062,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				name->resetNameIfObject();
 				break;
 			}
-			case 0x60:
+			case 0x60: OPCODE_LABEL(0x60)
 			{
 				//getlex
 				uint32_t t=data->uints[0];
@@ -871,7 +1070,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				getLex(context,t);
 				break;
 			}
-			case 0x61:
+			case 0x61: OPCODE_LABEL(0x61)
 			{
 				//setproperty
 				uint32_t t=data->uints[0];
@@ -886,11 +1085,17 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				name->resetNameIfObject();
 				break;
 			}
-			case 0x62:
+			case 0x62: OPCODE_LABEL(0x62)
 			{
 				//getlocal
 				uint32_t i=data->uints[0];
 				instructionPointer+=4;
+				//Fuse with the following instructions if they can read the local directly
+				uint8_t next=code[instructionPointer];
+				if(next==GET_PROPERTY_CACHED)
+					rewriteOpcode(mi,context->exec_pos,GET_LOCAL_PROPERTY_CACHED);
+				else if(next==0x62 && isNumericIf(code[instructionPointer+5]))
+					rewriteOpcode(mi,context->exec_pos,IF_LOCALS_NUMERIC);
 				if (!context->locals[i])
 				{
 					LOG_CALL( _("getLocal ") << i << " not set, pushing Undefined");
@@ -902,7 +1107,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(context->locals[i]);
 				break;
 			}
-			case 0x63:
+			case 0x63: OPCODE_LABEL(0x63)
 			{
 				//setlocal
 				uint32_t i=data->uints[0];
@@ -918,13 +1123,13 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x64:
+			case 0x64: OPCODE_LABEL(0x64)
 			{
 				//getglobalscope
 				context->runtime_stack_push(getGlobalScope(context));
 				break;
 			}
-			case 0x65:
+			case 0x65: OPCODE_LABEL(0x65)
 			{
 				//getscopeobject
 				uint32_t t=data->uints[0];
@@ -932,7 +1137,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(getScopeObject(context,t));
 				break;
 			}
-			case 0x66:
+			case 0x66: OPCODE_LABEL(0x66)
 			{
 				//getproperty
 				uint32_t t=data->uints[0];
@@ -947,7 +1152,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x68:
+			case 0x68: OPCODE_LABEL(0x68)
 			{
 				//initproperty
 				uint32_t t=data->uints[0];
@@ -959,7 +1164,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				name->resetNameIfObject();
 				break;
 			}
-			case 0x6a:
+			case 0x6a: OPCODE_LABEL(0x6a)
 			{
 				//deleteproperty
 				uint32_t t=data->uints[0];
@@ -971,7 +1176,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
 				break;
 			}
-			case 0x6c:
+			case 0x6c: OPCODE_LABEL(0x6c)
 			{
 				//getslot
 				uint32_t t=data->uints[0];
@@ -981,7 +1186,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x6d:
+			case 0x6d: OPCODE_LABEL(0x6d)
 			{
 				//setslot
 				uint32_t t=data->uints[0];
@@ -993,7 +1198,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				setSlot(v1, v2, t);
 				break;
 			}
-			case 0x6e:
+			case 0x6e: OPCODE_LABEL(0x6e)
 			{
 				//getglobalSlot
 				uint32_t t=data->uints[0];
@@ -1003,7 +1208,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(globalscope->getSlot(t));
 				break;
 			}
-			case 0x6f:
+			case 0x6f: OPCODE_LABEL(0x6f)
 			{
 				//setglobalSlot
 				uint32_t t=data->uints[0];
@@ -1014,25 +1219,26 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				globalscope->setSlot(t,obj);
 				break;
 			}
-			case 0x70:
+			case 0x70: OPCODE_LABEL(0x70)
 			{
 				//convert_s
 				ASObject* val=context->runtime_stack_pop();
 				context->runtime_stack_push(convert_s(val));
 				break;
 			}
-			case 0x71:
+			case 0x71: OPCODE_LABEL(0x71)
 			{
 				ASObject* val=context->runtime_stack_pop();
 				context->runtime_stack_push(esc_xelem(val));
 				break;
 			}
-			case 0x72:
+			case 0x72: OPCODE_LABEL(0x72)
 			{
 				ASObject* val=context->runtime_stack_pop();
 				context->runtime_stack_push(esc_xattr(val));
 				break;
-			}case 0x73:
+			}
+			case 0x73: OPCODE_LABEL(0x73)
 			{
 				//convert_i
 				ASObject* val=context->runtime_stack_peek();
@@ -1043,7 +1249,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x74:
+			case 0x74: OPCODE_LABEL(0x74)
 			{
 				//convert_u
 				ASObject* val=context->runtime_stack_peek();
@@ -1054,7 +1260,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x75:
+			case 0x75: OPCODE_LABEL(0x75)
 			{
 				//convert_d
 				ASObject* val=context->runtime_stack_peek();
@@ -1077,7 +1283,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x76:
+			case 0x76: OPCODE_LABEL(0x76)
 			{
 				//convert_b
 				ASObject* val=context->runtime_stack_peek();
@@ -1088,7 +1294,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x77:
+			case 0x77: OPCODE_LABEL(0x77)
 			{
 				//convert_o
 				ASObject* val=context->runtime_stack_peek();
@@ -1108,14 +1314,14 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0x78:
+			case 0x78: OPCODE_LABEL(0x78)
 			{
 				//checkfilter
 				ASObject* val=context->runtime_stack_pop();
 				context->runtime_stack_push(checkfilter(val));
 				break;
 			}
-			case 0x80:
+			case 0x80: OPCODE_LABEL(0x80)
 			{
 				//coerce
 				const multiname* name=data->names[0];
@@ -1135,13 +1341,13 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
-			case 0x82:
+			case 0x82: OPCODE_LABEL(0x82)
 			{
 				//coerce_a
 				coerce_a();
 				break;
 			}
-			case 0x85:
+			case 0x85: OPCODE_LABEL(0x85)
 			{
 				//coerce_s
 				ASObject* val=context->runtime_stack_pop();
@@ -1151,7 +1357,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 					context->runtime_stack_push(coerce_s(val));
 				break;
 			}
-			case 0x86:
+			case 0x86: OPCODE_LABEL(0x86)
 			{
 				//astype
 				uint32_t t=data->uints[0];
@@ -1164,7 +1370,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x87:
+			case 0x87: OPCODE_LABEL(0x87)
 			{
 				//astypelate
 				ASObject* v1=context->runtime_stack_pop();
@@ -1174,7 +1380,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x90:
+			case 0x90: OPCODE_LABEL(0x90)
 			{
 				//negate
 				ASObject* val=context->runtime_stack_pop();
@@ -1186,7 +1392,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x91:
+			case 0x91: OPCODE_LABEL(0x91)
 			{
 				//increment
 				ASObject* val=context->runtime_stack_pop();
@@ -1198,7 +1404,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x92:
+			case 0x92: OPCODE_LABEL(0x92)
 			{
 				//inclocal
 				uint32_t t=data->uints[0];
@@ -1206,7 +1412,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				incLocal(context, t);
 				break;
 			}
-			case 0x93:
+			case 0x93: OPCODE_LABEL(0x93)
 			{
 				//decrement
 				ASObject* val=context->runtime_stack_pop();
@@ -1218,7 +1424,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x94:
+			case 0x94: OPCODE_LABEL(0x94)
 			{
 				//declocal
 				uint32_t t=data->uints[0];
@@ -1226,7 +1432,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				decLocal(context, t);
 				break;
 			}
-			case 0x95:
+			case 0x95: OPCODE_LABEL(0x95)
 			{
 				//typeof
 				ASObject* val=context->runtime_stack_pop();
@@ -1234,7 +1440,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x96:
+			case 0x96: OPCODE_LABEL(0x96)
 			{
 				//not
 				ASObject* val=context->runtime_stack_pop();
@@ -1242,7 +1448,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0x97:
+			case 0x97: OPCODE_LABEL(0x97)
 			{
 				//bitnot
 				ASObject* val=context->runtime_stack_pop();
@@ -1250,17 +1456,19 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa0:
+			case 0xa0: OPCODE_LABEL(0xa0)
 			{
 				//add
 				ASObject* v2=context->runtime_stack_pop();
 				ASObject* v1=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,ADD_NUMERIC);
 
 				ASObject* ret=add(v2, v1);
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa1:
+			case 0xa1: OPCODE_LABEL(0xa1)
 			{
 				//subtract
 				//Be careful, operands in subtract implementation are swapped
@@ -1284,7 +1492,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa2:
+			case 0xa2: OPCODE_LABEL(0xa2)
 			{
 				//multiply
 				ASObject* v2=context->runtime_stack_pop();
@@ -1307,7 +1515,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa3:
+			case 0xa3: OPCODE_LABEL(0xa3)
 			{
 				//divide
 				ASObject* v2=context->runtime_stack_pop();
@@ -1317,7 +1525,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa4:
+			case 0xa4: OPCODE_LABEL(0xa4)
 			{
 				//modulo
 				ASObject* v2=context->runtime_stack_pop();
@@ -1343,7 +1551,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa5:
+			case 0xa5: OPCODE_LABEL(0xa5)
 			{
 				//lshift
 				ASObject* v1=context->runtime_stack_pop();
@@ -1353,7 +1561,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa6:
+			case 0xa6: OPCODE_LABEL(0xa6)
 			{
 				//rshift
 				ASObject* v1=context->runtime_stack_pop();
@@ -1363,7 +1571,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa7:
+			case 0xa7: OPCODE_LABEL(0xa7)
 			{
 				//urshift
 				ASObject* v1=context->runtime_stack_pop();
@@ -1373,7 +1581,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa8:
+			case 0xa8: OPCODE_LABEL(0xa8)
 			{
 				//bitand
 				ASObject* v1=context->runtime_stack_pop();
@@ -1383,7 +1591,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xa9:
+			case 0xa9: OPCODE_LABEL(0xa9)
 			{
 				//bitor
 				ASObject* v1=context->runtime_stack_pop();
@@ -1393,7 +1601,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xaa:
+			case 0xaa: OPCODE_LABEL(0xaa)
 			{
 				//bitxor
 				ASObject* v1=context->runtime_stack_pop();
@@ -1403,7 +1611,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xab:
+			case 0xab: OPCODE_LABEL(0xab)
 			{
 				//equals
 				ASObject* v2=context->runtime_stack_pop();
@@ -1413,7 +1621,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xac:
+			case 0xac: OPCODE_LABEL(0xac)
 			{
 				//strictequals
 				ASObject* v2=context->runtime_stack_pop();
@@ -1423,47 +1631,55 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xad:
+			case 0xad: OPCODE_LABEL(0xad)
 			{
 				//lessthan
 				ASObject* v2=context->runtime_stack_pop();
 				ASObject* v1=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,LESS_THAN_NUMERIC);
 
 				ASObject* ret=abstract_b(function->getSystemState(),lessThan(v1, v2));
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xae:
+			case 0xae: OPCODE_LABEL(0xae)
 			{
 				//lessequals
 				ASObject* v2=context->runtime_stack_pop();
 				ASObject* v1=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,LESS_EQUALS_NUMERIC);
 
 				ASObject* ret=abstract_b(function->getSystemState(),lessEquals(v1, v2));
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xaf:
+			case 0xaf: OPCODE_LABEL(0xaf)
 			{
 				//greaterthan
 				ASObject* v2=context->runtime_stack_pop();
 				ASObject* v1=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,GREATER_THAN_NUMERIC);
 
 				ASObject* ret=abstract_b(function->getSystemState(),greaterThan(v1, v2));
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xb0:
+			case 0xb0: OPCODE_LABEL(0xb0)
 			{
 				//greaterequals
 				ASObject* v2=context->runtime_stack_pop();
 				ASObject* v1=context->runtime_stack_pop();
+				if(isNumeric(v1) && isNumeric(v2))
+					rewriteOpcode(mi,context->exec_pos,GREATER_EQUALS_NUMERIC);
 
 				ASObject* ret=abstract_b(function->getSystemState(),greaterEquals(v1, v2));
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xb1:
+			case 0xb1: OPCODE_LABEL(0xb1)
 			{
 				//instanceof
 				ASObject* type=context->runtime_stack_pop();
@@ -1472,7 +1688,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(abstract_b(function->getSystemState(),ret));
 				break;
 			}
-			case 0xb2:
+			case 0xb2: OPCODE_LABEL(0xb2)
 			{
 				//istype
 				uint32_t t=data->uints[0];
@@ -1485,7 +1701,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xb3:
+			case 0xb3: OPCODE_LABEL(0xb3)
 			{
 				//istypelate
 				ASObject* v1=context->runtime_stack_pop();
@@ -1495,7 +1711,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xb4:
+			case 0xb4: OPCODE_LABEL(0xb4)
 			{
 				//in
 				ASObject* v1=context->runtime_stack_pop();
@@ -1505,7 +1721,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xc0:
+			case 0xc0: OPCODE_LABEL(0xc0)
 			{
 				//increment_i
 				ASObject* val=context->runtime_stack_pop();
@@ -1513,7 +1729,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xc1:
+			case 0xc1: OPCODE_LABEL(0xc1)
 			{
 				//decrement_i
 				ASObject* val=context->runtime_stack_pop();
@@ -1521,7 +1737,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xc2:
+			case 0xc2: OPCODE_LABEL(0xc2)
 			{
 				//inclocal_i
 				uint32_t t=data->uints[0];
@@ -1529,7 +1745,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				incLocal_i(context, t);
 				break;
 			}
-			case 0xc3:
+			case 0xc3: OPCODE_LABEL(0xc3)
 			{
 				//declocal_i
 				uint32_t t=data->uints[0];
@@ -1537,7 +1753,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				decLocal_i(context, t);
 				break;
 			}
-			case 0xc4:
+			case 0xc4: OPCODE_LABEL(0xc4)
 			{
 				//negate_i
 				ASObject *val=context->runtime_stack_pop();
@@ -1545,7 +1761,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xc5:
+			case 0xc5: OPCODE_LABEL(0xc5)
 			{
 				//add_i
 				ASObject* v2=context->runtime_stack_pop();
@@ -1555,7 +1771,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xc6:
+			case 0xc6: OPCODE_LABEL(0xc6)
 			{
 				//subtract_i
 				ASObject* v2=context->runtime_stack_pop();
@@ -1565,7 +1781,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xc7:
+			case 0xc7: OPCODE_LABEL(0xc7)
 			{
 				//multiply_i
 				ASObject* v2=context->runtime_stack_pop();
@@ -1575,10 +1791,10 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(ret);
 				break;
 			}
-			case 0xd0:
-			case 0xd1:
-			case 0xd2:
-			case 0xd3:
+			case 0xd0: OPCODE_LABEL(0xd0)
+			case 0xd1: OPCODE_LABEL(0xd1)
+			case 0xd2: OPCODE_LABEL(0xd2)
+			case 0xd3: OPCODE_LABEL(0xd3)
 			{
 				//getlocal_n
 				int i=opcode&3;
@@ -1593,10 +1809,10 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				context->runtime_stack_push(context->locals[i]);
 				break;
 			}
-			case 0xd4:
-			case 0xd5:
-			case 0xd6:
-			case 0xd7:
+			case 0xd4: OPCODE_LABEL(0xd4)
+			case 0xd5: OPCODE_LABEL(0xd5)
+			case 0xd6: OPCODE_LABEL(0xd6)
+			case 0xd7: OPCODE_LABEL(0xd7)
 			{
 				//setlocal_n
 				int i=opcode&3;
@@ -1610,14 +1826,14 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				}
 				break;
 			}
-			case 0xf2:
+			case 0xf2: OPCODE_LABEL(0xf2)
 			{
 				//bkptline
 				LOG_CALL( _("bkptline") );
 				instructionPointer+=4;
 				break;
 			}
-			case 0xf3:
+			case 0xf3: OPCODE_LABEL(0xf3)
 			{
 				//timestamp
 				LOG_CALL( _("timestamp") );
@@ -1625,7 +1841,552 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				break;
 			}
 			//lightspark custom opcodes
-			case 0xfb:
+			case ADD_NUMERIC: OPCODE_LABEL(ADD_NUMERIC)
+			{
+				//add, specialized for numeric operands
+				ASObject* v2=context->runtime_stack_pop();
+				ASObject* v1=context->runtime_stack_pop();
+
+				ASObject* ret;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					LOG_CALL("addNumeric");
+					if(isIntegral(v1) && isIntegral(v2))
+						ret=abstract_di(function->getSystemState(),integralValue(v1)+integralValue(v2));
+					else
+						ret=abstract_d(function->getSystemState(),numericValue(v1)+numericValue(v2));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0xa0);
+					ret=add(v2, v1);
+				}
+				context->runtime_stack_push(ret);
+				break;
+			}
+			case LESS_THAN_NUMERIC: OPCODE_LABEL(LESS_THAN_NUMERIC)
+			{
+				//lessthan, specialized for numeric operands
+				ASObject* v2=context->runtime_stack_pop();
+				ASObject* v1=context->runtime_stack_pop();
+
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v1);
+					number_t b=numericValue(v2);
+					cond=(a<b);
+					LOG_CALL("lessThanNumeric " << cond);
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0xad);
+					cond=lessThan(v1, v2);
+				}
+				context->runtime_stack_push(abstract_b(function->getSystemState(),cond));
+				break;
+			}
+			case LESS_EQUALS_NUMERIC: OPCODE_LABEL(LESS_EQUALS_NUMERIC)
+			{
+				//lessequals, specialized for numeric operands
+				ASObject* v2=context->runtime_stack_pop();
+				ASObject* v1=context->runtime_stack_pop();
+
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v1);
+					number_t b=numericValue(v2);
+					cond=(a<=b);
+					LOG_CALL("lessEqualsNumeric " << cond);
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0xae);
+					cond=lessEquals(v1, v2);
+				}
+				context->runtime_stack_push(abstract_b(function->getSystemState(),cond));
+				break;
+			}
+			case GREATER_THAN_NUMERIC: OPCODE_LABEL(GREATER_THAN_NUMERIC)
+			{
+				//greaterthan, specialized for numeric operands
+				ASObject* v2=context->runtime_stack_pop();
+				ASObject* v1=context->runtime_stack_pop();
+
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v1);
+					number_t b=numericValue(v2);
+					cond=(a>b);
+					LOG_CALL("greaterThanNumeric " << cond);
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0xaf);
+					cond=greaterThan(v1, v2);
+				}
+				context->runtime_stack_push(abstract_b(function->getSystemState(),cond));
+				break;
+			}
+			case GREATER_EQUALS_NUMERIC: OPCODE_LABEL(GREATER_EQUALS_NUMERIC)
+			{
+				//greaterequals, specialized for numeric operands
+				ASObject* v2=context->runtime_stack_pop();
+				ASObject* v1=context->runtime_stack_pop();
+
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v1);
+					number_t b=numericValue(v2);
+					cond=(a>=b);
+					LOG_CALL("greaterEqualsNumeric " << cond);
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0xb0);
+					cond=greaterEquals(v1, v2);
+				}
+				context->runtime_stack_push(abstract_b(function->getSystemState(),cond));
+				break;
+			}
+			case IF_NLT_NUMERIC: OPCODE_LABEL(IF_NLT_NUMERIC)
+			{
+				//ifnlt, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=!(a<b);
+					LOG_CALL("ifNLTNumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x0c);
+					cond=ifNLT(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case IF_NLE_NUMERIC: OPCODE_LABEL(IF_NLE_NUMERIC)
+			{
+				//ifnle, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=!(a<=b);
+					LOG_CALL("ifNLENumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x0d);
+					cond=ifNLE(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case IF_NGT_NUMERIC: OPCODE_LABEL(IF_NGT_NUMERIC)
+			{
+				//ifngt, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=!(a>b);
+					LOG_CALL("ifNGTNumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x0e);
+					cond=ifNGT(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case IF_NGE_NUMERIC: OPCODE_LABEL(IF_NGE_NUMERIC)
+			{
+				//ifnge, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=!(a>=b);
+					LOG_CALL("ifNGENumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x0f);
+					cond=ifNGE(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case IF_LT_NUMERIC: OPCODE_LABEL(IF_LT_NUMERIC)
+			{
+				//iflt, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=a<b;
+					LOG_CALL("ifLTNumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x15);
+					cond=ifLT(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case IF_LE_NUMERIC: OPCODE_LABEL(IF_LE_NUMERIC)
+			{
+				//ifle, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=a<=b;
+					LOG_CALL("ifLENumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x16);
+					cond=ifLE(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case IF_GT_NUMERIC: OPCODE_LABEL(IF_GT_NUMERIC)
+			{
+				//ifgt, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=a>b;
+					LOG_CALL("ifGTNumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x17);
+					cond=ifGT(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case IF_GE_NUMERIC: OPCODE_LABEL(IF_GE_NUMERIC)
+			{
+				//ifge, specialized for numeric operands
+				uint32_t dest=data->uints[0];
+				instructionPointer+=4;
+
+				ASObject* v1=context->runtime_stack_pop();
+				ASObject* v2=context->runtime_stack_pop();
+				bool cond;
+				if(isNumeric(v1) && isNumeric(v2))
+				{
+					number_t a=numericValue(v2);
+					number_t b=numericValue(v1);
+					cond=a>=b;
+					LOG_CALL("ifGENumeric (" << ((cond)?"taken)":"not taken)"));
+					v1->decRef();
+					v2->decRef();
+				}
+				else
+				{
+					rewriteOpcode(mi,context->exec_pos,0x18);
+					cond=ifGE(v1, v2);
+				}
+				if(cond)
+				{
+					assert(dest < code_len);
+					instructionPointer=dest;
+				}
+				break;
+			}
+			case GET_PROPERTY_CACHED: OPCODE_LABEL(GET_PROPERTY_CACHED)
+			{
+				//getproperty, with an inline cache of the slot of a declared trait
+				uint32_t t=data->uints[0];
+				uint32_t slot=data->uints[1];
+				Class_base* cls=readCachePtr<Class_base*>(data,CACHE_CLASS_OFFSET);
+				instructionPointer+=16;
+
+				ASObject* obj=context->runtime_stack_pop();
+				Class_base* objClass=obj->getClass();
+				if(cls && objClass==cls && obj->isInitialized())
+				{
+					ASObject* ret=obj->getSlot(slot);
+					//Methods stored in slots still have to be bound
+					if(ret && ret->getObjectType()!=T_FUNCTION)
+					{
+						LOG_CALL("getPropertyCached " << slot);
+						ret->incRef();
+						obj->decRef();
+						context->runtime_stack_push(ret);
+						break;
+					}
+				}
+				multiname* name=context->context->getMultiname(t,context);
+				//The cache must be updated before obj is released
+				if(objClass!=cls && slot!=MEGAMORPHIC_SLOT)
+					updateSlotCache(mi,context->exec_pos,obj,name);
+
+				ASObject* ret=getProperty(obj,name);
+				name->resetNameIfObject();
+
+				context->runtime_stack_push(ret);
+				break;
+			}
+			case SET_PROPERTY_CACHED: OPCODE_LABEL(SET_PROPERTY_CACHED)
+			{
+				//setproperty, with an inline cache of the slot of a declared trait
+				uint32_t t=data->uints[0];
+				uint32_t slot=data->uints[1];
+				Class_base* cls=readCachePtr<Class_base*>(data,CACHE_CLASS_OFFSET);
+				instructionPointer+=16;
+				ASObject* value=context->runtime_stack_pop();
+
+				multiname* name=context->context->getMultiname(t,context);
+
+				ASObject* obj=context->runtime_stack_pop();
+				Class_base* objClass=obj->getClass();
+				if(cls && objClass==cls && obj->isInitialized())
+				{
+					LOG_CALL("setPropertyCached " << slot);
+					obj->setSlot(slot,value);
+					obj->decRef();
+					break;
+				}
+				if(objClass!=cls && slot!=MEGAMORPHIC_SLOT)
+					updateSlotCache(mi,context->exec_pos,obj,name);
+
+				setProperty(value,obj,name);
+				name->resetNameIfObject();
+				break;
+			}
+			case CALL_PROPERTY_CACHED: OPCODE_LABEL(CALL_PROPERTY_CACHED)
+			case CALL_PROPVOID_CACHED: OPCODE_LABEL(CALL_PROPVOID_CACHED)
+			{
+				//callproperty and callpropvoid, with an inline cache of the method
+				uint32_t t=data->uints[0];
+				uint32_t t2=data->uints[1];
+				Class_base* cls=readCachePtr<Class_base*>(data,CACHE_CLASS_OFFSET);
+				IFunction* f=readCachePtr<IFunction*>(data,CACHE_METHOD_OFFSET);
+				bool keepReturn=(opcode==CALL_PROPERTY_CACHED);
+				method_info* called_mi=NULL;
+				PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
+
+				ASObject* obj=(context->stack_index>t2)?context->stack[context->stack_index-t2-1]:NULL;
+				if(obj==NULL || f==MEGAMORPHIC_METHOD)
+					f=NULL;
+				else if(cls==NULL)
+				{
+					//Bind the cache to the class of this object
+					f=getCacheableMethod(obj,context->context->getMultiname(t,context));
+					OpcodeData* cache=reinterpret_cast<OpcodeData*>(&(mi->body->code[0])+context->exec_pos+1);
+					writeCachePtr<Class_base*>(cache,CACHE_CLASS_OFFSET,f?obj->getClass():NULL);
+					writeCachePtr<IFunction*>(cache,CACHE_METHOD_OFFSET,f?f:MEGAMORPHIC_METHOD);
+				}
+				else if(obj->getClass()!=cls)
+				{
+					OpcodeData* cache=reinterpret_cast<OpcodeData*>(&(mi->body->code[0])+context->exec_pos+1);
+					writeCachePtr<Class_base*>(cache,CACHE_CLASS_OFFSET,NULL);
+					writeCachePtr<IFunction*>(cache,CACHE_METHOD_OFFSET,MEGAMORPHIC_METHOD);
+					f=NULL;
+				}
+				else if(!obj->isInitialized())
+					f=NULL;
+				if(f)
+				{
+					//Call the method directly, without binding it to obj
+					LOG_CALL((keepReturn ? "callPropertyCached " : "callPropVoidCached ") << t2);
+					ASObject** args=context->stack+context->stack_index-t2;
+					context->stack_index-=t2+1;
+					ASObject* ret=f->call(obj,args,t2);
+					//call getMethodInfo only after the call, so it's updated
+					called_mi=f->getMethodInfo();
+					if(keepReturn)
+						context->runtime_stack_push(ret);
+					else
+						ret->decRef();
+				}
+				else
+					callProperty(context,t,t2,&called_mi,keepReturn);
+				if(called_mi)
+					PROF_ACCOUNT_TIME(mi->profCalls[called_mi],profilingCheckpoint(startTime));
+				else
+					PROF_IGNORE_TIME(profilingCheckpoint(startTime));
+				instructionPointer+=24;
+				break;
+			}
+			case GET_LOCAL_PROPERTY_CACHED: OPCODE_LABEL(GET_LOCAL_PROPERTY_CACHED)
+			{
+				//getlocal fused with the following getproperty, if the cache hits the
+				//local is read in place, otherwise only the getlocal is executed
+				uint32_t i=data->uints[0];
+				const OpcodeData* next=reinterpret_cast<const OpcodeData*>(code+instructionPointer+5);
+				ASObject* obj=context->locals[i];
+				Class_base* cls=readCachePtr<Class_base*>(next,CACHE_CLASS_OFFSET);
+				if(obj && cls && obj->getClass()==cls && obj->isInitialized())
+				{
+					ASObject* ret=obj->getSlot(next->uints[1]);
+					if(ret && ret->getObjectType()!=T_FUNCTION)
+					{
+						LOG_CALL("getLocalPropertyCached " << i << ' ' << next->uints[1]);
+						ret->incRef();
+						context->runtime_stack_push(ret);
+						instructionPointer+=21;
+						break;
+					}
+				}
+				instructionPointer+=4;
+				if (!obj)
+				{
+					LOG_CALL( _("getLocal ") << i << " not set, pushing Undefined");
+					context->runtime_stack_push(function->getSystemState()->getUndefinedRef());
+					break;
+				}
+				LOG_CALL( _("getLocal ") << i << _(": ") << obj->toDebugString() );
+				obj->incRef();
+				context->runtime_stack_push(obj);
+				break;
+			}
+			case IF_LOCALS_NUMERIC: OPCODE_LABEL(IF_LOCALS_NUMERIC)
+			{
+				//Two getlocal fused with the following numeric conditional jump,
+				//the locals are compared in place without going through the stack
+				uint32_t i=data->uints[0];
+				uint32_t j=reinterpret_cast<const OpcodeData*>(code+instructionPointer+5)->uints[0];
+				uint8_t cmp=code[instructionPointer+9];
+				ASObject* a=context->locals[i];
+				ASObject* b=context->locals[j];
+				if(a && b && isNumeric(a) && isNumeric(b) && isNumericIf(cmp))
+				{
+					uint32_t dest=reinterpret_cast<const OpcodeData*>(code+instructionPointer+10)->uints[0];
+					bool cond=numericIfTaken(cmp,numericValue(a),numericValue(b));
+					LOG_CALL("ifLocalsNumeric " << i << ' ' << j << " (" << ((cond)?"taken)":"not taken)"));
+					instructionPointer+=14;
+					if(cond)
+					{
+						assert(dest < code_len);
+						instructionPointer=dest;
+					}
+					break;
+				}
+				//Go back to a plain getlocal, it is fused again when the types are numeric
+				rewriteOpcode(mi,context->exec_pos,0x62);
+				instructionPointer+=4;
+				if (!a)
+				{
+					LOG_CALL( _("getLocal ") << i << " not set, pushing Undefined");
+					context->runtime_stack_push(function->getSystemState()->getUndefinedRef());
+					break;
+				}
+				LOG_CALL( _("getLocal ") << i << _(": ") << a->toDebugString() );
+				a->incRef();
+				context->runtime_stack_push(a);
+				break;
+			}
+			case 0xfb: OPCODE_LABEL(0xfb)
 			{
 				//setslot_no_coerce
 				uint32_t t=data->uints[0];
@@ -1639,7 +2400,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				obj->decRef();
 				break;
 			}
-			case 0xfc:
+			case 0xfc: OPCODE_LABEL(0xfc)
 			{
 				//coerceearly
 				const Type* type = data->types[0];
@@ -1652,7 +2413,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
-			case 0xfd:
+			case 0xfd: OPCODE_LABEL(0xfd)
 			{
 				//getscopeatindex
 				//This opcode is similar to getscopeobject, but it allows access to any
@@ -1673,7 +2434,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=4;
 				break;
 			}
-			case 0xfe:
+			case 0xfe: OPCODE_LABEL(0xfe)
 			{
 				//getlexonce
 				//This opcode execute a lookup on the application domain
@@ -1696,7 +2457,7 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				instructionPointer+=8;
 				break;
 			}
-			case 0xff:
+			case 0xff: OPCODE_LABEL(0xff)
 			{
 				//pushearly
 				ASObject* o=data->objs[0];
@@ -1712,6 +2473,15 @@ ASObject* ABCVm::executeFunctionFast(const SyntheticFunction* function, call_con
 				throw ParseException("Not implemented instruction in fast interpreter");
 		}
 		PROF_ACCOUNT_TIME(mi->profTime[instructionPointer],profilingCheckpoint(startTime));
+#ifdef THREADED_DISPATCH
+		//Jump straight to the handler of the next instruction
+		assert(instructionPointer<code_len);
+		opcode=code[instructionPointer];
+		context->exec_pos = instructionPointer;
+		instructionPointer++;
+		data=reinterpret_cast<const OpcodeData*>(code+instructionPointer);
+		goto *dispatchTable[opcode];
+#endif
 	}
 
 #undef PROF_ACCOUNT_TIME 
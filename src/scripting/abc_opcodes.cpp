@@ -28,6 +28,7 @@
 #include "scripting/toplevel/XML.h"
 #include "scripting/toplevel/XMLList.h"
 #include "scripting/flash/utils/Proxy.h"
+#include "scripting/flash/utils/Dictionary.h"
 
 using namespace std;
 using namespace lightspark;
@@ -452,6 +453,48 @@ void ABCVm::checkDeclaredTraits(ASObject* obj)
 		obj->getClass()->setupDeclaredTraits(obj);
 }
 
+/*
+ * Inline caches only bind the instances of classes defined in ActionScript, unless
+ * they inherit a custom property lookup from one of the builtin classes
+ */
+static bool hasCacheableTraits(ASObject* obj)
+{
+	Class_base* cls=obj->getClass();
+	return cls && cls->is<Class_inherit>() && obj->isInitialized() &&
+		!obj->is<Proxy>() && !obj->is<Array>() && !obj->is<ByteArray>() && !obj->is<Dictionary>() && !obj->is<Global>();
+}
+
+uint32_t ABCVm::getCacheableSlot(ASObject* obj, const multiname* name)
+{
+	if(!hasCacheableTraits(obj))
+		return 0;
+	const variable* var=obj->Variables.findObjVar(obj->getSystemState(),*name,DECLARED_TRAIT|DYNAMIC_TRAIT);
+	if(var==NULL || var->kind!=DECLARED_TRAIT || var->getter || var->setter || var->var==NULL)
+		return 0;
+	//Slots are laid out in the same way in all the instances of a class
+	const auto& slots=obj->Variables.slots_vars;
+	for(uint32_t i=0;i<slots.size();i++)
+	{
+		if(slots[i]!=obj->Variables.Variables.end() && &slots[i]->second==var)
+			return i+1;
+	}
+	return 0;
+}
+
+IFunction* ABCVm::getCacheableMethod(ASObject* obj, const multiname* name)
+{
+	//Dynamic properties of the object could hide the method later
+	if(!hasCacheableTraits(obj) || !obj->getClass()->isSealed)
+		return NULL;
+	if(obj->Variables.findObjVar(obj->getSystemState(),*name,DECLARED_TRAIT|DYNAMIC_TRAIT))
+		return NULL;
+	const variable* var=obj->getClass()->findBorrowedGettable(*name);
+	if(var==NULL || var->getter || var->var==NULL || !var->var->is<IFunction>())
+		return NULL;
+	IFunction* f=var->var->as<IFunction>();
+	return (f->isMethod() && !f->isBound())?f:NULL;
+}
+
 int32_t ABCVm::getProperty_i(ASObject* obj, multiname* name)
 {
 	LOG_CALL( _("getProperty_i ") << *name );
@@ -726,6 +769,7 @@ ASObject* ABCVm::constructFunction(call_context* th, IFunction* f, ASObject** ar
 		SyntheticFunction* sf=f->as<SyntheticFunction>();
 		if (sf->mi->body && !sf->mi->needsActivation())
 		{
+			sf->mi->ensureBodyParsed();
 			LOG_CALL(_("Building method traits"));
 			for(unsigned int i=0;i<sf->mi->body->trait_count;i++)
 				th->context->buildTrait(ret,&sf->mi->body->traits[i],false);
@@ -1049,13 +1093,25 @@ ASObject* ABCVm::add(ASObject* val2, ASObject* val1)
 	}
 	else if(val1->is<ASString>() || val2->is<ASString>())
 	{
-		tiny_string a = val1->toString();
-		tiny_string b = val2->toString();
-		LOG_CALL("add " << a << '+' << b);
-		res = abstract_s(val1->getSystemState(),a + b);
-		val1->decRef();
-		val2->decRef();
-		return res;
+		//Long results are built lazily as ropes
+		ASString* a;
+		ASString* b;
+		if(val1->is<ASString>())
+			a = val1->as<ASString>();
+		else
+		{
+			a = abstract_s(val1->getSystemState(),val1->toString());
+			val1->decRef();
+		}
+		if(val2->is<ASString>())
+			b = val2->as<ASString>();
+		else
+		{
+			b = abstract_s(val2->getSystemState(),val2->toString());
+			val2->decRef();
+		}
+		LOG_CALL("add " << a->getData() << '+' << b->getData());
+		return ASString::concatenate(a,b);
 	}
 	else if( (val1->is<XML>() || val1->is<XMLList>()) && (val2->is<XML>() || val2->is<XMLList>()) )
 	{
@@ -2346,7 +2402,8 @@ void ABCVm::newClass(call_context* th, int n)
 			return;
 		}
 		
-		ret=new (th->context->root->getSystemState()->unaccountedMemory) Class_inherit(className, th->context->root->getSystemState()->unaccountedMemory);
+		SystemState* sys=th->context->root->getSystemState();
+		ret=new (sys->unaccountedMemory) Class_inherit(className, sys->allocateMemoryAccount(className.getQualifiedName(sys)));
 
 		LOG_CALL("add classes defined:"<<*mname<<" "<<th->context);
 		//Add the class to the ones being currently defined in this context
@@ -2676,6 +2733,8 @@ ASObject* ABCVm::newFunction(call_context* th, int n)
 	f->bind(NullRef,-1);
 	//Create the prototype object
 	f->prototype = _MR(new_asobject(f->getSystemState()));
+	//Closures are usually stored in the objects they capture
+	f->markCycleCandidate();
 	return f;
 }
 
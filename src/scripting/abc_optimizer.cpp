@@ -22,14 +22,13 @@
 #include "abcutils.h"
 #include "toplevel/toplevel.h"
 #include "toplevel/ASString.h"
+#include <cstring>
 #include <string>
 #include <sstream>
 
 using namespace std;
 using namespace lightspark;
 
-enum SPECIAL_OPCODES { SET_SLOT_NO_COERCE = 0xfb, COERCE_EARLY = 0xfc, GET_SCOPE_AT_INDEX = 0xfd, GET_LEX_ONCE = 0xfe, PUSH_EARLY = 0xff };
-
 struct lightspark::InferenceData
 {
 	const Type* type;
@@ -286,7 +285,10 @@ void ABCVm::writeDouble(std::ostream& o, double val)
 
 void ABCVm::writePtr(std::ostream& o, const void* val)
 {
-	o.write((char*)&val, 8);
+	//Pointers always take 8 bytes, padded with zeros on 32 bit targets
+	char buf[8]={0};
+	memcpy(buf, &val, sizeof(val));
+	o.write(buf, 8);
 }
 
 void ABCVm::verifyBranch(std::set<uint32_t>& pendingBlocks,
@@ -949,11 +951,23 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				u30 t,t2;
 				code >> t;
 				code >> t2;
-				out << (uint8_t)opcode;
-				writeInt32(out,t);
-				writeInt32(out,t2);
-				
 				int numRT=mi->context->getMultinameRTData(t);
+				if(opcode==0x46 && numRT==0)
+				{
+					out << (uint8_t)CALL_PROPERTY_CACHED;
+					writeInt32(out,t);
+					writeInt32(out,t2);
+					//Inline cache: class and method, filled on execution
+					writePtr(out,NULL);
+					writePtr(out,NULL);
+				}
+				else
+				{
+					out << (uint8_t)opcode;
+					writeInt32(out,t);
+					writeInt32(out,t2);
+				}
+
 				curBlock->popStack(numRT+t2);
 				InferenceData baseData=curBlock->peekStack();
 				//Try to infer the return type
@@ -1018,11 +1032,22 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				u30 t,t2;
 				code >> t;
 				code >> t2;
-				out << (uint8_t)opcode;
-				writeInt32(out,t);
-				writeInt32(out,t2);
-				
 				int numRT=mi->context->getMultinameRTData(t);
+				if(opcode==0x4f && numRT==0)
+				{
+					out << (uint8_t)CALL_PROPVOID_CACHED;
+					writeInt32(out,t);
+					writeInt32(out,t2);
+					writePtr(out,NULL);
+					writePtr(out,NULL);
+				}
+				else
+				{
+					out << (uint8_t)opcode;
+					writeInt32(out,t);
+					writeInt32(out,t2);
+				}
+
 				curBlock->popStack(numRT+1+t2);
 				break;
 			}
@@ -1174,10 +1199,21 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				//setproperty
 				u30 t;
 				code >> t;
-				out << (uint8_t)opcode;
-				writeInt32(out,t);
-
 				int numRT=mi->context->getMultinameRTData(t);
+				if(numRT==0)
+				{
+					out << (uint8_t)SET_PROPERTY_CACHED;
+					writeInt32(out,t);
+					//Inline cache: slot and class, filled on execution
+					writeInt32(out,0);
+					writePtr(out,NULL);
+				}
+				else
+				{
+					out << (uint8_t)opcode;
+					writeInt32(out,t);
+				}
+
 				curBlock->popStack(numRT+2);
 				break;
 			}
@@ -1228,10 +1264,20 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 				//getproperty
 				u30 t;
 				code >> t;
-				out << (uint8_t)opcode;
-				writeInt32(out,t);
-
 				int numRT=mi->context->getMultinameRTData(t);
+				if(numRT==0)
+				{
+					out << (uint8_t)GET_PROPERTY_CACHED;
+					writeInt32(out,t);
+					writeInt32(out,0);
+					writePtr(out,NULL);
+				}
+				else
+				{
+					out << (uint8_t)opcode;
+					writeInt32(out,t);
+				}
+
 				curBlock->popStack(numRT+1);
 				curBlock->pushStack(Type::anyType);
 				break;
@@ -1597,8 +1643,10 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 			case 0xd3:
 			{
 				//getlocal_n
-				//TODO: collapse on getlocal
-				out << (uint8_t)opcode;
+				//Collapse on getlocal, so that the fast interpreter
+				//can fuse all local accesses with the following instructions
+				out << (uint8_t)0x62;
+				writeInt32(out,opcode-0xd0);
 				//Infer the type of the object when possible
 				const Type* t=getLocalType(function, opcode-0xd0);
 				curBlock->pushStack(t);
@@ -1610,8 +1658,9 @@ void ABCVm::optimizeFunction(SyntheticFunction* function)
 			case 0xd7:
 			{
 				//setlocal_n
-				//TODO: collapse on setlocal
-				out << (uint8_t)opcode;
+				//Collapse on setlocal
+				out << (uint8_t)0x63;
+				writeInt32(out,opcode-0xd4);
 				curBlock->popStack(1);
 				break;
 			}
@@ -110,15 +110,70 @@ istream& lightspark::operator>>(istream& in, d64& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, string_info& v)
+void abc_reader::truncated() const
 {
-	u30 size;
-	in >> size;
-	v.val = getSys()->getUniqueStringId(tiny_string(in,size));
+	throw ParseException("Truncated ABC data");
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, u8& v)
+{
+	v.val=in.readU8();
+	return in;
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, u16& v)
+{
+	uint16_t t;
+	memcpy(&t,in.readBytes(2),2);
+	v.val=GINT16_FROM_LE(t);
+	return in;
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, u30& v)
+{
+	v.val=in.readU30();
+	return in;
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, u32& v)
+{
+	v.val=in.readU32();
+	return in;
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, s24& v)
+{
+	uint32_t ret=0;
+	memcpy(&ret,in.readBytes(3),3);
+	v.val=LittleEndianToSignedHost24(ret);
+	return in;
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, s32& v)
+{
+	//Same encoding as u32, only the first 4 bits of the fifth byte are used
+	v.val=in.readU32();
+	return in;
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, d64& v)
+{
+	uint64_t dump;
+	memcpy(&dump,in.readBytes(8),8);
+	dump=GINT64_FROM_LE(dump);
+	memcpy(&v.val,&dump,8);
+	return in;
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, string_info& v)
+{
+	uint32_t size=in.readU30();
+	const char* str=(const char*)in.readBytes(size);
+	v.val = getSys()->getUniqueStringId(tiny_string(std::string(str,size)));
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, namespace_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, namespace_info& v)
 {
 	in >> v.kind >> v.name;
 	if(v.kind!=0x05 && v.kind!=0x08 && v.kind!=0x16 && v.kind!=0x17 && v.kind!=0x18 && v.kind!=0x19 && v.kind!=0x1a)
@@ -130,7 +185,7 @@ istream& lightspark::operator>>(istream& in, namespace_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, method_info_simple& v)
+abc_reader& lightspark::operator>>(abc_reader& in, method_info_simple& v)
 {
 	in >> v.param_count;
 	in >> v.return_type;
@@ -160,28 +215,83 @@ istream& lightspark::operator>>(istream& in, method_info_simple& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, method_body_info& v)
+static void skipTraits(abc_reader& in)
+{
+	uint32_t trait_count=in.readU30();
+	for(uint32_t i=0;i<trait_count;i++)
+	{
+		in.readU30();
+		uint8_t kind=in.readU8();
+		switch(kind&0xf)
+		{
+			case traits_info::Slot:
+			case traits_info::Const:
+				in.readU30();
+				in.readU30();
+				if(in.readU30())
+					in.readU8();
+				break;
+			case traits_info::Class:
+			case traits_info::Function:
+			case traits_info::Getter:
+			case traits_info::Setter:
+			case traits_info::Method:
+				in.readU30();
+				in.readU30();
+				break;
+			default:
+				break;
+		}
+		if(kind&traits_info::Metadata)
+		{
+			uint32_t metadata_count=in.readU30();
+			for(uint32_t j=0;j<metadata_count;j++)
+				in.readU30();
+		}
+	}
+}
+
+abc_reader& lightspark::operator>>(abc_reader& in, method_body_info& v)
+{
+	in >> v.method >> v.max_stack >> v.local_count >> v.init_scope_depth >> v.max_scope_depth;
+	v.code_length=in.readU30();
+	uint32_t start=in.tellg();
+	v.data=in.readBytes(v.code_length);
+	//Find the end of the body, it is validated only when the method is first called
+	uint32_t exception_count=in.readU30();
+	for(uint32_t i=0;i<5*exception_count;i++)
+		in.readU30();
+	skipTraits(in);
+	v.data_length=in.tellg()-start;
+	return in;
+}
+
+void method_body_info::parse()
 {
-	u30 code_length;
-	in >> v.method >> v.max_stack >> v.local_count >> v.init_scope_depth >> v.max_scope_depth >> code_length;
-	v.code.resize(code_length);
-	in.read(&v.code[0],code_length);
-	v.codecache = new method_body_info_cache[code_length];
-	memset(v.codecache,0,code_length*sizeof(method_body_info_cache));
+	assert(!parsed);
+	abc_reader in(data+code_length,data_length-code_length);
 	u30 exception_count;
 	in >> exception_count;
-	v.exceptions.resize(exception_count);
+	exceptions.resize(exception_count);
 	for(unsigned int i=0;i<exception_count;i++)
-		in >> v.exceptions[i];
-
-	in >> v.trait_count;
-	v.traits.resize(v.trait_count);
-	for(unsigned int i=0;i<v.trait_count;i++)
-		in >> v.traits[i];
-	return in;
+	{
+		in >> exceptions[i];
+		const exception_info& e=exceptions[i];
+		if(e.from>code_length || e.to>code_length || e.target>=code_length)
+			throw ParseException("Invalid exception range");
+	}
+	code.assign((const char*)data,code_length);
+	codecache = new method_body_info_cache[code_length];
+	memset(codecache,0,code_length*sizeof(method_body_info_cache));
+
+	in >> trait_count;
+	traits.resize(trait_count);
+	for(unsigned int i=0;i<trait_count;i++)
+		in >> traits[i];
+	parsed=true;
 }
 
-istream& lightspark::operator >>(istream& in, ns_set_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, ns_set_info& v)
 {
 	in >> v.count;
 
@@ -195,7 +305,7 @@ istream& lightspark::operator >>(istream& in, ns_set_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, multiname_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, multiname_info& v)
 {
 	in >> v.kind;
 
@@ -241,7 +351,7 @@ istream& lightspark::operator>>(istream& in, multiname_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, script_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, script_info& v)
 {
 	in >> v.init >> v.trait_count;
 	v.traits.resize(v.trait_count);
@@ -250,7 +360,7 @@ istream& lightspark::operator>>(istream& in, script_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, class_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, class_info& v)
 {
 	in >> v.cinit >> v.trait_count;
 	v.traits.resize(v.trait_count);
@@ -261,7 +371,7 @@ istream& lightspark::operator>>(istream& in, class_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, metadata_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, metadata_info& v)
 {
 	in >> v.name;
 	in >> v.item_count;
@@ -274,7 +384,7 @@ istream& lightspark::operator>>(istream& in, metadata_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, traits_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, traits_info& v)
 {
 	in >> v.name >> v.kind;
 	switch(v.kind&0xf)
@@ -311,7 +421,7 @@ istream& lightspark::operator>>(istream& in, traits_info& v)
 	return in;
 }
 
-istream& lightspark::operator >>(istream& in, exception_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, exception_info& v)
 {
 	u30 from, to, target;
 	in >> from >> to >> target >> v.exc_type >> v.var_name;
@@ -321,7 +431,7 @@ istream& lightspark::operator >>(istream& in, exception_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, instance_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, instance_info& v)
 {
 	in >> v.name >> v.supername >> v.flags;
 	if(v.isProtectedNs())
@@ -345,7 +455,7 @@ istream& lightspark::operator>>(istream& in, instance_info& v)
 	return in;
 }
 
-istream& lightspark::operator>>(istream& in, cpool_info& v)
+abc_reader& lightspark::operator>>(abc_reader& in, cpool_info& v)
 {
 	in >> v.int_count;
 	v.integer.resize(v.int_count);
@@ -28,9 +28,12 @@ class memorystream;
 namespace lightspark
 {
 
+class abc_reader;
+
 class u8
 {
 friend std::istream& operator>>(std::istream& in, u8& v);
+friend abc_reader& operator>>(abc_reader& in, u8& v);
 friend memorystream& operator>>(memorystream& in, u8& v);
 private:
 	uint32_t val;
@@ -46,6 +49,7 @@ public:
 class u16
 {
 friend std::istream& operator>>(std::istream& in, u16& v);
+friend abc_reader& operator>>(abc_reader& in, u16& v);
 private:
 	uint32_t val;
 public:
@@ -55,6 +59,7 @@ public:
 class s24
 {
 friend std::istream& operator>>(std::istream& in, s24& v);
+friend abc_reader& operator>>(abc_reader& in, s24& v);
 friend memorystream& operator>>(memorystream& in, s24& v);
 private:
 	int32_t val;
@@ -65,6 +70,7 @@ public:
 class u30
 {
 friend std::istream& operator>>(std::istream& in, u30& v);
+friend abc_reader& operator>>(abc_reader& in, u30& v);
 friend memorystream& operator>>(memorystream& in, u30& v);
 private:
 	uint32_t val;
@@ -77,6 +83,7 @@ public:
 class s32
 {
 friend std::istream& operator>>(std::istream& in, s32& v);
+friend abc_reader& operator>>(abc_reader& in, s32& v);
 private:
 	int32_t val;
 public:
@@ -86,6 +93,7 @@ public:
 class d64
 {
 friend std::istream& operator>>(std::istream& in, d64& v);
+friend abc_reader& operator>>(abc_reader& in, d64& v);
 private:
 	double val;
 public:
@@ -94,13 +102,69 @@ public:
 
 class string_info
 {
-friend std::istream& operator>>(std::istream& in, string_info& v);
+friend abc_reader& operator>>(abc_reader& in, string_info& v);
 private:
 	uint32_t val;
 public:
 	operator uint32_t() const{return val;}
 };
 
+/*
+ * Decodes an ABC block kept in memory. Reading past the end of the block
+ * throws a ParseException
+ */
+class abc_reader
+{
+private:
+	const uint8_t* const start;
+	const uint8_t* pos;
+	const uint8_t* const end;
+	void truncated() const;
+public:
+	abc_reader(const uint8_t* b, uint32_t len):start(b),pos(b),end(b+len){}
+	uint32_t tellg() const { return pos-start; }
+	uint32_t remaining() const { return end-pos; }
+	/* Returns a pointer to the next len bytes and skips them */
+	const uint8_t* readBytes(uint32_t len)
+	{
+		if(len>remaining())
+			truncated();
+		const uint8_t* ret=pos;
+		pos+=len;
+		return ret;
+	}
+	void skip(uint32_t len) { readBytes(len); }
+	uint8_t readU8()
+	{
+		if(pos==end)
+			truncated();
+		return *pos++;
+	}
+	uint32_t readU32()
+	{
+		//Most values fit in one byte
+		if(pos!=end && (*pos&0x80)==0)
+			return *pos++;
+		uint32_t val=0;
+		//No more than 5 bytes should be read
+		for(int i=0;i<35;i+=7)
+		{
+			uint8_t t=readU8();
+			val|=uint32_t(t&0x7f)<<i;
+			if((t&0x80)==0)
+				break;
+		}
+		return val;
+	}
+	uint32_t readU30()
+	{
+		uint32_t val=readU32();
+		if(val&0xc0000000)
+			throw ParseException("Invalid u30");
+		return val;
+	}
+};
+
 struct namespace_info
 {
 	u8 kind;
@@ -272,7 +336,7 @@ struct method_body_info_cache
 
 struct method_body_info
 {
-	method_body_info():hit_count(0),codeStatus(ORIGINAL){}
+	method_body_info():hit_count(0),codeStatus(ORIGINAL),codecache(NULL),data(NULL),data_length(0),code_length(0),parsed(false){}
 	~method_body_info() { delete[] codecache; }
 	u30 method;
 	u30 max_stack;
@@ -289,6 +353,24 @@ struct method_body_info
 	enum CODE_STATUS { ORIGINAL = 0, USED, OPTIMIZED, JITTED };
 	CODE_STATUS codeStatus;
 	method_body_info_cache* codecache;
+	/*
+	 * Only the header of a body is decoded when the ABC block is loaded, the code,
+	 * the exceptions and the traits are decoded from the block, which is owned by
+	 * the ABCContext, the first time the method is needed
+	 */
+	void ensureParsed()
+	{
+		if(!parsed)
+			parse();
+	}
+private:
+	//The code of the body, followed by the exceptions and the traits
+	const uint8_t* data;
+	uint32_t data_length;
+	uint32_t code_length;
+	bool parsed;
+	void parse();
+	friend abc_reader& operator>>(abc_reader& in, method_body_info& v);
 };
 
 std::istream& operator>>(std::istream& in, u8& v);
@@ -298,19 +380,28 @@ std::istream& operator>>(std::istream& in, u32& v);
 std::istream& operator>>(std::istream& in, s24& v);
 std::istream& operator>>(std::istream& in, s32& v);
 std::istream& operator>>(std::istream& in, d64& v);
-std::istream& operator>>(std::istream& in, string_info& v);
-std::istream& operator>>(std::istream& in, namespace_info& v);
-std::istream& operator>>(std::istream& in, ns_set_info& v);
-std::istream& operator>>(std::istream& in, multiname_info& v);
-std::istream& operator>>(std::istream& in, cpool_info& v);
-std::istream& operator>>(std::istream& in, exception_info& v);
-std::istream& operator>>(std::istream& in, method_info_simple& v);
-std::istream& operator>>(std::istream& in, method_body_info& v);
-std::istream& operator>>(std::istream& in, instance_info& v);
-std::istream& operator>>(std::istream& in, traits_info& v);
-std::istream& operator>>(std::istream& in, script_info& v);
-std::istream& operator>>(std::istream& in, metadata_info& v);
-std::istream& operator>>(std::istream& in, class_info& v);
+
+abc_reader& operator>>(abc_reader& in, u8& v);
+abc_reader& operator>>(abc_reader& in, u16& v);
+abc_reader& operator>>(abc_reader& in, u30& v);
+abc_reader& operator>>(abc_reader& in, u32& v);
+abc_reader& operator>>(abc_reader& in, s24& v);
+abc_reader& operator>>(abc_reader& in, s32& v);
+abc_reader& operator>>(abc_reader& in, d64& v);
+abc_reader& operator>>(abc_reader& in, string_info& v);
+abc_reader& operator>>(abc_reader& in, namespace_info& v);
+abc_reader& operator>>(abc_reader& in, ns_set_info& v);
+abc_reader& operator>>(abc_reader& in, multiname_info& v);
+abc_reader& operator>>(abc_reader& in, cpool_info& v);
+abc_reader& operator>>(abc_reader& in, exception_info& v);
+abc_reader& operator>>(abc_reader& in, method_info_simple& v);
+//Only decodes the header of the body, see method_body_info::ensureParsed
+abc_reader& operator>>(abc_reader& in, method_body_info& v);
+abc_reader& operator>>(abc_reader& in, instance_info& v);
+abc_reader& operator>>(abc_reader& in, traits_info& v);
+abc_reader& operator>>(abc_reader& in, script_info& v);
+abc_reader& operator>>(abc_reader& in, metadata_info& v);
+abc_reader& operator>>(abc_reader& in, class_info& v);
 
 };
 
@@ -30,6 +30,7 @@ class method_info;
 class ABCContext;
 class ASObject;
 class Class_base;
+class CycleCollector;
 
 struct scope_entry
 {
@@ -43,6 +44,8 @@ class scope_entry_list: public RefCountable
 {
 public:
 	std::vector<scope_entry> scope;
+	void gcTrace(CycleCollector& gc);
+	void gcClear();
 };
 struct call_context
 {
@@ -56,6 +59,8 @@ struct call_context
 	} PACKED;
 #include "packed_end.h"
 	ABCContext* context;
+	//The context of the caller, NULL for the outermost call
+	call_context* parent;
 	uint32_t locals_size;
 	uint32_t max_stack;
 	int32_t argarrayposition; // position of argument array in locals ( -1 if no argument array needed)
@@ -73,6 +78,14 @@ struct call_context
 	 * Defaults to empty string according to ECMA-357 13.1.1.1
 	 */
 	uint32_t defaultNamespaceUri;
+	/* Buffer of the domain memory used by the Alchemy opcodes, valid while
+	 * domainMemoryGeneration matches ByteArray::domainMemoryGeneration.
+	 * domainMemoryBase is NULL if the application domain has no domain memory,
+	 * or if it is shareable since another worker may reallocate it at any time
+	 */
+	uint8_t* domainMemoryBase;
+	uint32_t domainMemoryLength;
+	int32_t domainMemoryGeneration;
 	~call_context();
 	static void handleError(int errorcode);
 	inline void runtime_stack_clear()
@@ -147,13 +147,14 @@ ASFUNCTIONBODY(avmplusSystem,_freeMemory)
 }
 ASFUNCTIONBODY(avmplusSystem,_totalMemory)
 {
-	LOG(LOG_NOT_IMPLEMENTED, _("avmplus.System.totalMemory is unimplemented."));
-	return abstract_d(obj->getSystemState(),1024);
+	return abstract_d(obj->getSystemState(),MemoryAccount::getTotalBytes());
 }
 ASFUNCTIONBODY(avmplusSystem,_privateMemory)
 {
-	LOG(LOG_NOT_IMPLEMENTED, _("avmplus.System.privateMemory is unimplemented."));
-	return abstract_d(obj->getSystemState(),1024);
+	uint64_t bytes=getResidentMemory();
+	if(bytes==0)
+		bytes=MemoryAccount::getTotalBytes();
+	return abstract_d(obj->getSystemState(),bytes);
 }
 ASFUNCTIONBODY(avmplusSystem,argv)
 {
@@ -219,7 +219,7 @@ Class<ASObject>* Class<ASObject>::getClass(SystemState* sys)
 	{
 		//Create the class
 		QName name(s->getUniqueStringId(ClassName<ASObject>::name),s->getUniqueStringId(ClassName<ASObject>::ns));
-		ret=new (s->unaccountedMemory) Class<ASObject>(name, s->unaccountedMemory);
+		ret=new (s->unaccountedMemory) Class<ASObject>(name, s->allocateMemoryAccount(name.getQualifiedName(s)));
 		ret->setSystemState(s);
 		ret->incRef();
 		*retAddr=ret;
@@ -129,7 +129,10 @@ protected:
 			realClass=this;
 		T* ret = realClass->freelist[0].getObjectFromFreeList()->as<T>();
 		if (!ret)
+		{
 			ret=new (realClass->memoryAccount) T(realClass);
+			realClass->freelist[0].initNewObject(ret);
+		}
 		if(construct)
 			handleConstruction(ret,args,argslen,true);
 		return ret;
@@ -167,6 +170,7 @@ public:
 		if (!ret)
 		{
 			ret=new (c->memoryAccount) T(c);
+			c->freelist[0].initNewObject(ret);
 		}
 		ret->setIsInitialized();
 		ret->constructionComplete();
@@ -182,7 +186,7 @@ public:
 		{
 			//Create the class
 			QName name(sys->getUniqueStringId(ClassName<T>::name),sys->getUniqueStringId(ClassName<T>::ns));
-			ret=new (sys->unaccountedMemory) Class<T>(name, sys->unaccountedMemory);
+			ret=new (sys->unaccountedMemory) Class<T>(name, sys->allocateMemoryAccount(name.getQualifiedName(sys)));
 			ret->setSystemState(sys);
 			ret->incRef();
 			*retAddr=ret;
@@ -506,7 +510,8 @@ public:
 		Class<T>* ret=NULL;
 		if(it==appdomain->instantiatedTemplates.end()) //This class is not yet in the map, create it
 		{
-			ret=new (appdomain->getSystemState()->unaccountedMemory) TemplatedClass<T>(instantiatedQName,types,this,appdomain->getSystemState()->unaccountedMemory);
+			SystemState* sys=appdomain->getSystemState();
+			ret=new (sys->unaccountedMemory) TemplatedClass<T>(instantiatedQName,types,this,sys->allocateMemoryAccount(instantiatedQName.getQualifiedName(sys)));
 			appdomain->instantiatedTemplates.insert(std::make_pair(instantiatedQName,ret));
 			ret->prototype = _MNR(new_objectPrototype(appdomain->getSystemState()));
 			T::sinit(ret);
@@ -533,7 +538,8 @@ public:
 		Class<T>* ret=NULL;
 		if(it==appdomain->instantiatedTemplates.end()) //This class is not yet in the map, create it
 		{
-			ret=new (appdomain->getSystemState()->unaccountedMemory) TemplatedClass<T>(qname,types,this,appdomain->getSystemState()->unaccountedMemory);
+			SystemState* sys=appdomain->getSystemState();
+			ret=new (sys->unaccountedMemory) TemplatedClass<T>(qname,types,this,sys->allocateMemoryAccount(qname.getQualifiedName(sys)));
 			appdomain->instantiatedTemplates.insert(std::make_pair(qname,ret));
 			ret->prototype = _MNR(new_objectPrototype(appdomain->getSystemState()));
 			T::sinit(ret);
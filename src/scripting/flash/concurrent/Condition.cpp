@@ -30,7 +30,7 @@ ASCondition::ASCondition(Class_base* c):ASObject(c)
 void ASCondition::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_FINAL);
-	c->setVariableByQName("isSupported","",abstract_b(c->getSystemState(),false),CONSTANT_TRAIT);
+	c->setVariableByQName("isSupported","",abstract_b(c->getSystemState(),true),CONSTANT_TRAIT);
 	c->setDeclaredMethodByQName("notify","",Class<IFunction>::getFunction(c->getSystemState(),_notify),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("notifyAll","",Class<IFunction>::getFunction(c->getSystemState(),_notifyAll),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("wait","",Class<IFunction>::getFunction(c->getSystemState(),_wait),NORMAL_METHOD,true);
@@ -39,6 +39,20 @@ void ASCondition::sinit(Class_base* c)
 
 ASFUNCTIONBODY_GETTER(ASCondition,mutex);
 
+void ASCondition::finalize()
+{
+	ASObject::finalize();
+	mutex.reset();
+	condition.reset();
+}
+
+void ASCondition::setWorkerCondition(_R<WorkerCondition> c)
+{
+	condition=c;
+	mutex=_MR(Class<ASMutex>::getInstanceS(getSystemState()));
+	mutex->setWorkerMutex(c->getMutex());
+}
+
 ASFUNCTIONBODY(ASCondition,_constructor)
 {
 	ASCondition* th=obj->as<ASCondition>();
@@ -51,31 +65,35 @@ ASFUNCTIONBODY(ASCondition,_constructor)
 		throwError<ArgumentError>(kInvalidArgumentError) ;
 	arg->incRef();
 	th->mutex = _NR<ASMutex>(arg->as<ASMutex>());
+	th->condition = _MR(new WorkerCondition(th->mutex->getWorkerMutex()));
 
 	return NULL;
 }
 ASFUNCTIONBODY(ASCondition,_notify)
 {
-	LOG(LOG_NOT_IMPLEMENTED,"condition notify not implemented");
 	ASCondition* th=obj->as<ASCondition>();
 	if (!th->mutex->getLockCount())
 		throwError<ASError>(kConditionCannotNotify) ;
+	th->condition->notify();
 	return NULL;
 }
 ASFUNCTIONBODY(ASCondition,_notifyAll)
 {
-	LOG(LOG_NOT_IMPLEMENTED,"condition notifyAll not implemented");
 	ASCondition* th=obj->as<ASCondition>();
 	if (!th->mutex->getLockCount())
 		throwError<ASError>(kConditionCannotNotifyAll) ;
+	th->condition->notifyAll();
 	return NULL;
 }
 ASFUNCTIONBODY(ASCondition,_wait)
 {
-	LOG(LOG_NOT_IMPLEMENTED,"condition wait not implemented");
 	ASCondition* th=obj->as<ASCondition>();
+	number_t timeout;
+	ARG_UNPACK(timeout,-1);
 	if (!th->mutex->getLockCount())
 		throwError<ASError>(kConditionCannotWait) ;
-	return abstract_b(obj->getSystemState(),true);
+	if (timeout<0 && timeout!=-1)
+		throwError<ArgumentError>(kConditionInvalidTimeout);
+	bool notified=th->condition->wait(timeout<0 ? -1 : (int32_t)min(timeout,(number_t)INT32_MAX));
+	return abstract_b(obj->getSystemState(),notified);
 }
-
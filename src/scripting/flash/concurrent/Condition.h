@@ -28,9 +28,16 @@ namespace lightspark
 class ASCondition: public ASObject
 {
 	ASPROPERTY_GETTER(_NR<ASMutex>,mutex);
+private:
+	//Shared with the workers this condition is sent to
+	_NR<WorkerCondition> condition;
 public:
 	ASCondition(Class_base* c);
 	static void sinit(Class_base*);
+	void finalize();
+	_NR<WorkerCondition> getWorkerCondition() const { return condition; }
+	/* Wraps a condition received from another worker */
+	void setWorkerCondition(_R<WorkerCondition> c);
 	ASFUNCTION(_constructor);
 	ASFUNCTION(_notify);
 	ASFUNCTION(_notifyAll);
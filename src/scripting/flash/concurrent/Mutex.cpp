@@ -16,19 +16,21 @@
 **************************************************************************/
 
 #include "scripting/flash/concurrent/Mutex.h"
+#include "scripting/flash/errors/flasherrors.h"
 #include "scripting/class.h"
 #include "scripting/argconv.h"
 
 using namespace std;
 using namespace lightspark;
 
-ASMutex::ASMutex(Class_base* c):ASObject(c),lockcount(0)
+ASMutex::ASMutex(Class_base* c):ASObject(c),mutex(_MR(new WorkerMutex()))
 {
 	
 }
 void ASMutex::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_FINAL);
+	c->setVariableByQName("isSupported","",abstract_b(c->getSystemState(),true),CONSTANT_TRAIT);
 	c->setDeclaredMethodByQName("lock","",Class<IFunction>::getFunction(c->getSystemState(),_lock),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("unlock","",Class<IFunction>::getFunction(c->getSystemState(),_unlock),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("tryLock","",Class<IFunction>::getFunction(c->getSystemState(),_trylock),NORMAL_METHOD,true);
@@ -41,20 +43,19 @@ ASFUNCTIONBODY(ASMutex,_constructor)
 ASFUNCTIONBODY(ASMutex,_lock)
 {
 	ASMutex* th=obj->as<ASMutex>();
-	th->mutex.lock();
-	th->lockcount++;
+	th->mutex->lock();
 	return NULL;
 }
 ASFUNCTIONBODY(ASMutex,_unlock)
 {
 	ASMutex* th=obj->as<ASMutex>();
-	th->mutex.unlock();
-	th->lockcount--;
+	if(!th->mutex->unlock())
+		throwError<IllegalOperationError>(kMutextNotLocked);
 	return NULL;
 }
 ASFUNCTIONBODY(ASMutex,_trylock)
 {
 	ASMutex* th=obj->as<ASMutex>();
-	return abstract_b(obj->getSystemState(),th->mutex.trylock());
+	return abstract_b(obj->getSystemState(),th->mutex->trylock());
 }
 
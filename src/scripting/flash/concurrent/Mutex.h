@@ -20,6 +20,7 @@
 
 #include "asobject.h"
 #include "scripting/flash/events/flashevents.h"
+#include "backends/workers.h"
 
 namespace lightspark
 {
@@ -27,8 +28,8 @@ namespace lightspark
 class ASMutex: public ASObject
 {
 private:
-	RecMutex mutex;
-	int lockcount;
+	//Shared with the workers this mutex is sent to
+	_R<WorkerMutex> mutex;
 
 public:
 	ASMutex(Class_base* c);
@@ -37,7 +38,9 @@ public:
 	ASFUNCTION(_lock);
 	ASFUNCTION(_unlock);
 	ASFUNCTION(_trylock);
-	int getLockCount() { return lockcount; }
+	int getLockCount() { return mutex->getLockCount(); }
+	_R<WorkerMutex> getWorkerMutex() const { return mutex; }
+	void setWorkerMutex(_R<WorkerMutex> m) { mutex=m; }
 };
 
 }
@@ -116,6 +116,18 @@ void DisplayObject::finalize()
 	accessibilityProperties.reset();
 }
 
+void DisplayObject::gcTrace(CycleCollector& gc)
+{
+	EventDispatcher::gcTrace(gc);
+	gc.visit(parent.getPtr());
+}
+
+void DisplayObject::gcClear()
+{
+	parent.reset();
+	EventDispatcher::gcClear();
+}
+
 void DisplayObject::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, EventDispatcher, _constructorNotInstantiatable, CLASS_SEALED);
@@ -803,6 +815,9 @@ void DisplayObject::setParent(_NR<DisplayObjectContainer> p)
 	if(parent!=p)
 	{
 		parent=p;
+		//Children keep a reference to their parent
+		if(!p.isNull())
+			markCycleCandidate();
 		if(onStage)
 			requestInvalidation(getSystemState());
 	}
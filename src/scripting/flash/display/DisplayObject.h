@@ -141,6 +141,8 @@ public:
 	*/
 	DisplayObject(Class_base* c);
 	void finalize();
+	void gcTrace(CycleCollector& gc);
+	void gcClear();
 	MATRIX getMatrix() const;
 	bool isConstructed() const { return ACQUIRE_READ(constructed); }
 	/**
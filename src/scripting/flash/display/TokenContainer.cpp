@@ -21,22 +21,31 @@
 #include "scripting/flash/display/TokenContainer.h"
 #include "swf.h"
 #include "scripting/flash/display/BitmapData.h"
+#include "backends/config.h"
+#include "backends/rendering_context.h"
 
 using namespace lightspark;
 using namespace std;
 
-TokenContainer::TokenContainer(DisplayObject* _o) : owner(_o),tokens(reporter_allocator<GeomToken>(_o->getSystemState()->unaccountedMemory)), scaling(1.0f)
+TokenContainer::TokenContainer(DisplayObject* _o) : owner(_o),tokens(reporter_allocator<GeomToken>(_o->getSystemState()->unaccountedMemory)), scaling(1.0f),
+	tessellationAlpha(1.0f),tessellationRender(false)
 {
 }
 
 TokenContainer::TokenContainer(DisplayObject* _o, const tokensVector& _tokens, float _scaling) :
-	owner(_o), tokens(_tokens.begin(),_tokens.end(),reporter_allocator<GeomToken>(_o->getSystemState()->unaccountedMemory)), scaling(_scaling)
-
+	owner(_o), tokens(_tokens.begin(),_tokens.end(),reporter_allocator<GeomToken>(_o->getSystemState()->unaccountedMemory)), scaling(_scaling),
+	tessellationAlpha(1.0f),tessellationRender(false)
 {
 }
 
 void TokenContainer::renderImpl(RenderContext& ctxt) const
 {
+	{
+		Locker l(tessellationMutex);
+		if(tessellationRender && ctxt.renderTriangles(tessellator.getVertices().data(), tessellator.getColors().data(),
+					tessellator.getVertexCount(), tessellationMatrix, tessellationAlpha))
+			return;
+	}
 	owner->defaultRender(ctxt);
 }
 
@@ -116,6 +125,7 @@ void TokenContainer::FromShaperecordListToShapeVector(const std::vector<SHAPEREC
 
 void TokenContainer::requestInvalidation(InvalidateQueue* q)
 {
+	invalidateHitTest();
 	if(tokens.empty())
 		return;
 	owner->incRef();
@@ -141,20 +151,63 @@ IDrawable* TokenContainer::invalidate(DisplayObject* target, const MATRIX& initi
 	owner->computeBoundsForTransformedRect(bxmin,bxmax,bymin,bymax,x,y,width,height,totalMatrix);
 	if(width==0 || height==0)
 		return NULL;
+	if(invalidateTessellated(target, totalMatrix, masks))
+		return NULL;
 	return new CairoTokenRenderer(tokens,
 				totalMatrix, x, y, width, height, scaling,
 				owner->getConcatenatedAlpha(), masks);
 }
 
+/*
+ * Uses the triangles instead of a new raster when possible.
+ * They only depend on the tokens, so a new transformation only updates the matrix
+ */
+bool TokenContainer::invalidateTessellated(DisplayObject* target, const MATRIX& totalMatrix, const std::vector<IDrawable::MaskData>& masks)
+{
+	//BitmapData::draw still goes through cairo, and must not change how the stage draws the shape
+	if(target!=owner->getSystemState()->stage)
+		return false;
+	//Masks still go through cairo
+	bool usable=Config::getConfig()->isGPUVectorRenderingEnabled() && masks.empty();
+	uint64_t hash=0;
+	std::vector<uint8_t> content;
+	if(usable)
+		usable=RasterCache::hashTokens(hash, tokens, scaling, &content);
+
+	Locker l(tessellationMutex);
+	if(usable)
+	{
+		if(!tessellator.isBuiltFor(hash, content, scaling))
+			tessellator.build(tokens, scaling, hash, content);
+		usable=tessellator.isValid();
+	}
+	tessellationRender=usable;
+	if(usable)
+	{
+		tessellationMatrix=totalMatrix;
+		tessellationAlpha=owner->getConcatenatedAlpha();
+	}
+	return usable;
+}
+
 _NR<DisplayObject> TokenContainer::hitTestImpl(_NR<DisplayObject> last, number_t x, number_t y, DisplayObject::HIT_TYPE type) const
 {
 	//Masks have been already checked along the way
 
-	if(CairoTokenRenderer::hitTest(tokens, scaling, x, y))
+	Locker l(hitTestMutex);
+	if(!hitTester.isValidFor(tokens, scaling))
+		hitTester.build(tokens, scaling);
+	if(hitTester.hitTest(x/scaling, y/scaling))
 		return last;
 	return NullRef;
 }
 
+void TokenContainer::invalidateHitTest()
+{
+	Locker l(hitTestMutex);
+	hitTester.invalidate();
+}
+
 bool TokenContainer::boundsRect(number_t& xmin, number_t& xmax, number_t& ymin, number_t& ymax) const
 {
 
@@ -53,6 +53,19 @@ public:
 	static void getTextureSize(tokensVector& tokens, int *width, int *height);
 	uint16_t getCurrentLineWidth() const;
 	float scaling;
+	/* Must be called when the tokens are modified without requesting an invalidation */
+	void invalidateHitTest();
+private:
+	//Flattened tokens, built on the first hit test
+	mutable Mutex hitTestMutex;
+	mutable TokenHitTester hitTester;
+	//Triangles drawn by the GPU, and the state captured at the last invalidation
+	mutable Mutex tessellationMutex;
+	TokenTessellator tessellator;
+	MATRIX tessellationMatrix;
+	float tessellationAlpha;
+	bool tessellationRender;
+	bool invalidateTessellated(DisplayObject* target, const MATRIX& totalMatrix, const std::vector<IDrawable::MaskData>& masks);
 protected:
 	TokenContainer(DisplayObject* _o);
 	TokenContainer(DisplayObject* _o, const tokensVector& _tokens, float _scaling);
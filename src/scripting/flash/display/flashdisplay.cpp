@@ -1587,6 +1587,23 @@ bool DisplayObjectContainer::destruct()
 	return InteractiveObject::destruct();
 }
 
+void DisplayObjectContainer::gcTrace(CycleCollector& gc)
+{
+	InteractiveObject::gcTrace(gc);
+	for(uint32_t i=0;i<dynamicDisplayList.size();i++)
+		gc.visit(dynamicDisplayList[i].getPtr());
+}
+
+void DisplayObjectContainer::gcClear()
+{
+	{
+		Locker l(mutexDisplayList);
+		depthToLegacyChild.clear();
+		dynamicDisplayList.clear();
+	}
+	InteractiveObject::gcClear();
+}
+
 InteractiveObject::InteractiveObject(Class_base* c):DisplayObject(c),mouseEnabled(true),doubleClickEnabled(false),accessibilityImplementation(NullRef),contextMenu(NullRef),tabEnabled(false),tabIndex(-1)
 {
 }
@@ -2668,6 +2685,7 @@ ASFUNCTIONBODY_GETTER_SETTER_CB(Bitmap,pixelSnapping,onPixelSnappingChanged);
 void Bitmap::updatedData()
 {
 	tokens.clear();
+	invalidateHitTest();
 
 	if(bitmapData.isNull() || bitmapData->getBitmapContainer().isNull())
 		return;
@@ -108,6 +108,8 @@ public:
 	int getChildIndex(_R<DisplayObject> child);
 	DisplayObjectContainer(Class_base* c);
 	bool destruct();
+	void gcTrace(CycleCollector& gc);
+	void gcClear();
 	bool hasLegacyChildAt(uint32_t depth);
 	void deleteLegacyChildAt(uint32_t depth);
 	void insertLegacyChildAt(uint32_t depth, DisplayObject* obj);
@@ -23,6 +23,7 @@
 #include "compat.h"
 #include "scripting/class.h"
 #include "scripting/argconv.h"
+#include "backends/workers.h"
 
 using namespace std;
 using namespace lightspark;
@@ -55,6 +56,8 @@ void Event::sinit(Class_base* c)
 	c->setVariableByQName("ADDED_TO_STAGE","",abstract_s(c->getSystemState(),"addedToStage"),DECLARED_TRAIT);
 	c->setVariableByQName("CANCEL","",abstract_s(c->getSystemState(),"cancel"),DECLARED_TRAIT);
 	c->setVariableByQName("CHANGE","",abstract_s(c->getSystemState(),"change"),DECLARED_TRAIT);
+	c->setVariableByQName("CHANNEL_MESSAGE","",abstract_s(c->getSystemState(),"channelMessage"),DECLARED_TRAIT);
+	c->setVariableByQName("CHANNEL_STATE","",abstract_s(c->getSystemState(),"channelState"),DECLARED_TRAIT);
 	c->setVariableByQName("CLEAR","",abstract_s(c->getSystemState(),"clear"),DECLARED_TRAIT);
 	c->setVariableByQName("CLOSE","",abstract_s(c->getSystemState(),"close"),DECLARED_TRAIT);
 	c->setVariableByQName("CLOSING","",abstract_s(c->getSystemState(),"closing"),DECLARED_TRAIT);
@@ -99,6 +102,7 @@ void Event::sinit(Class_base* c)
 	c->setVariableByQName("UNLOAD","",abstract_s(c->getSystemState(),"unload"),DECLARED_TRAIT);
 	c->setVariableByQName("USER_IDLE","",abstract_s(c->getSystemState(),"userIdle"),DECLARED_TRAIT);
 	c->setVariableByQName("USER_PRESENT","",abstract_s(c->getSystemState(),"userPresent"),DECLARED_TRAIT);
+	c->setVariableByQName("WORKER_STATE","",abstract_s(c->getSystemState(),"workerState"),DECLARED_TRAIT);
 
 	c->setDeclaredMethodByQName("formatToString","",Class<IFunction>::getFunction(c->getSystemState(),formatToString),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("isDefaultPrevented","",Class<IFunction>::getFunction(c->getSystemState(),_isDefaultPrevented),NORMAL_METHOD,true);
@@ -554,6 +558,32 @@ void EventDispatcher::finalize()
 	forcedTarget.reset();
 }
 
+void EventDispatcher::gcTrace(CycleCollector& gc)
+{
+	ASObject::gcTrace(gc);
+	{
+		Locker l(handlersMutex);
+		std::map<tiny_string,list<listener> >::iterator it=handlers.begin();
+		for(;it!=handlers.end();++it)
+		{
+			list<listener>::iterator lit=it->second.begin();
+			for(;lit!=it->second.end();++lit)
+				gc.visit(lit->f.getPtr());
+		}
+	}
+	gc.visit(forcedTarget.getPtr());
+}
+
+void EventDispatcher::gcClear()
+{
+	{
+		Locker l(handlersMutex);
+		handlers.clear();
+	}
+	forcedTarget.reset();
+	ASObject::gcClear();
+}
+
 void EventDispatcher::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_SEALED);
@@ -615,6 +645,8 @@ ASFUNCTIONBODY(EventDispatcher,addEventListener)
 		list<listener>::iterator insertionPoint=upper_bound(listeners.begin(),listeners.end(),newListener);
 		listeners.insert(insertionPoint,newListener);
 	}
+	//Listeners often close over the dispatcher
+	th->markCycleCandidate();
 	th->eventListenerAdded(eventName);
 	return NULL;
 }
@@ -1164,6 +1196,32 @@ void ParseRPCMessageEvent::finalize()
 	responder.reset();
 }
 
+WorkerNotificationEvent::WorkerNotificationEvent(uint32_t n, WorkerInstance* w, ChannelQueue* c):
+	Event(NULL, "WorkerNotificationEvent"),notification(n)
+{
+	if(w)
+	{
+		w->incRef();
+		worker=_MNR(w);
+	}
+	if(c)
+	{
+		c->incRef();
+		channel=_MNR(c);
+	}
+}
+
+WorkerNotificationEvent::~WorkerNotificationEvent()
+{
+}
+
+void WorkerNotificationEvent::finalize()
+{
+	Event::finalize();
+	worker.reset();
+	channel.reset();
+}
+
 void StatusEvent::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, Event, _constructor, CLASS_SEALED);
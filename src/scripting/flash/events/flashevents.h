@@ -33,7 +33,7 @@ namespace lightspark
 
 enum EVENT_TYPE { EVENT=0, BIND_CLASS, SHUTDOWN, SYNC, MOUSE_EVENT,
 	FUNCTION, EXTERNAL_CALL, CONTEXT_INIT, INIT_FRAME,
-	FLUSH_INVALIDATION_QUEUE, ADVANCE_FRAME, PARSE_RPC_MESSAGE };
+	FLUSH_INVALIDATION_QUEUE, ADVANCE_FRAME, PARSE_RPC_MESSAGE, WORKER_NOTIFICATION, EVENT_TYPE_COUNT };
 
 class ABCContext;
 class DictionaryTag;
@@ -41,6 +41,8 @@ class InteractiveObject;
 class PlaceObject2Tag;
 class DisplayObject;
 class Responder;
+class WorkerInstance;
+class ChannelQueue;
 
 class Event: public ASObject
 {
@@ -360,6 +362,8 @@ protected:
 public:
 	EventDispatcher(Class_base* c);
 	void finalize();
+	void gcTrace(CycleCollector& gc);
+	void gcClear();
 	static void sinit(Class_base*);
 	static void buildTraits(ASObject* o);
 	void handleEvent(_R<Event> e);
@@ -483,6 +487,17 @@ public:
 	EVENT_TYPE getEventType() const { return ADVANCE_FRAME; }
 };
 
+//Event to park the VM thread between two events, until it is released
+class SynchronizationEvent: public Event
+{
+public:
+	SynchronizationEvent():Event(NULL, "SynchronizationEvent"),reached(0),release(0){}
+	EVENT_TYPE getEventType() const { return SYNC; }
+	//Signaled by the VM thread once all the events queued before this one have been handled
+	Semaphore reached;
+	Semaphore release;
+};
+
 //Event to flush the invalidation queue
 class FlushInvalidationQueueEvent: public Event
 {
@@ -502,6 +517,20 @@ public:
 	void finalize();
 };
 
+//Event sent by another worker, see backends/workers.h
+class WorkerNotificationEvent: public Event
+{
+public:
+	//A WorkerInstance::NOTIFICATION
+	uint32_t notification;
+	_NR<WorkerInstance> worker;
+	_NR<ChannelQueue> channel;
+	WorkerNotificationEvent(uint32_t n, WorkerInstance* w, ChannelQueue* c);
+	~WorkerNotificationEvent();
+	EVENT_TYPE getEventType() const { return WORKER_NOTIFICATION; }
+	void finalize();
+};
+
 class DRMErrorEvent: public ErrorEvent
 {
 public:
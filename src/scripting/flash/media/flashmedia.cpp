@@ -332,16 +332,18 @@ ASFUNCTIONBODY(Sound,play)
 {
 	Sound* th=Class<Sound>::cast(obj);
 	number_t startTime;
-	ARG_UNPACK(startTime, 0);
+	int32_t loops;
+	_NR<SoundTransform> soundTransform;
+	ARG_UNPACK(startTime, 0)(loops, 0)(soundTransform, NullRef);
 	//TODO: use startTime
 	if(startTime!=0)
 		LOG(LOG_NOT_IMPLEMENTED,"startTime not supported in Sound::play");
 
 	th->incRef();
 	if (th->container)
-		return Class<SoundChannel>::getInstanceS(obj->getSystemState(),th->soundData);
+		return Class<SoundChannel>::getInstanceS(obj->getSystemState(),th->soundData,AudioFormat(CODEC_NONE,0,0),soundTransform,loops);
 	else
-		return Class<SoundChannel>::getInstanceS(obj->getSystemState(),th->soundData, th->format);
+		return Class<SoundChannel>::getInstanceS(obj->getSystemState(),th->soundData, th->format, soundTransform,loops);
 }
 
 ASFUNCTIONBODY(Sound,close)
@@ -400,10 +402,12 @@ ASFUNCTIONBODY(SoundLoaderContext,_constructor)
 ASFUNCTIONBODY_GETTER_SETTER(SoundLoaderContext,bufferTime);
 ASFUNCTIONBODY_GETTER_SETTER(SoundLoaderContext,checkPolicyFile);
 
-SoundChannel::SoundChannel(Class_base* c, _NR<StreamCache> _stream, AudioFormat _format)
+SoundChannel::SoundChannel(Class_base* c, _NR<StreamCache> _stream, AudioFormat _format, _NR<SoundTransform> _soundTransform, int32_t _loops)
 : EventDispatcher(c),stream(_stream),stopped(false),audioDecoder(NULL),audioStream(NULL),
-  format(_format),position(0),soundTransform(_MR(Class<SoundTransform>::getInstanceS(c->getSystemState())))
+  format(_format),loops(_loops),position(0),soundTransform(_MR(Class<SoundTransform>::getInstanceS(c->getSystemState())))
 {
+	if (!_soundTransform.isNull())
+		soundTransform=_soundTransform;
 	if (!stream.isNull())
 	{
 		// Start playback
@@ -446,6 +450,17 @@ void SoundChannel::validateSoundTransform(_NR<SoundTransform> oldValue)
 		soundTransform = oldValue;
 		throwError<TypeError>(kNullPointerError, "soundTransform");
 	}
+	Locker l(mutex);
+	applySoundTransform();
+}
+
+void SoundChannel::applySoundTransform()
+{
+	if (audioStream && !soundTransform.isNull())
+	{
+		audioStream->setVolume(soundTransform->volume);
+		audioStream->setPan(soundTransform->pan);
+	}
 }
 
 ASFUNCTIONBODY(SoundChannel, _constructor)
@@ -470,6 +485,21 @@ void SoundChannel::execute()
 void SoundChannel::playStream()
 {
 	assert(!stream.isNull());
+	//The sound is played at least once, every loop starts from the beginning
+	int32_t remaining=(loops>1)?loops:1;
+	bool completed=true;
+	while(completed && remaining-- > 0 && !ACQUIRE_READ(stopped))
+		completed=playOnce();
+
+	if (!ACQUIRE_READ(stopped))
+	{
+		incRef();
+		getVm(getSystemState())->addEvent(_MR(this),_MR(Class<Event>::getInstanceS(getSystemState(),"soundComplete")));
+	}
+}
+
+bool SoundChannel::playOnce()
+{
 	std::streambuf *sbuf = stream->createReader();
 	istream s(sbuf);
 	s.exceptions ( istream::failbit | istream::badbit );
@@ -494,7 +524,11 @@ void SoundChannel::playStream()
 				audioDecoder=streamDecoder->audioDecoder;
 
 			if(audioStream==NULL && audioDecoder && audioDecoder->isValid())
+			{
+				Locker l(mutex);
 				audioStream=getSystemState()->audioManager->createStream(audioDecoder,false);
+				applySoundTransform();
+			}
 
 			// TODO: check the position only when the getter is called
 			if(audioStream)
@@ -537,12 +571,7 @@ void SoundChannel::playStream()
 	}
 	delete streamDecoder;
 	delete sbuf;
-
-	if (!ACQUIRE_READ(stopped))
-	{
-		incRef();
-		getVm(getSystemState())->addEvent(_MR(this),_MR(Class<Event>::getInstanceS(getSystemState(),"soundComplete")));
-	}
+	return waitForFlush;
 }
 
 
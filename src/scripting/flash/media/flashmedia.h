@@ -89,12 +89,18 @@ private:
 	AudioDecoder* audioDecoder;
 	AudioStream* audioStream;
 	AudioFormat format;
+	//How many times the sound is played
+	int32_t loops;
 	ASPROPERTY_GETTER_SETTER(uint32_t,position);
 	ASPROPERTY_GETTER_SETTER(_NR<SoundTransform>,soundTransform);
 	void validateSoundTransform(_NR<SoundTransform>);
+	//Must be called with mutex held
+	void applySoundTransform();
 	void playStream();
+	/* Plays the stream from the start, returns false if playback has been interrupted */
+	bool playOnce();
 public:
-	SoundChannel(Class_base* c, _NR<StreamCache> stream=NullRef, AudioFormat format=AudioFormat(CODEC_NONE,0,0));
+	SoundChannel(Class_base* c, _NR<StreamCache> stream=NullRef, AudioFormat format=AudioFormat(CODEC_NONE,0,0), _NR<SoundTransform> soundTransform=NullRef, int32_t loops=1);
 	~SoundChannel();
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
@@ -1131,7 +1131,7 @@ void NetStreamAppendBytesAction::sinit(Class_base* c)
 NetStream::NetStream(Class_base* c):EventDispatcher(c),tickStarted(false),paused(false),closed(true),
 	streamTime(0),frameRate(0),connection(),downloader(NULL),videoDecoder(NULL),
 	audioDecoder(NULL),audioStream(NULL),datagenerationfile(NULL),datagenerationthreadstarted(false),client(NullRef),
-	oldVolume(-1.0),checkPolicyFile(false),rawAccessAllowed(false),framesdecoded(0),playbackBytesPerSecond(0),maxBytesPerSecond(0),datagenerationexpecttype(DATAGENERATION_HEADER),datagenerationbuffer(Class<ByteArray>::getInstanceS(c->getSystemState())),
+	oldVolume(-1.0),checkPolicyFile(false),rawAccessAllowed(false),framesdecoded(0),prevstreamtime(0),framesbeforeseek(0),seekPending(false),seekTarget(0),seeked(false),playbackBytesPerSecond(0),maxBytesPerSecond(0),datagenerationexpecttype(DATAGENERATION_HEADER),datagenerationbuffer(Class<ByteArray>::getInstanceS(c->getSystemState())),
 	backBufferLength(0),backBufferTime(30),bufferLength(0),bufferTime(0.1),bufferTimeMax(0),
 	maxPauseBufferTime(0)
 {
@@ -1242,7 +1242,10 @@ ASFUNCTIONBODY(NetStream,_getInfo)
 	else
 		LOG(LOG_NOT_IMPLEMENTED,"NetStreamInfo.currentBytesPerSecond/maxBytesPerSecond/dataBytesPerSecond is only implemented for data generation mode");
 	if (th->videoDecoder)
+	{
 		res->droppedFrames = th->videoDecoder->framesdropped;
+		res->videoBufferByteLength = th->videoDecoder->getQueuedBytes();
+	}
 	res->playbackBytesPerSecond = th->playbackBytesPerSecond;
 	res->audioBufferLength = th->bufferLength;
 	res->videoBufferLength = th->bufferLength;
@@ -1475,13 +1478,61 @@ ASFUNCTIONBODY(NetStream,play2)
 }
 ASFUNCTIONBODY(NetStream,seek)
 {
-	//NetStream* th=Class<NetStream>::cast(obj);
-	int pos;
+	NetStream* th=Class<NetStream>::cast(obj);
+	number_t pos;
 	ARG_UNPACK(pos);
-	LOG(LOG_NOT_IMPLEMENTED,"NetStream.seek is not implemented yet:"<<pos);
+	if(th->closed || std::isnan(pos) || pos<0)
+	{
+		th->incRef();
+		getVm(th->getSystemState())->addEvent(_MR(th),_MR(Class<NetStatusEvent>::getInstanceS(th->getSystemState(),"error", "NetStream.Seek.InvalidTime")));
+		return NULL;
+	}
+	//The decoding thread owns the stream, it will seek before decoding the next tag
+	Locker l(th->countermutex);
+	th->seekPending=true;
+	th->seekTarget=pos*1000;
 	return NULL;
 }
 
+number_t NetStream::computeBufferLength() const
+{
+	number_t decoded=(number_t(framesdecoded)-framesbeforeseek)/frameRate;
+	number_t played=(number_t(streamTime)-prevstreamtime)/1000.0;
+	return decoded-played;
+}
+
+void NetStream::seekStream(StreamDecoder* streamDecoder, uint32_t target)
+{
+	uint32_t keyTime;
+	if(!streamDecoder->seek(target, getReceivedLength(), keyTime))
+	{
+		LOG(LOG_INFO,"NetStream: no keyframe available to seek to " << target);
+		this->incRef();
+		getVm(getSystemState())->addEvent(_MR(this),_MR(Class<NetStatusEvent>::getInstanceS(getSystemState(),"error", "NetStream.Seek.InvalidTime")));
+		return;
+	}
+	//Drop what was decoded from the old position
+	if(streamDecoder->videoDecoder)
+	{
+		streamDecoder->videoDecoder->discardDelayedFrames();
+		streamDecoder->videoDecoder->skipAll();
+	}
+	if(streamDecoder->audioDecoder)
+		streamDecoder->audioDecoder->skipAll();
+	countermutex.lock();
+	//Frames between the keyframe and the target are decoded and then skipped by tick
+	streamTime=target;
+	seeked=true;
+	//The buffer length counts the frames decoded since the keyframe
+	prevstreamtime=keyTime;
+	framesbeforeseek=framesdecoded;
+	this->bufferLength=0;
+	countermutex.unlock();
+	LOG(LOG_INFO,"NetStream: seek to " << target << " from keyframe at " << keyTime);
+	this->incRef();
+	getVm(getSystemState())->addEvent(_MR(this),_MR(Class<NetStatusEvent>::getInstanceS(getSystemState(),"status", "NetStream.Seek.Notify")));
+}
+
 ASFUNCTIONBODY(NetStream,attach)
 {
 	NetStream* th=obj->as<NetStream>();
@@ -1680,12 +1731,13 @@ void NetStream::tick()
 	//Check if the stream is paused
 	if(audioStream)
 	{
-		//TODO: use soundTransform->pan
 		if(soundTransform && soundTransform->volume != oldVolume)
 		{
 			audioStream->setVolume(soundTransform->volume);
 			oldVolume = soundTransform->volume;
 		}
+		if(soundTransform)
+			audioStream->setPan(soundTransform->pan);
 	}
 	if(paused)
 		return;
@@ -1699,7 +1751,7 @@ void NetStream::tick()
 	if(audioStream)
 	{
 		assert(audioDecoder);
-		if (streamTime == 0)
+		if (streamTime == 0 && !seeked)
 			streamTime=audioStream->getPlayedTime()+audioDecoder->initialTime;
 		else if (this->bufferLength > 0)
 			streamTime+=1000/frameRate;
@@ -1711,7 +1763,7 @@ void NetStream::tick()
 		if (audioDecoder)
 			audioDecoder->skipAll();
 	}
-	this->bufferLength = (framesdecoded / frameRate) - (streamTime-prevstreamtime)/1000.0;
+	this->bufferLength = computeBufferLength();
 	if (this->bufferLength < 0)
 		this->bufferLength = 0;
 	//LOG(LOG_INFO,"tick:"<< " "<<bufferLength << " "<<streamTime<<" "<<frameRate<<" "<<framesdecoded<<" "<<bufferTime<<" "<<this->playbackBytesPerSecond<<" "<<this->getReceivedLength());
@@ -1814,6 +1866,8 @@ void NetStream::execute()
 		
 		countermutex.lock();
 		framesdecoded = 0;
+		framesbeforeseek = 0;
+		seeked = false;
 		frameRate=0;
 		videoDecoder = NULL;
 		this->prevstreamtime = streamTime;
@@ -1829,6 +1883,16 @@ void NetStream::execute()
 				done = true;
 				continue;
 			}
+			countermutex.lock();
+			bool seekRequested=seekPending;
+			seekPending=false;
+			uint32_t target=seekTarget;
+			countermutex.unlock();
+			if(seekRequested)
+			{
+				seekStream(streamDecoder, target);
+				bufferfull=true;
+			}
 			bool decodingSuccess= bufferfull && streamDecoder->decodeNextFrame();
 			if(!decodingSuccess && bufferfull)
 			{
@@ -1858,7 +1922,7 @@ void NetStream::execute()
 						if (frameRate)
 						{
 							this->playbackBytesPerSecond = s.tellg() / (framesdecoded / frameRate);
-							this->bufferLength = (framesdecoded / frameRate) - (streamTime-prevstreamtime)/1000.0;
+							this->bufferLength = computeBufferLength();
 						}
 						countermutex.unlock();
 						if (bufferfull && this->bufferLength < 0)
@@ -1925,6 +1989,9 @@ void NetStream::execute()
 	}
 	if(waitForFlush)
 	{
+		//Get the frames still held by the decoder threads
+		if(videoDecoder)
+			videoDecoder->flushDelayedFrames();
 		//Put the decoders in the flushing state and wait for the complete consumption of contents
 		if(audioDecoder)
 			audioDecoder->setFlushing();
@@ -2534,6 +2601,7 @@ ASFUNCTIONBODY(lightspark,registerClassAlias)
 	args[1]->incRef();
 	_R<Class_base> c=_MR(static_cast<Class_base*>(args[1]));
 	getSys()->aliasMap.insert(make_pair(arg0, c));
+	c->amf3TraitsCached=false;
 	return NULL;
 }
 
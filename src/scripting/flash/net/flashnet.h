@@ -289,6 +289,16 @@ private:
 
 	uint32_t framesdecoded;
 	uint32_t prevstreamtime;
+	//The frames decoded before the last seek, they are not part of the buffer
+	uint32_t framesbeforeseek;
+	//Requested by seek(), performed by the decoding thread. Protected by countermutex
+	bool seekPending;
+	uint32_t seekTarget;
+	//Set by a seek, streamTime is already positioned and must not be resynced with the audio
+	bool seeked;
+	void seekStream(StreamDecoder* streamDecoder, uint32_t target);
+	//Seconds of decoded video ahead of streamTime, countermutex must be held
+	number_t computeBufferLength() const;
 	number_t playbackBytesPerSecond;
 	number_t maxBytesPerSecond;
 
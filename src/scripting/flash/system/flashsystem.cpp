@@ -25,6 +25,12 @@
 #include "backends/security.h"
 #include "scripting/toplevel/XML.h"
 #include "scripting/toplevel/XMLList.h"
+#include "scripting/toplevel/Vector.h"
+#include "scripting/flash/concurrent/Mutex.h"
+#include "scripting/flash/concurrent/Condition.h"
+#include "scripting/flash/errors/flasherrors.h"
+#include "parsing/amf3_generator.h"
+#include "backends/workers.h"
 
 #include <istream>
 
@@ -197,6 +203,7 @@ ASFUNCTIONBODY(Capabilities,_getScreenDPI)
 ApplicationDomain::ApplicationDomain(Class_base* c, _NR<ApplicationDomain> p):ASObject(c),domainMemory(Class<ByteArray>::getInstanceS(c->getSystemState())),parentDomain(p)
 {
 	domainMemory->setLength(MIN_DOMAIN_MEMORY_LIMIT);
+	domainMemory->domainMemoryUsers++;
 }
 
 void ApplicationDomain::sinit(Class_base* c)
@@ -212,7 +219,7 @@ void ApplicationDomain::sinit(Class_base* c)
 	REGISTER_GETTER(c,parentDomain);
 }
 
-ASFUNCTIONBODY_GETTER_SETTER(ApplicationDomain,domainMemory);
+ASFUNCTIONBODY_GETTER_SETTER_CB(ApplicationDomain,domainMemory,domainMemoryChanged);
 ASFUNCTIONBODY_GETTER(ApplicationDomain,parentDomain);
 
 void ApplicationDomain::buildTraits(ASObject* o)
@@ -222,6 +229,11 @@ void ApplicationDomain::buildTraits(ASObject* o)
 void ApplicationDomain::finalize()
 {
 	ASObject::finalize();
+	if(!domainMemory.isNull())
+	{
+		domainMemory->domainMemoryUsers--;
+		++ByteArray::domainMemoryGeneration;
+	}
 	domainMemory.reset();
 	for(auto i = globalScopes.begin(); i != globalScopes.end(); ++i)
 		(*i)->decRef();
@@ -230,6 +242,17 @@ void ApplicationDomain::finalize()
 	//Free template instantations by decRef'ing them
 	for(auto i = instantiatedTemplates.begin(); i != instantiatedTemplates.end(); ++i)
 		i->second->decRef();
+	SlabAllocator::trim();
+}
+
+void ApplicationDomain::domainMemoryChanged(_NR<ByteArray> oldValue)
+{
+	if(!oldValue.isNull())
+		oldValue->domainMemoryUsers--;
+	if(!domainMemory.isNull())
+		domainMemory->domainMemoryUsers++;
+	//Drop the buffers cached by the running functions
+	++ByteArray::domainMemoryGeneration;
 }
 
 ASFUNCTIONBODY(ApplicationDomain,_constructor)
@@ -587,14 +610,31 @@ void System::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructorNotInstantiatable, CLASS_SEALED | CLASS_FINAL);
 	c->setDeclaredMethodByQName("totalMemory","",Class<IFunction>::getFunction(c->getSystemState(),totalMemory),GETTER_METHOD,false);
+	c->setDeclaredMethodByQName("totalMemoryNumber","",Class<IFunction>::getFunction(c->getSystemState(),totalMemoryNumber),GETTER_METHOD,false);
+	c->setDeclaredMethodByQName("privateMemory","",Class<IFunction>::getFunction(c->getSystemState(),privateMemory),GETTER_METHOD,false);
 	c->setDeclaredMethodByQName("disposeXML","",Class<IFunction>::getFunction(c->getSystemState(),disposeXML),NORMAL_METHOD,false);
+	c->setDeclaredMethodByQName("gc","",Class<IFunction>::getFunction(c->getSystemState(),gc),NORMAL_METHOD,false);
 }
 
 
 ASFUNCTIONBODY(System,totalMemory)
 {
-	LOG(LOG_NOT_IMPLEMENTED, "System.totalMemory not implemented");
-	return abstract_d(obj->getSystemState(),1024);
+	//The memory of all the accounts of the process, as the player does for all the movies
+	uint64_t bytes=MemoryAccount::getTotalBytes();
+	return abstract_ui(obj->getSystemState(),std::min(bytes, uint64_t(UINT32_MAX)));
+}
+
+ASFUNCTIONBODY(System,totalMemoryNumber)
+{
+	return abstract_d(obj->getSystemState(),MemoryAccount::getTotalBytes());
+}
+
+ASFUNCTIONBODY(System,privateMemory)
+{
+	uint64_t bytes=getResidentMemory();
+	if(bytes==0)
+		bytes=MemoryAccount::getTotalBytes();
+	return abstract_d(obj->getSystemState(),bytes);
 }
 ASFUNCTIONBODY(System,disposeXML)
 {
@@ -612,27 +652,455 @@ ASFUNCTIONBODY(System,disposeXML)
 	return NULL;
 }
 
+ASFUNCTIONBODY(System,gc)
+{
+	//Only reference cycles need collecting, everything else is already freed.
+	//The running frames hold references the collector can't see, so wait for the end of the event
+	obj->getSystemState()->getCycleCollector().requestCollection();
+	return NULL;
+}
+
+/*
+ * Values crossing a worker boundary. Workers, message channels, mutexes, conditions
+ * and shareable ByteArrays are passed by reference, everything else is copied as AMF3
+ */
+static void packWorkerValue(ASObject* o, WorkerValue& v)
+{
+	if(o->is<MessageChannel>())
+	{
+		v.type=WorkerValue::CHANNEL;
+		ChannelQueue* q=o->as<MessageChannel>()->getQueue();
+		q->incRef();
+		v.ref=_MNR(q);
+	}
+	else if(o->is<ASWorker>())
+	{
+		v.type=WorkerValue::WORKER;
+		WorkerInstance* w=o->as<ASWorker>()->getInstance();
+		w->incRef();
+		v.ref=_MNR(w);
+	}
+	else if(o->is<ASMutex>())
+	{
+		v.type=WorkerValue::MUTEX;
+		v.ref=o->as<ASMutex>()->getWorkerMutex();
+	}
+	else if(o->is<ASCondition>() && !o->as<ASCondition>()->getWorkerCondition().isNull())
+	{
+		v.type=WorkerValue::CONDITION;
+		v.ref=o->as<ASCondition>()->getWorkerCondition();
+	}
+	else if(o->is<ByteArray>() && o->as<ByteArray>()->shareable)
+	{
+		v.type=WorkerValue::BYTEARRAY;
+		v.ref=o->as<ByteArray>()->getSharedBuffer();
+	}
+	else
+	{
+		v.type=WorkerValue::AMF;
+		_R<ByteArray> b=_MR(Class<ByteArray>::getInstanceS(o->getSystemState()));
+		b->writeObject(o);
+		uint32_t len=b->getLength();
+		const uint8_t* data=b->getBuffer(len,false);
+		v.amf.assign(data, data+len);
+	}
+}
+
+static ASObject* unpackWorkerValue(SystemState* sys, const WorkerValue& v)
+{
+	switch(v.type)
+	{
+		case WorkerValue::CHANNEL:
+		{
+			MessageChannel* ret=MessageChannel::getChannelObject(sys, static_cast<ChannelQueue*>(v.ref.getPtr()));
+			ret->incRef();
+			return ret;
+		}
+		case WorkerValue::WORKER:
+		{
+			ASWorker* ret=ASWorker::getWorkerObject(sys, static_cast<WorkerInstance*>(v.ref.getPtr()));
+			ret->incRef();
+			return ret;
+		}
+		case WorkerValue::MUTEX:
+		{
+			ASMutex* ret=Class<ASMutex>::getInstanceS(sys);
+			WorkerMutex* m=static_cast<WorkerMutex*>(v.ref.getPtr());
+			m->incRef();
+			ret->setWorkerMutex(_MR(m));
+			return ret;
+		}
+		case WorkerValue::CONDITION:
+		{
+			ASCondition* ret=Class<ASCondition>::getInstanceS(sys);
+			WorkerCondition* c=static_cast<WorkerCondition*>(v.ref.getPtr());
+			c->incRef();
+			ret->setWorkerCondition(_MR(c));
+			return ret;
+		}
+		case WorkerValue::BYTEARRAY:
+		{
+			ByteArray* ret=Class<ByteArray>::getInstanceS(sys);
+			SharedBuffer* buf=static_cast<SharedBuffer*>(v.ref.getPtr());
+			buf->incRef();
+			ret->setSharedBuffer(_MR(buf));
+			return ret;
+		}
+		case WorkerValue::AMF:
+			break;
+	}
+	if(v.amf.empty())
+		return sys->getUndefinedRef();
+	uint8_t* data=(uint8_t*)malloc(v.amf.size());
+	memcpy(data, v.amf.data(), v.amf.size());
+	_R<ByteArray> b=_MR(Class<ByteArray>::getInstanceS(sys));
+	b->acquireBuffer(data, v.amf.size());
+	Amf3Deserializer d(b.getPtr());
+	_R<ASObject> ret=d.readObject();
+	ret->incRef();
+	return ret.getPtr();
+}
+
+static const char* workerStateName(WorkerInstance::STATE s)
+{
+	switch(s)
+	{
+		case WorkerInstance::NEW:
+			return "new";
+		case WorkerInstance::RUNNING:
+			return "running";
+		case WorkerInstance::TERMINATED:
+			return "terminated";
+	}
+	return "";
+}
+
+static const char* channelStateName(ChannelQueue::STATE s)
+{
+	switch(s)
+	{
+		case ChannelQueue::OPEN:
+			return "open";
+		case ChannelQueue::CLOSING:
+			return "closing";
+		case ChannelQueue::CLOSED:
+			return "closed";
+	}
+	return "";
+}
+
 ASWorker::ASWorker(Class_base* c):
 	EventDispatcher(c)
 {
-	LOG(LOG_NOT_IMPLEMENTED, "Worker not implemented");
 }
 
 void ASWorker::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, EventDispatcher, _constructorNotInstantiatable, CLASS_SEALED | CLASS_FINAL);
 	c->setDeclaredMethodByQName("current","",Class<IFunction>::getFunction(c->getSystemState(),_getCurrent),GETTER_METHOD,false);
+	c->setDeclaredMethodByQName("isSupported","",Class<IFunction>::getFunction(c->getSystemState(),_isSupported),GETTER_METHOD,false);
+	c->setDeclaredMethodByQName("isPrimordial","",Class<IFunction>::getFunction(c->getSystemState(),_getIsPrimordial),GETTER_METHOD,true);
+	c->setDeclaredMethodByQName("state","",Class<IFunction>::getFunction(c->getSystemState(),_getState),GETTER_METHOD,true);
+	c->setDeclaredMethodByQName("start","",Class<IFunction>::getFunction(c->getSystemState(),start),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("terminate","",Class<IFunction>::getFunction(c->getSystemState(),terminate),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("setSharedProperty","",Class<IFunction>::getFunction(c->getSystemState(),setSharedProperty),NORMAL_METHOD,true);
 	c->setDeclaredMethodByQName("getSharedProperty","",Class<IFunction>::getFunction(c->getSystemState(),getSharedProperty),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("createMessageChannel","",Class<IFunction>::getFunction(c->getSystemState(),createMessageChannel),NORMAL_METHOD,true);
+}
+
+void ASWorker::finalize()
+{
+	EventDispatcher::finalize();
+	instance.reset();
+}
+
+/*
+ * Forgets the objects of terminated workers and closed channels that are only
+ * referenced by the maps, no more events will be dispatched to them
+ */
+static void pruneWorkerObjects(SystemState* sys)
+{
+	for(auto it=sys->workerObjects.begin();it!=sys->workerObjects.end();)
+	{
+		if(it->second->isLastRef() && it->first->getState()==WorkerInstance::TERMINATED)
+			it=sys->workerObjects.erase(it);
+		else
+			++it;
+	}
+	for(auto it=sys->messageChannelObjects.begin();it!=sys->messageChannelObjects.end();)
+	{
+		if(it->second->isLastRef() && it->first->getState()==ChannelQueue::CLOSED)
+			it=sys->messageChannelObjects.erase(it);
+		else
+			++it;
+	}
+}
+
+ASWorker* ASWorker::getWorkerObject(SystemState* sys, WorkerInstance* w)
+{
+	pruneWorkerObjects(sys);
+	auto it=sys->workerObjects.find(w);
+	if(it!=sys->workerObjects.end())
+		return it->second.getPtr();
+	ASWorker* ret=Class<ASWorker>::getInstanceS(sys);
+	w->incRef();
+	ret->instance=_MNR(w);
+	sys->workerObjects.insert(std::make_pair(w,_MR(ret)));
+	return ret;
 }
+
+void ASWorker::handleNotification(SystemState* sys, WorkerNotificationEvent* ev)
+{
+	switch(ev->notification)
+	{
+		case WorkerInstance::WORKER_STATE:
+		{
+			auto it=sys->workerObjects.find(ev->worker.getPtr());
+			if(it!=sys->workerObjects.end())
+				getVm(sys)->addEvent(it->second,_MR(Class<Event>::getInstanceS(sys,"workerState")));
+			break;
+		}
+		case WorkerInstance::CHANNEL_MESSAGE:
+		case WorkerInstance::CHANNEL_STATE:
+		{
+			auto it=sys->messageChannelObjects.find(ev->channel.getPtr());
+			if(it==sys->messageChannelObjects.end())
+				break;
+			const char* type=(ev->notification==WorkerInstance::CHANNEL_MESSAGE)?"channelMessage":"channelState";
+			getVm(sys)->addEvent(it->second,_MR(Class<Event>::getInstanceS(sys,type)));
+			break;
+		}
+	}
+	pruneWorkerObjects(sys);
+}
+
 ASFUNCTIONBODY(ASWorker,_getCurrent)
 {
-	LOG(LOG_NOT_IMPLEMENTED, "Worker not implemented");
-	return Class<ASObject>::getInstanceS(getSys());
+	SystemState* sys=getSys();
+	ASWorker* ret=getWorkerObject(sys, sys->getWorker());
+	ret->incRef();
+	return ret;
+}
+ASFUNCTIONBODY(ASWorker,_isSupported)
+{
+	return abstract_b(getSys(),true);
+}
+ASFUNCTIONBODY(ASWorker,_getIsPrimordial)
+{
+	ASWorker* th=obj->as<ASWorker>();
+	return abstract_b(obj->getSystemState(),th->instance->isPrimordial());
+}
+ASFUNCTIONBODY(ASWorker,_getState)
+{
+	ASWorker* th=obj->as<ASWorker>();
+	return abstract_s(obj->getSystemState(),workerStateName(th->instance->getState()));
+}
+ASFUNCTIONBODY(ASWorker,start)
+{
+	ASWorker* th=obj->as<ASWorker>();
+	if(th->instance->isPrimordial())
+		throwError<IllegalOperationError>(kWorkerIllegalCallToStart);
+	if(!th->instance->start())
+		throwError<IllegalOperationError>(kWorkerAlreadyStarted);
+	return NULL;
+}
+ASFUNCTIONBODY(ASWorker,terminate)
+{
+	ASWorker* th=obj->as<ASWorker>();
+	return abstract_b(obj->getSystemState(),th->instance->terminate());
+}
+ASFUNCTIONBODY(ASWorker,setSharedProperty)
+{
+	ASWorker* th=obj->as<ASWorker>();
+	tiny_string key;
+	_NR<ASObject> value;
+	ARG_UNPACK(key)(value);
+	WorkerValue v;
+	packWorkerValue(value.getPtr(), v);
+	th->instance->setSharedProperty(key, v);
+	return NULL;
 }
 ASFUNCTIONBODY(ASWorker,getSharedProperty)
 {
-	LOG(LOG_NOT_IMPLEMENTED, "Worker.getSharedProperty not implemented");
-	return Class<ASObject>::getInstanceS(getSys());
+	ASWorker* th=obj->as<ASWorker>();
+	tiny_string key;
+	ARG_UNPACK(key);
+	WorkerValue v;
+	if(!th->instance->getSharedProperty(key, v))
+		return obj->getSystemState()->getNullRef();
+	return unpackWorkerValue(obj->getSystemState(), v);
+}
+ASFUNCTIONBODY(ASWorker,createMessageChannel)
+{
+	ASWorker* th=obj->as<ASWorker>();
+	_NR<ASWorker> receiver;
+	ARG_UNPACK(receiver);
+	if(receiver.isNull())
+		throwError<ArgumentError>(kNullPointerError, "receiver");
+	th->instance->incRef();
+	receiver->instance->incRef();
+	ChannelQueue* q=new ChannelQueue(_MR(th->instance.getPtr()), _MR(receiver->instance.getPtr()));
+	MessageChannel* ret=MessageChannel::getChannelObject(obj->getSystemState(), q);
+	//The MessageChannel object holds its own reference
+	q->decRef();
+	ret->incRef();
+	return ret;
+}
+
+void WorkerDomain::sinit(Class_base* c)
+{
+	CLASS_SETUP(c, ASObject, _constructorNotInstantiatable, CLASS_SEALED | CLASS_FINAL);
+	c->setDeclaredMethodByQName("current","",Class<IFunction>::getFunction(c->getSystemState(),_getCurrent),GETTER_METHOD,false);
+	c->setDeclaredMethodByQName("isSupported","",Class<IFunction>::getFunction(c->getSystemState(),_isSupported),GETTER_METHOD,false);
+	c->setDeclaredMethodByQName("createWorker","",Class<IFunction>::getFunction(c->getSystemState(),createWorker),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("listWorkers","",Class<IFunction>::getFunction(c->getSystemState(),listWorkers),NORMAL_METHOD,true);
+}
+ASFUNCTIONBODY(WorkerDomain,_getCurrent)
+{
+	//All the workers share a single domain
+	return Class<WorkerDomain>::getInstanceS(getSys());
+}
+ASFUNCTIONBODY(WorkerDomain,_isSupported)
+{
+	return abstract_b(getSys(),true);
+}
+ASFUNCTIONBODY(WorkerDomain,createWorker)
+{
+	_NR<ByteArray> swf;
+	bool giveAppPrivileges;
+	ARG_UNPACK(swf)(giveAppPrivileges,false);
+	if(swf.isNull())
+		throwError<ArgumentError>(kNullPointerError, "swf");
+	if(giveAppPrivileges)
+		LOG(LOG_NOT_IMPLEMENTED, "WorkerDomain.createWorker: giveAppPrivileges is ignored");
+	SystemState* sys=obj->getSystemState();
+	uint32_t len=swf->getLength();
+	const uint8_t* data=len?swf->getBuffer(len,false):NULL;
+	WorkerInstance* w=new WorkerInstance(sys, data, len);
+	ASWorker* ret=ASWorker::getWorkerObject(sys, w);
+	w->decRef();
+	ret->incRef();
+	return ret;
+}
+ASFUNCTIONBODY(WorkerDomain,listWorkers)
+{
+	SystemState* sys=obj->getSystemState();
+	std::vector<_R<WorkerInstance>> workers;
+	sys->getWorker()->listWorkers(workers);
+	Vector* ret=Template<Vector>::getInstanceS(sys,Class<ASWorker>::getClass(sys),NullRef);
+	for(uint32_t i=0;i<workers.size();i++)
+	{
+		if(workers[i]->getState()==WorkerInstance::TERMINATED)
+			continue;
+		ASWorker* w=ASWorker::getWorkerObject(sys, workers[i].getPtr());
+		w->incRef();
+		ret->append(w);
+	}
+	return ret;
+}
+
+void WorkerState::sinit(Class_base* c)
+{
+	CLASS_SETUP(c, ASObject, _constructorNotInstantiatable, CLASS_SEALED | CLASS_FINAL);
+	c->setVariableByQName("NEW","",abstract_s(c->getSystemState(),"new"),CONSTANT_TRAIT);
+	c->setVariableByQName("RUNNING","",abstract_s(c->getSystemState(),"running"),CONSTANT_TRAIT);
+	c->setVariableByQName("TERMINATED","",abstract_s(c->getSystemState(),"terminated"),CONSTANT_TRAIT);
+}
+
+MessageChannel::MessageChannel(Class_base* c):
+	EventDispatcher(c)
+{
+}
+
+void MessageChannel::sinit(Class_base* c)
+{
+	CLASS_SETUP(c, EventDispatcher, _constructorNotInstantiatable, CLASS_SEALED | CLASS_FINAL);
+	c->setDeclaredMethodByQName("messageAvailable","",Class<IFunction>::getFunction(c->getSystemState(),_getMessageAvailable),GETTER_METHOD,true);
+	c->setDeclaredMethodByQName("state","",Class<IFunction>::getFunction(c->getSystemState(),_getState),GETTER_METHOD,true);
+	c->setDeclaredMethodByQName("send","",Class<IFunction>::getFunction(c->getSystemState(),send),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("receive","",Class<IFunction>::getFunction(c->getSystemState(),receive),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("close","",Class<IFunction>::getFunction(c->getSystemState(),close),NORMAL_METHOD,true);
+	c->setDeclaredMethodByQName("toString","",Class<IFunction>::getFunction(c->getSystemState(),_toString),NORMAL_METHOD,true);
+}
+
+void MessageChannel::finalize()
+{
+	EventDispatcher::finalize();
+	queue.reset();
+}
+
+MessageChannel* MessageChannel::getChannelObject(SystemState* sys, ChannelQueue* q)
+{
+	pruneWorkerObjects(sys);
+	auto it=sys->messageChannelObjects.find(q);
+	if(it!=sys->messageChannelObjects.end())
+		return it->second.getPtr();
+	MessageChannel* ret=Class<MessageChannel>::getInstanceS(sys);
+	q->incRef();
+	ret->queue=_MNR(q);
+	sys->messageChannelObjects.insert(std::make_pair(q,_MR(ret)));
+	return ret;
+}
+
+ASFUNCTIONBODY(MessageChannel,_getMessageAvailable)
+{
+	MessageChannel* th=obj->as<MessageChannel>();
+	return abstract_b(obj->getSystemState(),th->queue->messageAvailable());
+}
+ASFUNCTIONBODY(MessageChannel,_getState)
+{
+	MessageChannel* th=obj->as<MessageChannel>();
+	return abstract_s(obj->getSystemState(),channelStateName(th->queue->getState()));
+}
+ASFUNCTIONBODY(MessageChannel,send)
+{
+	MessageChannel* th=obj->as<MessageChannel>();
+	_NR<ASObject> arg;
+	int32_t queueLimit;
+	ARG_UNPACK(arg)(queueLimit,-1);
+	if(queueLimit!=-1)
+		LOG(LOG_NOT_IMPLEMENTED, "MessageChannel.send: queueLimit is ignored");
+	if(th->queue->getSender()!=obj->getSystemState()->getWorker())
+		throwError<IllegalOperationError>(kInvalidParamError);
+	WorkerValue v;
+	packWorkerValue(arg.getPtr(), v);
+	if(!th->queue->send(v))
+		throwError<IOError>(kInvalidParamError);
+	return NULL;
+}
+ASFUNCTIONBODY(MessageChannel,receive)
+{
+	MessageChannel* th=obj->as<MessageChannel>();
+	bool blockUntilReceived;
+	ARG_UNPACK(blockUntilReceived,false);
+	SystemState* sys=obj->getSystemState();
+	if(th->queue->getReceiver()!=sys->getWorker())
+		throwError<IllegalOperationError>(kInvalidParamError);
+	//The primordial worker runs the display list, it never blocks
+	if(blockUntilReceived && !sys->isBackgroundWorker())
+		blockUntilReceived=false;
+	WorkerValue v;
+	if(!th->queue->receive(v, blockUntilReceived))
+		return sys->getNullRef();
+	return unpackWorkerValue(sys, v);
+}
+ASFUNCTIONBODY(MessageChannel,close)
+{
+	MessageChannel* th=obj->as<MessageChannel>();
+	th->queue->close();
+	return NULL;
+}
+ASFUNCTIONBODY(MessageChannel,_toString)
+{
+	return abstract_s(obj->getSystemState(),"[object MessageChannel]");
+}
+
+void MessageChannelState::sinit(Class_base* c)
+{
+	CLASS_SETUP(c, ASObject, _constructorNotInstantiatable, CLASS_SEALED | CLASS_FINAL);
+	c->setVariableByQName("OPEN","",abstract_s(c->getSystemState(),"open"),CONSTANT_TRAIT);
+	c->setVariableByQName("CLOSING","",abstract_s(c->getSystemState(),"closing"),CONSTANT_TRAIT);
+	c->setVariableByQName("CLOSED","",abstract_s(c->getSystemState(),"closed"),CONSTANT_TRAIT);
 }
 
 void ImageDecodingPolicy::sinit(Class_base* c)
@@ -30,6 +30,8 @@ namespace lightspark
 {
 
 class SecurityDomain;
+class WorkerInstance;
+class ChannelQueue;
 
 class Capabilities: public ASObject
 {
@@ -84,29 +86,8 @@ public:
 	ASFUNCTION(hasDefinition);
 	ASFUNCTION(getDefinition);
 	ASPROPERTY_GETTER_SETTER(_NR<ByteArray>, domainMemory);
+	void domainMemoryChanged(_NR<ByteArray> oldValue);
 	ASPROPERTY_GETTER(_NR<ApplicationDomain>, parentDomain);
-	template<class T>
-	T readFromDomainMemory(uint32_t addr) const
-	{
-		if(domainMemory.isNull())
-			return 0;
-		uint32_t bufLen=domainMemory->getLength();
-		if(bufLen < (addr+sizeof(T)))
-			throwError<RangeError>(kInvalidRangeError);
-		uint8_t* buf=domainMemory->getBuffer(bufLen, false);
-		return *reinterpret_cast<T*>(buf+addr);
-	}
-	template<class T>
-	void writeToDomainMemory(uint32_t addr, T val)
-	{
-		if(domainMemory.isNull())
-			return;
-		uint32_t bufLen=domainMemory->getLength();
-		if(bufLen < (addr+sizeof(T)))
-			throwError<RangeError>(kInvalidRangeError);
-		uint8_t* buf=domainMemory->getBuffer(bufLen, false);
-		*reinterpret_cast<T*>(buf+addr)=val;
-	}
 };
 
 class LoaderContext: public ASObject
@@ -159,15 +140,73 @@ public:
 	System(Class_base* c):ASObject(c){}
 	static void sinit(Class_base* c);
 	ASFUNCTION(totalMemory);
+	ASFUNCTION(totalMemoryNumber);
+	ASFUNCTION(privateMemory);
 	ASFUNCTION(disposeXML);
+	ASFUNCTION(gc);
 };
 class ASWorker: public EventDispatcher
 {
+private:
+	_NR<WorkerInstance> instance;
 public:
 	ASWorker(Class_base* c);
 	static void sinit(Class_base*);
+	void finalize();
+	WorkerInstance* getInstance() const { return instance.getPtr(); }
+	/* Returns the object representing w in the worker of sys, the same object is returned every time */
+	static ASWorker* getWorkerObject(SystemState* sys, WorkerInstance* w);
+	/* Dispatches the events of a notification sent by another worker, called by the VM thread */
+	static void handleNotification(SystemState* sys, WorkerNotificationEvent* ev);
 	ASFUNCTION(_getCurrent);
+	ASFUNCTION(_isSupported);
+	ASFUNCTION(_getIsPrimordial);
+	ASFUNCTION(_getState);
+	ASFUNCTION(start);
+	ASFUNCTION(terminate);
+	ASFUNCTION(setSharedProperty);
 	ASFUNCTION(getSharedProperty);
+	ASFUNCTION(createMessageChannel);
+};
+class WorkerDomain: public ASObject
+{
+public:
+	WorkerDomain(Class_base* c):ASObject(c){}
+	static void sinit(Class_base*);
+	ASFUNCTION(_getCurrent);
+	ASFUNCTION(_isSupported);
+	ASFUNCTION(createWorker);
+	ASFUNCTION(listWorkers);
+};
+class WorkerState: public ASObject
+{
+public:
+	WorkerState(Class_base* c):ASObject(c){}
+	static void sinit(Class_base*);
+};
+class MessageChannel: public EventDispatcher
+{
+private:
+	_NR<ChannelQueue> queue;
+public:
+	MessageChannel(Class_base* c);
+	static void sinit(Class_base*);
+	void finalize();
+	ChannelQueue* getQueue() const { return queue.getPtr(); }
+	/* Returns the object representing q in the worker of sys, the same object is returned every time */
+	static MessageChannel* getChannelObject(SystemState* sys, ChannelQueue* q);
+	ASFUNCTION(_getMessageAvailable);
+	ASFUNCTION(_getState);
+	ASFUNCTION(send);
+	ASFUNCTION(receive);
+	ASFUNCTION(close);
+	ASFUNCTION(_toString);
+};
+class MessageChannelState: public ASObject
+{
+public:
+	MessageChannelState(Class_base* c):ASObject(c){}
+	static void sinit(Class_base*);
 };
 class ImageDecodingPolicy: public ASObject
 {
@@ -92,7 +92,8 @@ ASFUNCTIONBODY(ASFont,registerFont)
 TextField::TextField(Class_base* c, const TextData& textData, bool _selectable, bool readOnly)
 	: InteractiveObject(c), TextData(textData), TokenContainer(this), type(ET_READ_ONLY),
 	  antiAliasType(AA_NORMAL), gridFitType(GF_PIXEL),
-	  textInteractionMode(TI_NORMAL), alwaysShowSelection(false),
+	  textInteractionMode(TI_NORMAL), layoutCache(_MR(new TextLayoutCache())),
+	  alwaysShowSelection(false),
 	  caretIndex(0), condenseWhite(false), displayAsPassword(false),
 	  embedFonts(false), maxChars(0), mouseWheelEnabled(true),
 	  selectable(_selectable), selectionBeginIndex(0), selectionEndIndex(0),
@@ -512,7 +513,7 @@ ASFUNCTIONBODY(TextField,_getLineIndexAtPoint)
 	number_t y;
 	ARG_UNPACK(x) (y);
 
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*th);
+	std::vector<LineData> lines = th->layoutCache->getLineData(*th);
 	std::vector<LineData>::const_iterator it;
 	int i;
 	for (i=0, it=lines.begin(); it!=lines.end(); ++i, ++it)
@@ -534,7 +535,7 @@ ASFUNCTIONBODY(TextField,_getLineIndexOfChar)
 	if (charIndex < 0)
 		return abstract_i(obj->getSystemState(),-1);
 
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*th);
+	std::vector<LineData> lines = th->layoutCache->getLineData(*th);
 	std::vector<LineData>::const_iterator it;
 	int i;
 	for (i=0, it=lines.begin(); it!=lines.end(); ++i, ++it)
@@ -555,7 +556,7 @@ ASFUNCTIONBODY(TextField,_getLineLength)
 	int32_t  lineIndex;
 	ARG_UNPACK(lineIndex);
 
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*th);
+	std::vector<LineData> lines = th->layoutCache->getLineData(*th);
 	if (lineIndex < 0 || lineIndex >= (int32_t)lines.size())
 		throwError<RangeError>(kParamRangeError);
 
@@ -568,7 +569,7 @@ ASFUNCTIONBODY(TextField,_getLineMetrics)
 	int32_t  lineIndex;
 	ARG_UNPACK(lineIndex);
 
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*th);
+	std::vector<LineData> lines = th->layoutCache->getLineData(*th);
 	if (lineIndex < 0 || lineIndex >= (int32_t)lines.size())
 		throwError<RangeError>(kParamRangeError);
 
@@ -587,7 +588,7 @@ ASFUNCTIONBODY(TextField,_getLineOffset)
 	int32_t  lineIndex;
 	ARG_UNPACK(lineIndex);
 
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*th);
+	std::vector<LineData> lines = th->layoutCache->getLineData(*th);
 	if (lineIndex < 0 || lineIndex >= (int32_t)lines.size())
 		throwError<RangeError>(kParamRangeError);
 
@@ -600,7 +601,7 @@ ASFUNCTIONBODY(TextField,_getLineText)
 	int32_t  lineIndex;
 	ARG_UNPACK(lineIndex);
 
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*th);
+	std::vector<LineData> lines = th->layoutCache->getLineData(*th);
 	if (lineIndex < 0 || lineIndex >= (int32_t)lines.size())
 		throwError<RangeError>(kParamRangeError);
 
@@ -674,7 +675,7 @@ ASFUNCTIONBODY(TextField,_getLength)
 ASFUNCTIONBODY(TextField,_getNumLines)
 {
 	TextField* th=Class<TextField>::cast(obj);
-	return abstract_i(obj->getSystemState(),CairoPangoRenderer::getLineData(*th).size());
+	return abstract_i(obj->getSystemState(),th->layoutCache->getLineCount(*th));
 }
 
 ASFUNCTIONBODY(TextField,_getMaxScrollH)
@@ -692,7 +693,7 @@ ASFUNCTIONBODY(TextField,_getMaxScrollV)
 ASFUNCTIONBODY(TextField,_getBottomScrollV)
 {
 	TextField* th=Class<TextField>::cast(obj);
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*th);
+	std::vector<LineData> lines = th->layoutCache->getLineData(*th);
 	for (unsigned int k=0; k<lines.size()-1; k++)
 	{
 		if (lines[k+1].extents.Ymin >= (int)th->height)
@@ -841,7 +842,7 @@ int32_t TextField::getMaxScrollH()
 
 int32_t TextField::getMaxScrollV()
 {
-	std::vector<LineData> lines = CairoPangoRenderer::getLineData(*this);
+	std::vector<LineData> lines = layoutCache->getLineData(*this);
 	if (lines.size() <= 1)
 		return 1;
 
@@ -868,7 +869,7 @@ void TextField::updateSizes()
 	w = width;
 	h = height;
 	//Compute (text)width, (text)height
-	CairoPangoRenderer::getBounds(*this, w, h, tw, th);
+	layoutCache->getBounds(*this, w, h, tw, th);
 	width = w; //TODO: check the case when w,h == 0
 	textWidth=tw;
 	height = h;
@@ -992,6 +993,7 @@ IDrawable* TextField::invalidate(DisplayObject* target, const MATRIX& initialMat
 		scaling = 1.0f/1024.0f/20.0f;
 		embeddedfont->fillTextTokens(tokens,text,fontSize,textColor);
 	}
+	invalidateHitTest();
 	if (!tokensEmpty())
 		return TokenContainer::invalidate(target, initialMatrix);
 	
@@ -1011,7 +1013,7 @@ IDrawable* TextField::invalidate(DisplayObject* target, const MATRIX& initialMat
 	*/
 	return new CairoPangoRenderer(*this,
 				totalMatrix, x, y, width, height, 1.0f,
-				getConcatenatedAlpha(), masks);
+				getConcatenatedAlpha(), masks, layoutCache);
 }
 
 void TextField::renderImpl(RenderContext& ctxt) const
@@ -113,6 +113,8 @@ private:
 	GRID_FIT_TYPE gridFitType;
 	TEXT_INTERACTION_MODE textInteractionMode;
 	_NR<ASString> restrictChars;
+	//Shared by the metrics, the size computation and the renderer
+	_R<TextLayoutCache> layoutCache;
 public:
 	TextField(Class_base* c, const TextData& textData=TextData(), bool _selectable=true, bool readOnly=true);
 	void finalize();
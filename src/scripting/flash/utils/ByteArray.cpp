@@ -32,28 +32,37 @@
 using namespace std;
 using namespace lightspark;
 
+ATOMIC_INT32(ByteArray::domainMemoryGeneration);
+
 #define BA_CHUNK_SIZE 4096
 
 
 ByteArray::ByteArray(Class_base* c, uint8_t* b, uint32_t l):ASObject(c),littleEndian(false),objectEncoding(ObjectEncoding::AMF3),currentObjectEncoding(ObjectEncoding::AMF3),
-	position(0),bytes(b),real_len(l),len(l),shareable(false)
+	position(0),bytes(b),real_len(l),len(l),domainMemoryUsers(0),shareable(false)
 {
-#ifdef MEMORY_USAGE_PROFILING
-	c->memoryAccount->addBytes(l);
-#endif
+	accountBytes(l);
 }
 
 ByteArray::~ByteArray()
 {
-	if(bytes)
+	//Shared bytes are freed by the SharedBuffer
+	if(bytes && shared.isNull())
 	{
-#ifdef MEMORY_USAGE_PROFILING
-		getClass()->memoryAccount->removeBytes(real_len);
-#endif
+		accountBytes(-int64_t(real_len));
 		free(bytes);
 	}
 }
 
+void ByteArray::accountBytes(int64_t change)
+{
+	//The bytes of a shared buffer left the account in getSharedBuffer, and belong to no worker
+	if(!shared.isNull())
+		return;
+	Class_base* c=getClass();
+	if(c && c->memoryAccount)
+		MemoryAccount::count(c->memoryAccount->getId(), change, 0);
+}
+
 void ByteArray::sinit(Class_base* c)
 {
 	CLASS_SETUP(c, ASObject, _constructor, CLASS_SEALED);
@@ -119,11 +128,67 @@ void ByteArray::buildTraits(ASObject* o)
 
 void ByteArray::lock()
 {
-	if (shareable) mutex.lock();
+	if (!shared.isNull())
+	{
+		shared->mutex.lock();
+		//Another worker may have reallocated the bytes
+		if(bytes!=shared->bytes || len!=shared->len)
+			bufferChanged();
+		bytes=shared->bytes;
+		len=shared->len;
+		real_len=shared->real_len;
+	}
+	else if (shareable) mutex.lock();
 }
 void ByteArray::unlock()
 {
-	if (shareable) mutex.unlock();
+	if (!shared.isNull())
+	{
+		shared->bytes=bytes;
+		shared->len=len;
+		shared->real_len=real_len;
+		shared->mutex.unlock();
+	}
+	else if (shareable) mutex.unlock();
+}
+
+bool ByteArray::copyLocked(uint32_t addr, void* val, uint32_t size, bool write)
+{
+	lock();
+	bool ret=uint64_t(addr)+size<=len;
+	if(ret && write)
+		memcpy(bytes+addr, val, size);
+	else if(ret)
+		memcpy(val, bytes+addr, size);
+	unlock();
+	return ret;
+}
+
+_R<SharedBuffer> ByteArray::getSharedBuffer()
+{
+	assert(shareable);
+	lock();
+	if(shared.isNull())
+	{
+		accountBytes(-int64_t(real_len));
+		shared=_MR(new SharedBuffer(bytes,len,real_len));
+		//lock() took the private mutex
+		mutex.unlock();
+	}
+	else
+		unlock();
+	return shared;
+}
+
+void ByteArray::setSharedBuffer(_R<SharedBuffer> buf)
+{
+	assert(bytes==NULL);
+	shareable=true;
+	shared=buf;
+	Locker l(shared->mutex);
+	bytes=shared->bytes;
+	len=shared->len;
+	real_len=shared->real_len;
 }
 
 uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
@@ -134,16 +199,15 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 	if (size > 0x40000000) 
 		throwError<ASError>(kOutOfMemoryError);
 	// The first allocation is exactly the size we need,
-	// the subsequent reallocations happen in increments of BA_CHUNK_SIZE bytes
+	// the subsequent reallocations grow geometrically, rounded to BA_CHUNK_SIZE bytes
 	uint32_t prevLen = len;
+	uint8_t* prevBytes = bytes;
 	if(bytes==NULL)
 	{
 		len=size;
 		real_len=len;
 		bytes = (uint8_t*) malloc(len);
-#ifdef MEMORY_USAGE_PROFILING
-		getClass()->memoryAccount->addBytes(len);
-#endif
+		accountBytes(len);
 	}
 	else if(enableResize==false)
 	{
@@ -151,16 +215,17 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 	}
 	else if(real_len<size) // && enableResize==true
 	{
-#ifdef MEMORY_USAGE_PROFILING
 		uint32_t prev_real_len = real_len;
-#endif
-		while(real_len < size)
-			real_len += BA_CHUNK_SIZE;
-		// Reallocate the buffer, in chunks of BA_CHUNK_SIZE bytes
+		// Grow by half of the current size, so that appending many small
+		// values (i.e. while serializing) does not realloc every few KBs
+		uint64_t newLen=max(uint64_t(real_len)+real_len/2, uint64_t(size));
+		newLen=(newLen+BA_CHUNK_SIZE-1)/BA_CHUNK_SIZE*BA_CHUNK_SIZE;
+		real_len=min(newLen, uint64_t(0x40000000));
+		if(real_len<size)
+			real_len=size;
+		// Reallocate the buffer
 		uint8_t* bytes2 = (uint8_t*) realloc(bytes, real_len);
-#ifdef MEMORY_USAGE_PROFILING
-		getClass()->memoryAccount->addBytes(real_len-prev_real_len);
-#endif
+		accountBytes(real_len-prev_real_len);
 		assert_and_throw(bytes2);
 		bytes = bytes2;
 		len=size;
@@ -175,6 +240,8 @@ uint8_t* ByteArray::getBuffer(unsigned int size, bool enableResize)
 		//Extend
 		memset(bytes+prevLen,0,size-prevLen);
 	}
+	if(bytes!=prevBytes || len!=prevLen)
+		bufferChanged();
 	return bytes;
 }
 
@@ -322,9 +389,8 @@ ASFUNCTIONBODY(ByteArray,_setLength)
 
 	uint32_t newLen=args[0]->toInt();
 	th->lock();
-	if(newLen==th->len) //Nothing to do
-		return NULL;
-	th->setLength(newLen);
+	if(newLen!=th->len)
+		th->setLength(newLen);
 	th->unlock();
 	return NULL;
 }
@@ -338,28 +404,36 @@ void ByteArray::setLength(uint32_t newLen)
 	{
 		if (bytes)
 		{
-#ifdef MEMORY_USAGE_PROFILING
-			getClass()->memoryAccount->removeBytes(th->real_len);
-#endif
+			accountBytes(-int64_t(real_len));
 			free(bytes);
 		}
 		bytes = NULL;
 		real_len = newLen;
 	}
-	len = newLen;
+	if (len != newLen)
+	{
+		len = newLen;
+		bufferChanged();
+	}
 	if (position > len)
 		position = (len > 0 ? len-1 : 0);
 }
 ASFUNCTIONBODY(ByteArray,_getLength)
 {
 	ByteArray* th=static_cast<ByteArray*>(obj);
-	return abstract_i(obj->getSystemState(),th->len);
+	th->lock();
+	uint32_t ret=th->len;
+	th->unlock();
+	return abstract_i(obj->getSystemState(),ret);
 }
 
 ASFUNCTIONBODY(ByteArray,_getBytesAvailable)
 {
 	ByteArray* th=static_cast<ByteArray*>(obj);
-	return abstract_i(obj->getSystemState(),th->len-th->position);
+	th->lock();
+	uint32_t ret=(th->len>th->position)?th->len-th->position:0;
+	th->unlock();
+	return abstract_i(obj->getSystemState(),ret);
 }
 
 ASFUNCTIONBODY(ByteArray,readBoolean)
@@ -553,9 +627,9 @@ uint32_t ByteArray::writeObject(ASObject* obj)
 	//Return the length of the serialized object
 
 	//TODO: support custom serialization
-	map<tiny_string, uint32_t> stringMap;
-	map<const ASObject*, uint32_t> objMap;
-	map<const Class_base*, uint32_t> traitsMap;
+	unordered_map<tiny_string, uint32_t> stringMap;
+	unordered_map<const ASObject*, uint32_t> objMap;
+	unordered_map<const Class_base*, uint32_t> traitsMap;
 	uint32_t oldPosition=position;
 	obj->serialize(this, stringMap, objMap,traitsMap);
 	return position-oldPosition;
@@ -758,6 +832,16 @@ bool ByteArray::readByte(uint8_t& b)
 	return true;
 }
 
+const uint8_t* ByteArray::readRawBytes(uint32_t count)
+{
+	if (len < position || len-position < count)
+		return NULL;
+
+	const uint8_t* ret=bytes+position;
+	position+=count;
+	return ret;
+}
+
 bool ByteArray::readU29(uint32_t& ret)
 {
 	//Be careful! This is different from u32 parsing.
@@ -1044,11 +1128,13 @@ _NR<ASObject> ByteArray::getVariableByMultiname(const multiname& name, GET_VARIA
 	if((opt & ASObject::SKIP_IMPL)!=0  || !implEnable || !Array::isValidMultiname(getSystemState(),name,index))
 		return ASObject::getVariableByMultiname(name,opt);
 
-	if(index<len)
-	{
-		uint8_t value = bytes[index];
+	//The bytes of a shared ByteArray may be reallocated by another worker
+	lock();
+	bool found=index<len;
+	uint8_t value = found ? bytes[index] : 0;
+	unlock();
+	if(found)
 		return _MNR(abstract_ui(getSystemState(),static_cast<uint32_t>(value)));
-	}
 	else
 		return _MNR(getSystemState()->getUndefinedRef());
 }
@@ -1060,11 +1146,12 @@ int32_t ByteArray::getVariableByMultiname_i(const multiname& name)
 	if(!Array::isValidMultiname(getSystemState(),name,index))
 		return ASObject::getVariableByMultiname_i(name);
 
-	if(index<len)
-	{
-		uint8_t value = bytes[index];
+	lock();
+	bool found=index<len;
+	uint8_t value = found ? bytes[index] : 0;
+	unlock();
+	if(found)
 		return static_cast<uint32_t>(value);
-	}
 	else
 		return _MNR(getSystemState()->getUndefinedRef());
 }
@@ -1076,19 +1163,29 @@ void ByteArray::setVariableByMultiname(const multiname& name, ASObject* o, CONST
 	if(!Array::isValidMultiname(getSystemState(),name,index))
 		return ASObject::setVariableByMultiname(name,o,allowConst);
 
+	// Fill the byte pointed to by index with the truncated uint value of the object.
+	// The conversion may run AS code, so it is done before taking the lock
+	uint8_t value = static_cast<uint8_t>(o->toUInt() & 0xff);
+	o->decRef();
+
+	lock();
 	if(index>=len)
 	{
 		uint32_t prevLen = len;
-		getBuffer(index+1, true);
+		try
+		{
+			getBuffer(index+1, true);
+		}
+		catch(...)
+		{
+			unlock();
+			throw;
+		}
 		// Fill the gap between the end of the current data and the index with zeros
 		memset(bytes+prevLen, 0, index-prevLen);
 	}
-
-	// Fill the byte pointed to by index with the truncated uint value of the object.
-	uint8_t value = static_cast<uint8_t>(o->toUInt() & 0xff);
 	bytes[index] = value;
-
-	o->decRef();
+	unlock();
 }
 
 void ByteArray::setVariableByMultiname_i(const multiname& name, int32_t value)
@@ -1100,53 +1197,52 @@ void ByteArray::acquireBuffer(uint8_t* buf, int bufLen)
 {
 	if(bytes)
 	{
-#ifdef MEMORY_USAGE_PROFILING
-		getClass()->memoryAccount->removeBytes(real_len);
-#endif
+		accountBytes(-int64_t(real_len));
 		free(bytes);
 	}
 	bytes=buf;
 	real_len=bufLen;
 	len=bufLen;
-#ifdef MEMORY_USAGE_PROFILING
-	getClass()->memoryAccount->addBytes(real_len);
-#endif
+	bufferChanged();
+	accountBytes(real_len);
 	position=0;
 }
 
 void ByteArray::writeU29(uint32_t val)
 {
+	uint8_t buf[4];
+	uint32_t count=0;
 	for(uint32_t i=0;i<4;i++)
 	{
-		uint8_t b;
 		if(i<3)
 		{
 			uint32_t tmp=(val >> ((3-i)*7));
 			if(tmp==0)
 				continue;
 
-			b=(tmp&0x7f)|0x80;
+			buf[count++]=(tmp&0x7f)|0x80;
 		}
 		else
-			b=val&0x7f;
-
-		writeByte(b);
+			buf[count++]=val&0x7f;
 	}
+	getBuffer(position+count,true);
+	memcpy(bytes+position,buf,count);
+	position+=count;
 }
 
 void ByteArray::serializeDouble(number_t val)
 {
 	//We have to write the double in network byte order (big endian)
-	const uint64_t* tmpPtr=reinterpret_cast<const uint64_t*>(&val);
-	uint64_t bigEndianVal=GINT64_FROM_BE(*tmpPtr);
-	uint8_t* bigEndianPtr=reinterpret_cast<uint8_t*>(&bigEndianVal);
-		
-	for(uint32_t i=0;i<8;i++)
-		writeByte(bigEndianPtr[i]);
-	
+	uint64_t tmp;
+	memcpy(&tmp,&val,8);
+	uint64_t bigEndianVal=GINT64_FROM_BE(tmp);
+
+	getBuffer(position+8,true);
+	memcpy(bytes+position,&bigEndianVal,8);
+	position+=8;
 }
 
-void ByteArray::writeStringVR(map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
+void ByteArray::writeStringVR(unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s)
 {
 	const uint32_t len=s.numBytes();
 	if(len >= 1<<28)
@@ -1194,7 +1290,7 @@ void ByteArray::writeStringAMF0(const tiny_string& s)
 	}
 }
 
-void ByteArray::writeXMLString(std::map<const ASObject*, uint32_t>& objMap,
+void ByteArray::writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap,
 			       ASObject *xml,
 			       const tiny_string& xmlstr)
 {
@@ -1236,6 +1332,7 @@ void ByteArray::removeFrontBytes(int count)
 	memmove(bytes,bytes+count,count);
 	position -= count;
 	len -= count;
+	bufferChanged();
 }
 
 
@@ -1299,15 +1396,14 @@ void ByteArray::uncompress_zlib()
 	inflateEnd(&strm);
 
 	len=strm.total_out;
-#ifdef MEMORY_USAGE_PROFILING
-	getClass()->memoryAccount->addBytes(len-real_len);
-#endif
+	accountBytes(int64_t(len)-real_len);
 	real_len = len;
 	uint8_t* bytes2=(uint8_t*) realloc(bytes, len);
 	assert_and_throw(bytes2);
 	bytes = bytes2;
 	memcpy(bytes, &buf[0], len);
 	position=0;
+	bufferChanged();
 }
 
 ASFUNCTIONBODY(ByteArray,_compress)
@@ -1358,15 +1454,14 @@ ASFUNCTIONBODY(ByteArray,clear)
 	th->lock();
 	if(th->bytes)
 	{
-#ifdef MEMORY_USAGE_PROFILING
-		th->getClass()->memoryAccount->removeBytes(th->real_len);
-#endif
+		th->accountBytes(-int64_t(th->real_len));
 		free(th->bytes);
 	}
 	th->bytes = NULL;
 	th->len=0;
 	th->real_len=0;
 	th->position=0;
+	th->bufferChanged();
 	th->unlock();
 	return NULL;
 }
@@ -1432,7 +1527,7 @@ ASFUNCTIONBODY(ByteArray,unshift)
 	th->unlock();
 	return abstract_ui(obj->getSystemState(),res);
 }
-ASFUNCTIONBODY_GETTER_SETTER(ByteArray,shareable);
+ASFUNCTIONBODY_GETTER_SETTER_CB(ByteArray,shareable,shareableChanged);
 
 ASFUNCTIONBODY(ByteArray,atomicCompareAndSwapIntAt)
 {
@@ -1482,9 +1577,9 @@ ASFUNCTIONBODY(ByteArray,_toJSON)
 	return abstract_s(getSys(),"ByteArray");
 }
 
-void ByteArray::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ByteArray::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
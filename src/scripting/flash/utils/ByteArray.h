@@ -23,6 +23,7 @@
 #include "compat.h"
 #include "swftypes.h"
 #include "scripting/flash/utils/flashutils.h"
+#include "backends/workers.h"
 
 namespace lightspark
 {
@@ -43,15 +44,36 @@ protected:
 	uint32_t len;
 	void compress_zlib();
 	void uncompress_zlib();
+	//Accounts the buffer to the memory account of the class
+	void accountBytes(int64_t change);
 	Mutex mutex;
+	//The bytes of a shareable ByteArray that has been sent to another worker
+	_NR<SharedBuffer> shared;
 	void lock();
 	void unlock();
+	//How many application domains use this ByteArray as domainMemory
+	uint32_t domainMemoryUsers;
+	//Called when bytes or len change, see domainMemoryGeneration
+	void bufferChanged()
+	{
+		if(domainMemoryUsers)
+			++domainMemoryGeneration;
+	}
+	void shareableChanged(bool oldValue) { bufferChanged(); }
 public:
+	/*
+	 * Bumped whenever a ByteArray used as domainMemory is reallocated or resized,
+	 * or an application domain is given another domainMemory. The call_contexts
+	 * cache the domain memory buffer until this changes
+	 */
+	static ATOMIC_INT32(domainMemoryGeneration);
 	ByteArray(Class_base* c, uint8_t* b = NULL, uint32_t l = 0);
 	~ByteArray();
 	//Helper interface for serialization
 	bool peekByte(uint8_t& b);
 	bool readByte(uint8_t& b);
+	/* Returns a pointer to the next count bytes and skips them, NULL if not enough data is available */
+	const uint8_t* readRawBytes(uint32_t count);
 	bool readShort(uint16_t& ret);
 	bool readUnsignedInt(uint32_t& ret);
 	bool readU29(uint32_t& ret);
@@ -62,9 +84,9 @@ public:
 	void writeUnsignedInt(uint32_t val);
 	void writeUTF(const tiny_string& str);
 	uint32_t writeObject(ASObject* obj);
-	void writeStringVR(std::map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
+	void writeStringVR(std::unordered_map<tiny_string, uint32_t>& stringMap, const tiny_string& s);
 	void writeStringAMF0(const tiny_string& s);
-	void writeXMLString(std::map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
+	void writeXMLString(std::unordered_map<const ASObject*, uint32_t>& objMap, ASObject *xml, const tiny_string& s);
 	void writeU29(uint32_t val);
 
 	void serializeDouble(number_t val);
@@ -148,6 +170,14 @@ public:
 	void acquireBuffer(uint8_t* buf, int bufLen);
 	uint8_t* getBuffer(unsigned int size, bool enableResize);
 	uint32_t getLength() const { return len; }
+	uint8_t* getBufferNoCheck() const { return bytes; }
+	bool isShareable() const { return shareable; }
+	/* Copies size bytes at addr from or to val while holding the lock, returns false if out of bounds */
+	bool copyLocked(uint32_t addr, void* val, uint32_t size, bool write);
+	/* Moves the bytes of a shareable ByteArray to a buffer shared between workers */
+	_R<SharedBuffer> getSharedBuffer();
+	/* Makes this ByteArray a view of the bytes shared by another worker */
+	void setSharedBuffer(_R<SharedBuffer> buf);
 
 	uint16_t endianIn(uint16_t value);
 	uint32_t endianIn(uint32_t value);
@@ -165,9 +195,9 @@ public:
 	void setVariableByMultiname_i(const multiname& name, int32_t value);
 	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype);
 
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 }
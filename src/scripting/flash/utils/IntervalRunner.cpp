@@ -36,7 +36,11 @@ IntervalRunner::IntervalRunner(IntervalRunner::INTERVALTYPE _type, uint32_t _id,
 {
 	args = new ASObject*[argslen];
 	for(uint32_t i=0; i<argslen; i++)
+	{
 		args[i] = _args[i];
+		//The arguments are referenced from the timer thread in tick()
+		args[i]->clearThreadConfined();
+	}
 }
 
 IntervalRunner::~IntervalRunner()
@@ -169,7 +169,7 @@ ASFUNCTIONBODY(lightspark,describeType)
 
 ASFUNCTIONBODY(lightspark,getTimer)
 {
-	uint64_t ret=compat_msectiming() - obj->getSystemState()->startTime;
+	uint64_t ret=obj->getSystemState()->getElapsedTime();
 	return abstract_i(obj->getSystemState(),ret);
 }
 
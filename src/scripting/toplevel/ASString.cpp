@@ -29,39 +29,236 @@
 using namespace std;
 using namespace lightspark;
 
-ASString::ASString(Class_base* c):ASObject(c,T_STRING),hasId(true),datafilled(true)
+ASString::ASString(Class_base* c):ASObject(c,T_STRING),sliceStart(0),sliceStartChar(0),lazyBytes(0),lazyChars(0),hasId(true),datafilled(true)
 {
 	stringId = BUILTIN_STRINGS::EMPTY;
 }
 
-ASString::ASString(Class_base* c,const string& s) : ASObject(c,T_STRING),data(s),hasId(false),datafilled(true)
+ASString::ASString(Class_base* c,const string& s) : ASObject(c,T_STRING),data(s),sliceStart(0),sliceStartChar(0),lazyBytes(0),lazyChars(0),hasId(false),datafilled(true)
 {
 }
 
-ASString::ASString(Class_base* c,const tiny_string& s) : ASObject(c,T_STRING),data(s),hasId(false),datafilled(true)
+ASString::ASString(Class_base* c,const tiny_string& s) : ASObject(c,T_STRING),data(s),sliceStart(0),sliceStartChar(0),lazyBytes(0),lazyChars(0),hasId(false),datafilled(true)
 {
 }
 
-ASString::ASString(Class_base* c,const Glib::ustring& s) : ASObject(c,T_STRING),data(s),hasId(false),datafilled(true)
+ASString::ASString(Class_base* c,const Glib::ustring& s) : ASObject(c,T_STRING),data(s),sliceStart(0),sliceStartChar(0),lazyBytes(0),lazyChars(0),hasId(false),datafilled(true)
 {
 }
 
-ASString::ASString(Class_base* c,const char* s) : ASObject(c,T_STRING),data(s, /*copy:*/true),hasId(false),datafilled(true)
+ASString::ASString(Class_base* c,const char* s) : ASObject(c,T_STRING),data(s, /*copy:*/true),sliceStart(0),sliceStartChar(0),lazyBytes(0),lazyChars(0),hasId(false),datafilled(true)
 {
 }
 
-ASString::ASString(Class_base* c,const char* s, uint32_t len) : ASObject(c,T_STRING)
+ASString::ASString(Class_base* c,const char* s, uint32_t len) : ASObject(c,T_STRING),sliceStart(0),sliceStartChar(0),lazyBytes(0),lazyChars(0)
 {
 	data = std::string(s,len);
 	hasId = false;
 	datafilled=true;
 }
 
+/* Returns a new reference to obj as a String, converting it if needed */
+static _R<ASString> toASString(ASObject* obj)
+{
+	if(obj->is<ASString>())
+	{
+		obj->incRef();
+		return _MR(obj->as<ASString>());
+	}
+	return _MR(abstract_s(obj->getSystemState(),obj->toString()));
+}
+
+void ASString::fillData()
+{
+	if(hasId)
+		data = getSystemState()->getStringFromUniqueId(stringId);
+	else if(!ropeLeft.isNull())
+		flatten();
+	else
+	{
+		assert(!sliceBase.isNull());
+		data = sliceBase->getData().substr_bytes(sliceStart,lazyBytes);
+		sliceBase.reset();
+	}
+	datafilled = true;
+}
+
+void ASString::flatten()
+{
+	std::string buf;
+	buf.reserve(lazyBytes);
+	//Visit the leaves from left to right, ropes built in loops can be very deep
+	std::vector<ASString*> pending;
+	pending.push_back(ropeRight.getPtr());
+	pending.push_back(ropeLeft.getPtr());
+	while(!pending.empty())
+	{
+		ASString* s=pending.back();
+		pending.pop_back();
+		if(!s->datafilled && !s->ropeLeft.isNull())
+		{
+			pending.push_back(s->ropeRight.getPtr());
+			pending.push_back(s->ropeLeft.getPtr());
+		}
+		else if(!s->datafilled && !s->sliceBase.isNull())
+			buf.append(s->sliceBase->getData().raw_buf()+s->sliceStart,s->lazyBytes);
+		else
+		{
+			const tiny_string& d=s->getData();
+			buf.append(d.raw_buf(),d.numBytes());
+		}
+	}
+	data = buf;
+	releaseRope();
+}
+
+void ASString::releaseRope()
+{
+	//Release deep ropes iteratively, destroying them recursively could exhaust the stack
+	std::vector<_NR<ASString>> pending;
+	if(!ropeLeft.isNull())
+		pending.push_back(ropeLeft);
+	if(!ropeRight.isNull())
+		pending.push_back(ropeRight);
+	ropeLeft.reset();
+	ropeRight.reset();
+	while(!pending.empty())
+	{
+		_NR<ASString> s=pending.back();
+		pending.pop_back();
+		//Only ropes we are the last owner of are about to be destroyed
+		if(s->isLastRef() && !s->ropeLeft.isNull())
+		{
+			pending.push_back(s->ropeLeft);
+			pending.push_back(s->ropeRight);
+			s->ropeLeft.reset();
+			s->ropeRight.reset();
+		}
+	}
+}
+
+uint32_t ASString::getNumChars()
+{
+	if(!datafilled && !hasId)
+		return lazyChars;
+	return getData().numChars();
+}
+
+uint32_t ASString::getNumBytes()
+{
+	if(!datafilled && !hasId)
+		return lazyBytes;
+	return getData().numBytes();
+}
+
+uint32_t ASString::charToByte(uint32_t idx)
+{
+	tiny_string& d=getData();
+	if(d.isAscii())
+		return idx;
+	if(idx>=d.numChars())
+		return d.numBytes();
+	const char* buf=d.raw_buf();
+	if(d.numChars()<CHAR_INDEX_STRIDE*4)
+		return g_utf8_offset_to_pointer(buf,idx)-buf;
+	if(charIndex.empty())
+	{
+		charIndex.reserve(d.numChars()/CHAR_INDEX_STRIDE+1);
+		const char* p=buf;
+		for(uint32_t i=0;i<d.numChars();i+=CHAR_INDEX_STRIDE)
+		{
+			charIndex.push_back(p-buf);
+			if(i+CHAR_INDEX_STRIDE<d.numChars())
+				p=g_utf8_offset_to_pointer(p,CHAR_INDEX_STRIDE);
+		}
+	}
+	const char* p=buf+charIndex[idx/CHAR_INDEX_STRIDE];
+	return g_utf8_offset_to_pointer(p,idx%CHAR_INDEX_STRIDE)-buf;
+}
+
+uint32_t ASString::charCodeAt(uint32_t idx)
+{
+	if(!datafilled && !sliceBase.isNull())
+		return sliceBase->charCodeAt(sliceStartChar+idx);
+	tiny_string& d=getData();
+	if(d.isAscii())
+		return d.charAt(idx);
+	return g_utf8_get_char(d.raw_buf()+charToByte(idx));
+}
+
+ASString* ASString::substring(uint32_t start, uint32_t len)
+{
+	if(!datafilled && !sliceBase.isNull())
+	{
+		if(len>lazyChars-start)
+			len=lazyChars-start;
+		return sliceBase->substring(sliceStartChar+start,len);
+	}
+	tiny_string& d=getData();
+	assert_and_throw(start <= d.numChars());
+	if(len>d.numChars()-start)
+		len=d.numChars()-start;
+	if(start==0 && len==d.numChars())
+	{
+		//Strings are immutable
+		incRef();
+		return this;
+	}
+	uint32_t bytestart=charToByte(start);
+	uint32_t byteend=charToByte(start+len);
+	if(byteend-bytestart<SLICE_MIN_BYTES)
+		return abstract_s(getSystemState(),d.substr_bytes(bytestart,byteend-bytestart));
+	ASString* ret=Class<ASString>::getInstanceSNoArgs(getSystemState());
+	incRef();
+	ret->sliceBase=_MR(this);
+	ret->sliceStart=bytestart;
+	ret->sliceStartChar=start;
+	ret->lazyBytes=byteend-bytestart;
+	ret->lazyChars=len;
+	ret->stringId=UINT32_MAX;
+	ret->hasId=false;
+	ret->datafilled=false;
+	return ret;
+}
+
+ASString* ASString::concatenate(ASString* a, ASString* b)
+{
+	if(b->isEmpty())
+	{
+		b->decRef();
+		return a;
+	}
+	if(a->isEmpty())
+	{
+		a->decRef();
+		return b;
+	}
+	SystemState* sys=a->getSystemState();
+	uint32_t bytes=a->getNumBytes()+b->getNumBytes();
+	if(bytes<ROPE_MIN_BYTES)
+	{
+		ASString* ret=abstract_s(sys,a->getData()+b->getData());
+		a->decRef();
+		b->decRef();
+		return ret;
+	}
+	ASString* ret=Class<ASString>::getInstanceSNoArgs(sys);
+	ret->lazyBytes=bytes;
+	ret->lazyChars=a->getNumChars()+b->getNumChars();
+	ret->ropeLeft=_MR(a);
+	ret->ropeRight=_MR(b);
+	ret->stringId=UINT32_MAX;
+	ret->hasId=false;
+	ret->datafilled=false;
+	return ret;
+}
+
 ASFUNCTIONBODY(ASString,_constructor)
 {
 	ASString* th=static_cast<ASString*>(obj);
 	if(args && argslen==1)
 	{
+		th->charIndex.clear();
 		th->data=args[0]->toString();
 		th->hasId = false;
 		th->stringId = UINT32_MAX;
@@ -77,7 +274,7 @@ ASFUNCTIONBODY(ASString,_getLength)
 	{
 		ASString* th = obj->as<ASString>();
 		if (th->strlength.isNull())
-			th->strlength = _MNR(abstract_i(obj->getSystemState(),th->getData().numChars()));
+			th->strlength = _MNR(abstract_i(obj->getSystemState(),th->getNumChars()));
 		th->strlength->incRef();
 		return th->strlength.getPtr();
 //		return abstract_i(obj->getSystemState(),th->getData().numChars());
@@ -406,7 +603,8 @@ ASFUNCTIONBODY(ASString,split)
 
 ASFUNCTIONBODY(ASString,substr)
 {
-	tiny_string data = obj->toString();
+	_R<ASString> str=toASString(obj);
+	int numChars=str->getNumChars();
 	int start=0;
 	if(argslen>=1)
 	{
@@ -416,12 +614,12 @@ ASFUNCTIONBODY(ASString,substr)
 			return abstract_s(obj->getSystemState());
 	}
 	if(start<0) {
-		start=data.numChars()+start;
+		start=numChars+start;
 		if(start<0)
 			start=0;
 	}
-	if(start>(int)data.numChars())
-		start=data.numChars();
+	if(start>numChars)
+		start=numChars;
 
 	int len=0x7fffffff;
 	if (argslen==2 && !args[1]->is<Undefined>())
@@ -434,24 +632,27 @@ ASFUNCTIONBODY(ASString,substr)
 		else
 			len=args[1]->toInt();
 	}
-	return abstract_s(obj->getSystemState(),data.substr(start,len));
+	if(len<0)
+		len=0;
+	return str->substring(start,len);
 }
 
 ASFUNCTIONBODY(ASString,substring)
 {
-	tiny_string data = obj->toString();
+	_R<ASString> str=toASString(obj);
+	int numChars=str->getNumChars();
 
 	number_t start, end;
 	ARG_UNPACK (start,0) (end,0x7fffffff);
 	if(start<0 || std::isnan(start))
 		start=0;
-	if(start>(int)data.numChars() || std::isinf(start))
-		start=data.numChars();
+	if(start>numChars || std::isinf(start))
+		start=numChars;
 
 	if(end<0 || std::isnan(end))
 		end=0;
-	if(end>(int)data.numChars() || std::isinf(end))
-		end=data.numChars();
+	if(end>numChars || std::isinf(end))
+		end=numChars;
 
 	if(start>end) {
 		number_t tmp=start;
@@ -459,7 +660,7 @@ ASFUNCTIONBODY(ASString,substring)
 		end=tmp;
 	}
 
-	return abstract_s(obj->getSystemState(),data.substr(start,end-start));
+	return str->substring(start,end-start);
 }
 
 number_t ASString::toNumber()
@@ -593,9 +794,9 @@ TRISTATE ASString::isLess(ASObject* r)
 	return (a<b)?TTRUE:TFALSE;
 }
 
-void ASString::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void ASString::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -611,32 +812,33 @@ void ASString::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& string
 
 ASFUNCTIONBODY(ASString,slice)
 {
-	tiny_string data = obj->toString();
+	_R<ASString> str=toASString(obj);
+	int numChars=str->getNumChars();
 	int startIndex=0;
 	if(argslen>=1)
 		startIndex=args[0]->toInt();
 	if(startIndex<0) {
-		startIndex=data.numChars()+startIndex;
+		startIndex=numChars+startIndex;
 		if(startIndex<0)
 			startIndex=0;
 	}
-	if(startIndex>(int)data.numChars())
-		startIndex=data.numChars();
+	if(startIndex>numChars)
+		startIndex=numChars;
 
 	int endIndex=0x7fffffff;
 	if(argslen>=2)
 		endIndex=args[1]->toInt();
 	if(endIndex<0) {
-		endIndex=data.numChars()+endIndex;
+		endIndex=numChars+endIndex;
 		if(endIndex<0)
 			endIndex=0;
 	}
-	if(endIndex>(int)data.numChars())
-		endIndex=data.numChars();
+	if(endIndex>numChars)
+		endIndex=numChars;
 	if(endIndex<=startIndex)
 		return abstract_s(obj->getSystemState());
 	else
-		return abstract_s(obj->getSystemState(),data.substr(startIndex,endIndex-startIndex));
+		return str->substring(startIndex,endIndex-startIndex);
 }
 
 ASFUNCTIONBODY(ASString,charAt)
@@ -646,11 +848,11 @@ ASFUNCTIONBODY(ASString,charAt)
 	// fast path if obj is ASString
 	if (obj->is<ASString>())
 	{
-		int maxIndex=obj->as<ASString>()->getData().numChars();
+		int maxIndex=obj->as<ASString>()->getNumChars();
 		
 		if(index<0 || index>=maxIndex || std::isinf(index))
 			return abstract_s(obj->getSystemState());
-		return abstract_s(obj->getSystemState(), tiny_string::fromChar(obj->as<ASString>()->getData().charAt(index)) );
+		return abstract_s(obj->getSystemState(), tiny_string::fromChar(obj->as<ASString>()->charCodeAt(index)) );
 	}
 
 	tiny_string data = obj->toString();
@@ -669,9 +871,9 @@ ASFUNCTIONBODY(ASString,charCodeAt)
 	// fast path if obj is ASString
 	if (obj->is<ASString>())
 	{
-		if(index<0 || index>=(int64_t)obj->as<ASString>()->getData().numChars())
+		if(index<0 || index>=(int64_t)obj->as<ASString>()->getNumChars())
 			return abstract_d(obj->getSystemState(),Number::NaN);
-		return abstract_i(obj->getSystemState(),obj->as<ASString>()->getData().charAt(index));
+		return abstract_i(obj->getSystemState(),obj->as<ASString>()->charCodeAt(index));
 	}
 	tiny_string data = obj->toString();
 	if(index<0 || index>=(int64_t)data.numChars())
@@ -908,14 +1110,26 @@ ASFUNCTIONBODY(ASString,replace)
 
 ASFUNCTIONBODY(ASString,concat)
 {
-	tiny_string data = obj->toString();
-	ASString* ret=abstract_s(obj->getSystemState(),data);
+	ASString* ret;
+	if(obj->is<ASString>())
+	{
+		obj->incRef();
+		ret=obj->as<ASString>();
+	}
+	else
+		ret=abstract_s(obj->getSystemState(),obj->toString());
 	for(unsigned int i=0;i<argslen;i++)
 	{
-		ret->hasId = false;
-		ret->getData()+=args[i]->toString().raw_buf();
+		ASString* arg;
+		if(args[i]->is<ASString>())
+		{
+			args[i]->incRef();
+			arg=args[i]->as<ASString>();
+		}
+		else
+			arg=abstract_s(obj->getSystemState(),args[i]->toString());
+		ret=concatenate(ret,arg);
 	}
-
 	return ret;
 }
 
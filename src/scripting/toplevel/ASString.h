@@ -41,6 +41,30 @@ private:
 	number_t parseStringInfinite(const char *s, char **end) const;
 	tiny_string data;
 	_NR<ASObject> strlength;
+	/*
+	 * Results of long concatenations and substrings are not copied immediately.
+	 * A rope references the two strings it is made of, a slice references the
+	 * (flat) string it is part of. data is built by fillData on the first access.
+	 */
+	_NR<ASString> ropeLeft;
+	_NR<ASString> ropeRight;
+	_NR<ASString> sliceBase;
+	//Offset of the slice inside sliceBase, in bytes and in characters
+	uint32_t sliceStart;
+	uint32_t sliceStartChar;
+	//Sizes of the rope or slice when data is not filled
+	uint32_t lazyBytes;
+	uint32_t lazyChars;
+	//Byte offset of every CHAR_INDEX_STRIDE-th character, only built for long non ASCII strings
+	std::vector<uint32_t> charIndex;
+	void fillData();
+	void flatten();
+	void releaseRope();
+	uint32_t charToByte(uint32_t idx);
+	/* Shorter results are copied immediately */
+	static const uint32_t ROPE_MIN_BYTES = 256;
+	static const uint32_t SLICE_MIN_BYTES = 256;
+	static const uint32_t CHAR_INDEX_STRIDE = 64;
 public:
 	ASString(Class_base* c);
 	ASString(Class_base* c, const std::string& s);
@@ -53,18 +77,26 @@ public:
 	inline tiny_string& getData()
 	{
 		if (!datafilled)
-		{
-			data = getSystemState()->getStringFromUniqueId(stringId);
-			datafilled = true;
-		}
+			fillData();
 		return data;
 	}
 	inline bool isEmpty() const
 	{
 		if (hasId)
 			return stringId == BUILTIN_STRINGS::EMPTY || stringId == UINT32_MAX;
+		if (!datafilled)
+			return lazyBytes == 0;
 		return data.empty();
 	}
+	/* These do not flatten ropes or copy slices */
+	uint32_t getNumChars();
+	uint32_t getNumBytes();
+	/* idx is an index of characters and must be less than getNumChars() */
+	uint32_t charCodeAt(uint32_t idx);
+	/* start and len are indices of characters, like tiny_string::substr */
+	ASString* substring(uint32_t start, uint32_t len);
+	/* Returns the concatenation of a and b, the references are consumed */
+	static ASString* concatenate(ASString* a, ASString* b);
 
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o);
@@ -97,9 +129,9 @@ public:
 	
 	ASFUNCTION(generator);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	std::string toDebugString() { return std::string("\"") + std::string(getData()) + "\""; }
 	static bool isEcmaSpace(uint32_t c);
 	static bool isEcmaLineTerminator(uint32_t c);
@@ -107,6 +139,9 @@ public:
 	{ 
 		data.clear(); 
 		strlength.reset();
+		releaseRope();
+		sliceBase.reset();
+		charIndex.clear();
 		hasId = false;
 		datafilled=false; 
 		if (!ASObject::destruct())
@@ -72,6 +72,8 @@ bool XML::destruct()
 	isAttribute = false;
 	constructed = false;
 	childrenlist.reset();
+	pendingDoc.reset();
+	pendingNode=pugi::xml_node();
 	nodename.clear();
 	nodevalue.clear();
 	nodenamespace_uri=BUILTIN_STRINGS::EMPTY;
@@ -366,7 +368,7 @@ void XML::appendChild(_R<XML> newChild)
 		}
 		this->incRef();
 		newChild->parentNode = _NR<XML>(this);
-		childrenlist->append(newChild);
+		loadedChildren()->append(newChild);
 	}
 	else
 		newChild->decRef();
@@ -615,7 +617,7 @@ const tiny_string XML::toXMLString_internal(bool pretty, uint32_t defaultnsprefi
 						res += "\"";
 					}
 				}
-				if (childrenlist.isNull() || childrenlist->nodes.size() == 0)
+				if (loadedChildren().isNull() || loadedChildren()->nodes.size() == 0)
 				{
 					res += "/>";
 					break;
@@ -623,10 +625,10 @@ const tiny_string XML::toXMLString_internal(bool pretty, uint32_t defaultnsprefi
 				res += ">";
 				tiny_string newindent;
 				bool bindent = (pretty && prettyPrinting && prettyIndent >=0 && 
-								!childrenlist.isNull() &&
-								(childrenlist->nodes.size() >1 || 
-								 (!childrenlist->nodes[0]->procinstlist.isNull()) ||
-								 (childrenlist->nodes[0]->nodetype != pugi::node_pcdata && childrenlist->nodes[0]->nodetype != pugi::node_cdata)));
+								!loadedChildren().isNull() &&
+								(loadedChildren()->nodes.size() >1 || 
+								 (!loadedChildren()->nodes[0]->procinstlist.isNull()) ||
+								 (loadedChildren()->nodes[0]->nodetype != pugi::node_pcdata && loadedChildren()->nodes[0]->nodetype != pugi::node_cdata)));
 				if (bindent)
 				{
 					newindent = indent;
@@ -635,11 +637,11 @@ const tiny_string XML::toXMLString_internal(bool pretty, uint32_t defaultnsprefi
 						newindent += " ";
 					}
 				}
-				if (!childrenlist.isNull())
+				if (!loadedChildren().isNull())
 				{
-					for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
+					for (uint32_t i = 0; i < loadedChildren()->nodes.size(); i++)
 					{
-						_R<XML> child= childrenlist->nodes[i];
+						_R<XML> child= loadedChildren()->nodes[i];
 						tiny_string tmpres = child->toXMLString_internal(pretty,defaultnsprefix,newindent.raw_buf(),false);
 						if (bindent && !tmpres.empty())
 							res += "\n";
@@ -693,11 +695,11 @@ ASFUNCTIONBODY(XML,toXMLString)
 
 void XML::childrenImpl(XMLVector& ret, const tiny_string& name)
 {
-	if (!childrenlist.isNull())
+	if (!loadedChildren().isNull())
 	{
-		for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
+		for (uint32_t i = 0; i < loadedChildren()->nodes.size(); i++)
 		{
-			_R<XML> child= childrenlist->nodes[i];
+			_R<XML> child= loadedChildren()->nodes[i];
 			if(name!="*" && child->nodename != name)
 				continue;
 			child->incRef();
@@ -708,9 +710,9 @@ void XML::childrenImpl(XMLVector& ret, const tiny_string& name)
 
 void XML::childrenImpl(XMLVector& ret, uint32_t index)
 {
-	if (constructed && !childrenlist.isNull() && index < childrenlist->nodes.size())
+	if (constructed && !loadedChildren().isNull() && index < loadedChildren()->nodes.size())
 	{
-		_R<XML> child= childrenlist->nodes[index];
+		_R<XML> child= loadedChildren()->nodes[index];
 		child->incRef();
 		ret.push_back(child);
 	}
@@ -753,12 +755,12 @@ ASFUNCTIONBODY(XML,children)
 ASFUNCTIONBODY(XML,childIndex)
 {
 	XML* th=Class<XML>::cast(obj);
-	if (th->parentNode && !th->parentNode->childrenlist.isNull())
+	if (th->parentNode && !th->parentNode->loadedChildren().isNull())
 	{
 		XML* parent = th->parentNode.getPtr();
-		for (uint32_t i = 0; i < parent->childrenlist->nodes.size(); i++)
+		for (uint32_t i = 0; i < parent->loadedChildren()->nodes.size(); i++)
 		{
-			ASObject* o= parent->childrenlist->nodes[i].getPtr();
+			ASObject* o= parent->loadedChildren()->nodes[i].getPtr();
 			if (o == th)
 				return abstract_i(obj->getSystemState(),i);
 		}
@@ -786,11 +788,11 @@ ASFUNCTIONBODY(XML,valueOf)
 
 void XML::getText(XMLVector& ret)
 {
-	if (childrenlist.isNull())
+	if (loadedChildren().isNull())
 		return;
-	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
+	for (uint32_t i = 0; i < loadedChildren()->nodes.size(); i++)
 	{
-		_R<XML> child= childrenlist->nodes[i];
+		_R<XML> child= loadedChildren()->nodes[i];
 		if (child->getNodeKind() == pugi::node_pcdata  ||
 			child->getNodeKind() == pugi::node_cdata)
 		{
@@ -824,11 +826,11 @@ ASFUNCTIONBODY(XML,elements)
 
 void XML::getElementNodes(const tiny_string& name, XMLVector& foundElements)
 {
-	if (childrenlist.isNull())
+	if (loadedChildren().isNull())
 		return;
-	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
+	for (uint32_t i = 0; i < loadedChildren()->nodes.size(); i++)
 	{
-		_R<XML> child= childrenlist->nodes[i];
+		_R<XML> child= loadedChildren()->nodes[i];
 		if(child->nodetype==pugi::node_element && (name.empty() || name == child->nodename))
 		{
 			child->incRef();
@@ -870,6 +872,8 @@ ASFUNCTIONBODY(XML,addNamespace)
 	XML *th = obj->as<XML>();
 	_NR<ASObject> newNamespace;
 	ARG_UNPACK(newNamespace);
+	//The namespaces of the descendants are resolved when they are created
+	th->loadSubtree();
 
 
 	uint32_t ns_uri = BUILTIN_STRINGS::EMPTY;
@@ -1027,6 +1031,7 @@ ASFUNCTIONBODY(XML,_setNamespace)
 	XML *th = obj->as<XML>();
 	_NR<ASObject> newNamespace;
 	ARG_UNPACK(newNamespace);
+	th->loadSubtree();
 
 	if(th->nodetype==pugi::node_pcdata ||
 	   th->nodetype==pugi::node_comment ||
@@ -1092,6 +1097,7 @@ ASFUNCTIONBODY(XML,_setNamespace)
 
 void XML::setNamespace(uint32_t ns_uri, uint32_t ns_prefix)
 {
+	loadSubtree();
 	this->nodenamespace_prefix = ns_prefix;
 	this->nodenamespace_uri = ns_uri;
 }
@@ -1113,7 +1119,7 @@ ASFUNCTIONBODY(XML,_setChildren)
 	_NR<ASObject> newChildren;
 	ARG_UNPACK(newChildren);
 
-	th->childrenlist->clear();
+	th->loadedChildren()->clear();
 
 	if (newChildren->is<XML>())
 	{
@@ -1147,7 +1153,7 @@ ASFUNCTIONBODY(XML,_normalize)
 
 void XML::normalize()
 {
-	childrenlist->normalize();
+	loadedChildren()->normalize();
 }
 
 void XML::addTextContent(const tiny_string& str)
@@ -1175,11 +1181,11 @@ bool XML::hasSimpleContent() const
 	if (getNodeKind() == pugi::node_comment ||
 		getNodeKind() == pugi::node_pi)
 		return false;
-	if (childrenlist.isNull())
+	if (loadedChildren().isNull())
 		return true;
-	for(size_t i=0; i<childrenlist->nodes.size(); i++)
+	for(size_t i=0; i<loadedChildren()->nodes.size(); i++)
 	{
-		if (childrenlist->nodes[i]->getNodeKind() == pugi::node_element)
+		if (loadedChildren()->nodes[i]->getNodeKind() == pugi::node_element)
 			return false;
 	}
 	return true;
@@ -1212,7 +1218,9 @@ void XML::getDescendantsByQName(const tiny_string& name, uint32_t ns, bool bIsAt
 			}
 		}
 	}
-	if (childrenlist.isNull())
+	if (!pendingSubtreeMayMatch(name, bIsAttribute))
+		return;
+	if (loadedChildren().isNull())
 		return;
 	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
 	{
@@ -1487,7 +1495,7 @@ _NR<ASObject> XML::getVariableByMultiname(const multiname& name, GET_VARIABLE_OP
 		}
 		else
 		{
-			const XMLVector& ret=getValuesByMultiname(childrenlist,name);
+			const XMLVector& ret=getValuesByMultiname(loadedChildren(),name);
 			if(ret.empty() && (opt & XML_STRICT)!=0)
 				return NullRef;
 			
@@ -1528,7 +1536,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 		isAttr=true;
 		buf+=1;
 	}
-	if (childrenlist.isNull())
+	if (loadedChildren().isNull())
 		childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 	
 	if(isAttr)
@@ -1580,15 +1588,15 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 	}
 	else if(XML::isValidMultiname(getSystemState(),name,index))
 	{
-		childrenlist->setVariableByMultiname(name,o,allowConst);
+		loadedChildren()->setVariableByMultiname(name,o,allowConst);
 	}
 	else
 	{
 		bool found = false;
 		XMLVector tmpnodes;
-		while (!childrenlist->nodes.empty())
+		while (!loadedChildren()->nodes.empty())
 		{
-			_R<XML> tmpnode = childrenlist->nodes.back();
+			_R<XML> tmpnode = loadedChildren()->nodes.back();
 			if (tmpnode->nodenamespace_uri == ns_uri && tmpnode->nodename == normalizedName)
 			{
 				if(o->is<XMLList>())
@@ -1612,8 +1620,8 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 						tmp->nodenamespace_prefix = BUILTIN_STRINGS::EMPTY;
 						tmp->nodevalue = o->toString();
 						tmp->constructed = true;
-						tmpnode->childrenlist->clear();
-						tmpnode->childrenlist->append(tmp);
+						tmpnode->loadedChildren()->clear();
+						tmpnode->loadedChildren()->append(tmp);
 						if (!found)
 							tmpnodes.push_back(tmpnode);
 					}
@@ -1629,15 +1637,15 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 				}
 				else
 				{
-					if (tmpnode->childrenlist.isNull())
+					if (tmpnode->loadedChildren().isNull())
 						tmpnode->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 					
-					if (tmpnode->childrenlist->nodes.size() == 1 && tmpnode->childrenlist->nodes[0]->nodetype == pugi::node_pcdata)
-						tmpnode->childrenlist->nodes[0]->nodevalue = o->toString();
+					if (tmpnode->loadedChildren()->nodes.size() == 1 && tmpnode->loadedChildren()->nodes[0]->nodetype == pugi::node_pcdata)
+						tmpnode->loadedChildren()->nodes[0]->nodevalue = o->toString();
 					else
 					{
 						XML* newnode = createFromString(this->getSystemState(),o->toString());
-						tmpnode->childrenlist->clear();
+						tmpnode->loadedChildren()->clear();
 						tmpnode->setVariableByMultiname(name,newnode,allowConst);
 					}
 					if (!found)
@@ -1653,7 +1661,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 				tmpnode->incRef();
 				tmpnodes.push_back(tmpnode);
 			}
-			childrenlist->nodes.pop_back();
+			loadedChildren()->nodes.pop_back();
 		}
 		if (!found)
 		{
@@ -1697,7 +1705,7 @@ void XML::setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOW
 				tmpnodes.push_back(tmp);
 			}
 		}
-		childrenlist->nodes.insert(childrenlist->nodes.begin(), tmpnodes.rbegin(),tmpnodes.rend());
+		loadedChildren()->nodes.insert(loadedChildren()->nodes.begin(), tmpnodes.rbegin(),tmpnodes.rend());
 	}
 }
 
@@ -1755,9 +1763,9 @@ bool XML::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bo
 	else
 	{
 		//Lookup children
-		for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
+		for (uint32_t i = 0; i < loadedChildren()->nodes.size(); i++)
 		{
-			_R<XML> child= childrenlist->nodes[i];
+			_R<XML> child= loadedChildren()->nodes[i];
 			bool name_match=(child->nodename == buf);
 			bool ns_match=ns_uri==BUILTIN_STRINGS::EMPTY || 
 				(child->nodenamespace_uri == ns_uri);
@@ -1806,8 +1814,8 @@ bool XML::deleteVariableByMultiname(const multiname& name)
 	}
 	else if(XML::isValidMultiname(getSystemState(),name,index))
 	{
-		if (!childrenlist.isNull())
-			childrenlist->nodes.erase(childrenlist->nodes.begin() + index);
+		if (!loadedChildren().isNull())
+			loadedChildren()->nodes.erase(loadedChildren()->nodes.begin() + index);
 	}
 	else
 	{
@@ -1818,10 +1826,10 @@ bool XML::deleteVariableByMultiname(const multiname& name)
 			assert_and_throw(name.ns[0].kind==NAMESPACE);
 			ns_uri=name.ns[0].nsNameId;
 		}
-		if (!childrenlist.isNull() && childrenlist->nodes.size() > 0)
+		if (!loadedChildren().isNull() && loadedChildren()->nodes.size() > 0)
 		{
-			XMLList::XMLListVector::iterator it = childrenlist->nodes.end();
-			while (it != childrenlist->nodes.begin())
+			XMLList::XMLListVector::iterator it = loadedChildren()->nodes.end();
+			while (it != loadedChildren()->nodes.begin())
 			{
 				it--;
 				_R<XML> node = *it;
@@ -1830,7 +1838,7 @@ bool XML::deleteVariableByMultiname(const multiname& name)
 						(node->nodenamespace_uri == ns_uri && name.normalizedName(getSystemState()) == "") ||
 						(node->nodenamespace_uri == ns_uri && node->nodename == name.normalizedName(getSystemState())))
 				{
-					childrenlist->nodes.erase(it);
+					loadedChildren()->nodes.erase(it);
 				}
 			}
 		}
@@ -1877,6 +1885,7 @@ uint32_t XML::getNamespacePrefixByURI(uint32_t uri, bool create)
 
 	if(!found && create)
 	{
+		loadSubtree();
 		nodenamespace_uri = uri;
 	}
 
@@ -2048,9 +2057,9 @@ void XML::CheckCyclicReference(XML* node)
 	XML* tmp = node;
 	if (tmp == this)
 		throwError<TypeError>(kXMLIllegalCyclicalLoop);
-	if (!childrenlist.isNull())
+	if (!loadedChildren().isNull())
 	{
-		for (auto it = tmp->childrenlist->nodes.begin(); it != tmp->childrenlist->nodes.end(); it++)
+		for (auto it = tmp->loadedChildren()->nodes.begin(); it != tmp->loadedChildren()->nodes.end(); it++)
 		{
 			if ((*it).getPtr() == this)
 				throwError<TypeError>(kXMLIllegalCyclicalLoop);
@@ -2066,7 +2075,7 @@ XML *XML::createFromString(SystemState* sys, const tiny_string &s)
 	return res;
 }
 
-XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList)
+XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList, XMLDocumentStore* doc)
 {
 	XML* res = Class<XML>::getInstanceSNoArgs(parent ? parent->getSystemState() : getSys());
 	if (parent)
@@ -2074,10 +2083,73 @@ XML *XML::createFromNode(const pugi::xml_node &_n, XML *parent, bool fromXMLList
 		parent->incRef();
 		res->parentNode = _NR<XML>(parent);
 	}
-	res->createTree(_n,fromXMLList);
+	res->createTree(_n,fromXMLList,doc);
 	return res;
 }
 
+void XML::loadPendingChildren() const
+{
+	//Keep the document alive while the children are created
+	_NR<XMLDocumentStore> doc = pendingDoc;
+	pugi::xml_node node = pendingNode;
+	pendingDoc.reset();
+	pendingNode = pugi::xml_node();
+	XML* th = const_cast<XML*>(this);
+	for (pugi::xml_node_iterator it=node.begin(); it!=node.end(); ++it)
+		childrenlist->append(_MR(XML::createFromNode(*it,th,false,doc.getPtr())));
+}
+
+void XML::loadSubtree() const
+{
+	if (loadedChildren().isNull())
+		return;
+	for (uint32_t i = 0; i < childrenlist->nodes.size(); i++)
+		childrenlist->nodes[i]->loadSubtree();
+}
+
+/*
+ * Checks the parsed document to avoid creating the children of a subtree
+ * that does not contain the name. Namespaces are checked on the created nodes
+ */
+bool XML::pendingSubtreeMayMatch(const tiny_string& name, bool bIsAttribute) const
+{
+	if (pendingDoc.isNull() || name=="" || name=="*")
+		return true;
+	pugi::xml_node cur = pendingNode.first_child();
+	while (cur && cur != pendingNode)
+	{
+		if (cur.type() == pugi::node_element)
+		{
+			if (bIsAttribute)
+			{
+				for (pugi::xml_attribute_iterator itattr = cur.attributes_begin(); itattr != cur.attributes_end(); ++itattr)
+				{
+					const char* aname = itattr->name();
+					const char* sep = strchr(aname,':');
+					if (name == (sep ? sep+1 : aname))
+						return true;
+				}
+			}
+			else
+			{
+				const char* sep = strchr(cur.name(),':');
+				if (name == (sep ? sep+1 : cur.name()))
+					return true;
+			}
+		}
+		if (cur.first_child())
+			cur = cur.first_child();
+		else
+		{
+			while (!cur.next_sibling() && cur != pendingNode)
+				cur = cur.parent();
+			if (cur != pendingNode)
+				cur = cur.next_sibling();
+		}
+	}
+	return false;
+}
+
 ASFUNCTIONBODY(XML,insertChildAfter)
 {
 	XML* th=Class<XML>::cast(obj);
@@ -2098,7 +2170,7 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 	}
 	else
 		child2 = _NR<XML>(createFromString(obj->getSystemState(),child2->toString()));
-	if (th->childrenlist.isNull())
+	if (th->loadedChildren().isNull())
 		th->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(obj->getSystemState()));
 	if (child1->is<Null>())
 	{
@@ -2108,7 +2180,7 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 			th->incRef();
 			child2->incRef();
 			child2->as<XML>()->parentNode = _NR<XML>(th);
-			th->childrenlist->nodes.insert(th->childrenlist->nodes.begin(),_NR<XML>(child2->as<XML>()));
+			th->loadedChildren()->nodes.insert(th->loadedChildren()->nodes.begin(),_NR<XML>(child2->as<XML>()));
 		}
 		else if (child2->is<XMLList>())
 		{
@@ -2118,7 +2190,7 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 				(*it2)->incRef();
 				(*it2)->parentNode = _NR<XML>(th);
 			}
-			th->childrenlist->nodes.insert(th->childrenlist->nodes.begin(),child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
+			th->loadedChildren()->nodes.insert(th->loadedChildren()->nodes.begin(),child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
 		}
 		th->incRef();
 		return th;
@@ -2129,7 +2201,7 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 			return obj->getSystemState()->getUndefinedRef();
 		child1 = child1->as<XMLList>()->nodes[0];
 	}
-	for (auto it = th->childrenlist->nodes.begin(); it != th->childrenlist->nodes.end(); it++)
+	for (auto it = th->loadedChildren()->nodes.begin(); it != th->loadedChildren()->nodes.end(); it++)
 	{
 		if ((*it).getPtr() == child1.getPtr())
 		{
@@ -2139,7 +2211,7 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 				th->incRef();
 				child2->incRef();
 				child2->as<XML>()->parentNode = _NR<XML>(th);
-				th->childrenlist->nodes.insert(it+1,_NR<XML>(child2->as<XML>()));
+				th->loadedChildren()->nodes.insert(it+1,_NR<XML>(child2->as<XML>()));
 			}
 			else if (child2->is<XMLList>())
 			{
@@ -2149,7 +2221,7 @@ ASFUNCTIONBODY(XML,insertChildAfter)
 					(*it2)->incRef();
 					(*it2)->parentNode = _NR<XML>(th);
 				}
-				th->childrenlist->nodes.insert(it+1,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
+				th->loadedChildren()->nodes.insert(it+1,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
 			}
 			return th;
 		}
@@ -2177,7 +2249,7 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 	else
 		child2 = _NR<XML>(createFromString(obj->getSystemState(),child2->toString()));
 
-	if (th->childrenlist.isNull())
+	if (th->loadedChildren().isNull())
 		th->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(obj->getSystemState()));
 	if (child1->is<Null>())
 	{
@@ -2192,7 +2264,7 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 				th->incRef();
 				(*it)->incRef();
 				(*it)->parentNode = _NR<XML>(th);
-				th->childrenlist->nodes.push_back(_NR<XML>(*it));
+				th->loadedChildren()->nodes.push_back(_NR<XML>(*it));
 			}
 		}
 		th->incRef();
@@ -2204,7 +2276,7 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 			return obj->getSystemState()->getUndefinedRef();
 		child1 = child1->as<XMLList>()->nodes[0];
 	}
-	for (auto it = th->childrenlist->nodes.begin(); it != th->childrenlist->nodes.end(); it++)
+	for (auto it = th->loadedChildren()->nodes.begin(); it != th->loadedChildren()->nodes.end(); it++)
 	{
 		if ((*it).getPtr() == child1.getPtr())
 		{
@@ -2214,7 +2286,7 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 				th->incRef();
 				child2->incRef();
 				child2->as<XML>()->parentNode = _NR<XML>(th);
-				th->childrenlist->nodes.insert(it,_NR<XML>(child2->as<XML>()));
+				th->loadedChildren()->nodes.insert(it,_NR<XML>(child2->as<XML>()));
 			}
 			else if (child2->is<XMLList>())
 			{
@@ -2224,7 +2296,7 @@ ASFUNCTIONBODY(XML,insertChildBefore)
 					(*it2)->incRef();
 					(*it2)->parentNode = _NR<XML>(th);
 				}
-				th->childrenlist->nodes.insert(it,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
+				th->loadedChildren()->nodes.insert(it,child2->as<XMLList>()->nodes.begin(), child2->as<XMLList>()->nodes.end());
 			}
 			return th;
 		}
@@ -2266,6 +2338,7 @@ ASFUNCTIONBODY(XML,removeNamespace)
 }
 void XML::RemoveNamespace(Namespace *ns)
 {
+	loadSubtree();
 	if (this->nodenamespace_uri == ns->getURI())
 	{
 		this->nodenamespace_uri = BUILTIN_STRINGS::EMPTY;
@@ -2280,9 +2353,9 @@ void XML::RemoveNamespace(Namespace *ns)
 			break;
 		}
 	}
-	if (childrenlist)
+	if (loadedChildren())
 	{
-		for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
+		for (auto it = loadedChildren()->nodes.begin(); it != loadedChildren()->nodes.end(); it++)
 		{
 			(*it)->RemoveNamespace(ns);
 		}
@@ -2300,9 +2373,9 @@ ASFUNCTIONBODY(XML,comments)
 }
 void XML::getComments(XMLVector& ret)
 {
-	if (childrenlist)
+	if (loadedChildren())
 	{
-		for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
+		for (auto it = loadedChildren()->nodes.begin(); it != loadedChildren()->nodes.end(); it++)
 		{
 			if ((*it)->getNodeKind() == pugi::node_comment)
 			{
@@ -2324,9 +2397,9 @@ ASFUNCTIONBODY(XML,processingInstructions)
 }
 void XML::getprocessingInstructions(XMLVector& ret, tiny_string name)
 {
-	if (childrenlist)
+	if (loadedChildren())
 	{
-		for (auto it = childrenlist->nodes.begin(); it != childrenlist->nodes.end(); it++)
+		for (auto it = loadedChildren()->nodes.begin(); it != loadedChildren()->nodes.end(); it++)
 		{
 			if ((*it)->getNodeKind() == pugi::node_pi && (name == "*" || name == (*it)->nodename))
 			{
@@ -2377,10 +2450,10 @@ tiny_string XML::toString_priv()
 	}
 	else if (hasSimpleContent())
 	{
-		if (!childrenlist.isNull())
+		if (!loadedChildren().isNull())
 		{
-			auto it = childrenlist->nodes.begin();
-			while(it != childrenlist->nodes.end())
+			auto it = loadedChildren()->nodes.begin();
+			while(it != loadedChildren()->nodes.end())
 			{
 				if ((*it)->getNodeKind() != pugi::node_comment &&
 						(*it)->getNodeKind() != pugi::node_pi)
@@ -2401,6 +2474,11 @@ bool XML::getPrettyPrinting()
 	return prettyPrinting;
 }
 
+bool XML::getIgnoreWhitespace()
+{
+	return ignoreWhitespace;
+}
+
 unsigned int XML::getParseMode()
 {
 	unsigned int parsemode = pugi::parse_cdata | pugi::parse_escapes|pugi::parse_fragment | pugi::parse_doctype |pugi::parse_pi|pugi::parse_declaration;
@@ -2508,12 +2586,12 @@ bool XML::nodesEqual(XML *a, XML *b) const
 	}
 	
 	// children
-	if (a->childrenlist.isNull())
-		return b->childrenlist.isNull() || b->childrenlist->nodes.size() == 0;
-	if (b->childrenlist.isNull())
-		return a->childrenlist.isNull() || a->childrenlist->nodes.size() == 0;
+	if (a->loadedChildren().isNull())
+		return b->loadedChildren().isNull() || b->loadedChildren()->nodes.size() == 0;
+	if (b->loadedChildren().isNull())
+		return a->loadedChildren().isNull() || a->loadedChildren()->nodes.size() == 0;
 	
-	return a->childrenlist->isEqual(b->childrenlist.getPtr());
+	return a->loadedChildren()->isEqual(b->loadedChildren().getPtr());
 }
 
 uint32_t XML::nextNameIndex(uint32_t cur_index)
@@ -2559,9 +2637,9 @@ bool XML::isEqual(ASObject* r)
 	return false;
 }
 
-void XML::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-		    std::map<const ASObject*, uint32_t>& objMap,
-		    std::map<const Class_base*, uint32_t>& traitsMap)
+void XML::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+		    std::unordered_map<const ASObject*, uint32_t>& objMap,
+		    std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 	{
@@ -2573,12 +2651,19 @@ void XML::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
 	out->writeXMLString(objMap, this, toString());
 }
 
-void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
+void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList,XMLDocumentStore* doc)
 {
 	pugi::xml_node node = rootnode;
 	bool done = false;
 	this->childrenlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 	this->childrenlist->incRef();
+	//A document parsed by this object, its children can be created lazily
+	if (doc == NULL && !xmldoc.isNull())
+	{
+		doc = xmldoc.getPtr();
+		doc->ignoreWhitespace = ignoreWhitespace;
+	}
+	bool stripWhitespace = doc ? doc->ignoreWhitespace : ignoreWhitespace;
 	if (parentNode.isNull() && !fromXMLList)
 	{
 		while (true)
@@ -2587,17 +2672,17 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 			switch (node.type())
 			{
 				case pugi::node_null: // Empty (null) node handle
-					fillNode(this,node);
+					fillNode(this,node,stripWhitespace);
 					done = true;
 					break;
 				case pugi::node_document:// A document tree's absolute root
-					createTree(node.first_child(),fromXMLList);
+					createTree(node.first_child(),fromXMLList,doc);
 					return;
 				case pugi::node_pi:	// Processing instruction, i.e. '<?name?>'
 				case pugi::node_declaration: // Document declaration, i.e. '<?xml version="1.0"?>'
 				{
 					_NR<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
-					fillNode(tmp.getPtr(),node);
+					fillNode(tmp.getPtr(),node,stripWhitespace);
 					if(this->procinstlist.isNull())
 						this->procinstlist = _MR(Class<XMLList>::getInstanceSNoArgs(getSystemState()));
 					this->procinstlist->incRef();
@@ -2605,19 +2690,27 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 					break;
 				}
 				case pugi::node_doctype:// Document type declaration, i.e. '<!DOCTYPE doc>'
-					fillNode(this,node);
+					fillNode(this,node,stripWhitespace);
 					break;
 				case pugi::node_pcdata: // Plain character data, i.e. 'text'
 				case pugi::node_cdata: // Character data, i.e. '<![CDATA[text]]>'
-					fillNode(this,node);
+					fillNode(this,node,stripWhitespace);
 					done = true;
 					break;
 				case pugi::node_comment: // Comment tag, i.e. '<!-- text -->'
-					fillNode(this,node);
+					fillNode(this,node,stripWhitespace);
 					break;
 				case pugi::node_element: // Element tag, i.e. '<node/>'
 				{
-					fillNode(this,node);
+					fillNode(this,node,stripWhitespace);
+					if (doc)
+					{
+						doc->incRef();
+						pendingDoc = _MR(doc);
+						pendingNode = node;
+						done = true;
+						break;
+					}
 					pugi::xml_node_iterator it=node.begin();
 					while(it!=node.end())
 					{
@@ -2650,11 +2743,18 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 			case pugi::node_pcdata: // Plain character data, i.e. 'text'
 			case pugi::node_cdata: // Character data, i.e. '<![CDATA[text]]>'
 			case pugi::node_comment: // Comment tag, i.e. '<!-- text -->'
-				fillNode(this,node);
+				fillNode(this,node,stripWhitespace);
 				break;
 			case pugi::node_element: // Element tag, i.e. '<node/>'
 			{
-				fillNode(this,node);
+				fillNode(this,node,stripWhitespace);
+				if (doc)
+				{
+					doc->incRef();
+					pendingDoc = _MR(doc);
+					pendingNode = node;
+					break;
+				}
 				pugi::xml_node_iterator it=node.begin();
 				{
 					while(it!=node.end())
@@ -2673,7 +2773,7 @@ void XML::createTree(const pugi::xml_node& rootnode,bool fromXMLList)
 	}
 }
 
-void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
+void XML::fillNode(XML* node, const pugi::xml_node &srcnode, bool stripWhitespace)
 {
 	if (node->childrenlist.isNull())
 	{
@@ -2687,7 +2787,7 @@ void XML::fillNode(XML* node, const pugi::xml_node &srcnode)
 		node->nodenamespace_uri = node->parentNode->nodenamespace_uri;
 	else
 		node->nodenamespace_uri = getVm(node->getSystemState())->getDefaultXMLNamespaceID();
-	if (ignoreWhitespace && node->nodetype == pugi::node_pcdata)
+	if (stripWhitespace && node->nodetype == pugi::node_pcdata)
 		node->nodevalue = node->removeWhitespace(node->nodevalue);
 	node->attributelist = _MR(Class<XMLList>::getInstanceSNoArgs(node->getSystemState()));
 	pugi::xml_attribute_iterator itattr;
@@ -2837,7 +2937,7 @@ void XML::prependChild(_R<XML> newChild)
 		}
 		this->incRef();
 		newChild->parentNode = _NR<XML>(this);
-		childrenlist->prepend(newChild);
+		loadedChildren()->prepend(newChild);
 	}
 	else
 		newChild->decRef();
@@ -2861,22 +2961,22 @@ ASFUNCTIONBODY(XML,_replace)
 	{
 		if (value->is<XMLList>())
 		{
-			th->childrenlist->decRef();
+			th->loadedChildren()->decRef();
 			value->incRef();
 			th->childrenlist = _NR<XMLList>(value->as<XMLList>());
 		}
 		else if (value->is<XML>())
 		{
-			th->childrenlist->clear();
+			th->loadedChildren()->clear();
 			value->incRef();
-			th->childrenlist->append(_R<XML>(value->as<XML>()));
+			th->loadedChildren()->append(_R<XML>(value->as<XML>()));
 		}
 		else
 		{
 			XML* x = createFromString(obj->getSystemState(),value->toString());
 			x->incRef();
-			th->childrenlist->clear();
-			th->childrenlist->append(_R<XML>(x));
+			th->loadedChildren()->clear();
+			th->loadedChildren()->append(_R<XML>(x));
 		}
 		th->incRef();
 		return th;
@@ -2889,7 +2989,7 @@ ASFUNCTIONBODY(XML,_replace)
 	uint32_t index=0;
 	if(XML::isValidMultiname(obj->getSystemState(),name,index))
 	{
-		th->childrenlist->setVariableByMultiname(name,value.getPtr(),CONST_NOT_ALLOWED);
+		th->loadedChildren()->setVariableByMultiname(name,value.getPtr(),CONST_NOT_ALLOWED);
 	}	
 	else if (th->hasPropertyByMultiname(name,true,false))
 	{
@@ -33,7 +33,14 @@ public:
 	typedef std::vector<_R<XML>> XMLVector;
 	typedef std::vector<_R<Namespace>> NSVector;
 private:
-	_NR<XMLList> childrenlist;
+	//Use loadedChildren() to access the children, they may still be in the parsed document
+	mutable _NR<XMLList> childrenlist;
+	/*
+	 * Source of the children not created yet. Elements parsed from a string
+	 * create their children only when they are first accessed
+	 */
+	mutable _NR<XMLDocumentStore> pendingDoc;
+	mutable pugi::xml_node pendingNode;
 	_NR<XML> parentNode;
 	pugi::xml_node_type nodetype;
 	bool isAttribute;
@@ -45,8 +52,17 @@ private:
 	_NR<XMLList> procinstlist;
 	NSVector namespacedefs;
 
-	void createTree(const pugi::xml_node &rootnode, bool fromXMLList);
-	static void fillNode(XML* node, const pugi::xml_node &srcnode);
+	void createTree(const pugi::xml_node &rootnode, bool fromXMLList, XMLDocumentStore* doc=NULL);
+	static void fillNode(XML* node, const pugi::xml_node &srcnode, bool stripWhitespace);
+	void loadPendingChildren() const;
+	_NR<XMLList>& loadedChildren() const
+	{
+		if (!pendingDoc.isNull())
+			loadPendingChildren();
+		return childrenlist;
+	}
+	void loadSubtree() const;
+	bool pendingSubtreeMayMatch(const tiny_string& name, bool bIsAttribute) const;
 	tiny_string toString_priv();
 	const char* nodekindString();
 	
@@ -143,13 +159,14 @@ public:
 	static void sinit(Class_base* c);
 	
 	static bool getPrettyPrinting();
+	static bool getIgnoreWhitespace();
 	static unsigned int getParseMode();
 	static XML* createFromString(SystemState *sys, const tiny_string& s);
-	static XML* createFromNode(const pugi::xml_node& _n, XML* parent=NULL, bool fromXMLList=false);
+	static XML* createFromNode(const pugi::xml_node& _n, XML* parent=NULL, bool fromXMLList=false, XMLDocumentStore* doc=NULL);
 
 	const tiny_string getName() const { return nodename;}
 	uint32_t getNamespaceURI() const { return nodenamespace_uri;}
-	XMLList* getChildrenlist() { return childrenlist ? childrenlist.getPtr() : NULL; }
+	XMLList* getChildrenlist() { return loadedChildren() ? childrenlist.getPtr() : NULL; }
 	
 	
 	void getDescendantsByQName(const tiny_string& name, uint32_t ns, bool bIsAttribute, XMLVector& ret) const;
@@ -177,9 +194,9 @@ public:
 	_R<ASObject> nextName(uint32_t index);
 	_R<ASObject> nextValue(uint32_t index);
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 }
 #endif /* SCRIPTING_TOPLEVEL_XML_H */
@@ -216,9 +216,10 @@ ASFUNCTIONBODY(XMLList,_constructor)
 
 void XMLList::buildFromString(const tiny_string &str)
 {
-	pugi::xml_document xmldoc;
+	_R<XMLDocumentStore> xmldoc = _MR(new XMLDocumentStore());
+	xmldoc->ignoreWhitespace = XML::getIgnoreWhitespace();
 
-	pugi::xml_parse_result res = xmldoc.load_buffer((void*)str.raw_buf(),str.numBytes(),XML::getParseMode());
+	pugi::xml_parse_result res = xmldoc->doc.load_buffer((void*)str.raw_buf(),str.numBytes(),XML::getParseMode());
 	switch (res.status)
 	{
 		case pugi::status_ok:
@@ -249,10 +250,10 @@ void XMLList::buildFromString(const tiny_string &str)
 			break;
 	}
 	
-	pugi::xml_node_iterator it=xmldoc.begin();
-	for(;it!=xmldoc.end();++it)
+	pugi::xml_node_iterator it=xmldoc->doc.begin();
+	for(;it!=xmldoc->doc.end();++it)
 	{
-		_R<XML> tmp = _MR(XML::createFromNode(*it,(XML*)NULL,true));
+		_R<XML> tmp = _MR(XML::createFromNode(*it,(XML*)NULL,true,xmldoc.getPtr()));
 		if (tmp->constructed)
 			nodes.push_back(tmp);
 	}
@@ -676,8 +677,8 @@ void XMLList::getTargetVariables(const multiname& name,XML::XMLVector& retnodes)
 			{
 				retnodes.push_back(child);
 			}
-			if (child->childrenlist)
-				child->childrenlist->getTargetVariables(name,retnodes);
+			if (child->loadedChildren())
+				child->loadedChildren()->getTargetVariables(name,retnodes);
 		}
 	}
 }
@@ -861,19 +862,19 @@ bool XMLList::deleteVariableByMultiname(const multiname& name)
 	if(XML::isValidMultiname(getSystemState(),name,index))
 	{
 		_R<XML> node = nodes[index];
-		if (!node->parentNode.isNull() && node->parentNode->childrenlist.getPtr() != this)
+		if (!node->parentNode.isNull() && node->parentNode->loadedChildren().getPtr() != this)
 		{
 			// the node to remove is also added to another list, so it has to be deleted there, too
 			if (node->parentNode)
 			{
-				XMLList::XMLListVector::iterator it = node->parentNode->childrenlist->nodes.end();
-				while (it != node->parentNode->childrenlist->nodes.begin())
+				XMLList::XMLListVector::iterator it = node->parentNode->loadedChildren()->nodes.end();
+				while (it != node->parentNode->loadedChildren()->nodes.begin())
 				{
 					it--;
 					_R<XML> n = *it;
 					if (n.getPtr() == node.getPtr())
 					{
-						node->parentNode->childrenlist->nodes.erase(it);
+						node->parentNode->loadedChildren()->nodes.erase(it);
 						bdeleted = true;
 						break;
 					}
@@ -1039,7 +1040,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 		}
 		if (o->as<XML>()->getNodeKind() == pugi::node_pcdata)
 		{
-			nodes[idx]->childrenlist->clear();
+			nodes[idx]->loadedChildren()->clear();
 			_R<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
 			nodes[idx]->incRef();
 			tmp->parentNode = nodes[idx];
@@ -1049,7 +1050,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 			tmp->nodenamespace_prefix = BUILTIN_STRINGS::EMPTY;
 			tmp->nodevalue = o->toString();
 			tmp->constructed = true;
-			nodes[idx]->childrenlist->append(tmp);
+			nodes[idx]->loadedChildren()->append(tmp);
 		}
 		else
 		{
@@ -1063,7 +1064,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 			nodes[idx]->nodevalue = o->toString();
 		else 
 		{
-			nodes[idx]->childrenlist->clear();
+			nodes[idx]->loadedChildren()->clear();
 			_R<XML> tmp = _MR<XML>(Class<XML>::getInstanceSNoArgs(getSystemState()));
 			nodes[idx]->incRef();
 			tmp->parentNode = nodes[idx];
@@ -1073,7 +1074,7 @@ void XMLList::replace(unsigned int idx, ASObject *o, const XML::XMLVector &retno
 			tmp->nodenamespace_prefix = BUILTIN_STRINGS::EMPTY;
 			tmp->nodevalue = o->toString();
 			tmp->constructed = true;
-			nodes[idx]->childrenlist->append(tmp);
+			nodes[idx]->loadedChildren()->append(tmp);
 		}
 	}
 }
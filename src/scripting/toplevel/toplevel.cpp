@@ -42,6 +42,7 @@
 #include "scripting/class.h"
 #include "exceptions.h"
 #include "backends/urlutils.h"
+#include "backends/profiler.h"
 #include "parsing/amf3_generator.h"
 #include "scripting/argconv.h"
 #include "scripting/toplevel/Number.h"
@@ -115,9 +116,9 @@ ASObject *Undefined::describeType() const
 	return ASObject::describeType();
 }
 
-void Undefined::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Undefined::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 		out->writeByte(amf0_undefined_marker);
@@ -135,6 +136,20 @@ IFunction::IFunction(Class_base* c):ASObject(c,T_FUNCTION),length(0),inClass(NUL
 {
 }
 
+void IFunction::gcTrace(CycleCollector& gc)
+{
+	ASObject::gcTrace(gc);
+	gc.visit(closure_this.getPtr());
+	gc.visit(prototype.getPtr());
+}
+
+void IFunction::gcClear()
+{
+	closure_this.reset();
+	prototype.reset();
+	ASObject::gcClear();
+}
+
 void IFunction::sinit(Class_base* c)
 {
 	c->isReusable=true;
@@ -276,6 +291,18 @@ SyntheticFunction::SyntheticFunction(Class_base* c,method_info* m):IFunction(c),
 	objfreelist = &c->freelist[1];
 }
 
+void SyntheticFunction::gcTrace(CycleCollector& gc)
+{
+	IFunction::gcTrace(gc);
+	gc.visit(func_scope.getPtr());
+}
+
+void SyntheticFunction::gcClear()
+{
+	func_scope.reset();
+	IFunction::gcClear();
+}
+
 /**
  * This prepares a new call_context and then executes the ABC bytecode function
  * by ABCVm::executeFunction() or through JIT.
@@ -287,6 +314,7 @@ ASObject* SyntheticFunction::call(ASObject* obj, ASObject* const* args, uint32_t
 	const uint32_t jit_hit_threshold=20;
 	if (!mi->body)
 		return getSystemState()->getUndefinedRef();
+	mi->ensureBodyParsed();
 
 	const uint16_t hit_count = mi->body->hit_count;
 	const method_body_info::CODE_STATUS& codeStatus = mi->body->codeStatus;
@@ -385,6 +413,10 @@ ASObject* SyntheticFunction::call(ASObject* obj, ASObject* const* args, uint32_t
 	cc.stack=stack;
 	cc.stack_index=0;
 	cc.context=mi->context;
+	//Loaded by the first Alchemy opcode
+	cc.domainMemoryBase=NULL;
+	cc.domainMemoryLength=0;
+	cc.domainMemoryGeneration=ByteArray::domainMemoryGeneration-1;
 	//cc.code= new istringstream(mi->body->code);
 	cc.parent_scope_stack=func_scope;
 	cc.exec_pos=0;
@@ -399,6 +431,15 @@ ASObject* SyntheticFunction::call(ASObject* obj, ASObject* const* args, uint32_t
 	
 	call_context* saved_cc = getVm(getSystemState())->currentCallContext;
 	cc.defaultNamespaceUri = saved_cc ? saved_cc->defaultNamespaceUri : (uint32_t)BUILTIN_STRINGS::EMPTY;
+	cc.parent = saved_cc;
+	if(SamplingProfiler::isRunning() && mi->sampleName==NULL)
+	{
+		tiny_string name = inClass ? inClass->getQualifiedClassName()+"/" : "";
+		name += functionname ? getSystemState()->getStringFromUniqueId(functionname) : "<anonymous>";
+		mi->sampleName = SamplingProfiler::internName(name);
+	}
+	//The profiler signal handler must never see a partially initialized context
+	std::atomic_signal_fence(std::memory_order_release);
 
 	/* Set the current global object, each script in each DoABCTag has its own */
 	getVm(getSystemState())->currentCallContext = &cc;
@@ -690,9 +731,9 @@ int64_t Null::toInt64()
 	return 0;
 }
 
-void Null::serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap)
+void Null::serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap)
 {
 	if (out->getObjectEncoding() == ObjectEncoding::AMF0)
 		out->writeByte(amf0_null_marker);
@@ -790,14 +831,14 @@ const Type* Type::getTypeFromMultiname(const multiname* mn, ABCContext* context)
 
 Class_base::Class_base(const QName& name, MemoryAccount* m):ASObject(Class_object::getClass(getSys()),T_CLASS),protected_ns(getSys(),"",NAMESPACE),constructor(NULL),
 	borrowedVariables(m),
-	context(NULL),class_name(name),memoryAccount(m),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),use_protected(false)
+	context(NULL),class_name(name),memoryAccount(m),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),amf3TraitsCached(false),use_protected(false)
 {
 	setConstant();
 }
 
 Class_base::Class_base(const Class_object*):ASObject((MemoryAccount*)NULL),protected_ns(getSys(),BUILTIN_STRINGS::EMPTY,NAMESPACE),constructor(NULL),
 	borrowedVariables(NULL),
-	context(NULL),class_name(BUILTIN_STRINGS::STRING_CLASS,BUILTIN_STRINGS::EMPTY),memoryAccount(NULL),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),use_protected(false)
+	context(NULL),class_name(BUILTIN_STRINGS::STRING_CLASS,BUILTIN_STRINGS::EMPTY),memoryAccount(NULL),length(1),class_index(-1),isFinal(false),isSealed(false),isInterface(false),isReusable(false),amf3TraitsCached(false),use_protected(false)
 {
 	setConstant();
 	type=T_CLASS;
@@ -2065,7 +2106,7 @@ Class<IFunction>* Class<IFunction>::getClass(SystemState* sys)
 	if(*retAddr==NULL)
 	{
 		//Create the class
-		ret=new (s->unaccountedMemory) Class<IFunction>(s->unaccountedMemory);
+		ret=new (s->unaccountedMemory) Class<IFunction>(s->allocateMemoryAccount("Function"));
 		ret->setSystemState(s);
 		//This function is called from Class<ASObject>::getRef(),
 		//so the Class<ASObject> we obtain will not have any
@@ -2109,16 +2150,60 @@ void Global::sinit(Class_base* c)
 	c->setSuper(Class<ASObject>::getRef(c->getSystemState()));
 }
 
+void Global::addPendingClass(uint32_t nameId, const traits_info* t)
+{
+	pendingClasses.insert(make_pair(nameId, t));
+}
+
+bool Global::definePendingClass(const multiname& name)
+{
+	if(pendingClasses.empty() || name.name_type!=multiname::NAME_STRING)
+		return false;
+	auto range=pendingClasses.equal_range(name.name_s_id);
+	for(auto it=range.first;it!=range.second;++it)
+	{
+		const traits_info* t=it->second;
+		const multiname* tname=context->getMultiname(t->name,NULL);
+		if(find(name.ns.begin(),name.ns.end(),tname->ns[0])==name.ns.end())
+			continue;
+		pendingClasses.erase(it);
+		context->defineClass(this,t);
+		return true;
+	}
+	return false;
+}
+
+void Global::definePendingClasses()
+{
+	while(!pendingClasses.empty())
+	{
+		const traits_info* t=pendingClasses.begin()->second;
+		pendingClasses.erase(pendingClasses.begin());
+		context->defineClass(this,t);
+	}
+}
+
+bool Global::hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype)
+{
+	if(ASObject::hasPropertyByMultiname(name, considerDynamic, considerPrototype))
+		return true;
+	return definePendingClass(name);
+}
+
 _NR<ASObject> Global::getVariableByMultinameOpportunistic(const multiname& name)
 {
 	_NR<ASObject> ret = ASObject::getVariableByMultiname(name, NONE);
-	//Do not attempt to define the variable now in any case
+	//Do not attempt to define the variable now in any case, but create the pending class objects
+	if(ret.isNull() && definePendingClass(name))
+		ret = ASObject::getVariableByMultiname(name, NONE);
 	return ret;
 }
 
 _NR<ASObject> Global::getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt)
 {
 	_NR<ASObject> ret = ASObject::getVariableByMultiname(name, opt);
+	if(ret.isNull() && definePendingClass(name))
+		ret = ASObject::getVariableByMultiname(name, opt);
 	/*
 	 * All properties are registered by now, even if the script init has
 	 * not been run. Thus if ret == NULL, we don't have to run the script init.
@@ -2588,6 +2673,7 @@ _NR<ASObject> Function_object::getVariableByMultiname(const multiname& name, GET
 EARLY_BIND_STATUS ActivationType::resolveMultinameStatically(const multiname& name) const
 {
 	std::cerr << "Looking for " << name << std::endl;
+	mi->ensureBodyParsed();
 	for(unsigned int i=0;i<mi->body->trait_count;i++)
 	{
 		const traits_info* t=&mi->body->traits[i];
@@ -2606,6 +2692,7 @@ EARLY_BIND_STATUS ActivationType::resolveMultinameStatically(const multiname& na
 const multiname* ActivationType::resolveSlotTypeName(uint32_t slotId) const
 {
 	std::cerr << "Resolving type at id " << slotId << std::endl;
+	mi->ensureBodyParsed();
 	for(unsigned int i=0;i<mi->body->trait_count;i++)
 	{
 		const traits_info* t=&mi->body->traits[i];
@@ -23,6 +23,7 @@
 #include "compat.h"
 #include <vector>
 #include <set>
+#include <map>
 #include "asobject.h"
 #include "exceptions.h"
 #include "threading.h"
@@ -143,7 +144,12 @@ struct asfreelist
 {
 	ASObject* freelist[FREELIST_SIZE];
 	int freelistsize;
-	asfreelist():freelistsize(0) {}
+	/*
+	 * The free lists are only used by the VM thread, so the objects of classes
+	 * that never leave it are marked as thread confined when they are handed out
+	 */
+	bool threadConfined;
+	asfreelist():freelistsize(0),threadConfined(false) {}
 	~asfreelist() 
 	{
 		for (int i = 0; i < freelistsize; i++)
@@ -157,7 +163,18 @@ struct asfreelist
 		// all ASObjects must be created in the VM thread
 		assert_and_throw(isVmThread());
 #endif
-		return freelistsize ? freelist[--freelistsize] :NULL;
+		if(!freelistsize)
+			return NULL;
+		ASObject* ret=freelist[--freelistsize];
+		if(threadConfined)
+			ret->setThreadConfined();
+		return ret;
+	}
+	/* Applies the same decision to objects allocated because the list was empty */
+	inline void initNewObject(ASObject* obj)
+	{
+		if(threadConfined)
+			obj->setThreadConfined();
 	}
 	inline bool pushObjectToFreeList(ASObject *obj)
 	{
@@ -213,6 +230,13 @@ public:
 	
 	// indicates if objects can be reused after they have lost their last reference
 	bool isReusable:1;
+	/*
+	 * AMF3 description of the instances, filled on the first serialization.
+	 * Invalidated when an alias is registered for the class
+	 */
+	bool amf3TraitsCached:1;
+	tiny_string amf3Alias;
+	std::vector<uint32_t> amf3TraitNames;
 private:
 	//TODO: move in Class_inherit
 	bool use_protected:1;
@@ -404,6 +428,8 @@ public:
 		length=0;
 		return ASObject::destruct();
 	}
+	void gcTrace(CycleCollector& gc);
+	void gcClear();
 	ASFUNCTION(apply);
 	ASFUNCTION(_call);
 	ASFUNCTION(_toString);
@@ -546,6 +572,8 @@ public:
 		mi = NULL;
 		return IFunction::destruct();
 	}
+	void gcTrace(CycleCollector& gc);
+	void gcClear();
 	
 	_NR<scope_entry_list> func_scope;
 	bool isEqual(ASObject* r)
@@ -653,9 +681,9 @@ public:
 	TRISTATE isLess(ASObject* r);
 	ASObject *describeType() const;
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 	void setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst);
 };
 
@@ -672,9 +700,9 @@ public:
 	void setVariableByMultiname(const multiname& name, ASObject* o, CONST_ALLOWED_FLAG allowConst);
 
 	//Serialization interface
-	void serialize(ByteArray* out, std::map<tiny_string, uint32_t>& stringMap,
-				std::map<const ASObject*, uint32_t>& objMap,
-				std::map<const Class_base*, uint32_t>& traitsMap);
+	void serialize(ByteArray* out, std::unordered_map<tiny_string, uint32_t>& stringMap,
+				std::unordered_map<const ASObject*, uint32_t>& objMap,
+				std::unordered_map<const Class_base*, uint32_t>& traitsMap);
 };
 
 class ASQName: public ASObject
@@ -744,12 +772,20 @@ class Global : public ASObject
 private:
 	int scriptId;
 	ABCContext* context;
+	//Class traits of the script that have not been defined yet, by name
+	std::multimap<uint32_t, const traits_info*> pendingClasses;
+	/* Defines the pending class matching name, returns false if there is none */
+	bool definePendingClass(const multiname& name);
 public:
 	Global(Class_base* cb, ABCContext* c, int s);
 	static void sinit(Class_base* c);
 	static void buildTraits(ASObject* o) {};
 	_NR<ASObject> getVariableByMultiname(const multiname& name, GET_VARIABLE_OPTION opt=NONE);
 	_NR<ASObject> getVariableByMultinameOpportunistic(const multiname& name);
+	bool hasPropertyByMultiname(const multiname& name, bool considerDynamic, bool considerPrototype);
+	/* The class is defined by ABCContext::defineClass when its name is first looked up */
+	void addPendingClass(uint32_t nameId, const traits_info* t);
+	void definePendingClasses();
 	/*
 	 * Utility method to register builtin methods and classes
 	 */
@@ -26,12 +26,32 @@
 namespace lightspark
 {
 
+class CycleCollector;
+
 class RefCountable {
+friend class CycleCollector;
 private:
 	ATOMIC_INT32(ref_count);
 	ACQUIRE_RELEASE_FLAG(isConstant);
+	/*
+	 * Set for objects that are only ever referenced from the VM thread,
+	 * their reference count is updated without atomic operations
+	 */
+	bool isThreadConfined;
+	/* The object is a possible root of a garbage cycle, see CycleCollector */
+	ACQUIRE_RELEASE_FLAG(gcCandidate);
+	/* Set when a reference to a candidate is dropped, the collector only looks at these */
+	ACQUIRE_RELEASE_FLAG(gcPurple);
+	/* The collector is holding a temporary reference, protected by the collector mutex */
+	bool gcPinned;
 protected:
-	RefCountable() : ref_count(1),isConstant(false) {}
+	RefCountable() : ref_count(1),isConstant(false),isThreadConfined(false),gcCandidate(false),gcPurple(false),gcPinned(false) {}
+	/*
+	 * Called when the last reference to a cycle collector candidate is dropped.
+	 * Returns false if the collector took a reference in the meantime, in that case
+	 * the reference being dropped has already been released and the object is not destroyed
+	 */
+	virtual bool gcReleaseCandidate() { return true; }
 
 public:
 	virtual ~RefCountable() {}
@@ -45,11 +65,24 @@ public:
 		RELEASE_WRITE(isConstant,true);
 	}
 	inline bool getConstant() const { return isConstant; }
+	/*
+	 * Only call this on objects created by the VM thread that have not been shared yet.
+	 * clearThreadConfined must be called before handing the object to another thread.
+	 */
+	inline void setThreadConfined() { isThreadConfined=true; }
+	inline void clearThreadConfined() { isThreadConfined=false; }
+	inline bool getThreadConfined() const { return isThreadConfined; }
+	inline bool isCycleCandidate() const { return ACQUIRE_READ(gcCandidate); }
 	
 	inline void incRef()
 	{
 		if (!isConstant)
-			++ref_count;
+		{
+			if (isThreadConfined)
+				ref_count.store(ref_count.load(std::memory_order_relaxed)+1,std::memory_order_relaxed);
+			else
+				++ref_count;
+		}
 	}
 	inline void decRef()
 	{
@@ -58,6 +91,8 @@ public:
 		{
 			if (ref_count == 1)
 			{
+				if (ACQUIRE_READ(gcCandidate) && !gcReleaseCandidate())
+					return;
 				if (destruct())
 				{
 					//Let's make refcount very invalid
@@ -66,13 +101,30 @@ public:
 				}
 			}
 			else
-				--ref_count;
+			{
+				if (isThreadConfined)
+					ref_count.store(ref_count.load(std::memory_order_relaxed)-1,std::memory_order_relaxed);
+				else
+					--ref_count;
+				if (ACQUIRE_READ(gcCandidate))
+					RELEASE_WRITE(gcPurple,true);
+			}
 		}
 	}
 	virtual bool destruct()
 	{
 		return true;
 	}
+	/*
+	 * Cycle collector support.
+	 * gcTrace must report every counted reference held by this object through
+	 * CycleCollector::visit. Reporting a reference that is not counted would
+	 * make the collector free live objects, omitting a reference is safe.
+	 * gcClear must drop the references reported by gcTrace, it is only called
+	 * on objects that are part of a garbage cycle.
+	 */
+	virtual void gcTrace(CycleCollector& gc) {}
+	virtual void gcClear() {}
 };
 
 /*
@@ -30,10 +30,14 @@
 #include "scripting/class.h"
 #include "backends/audio.h"
 #include "backends/config.h"
+#include "backends/profiler.h"
+#include "backends/memoryreport.h"
 #include "backends/rendering.h"
 #include "backends/image.h"
 #include "backends/extscriptobject.h"
 #include "backends/input.h"
+#include "backends/workers.h"
+#include "scripting/flash/system/flashsystem.h"
 #include "memory_support.h"
 
 #ifdef ENABLE_CURL
@@ -178,8 +182,8 @@ static const char* builtinStrings[] = {"", "any", "void", "prototype", "Function
 
 extern uint32_t asClassCount;
 
-SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
-	terminated(0),renderRate(0),error(false),shutdown(false),
+SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode, WorkerInstance* w):
+	terminated(0),renderRate(0),error(false),shutdown(false),virtualClock(false),virtualTime(0),
 	renderThread(NULL),inputThread(NULL),engineData(NULL),mainThread(0),dumpedSWFPathAvailable(0),
 	vmVersion(VMNONE),childPid(0),
 	parameters(NullRef),
@@ -214,6 +218,22 @@ SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 
 	mainThread = Thread::self();
 
+	if(w)
+	{
+		w->incRef();
+		worker=_MR(w);
+	}
+	else
+	{
+		worker=_MR(new WorkerInstance(this));
+		const Config* config=Config::getConfig();
+		if(!config->getProfilerOutput().empty())
+			SamplingProfiler::start(config->getProfilerOutput(), config->getProfilerInterval());
+		if(config->isMemoryReportEnabled())
+			MemoryReport::start(config->getMemoryReport(), config->getMemoryReportInterval(),
+					config->getMemoryReportTop(), config->isMemoryReportSignalEnabled());
+	}
+
 	unaccountedMemory = allocateMemoryAccount("Unaccounted");
 	tagsMemory = allocateMemoryAccount("Tags");
 	stringMemory = allocateMemoryAccount("Tiny_string");
@@ -267,6 +287,9 @@ SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 	renderThread=new RenderThread(this);
 	inputThread=new InputThread(this);
 
+	//Background workers are never shown, the engines are never started
+	if(isBackgroundWorker())
+		return;
 	EngineData::userevent = SDL_RegisterEvents(3);
 	SDL_Event event;
 	SDL_zero(event);
@@ -275,6 +298,11 @@ SystemState::SystemState(uint32_t fileSize, FLASH_MODE mode):
 	SDL_PushEvent(&event);
 }
 
+bool SystemState::isBackgroundWorker() const
+{
+	return !worker->isPrimordial();
+}
+
 void SystemState::setDownloadedPath(const tiny_string& p)
 {
 	dumpedSWFPath=p;
@@ -471,16 +499,20 @@ void SystemState::saveProfilingInformation()
 
 MemoryAccount* SystemState::allocateMemoryAccount(const tiny_string& name)
 {
-#ifdef MEMORY_USAGE_PROFILING
 	Locker l(memoryAccountsMutex);
 	memoryAccounts.emplace_back(name);
 	return &memoryAccounts.back();
-#else
-	return NULL;
-#endif
+}
+
+void SystemState::listMemoryAccounts(vector<const MemoryAccount*>& out) const
+{
+	Locker l(memoryAccountsMutex);
+	for(auto it=memoryAccounts.begin();it!=memoryAccounts.end();++it)
+		out.push_back(&(*it));
 }
 
 #ifdef MEMORY_USAGE_PROFILING
+
 void SystemState::saveMemoryUsageInformation(ofstream& out, int snapshotCount) const
 {
 	out << "#-----------\nsnapshot=" << snapshotCount << "\n#-----------\ntime=" << snapshotCount << endl;
@@ -490,9 +522,10 @@ void SystemState::saveMemoryUsageInformation(ofstream& out, int snapshotCount) c
 	auto it=memoryAccounts.begin();
 	for(;it!=memoryAccounts.end();++it)
 	{
-		if(it->bytes>0)
+		int64_t bytes=it->getBytes();
+		if(bytes>0)
 		{
-			totalMem+=it->bytes;
+			totalMem+=bytes;
 			totalCount++;
 		}
 	}
@@ -502,8 +535,9 @@ void SystemState::saveMemoryUsageInformation(ofstream& out, int snapshotCount) c
 	it=memoryAccounts.begin();
 	for(;it!=memoryAccounts.end();++it)
 	{
-		if(it->bytes>0)
-			out << " n0: " << it->bytes << " " << it->name << endl;
+		int64_t bytes=it->getBytes();
+		if(bytes>0)
+			out << " n0: " << bytes << " " << it->name << endl;
 	}
 }
 #endif
@@ -515,6 +549,8 @@ void SystemState::systemFinalize()
 	parameters.reset();
 	frameListeners.clear();
 	systemDomain.reset();
+	workerObjects.clear();
+	messageChannelObjects.clear();
 
 	mainClip->decRef();
 	//Free the stage. This should free all objects on the displaylist
@@ -523,6 +559,8 @@ void SystemState::systemFinalize()
 
 SystemState::~SystemState()
 {
+	//The accounts are destroyed with the members, strings freed from now on are not accounted
+	stringMemory=NULL;
 	delete[] builtinClasses;
 	null.forceDestruct();
 	undefined.forceDestruct();
@@ -536,6 +574,14 @@ void SystemState::destroy()
 	saveProfilingInformation();
 #endif
 	terminated.wait();
+	//No more notifications from other workers, and terminate our background workers
+	worker->detach();
+	if(!isBackgroundWorker())
+	{
+		SamplingProfiler::stop();
+		if(Config::getConfig()->isMemoryReportEnabled())
+			MemoryReport::stop();
+	}
 	//Acquire the mutex to sure that the engines are not being started right now
 	Locker l(rootMutex);
 	renderThread->wait();
@@ -973,6 +1019,9 @@ void SystemState::needsAVM2(bool avm2)
 		LOG(LOG_INFO,_("Creating VM"));
 		MemoryAccount* vmDataMemory=this->allocateMemoryAccount("VM_Data");
 		currentVm=new ABCVm(this, vmDataMemory);
+		//Background workers have no engines to wait for
+		if(isBackgroundWorker())
+			currentVm->start();
 	}
 	else
 		vmVersion=AVM1;
@@ -1001,6 +1050,27 @@ void SystemState::setRenderRate(float rate)
 	startRenderTicks();
 }
 
+uint64_t SystemState::getElapsedTime() const
+{
+	return (virtualClock?virtualTime.load():compat_msectiming())-startTime;
+}
+
+void SystemState::enableVirtualClock()
+{
+	virtualTime=startTime;
+	virtualClock=true;
+	timerThread->enableVirtualClock(startTime);
+	frameTimerThread->enableVirtualClock(startTime);
+}
+
+void SystemState::advanceVirtualClock(uint32_t ms)
+{
+	assert(virtualClock);
+	uint64_t now=(virtualTime+=ms);
+	timerThread->advanceVirtualClock(now);
+	frameTimerThread->advanceVirtualClock(now);
+}
+
 void SystemState::addJob(IThreadJob* j)
 {
 	threadPool->addJob(j);
@@ -1255,21 +1325,28 @@ void ParseThread::parseSWFHeader(RootMovieClip *root, UI8 ver)
 	{
 		//The file is compressed, create a filtering streambuf
 		backend=f.rdbuf();
+		uncompressing_filter* filter=NULL;
 		if(fileType==FT_COMPRESSED_SWF)
 		{
 			LOG(LOG_INFO, _("zlib compressed SWF file: Version ") << (int)version);
-			uncompressingFilter = new zlib_filter(backend);
+			filter = new zlib_filter(backend);
 		}
 		else if(fileType==FT_LZMA_COMPRESSED_SWF)
 		{
 			LOG(LOG_INFO, _("lzma compressed SWF file: Version ") << (int)version);
-			uncompressingFilter = new liblzma_filter(backend);
+			filter = new liblzma_filter(backend);
 		}
 		else
 		{
 			// not reached
 			assert(false);
 		}
+		//Decompress on another thread while the tags are parsed
+		unsigned int readAhead=Config::getConfig()->getParsingReadAhead();
+		if(readAhead)
+			uncompressingFilter = new readahead_filter(filter, readAhead);
+		else
+			uncompressingFilter = filter;
 		f.rdbuf(uncompressingFilter);
 		// the first 8 bytes from the header are always uncompressed (magic bytes + FileLength)
 		root->loaderInfo->setBytesTotal(FileLength-8);
@@ -1298,6 +1375,7 @@ void ParseThread::parseSWFHeader(RootMovieClip *root, UI8 ver)
 void ParseThread::execute()
 {
 	tls_set(&parse_thread_tls,this);
+	ProfilerScope profilerScope("[parse]");
 	try
 	{
 		UI8 Signature[4];
@@ -2007,6 +2085,8 @@ void RootMovieClip::finalize()
 	MovieClip::finalize();
 	applicationDomain.reset();
 	securityDomain.reset();
+	//Most of the objects of the movie are gone now
+	SlabAllocator::trim();
 }
 
 void RootMovieClip::addBinding(const tiny_string& name, DictionaryTag *tag)
@@ -33,6 +33,8 @@
 #include "scripting/flash/utils/IntervalManager.h"
 #include "timer.h"
 #include "memory_support.h"
+#include "cycle_collector.h"
+#include "backends/rastercache.h"
 #include "platforms/engineutils.h"
 
 class uncompressing_filter;
@@ -58,6 +60,10 @@ class ApplicationDomain;
 class SecurityDomain;
 class Class_inherit;
 class DefineFont3Tag;
+class WorkerInstance;
+class ChannelQueue;
+class ASWorker;
+class MessageChannel;
 
 class RootMovieClip: public MovieClip
 {
@@ -166,17 +172,26 @@ private:
 		void jobFence() { delete this; }
 	};
 	friend class SystemState::EngineCreator;
+	//Declared first so that it outlives every object owned by the SystemState
+	CycleCollector cycleCollector;
 	ThreadPool* threadPool;
 	TimerThread* timerThread;
 	TimerThread* frameTimerThread;
+	//Rasterized shapes shared by the render jobs
+	RasterCache rasterCache;
 	Semaphore terminated;
 	float renderRate;
 	bool error;
 	bool shutdown;
+	//Written by the thread driving the virtual clock, read by the VM thread
+	ACQUIRE_RELEASE_FLAG(virtualClock);
+	ACQUIRE_RELEASE_VARIABLE(uint64_t, virtualTime);
 	RenderThread* renderThread;
 	InputThread* inputThread;
 	EngineData* engineData;
 	Thread* mainThread;
+	//The worker this SystemState runs, see backends/workers.h
+	_NR<WorkerInstance> worker;
 	void startRenderTicks();
 	Mutex rootMutex;
 	/**
@@ -249,10 +264,8 @@ private:
 	*/
 	tiny_string profOut;
 #endif
-#ifdef MEMORY_USAGE_PROFILING
 	mutable Mutex memoryAccountsMutex;
 	std::list<MemoryAccount> memoryAccounts;
-#endif
 	/*
 	 * Pooling support
 	 */
@@ -290,6 +303,10 @@ public:
 	void tickFence();
 	RenderThread* getRenderThread() const { return renderThread; }
 	InputThread* getInputThread() const { return inputThread; }
+	CycleCollector& getCycleCollector() { return cycleCollector; }
+	WorkerInstance* getWorker() const { return worker.getPtr(); }
+	bool isBackgroundWorker() const;
+	RasterCache& getRasterCache() { return rasterCache; }
 	void setParamsAndEngine(EngineData* e, bool s) DLL_PUBLIC;
 	void setDownloadedPath(const tiny_string& p) DLL_PUBLIC;
 	void needsAVM2(bool n);
@@ -301,8 +318,10 @@ public:
 	 * before any other thread gets started
 	 * \param fileSize The size of the SWF being parsed, if known
 	 * \param mode FLASH or AIR
+	 * \param w The background worker to run, NULL for the primordial worker.
+	 * Background workers have no rendering and input engines
 	 */
-	SystemState(uint32_t fileSize, FLASH_MODE mode) DLL_PUBLIC;
+	SystemState(uint32_t fileSize, FLASH_MODE mode, WorkerInstance* w=NULL) DLL_PUBLIC;
 	~SystemState();
 	/* Stop engines, threads and free classes and objects.
 	 * This call will decRef this object in the end,
@@ -342,6 +361,14 @@ public:
 
 	//Application starting time in milliseconds
 	uint64_t startTime;
+	//Milliseconds elapsed since startTime, as seen by getTimer
+	uint64_t getElapsedTime() const;
+	/*
+	 * Deterministic clock, used by lightspark-bench. Once it is enabled time only moves
+	 * with advanceVirtualClock, which fires the timers becoming due in the calling thread
+	 */
+	void enableVirtualClock() DLL_PUBLIC;
+	void advanceVirtualClock(uint32_t ms) DLL_PUBLIC;
 
 	//Classes set. They own one reference to each class/template
 	std::set<Class_base*> customClasses;
@@ -420,6 +447,12 @@ public:
 	 * Support for class aliases in AMF3 serialization
 	 */
 	std::map<tiny_string, _R<Class_base> > aliasMap;
+	/*
+	 * The objects representing the workers and message channels in this worker,
+	 * so that the same object is returned every time. Only used by the VM thread
+	 */
+	std::map<WorkerInstance*, _R<ASWorker> > workerObjects;
+	std::map<ChannelQueue*, _R<MessageChannel> > messageChannelObjects;
 #ifdef PROFILING_SUPPORT
 	void setProfilingOutput(const tiny_string& t) DLL_PUBLIC;
 	const tiny_string& getProfilingOutput() const;
@@ -433,6 +466,7 @@ public:
 #ifdef MEMORY_USAGE_PROFILING
 	void saveMemoryUsageInformation(std::ofstream& out, int snapshotCount) const;
 #endif
+	void listMemoryAccounts(std::vector<const MemoryAccount*>& out) const DLL_PUBLIC;
 	/*
 	 * Pooling support
 	 */
@@ -481,7 +515,8 @@ public:
 	_NR<SecurityDomain> securityDomain;
 private:
 	std::istream& f;
-	uncompressing_filter* uncompressingFilter;
+	//The uncompressing filter, possibly wrapped in a readahead_filter
+	std::streambuf* uncompressingFilter;
 	std::streambuf* backend;
 	Loader *loader;
 	_NR<DisplayObject> parsedObject;
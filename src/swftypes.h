@@ -228,9 +228,12 @@ public:
 	operator uint32_t() const{ return val; }
 };
 
+class abc_reader;
+
 class u32
 {
 friend std::istream& operator>>(std::istream& in, u32& v);
+friend abc_reader& operator>>(abc_reader& in, u32& v);
 private:
 	uint32_t val;
 public:
@@ -23,6 +23,7 @@
 #include "compat.h"
 #include "logger.h"
 #include "swf.h"
+#include "backends/profiler.h"
 
 using namespace lightspark;
 
@@ -83,6 +84,7 @@ ThreadPool::~ThreadPool()
 void ThreadPool::job_worker(ThreadPool* th, uint32_t index)
 {
 	setTLSSys(th->m_sys);
+	ProfilerThreadScope profilerThread("jobs");
 
 	ThreadProfile* profile=th->m_sys->allocateProfiler(RGB(200,200,0));
 	char buf[16];
@@ -209,6 +209,82 @@ public:
 
 };
 
+/*
+ * Lock free queue for multiple producers and a single consumer.
+ * Producers push nodes on an atomic list, the consumer detaches the whole
+ * list at once and reverses it to get back the insertion order. Detaching
+ * everything with a single exchange avoids ABA issues on the consumer side.
+ * Nodes are allocated with ALLOC (rebound to the node type).
+ */
+template<class T, class ALLOC>
+class MPSCQueue
+{
+public:
+	struct Node
+	{
+		T value;
+		Node* next;
+		Node(const T& v):value(v),next(NULL){}
+	};
+private:
+	std::atomic<Node*> head;
+	typename ALLOC::template rebind<Node>::other alloc;
+	MPSCQueue(const MPSCQueue&);
+	MPSCQueue& operator=(const MPSCQueue&);
+public:
+	MPSCQueue(const ALLOC& a):head(NULL),alloc(a)
+	{
+	}
+	~MPSCQueue()
+	{
+		Node* n=popAll();
+		while(n)
+		{
+			Node* next=n->next;
+			release(n);
+			n=next;
+		}
+	}
+	/* Can be called from any thread */
+	void push(const T& v)
+	{
+		Node* n=alloc.allocate(1);
+		new ((void*)n) Node(v);
+		Node* old=head.load(std::memory_order_relaxed);
+		do
+		{
+			n->next=old;
+		}
+		while(!head.compare_exchange_weak(old,n));
+	}
+	bool empty() const
+	{
+		return head.load()==NULL;
+	}
+	/*
+	 * Detaches all the queued nodes, the oldest comes first.
+	 * Only the consumer thread may call this
+	 */
+	Node* popAll()
+	{
+		Node* n=head.exchange(NULL);
+		Node* ret=NULL;
+		while(n)
+		{
+			Node* next=n->next;
+			n->next=ret;
+			ret=n;
+			n=next;
+		}
+		return ret;
+	}
+	void release(Node* n)
+	{
+		n->~Node();
+		alloc.deallocate(n,1);
+	}
+};
+
 // This class represents the end time when waiting on a conditional
 // variable. It encapsulates the differences between new and old
 // glibmm API.
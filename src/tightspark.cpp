@@ -111,11 +111,13 @@ int main(int argc, char* argv[])
 	vector<ABCContext*> contexts;
 	for(unsigned int i=0;i<fileNames.size();i++)
 	{
-		ifstream f(fileNames[i]);
+		ifstream f(fileNames[i], ios::binary|ios::ate);
 		if(f.is_open())
 		{
+			uint32_t len=f.tellg();
+			f.seekg(0);
 			sys->mainClip->incRef();
-			ABCContext* context=new ABCContext(_MR(sys->mainClip), f, vm);
+			ABCContext* context=new ABCContext(_MR(sys->mainClip), f, len, vm);
 			contexts.push_back(context);
 			f.close();
 			vm->addEvent(NullRef,_MR(new (sys->unaccountedMemory) ABCContextInitEvent(context,false)));
@@ -22,12 +22,41 @@
 #include <cassert>
 
 #include "timer.h"
+#include "backends/profiler.h"
 #include "compat.h"
 
 using namespace lightspark;
 using namespace std;
 
-TimerThread::TimerThread(SystemState* s):m_sys(s),stopped(false),joined(false)
+void TimerThread::EventList::append(TimingEvent* e)
+{
+	e->list=this;
+	e->prev=tail;
+	e->next=NULL;
+	if(tail)
+		tail->next=e;
+	else
+		head=e;
+	tail=e;
+}
+
+void TimerThread::EventList::remove(TimingEvent* e)
+{
+	if(e->prev)
+		e->prev->next=e->next;
+	else
+		head=e->next;
+	if(e->next)
+		e->next->prev=e->prev;
+	else
+		tail=e->prev;
+	e->prev=NULL;
+	e->next=NULL;
+	e->list=NULL;
+}
+
+TimerThread::TimerThread(SystemState* s):wheelEvents(0),currentTick(compat_msectiming()),wakeUpTime(0),
+	virtualClock(false),virtualTime(0),m_sys(s),stopped(false),joined(false)
 {
 #ifdef HAVE_NEW_GLIBMM_THREAD_API
 	t = Thread::create(sigc::mem_fun(this,&TimerThread::worker));
@@ -38,6 +67,7 @@ TimerThread::TimerThread(SystemState* s):m_sys(s),stopped(false),joined(false)
 
 void TimerThread::stop()
 {
+	Mutex::Lock l(mutex);
 	if(!stopped)
 	{
 		stopped=true;
@@ -58,48 +88,141 @@ void TimerThread::wait()
 TimerThread::~TimerThread()
 {
 	stop();
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	for(;it!=pendingEvents.end();++it)
-		delete *it;
+	auto it=jobEvents.begin();
+	for(;it!=jobEvents.end();++it)
+		delete it->second;
 }
 
-void TimerThread::insertNewEvent_nolock(TimingEvent* e)
+void TimerThread::insertInWheel(TimingEvent* e)
 {
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	//If there are no events pending, or this is earlier than the first, signal newEvent
-	if(pendingEvents.empty() || (*it)->wakeUpTime > e->wakeUpTime)
+	if(e->due<currentTick)
 	{
-		pendingEvents.insert(it, e);
-		newEvent.signal();
+		ready.append(e);
 		return;
 	}
-	++it;
+	uint64_t delta=e->due-currentTick;
+	uint32_t level=0;
+	while(level<LEVELS-1 && delta>=(uint64_t(1)<<(SLOT_BITS*(level+1))))
+		level++;
+	//Events beyond the range of the last level are moved again when their slot comes
+	wheel[level][(e->due>>(SLOT_BITS*level))&(SLOTS-1)].append(e);
+	wheelEvents++;
+}
 
-	for(;it!=pendingEvents.end();++it)
+void TimerThread::unlinkEvent(TimingEvent* e)
+{
+	if(e->list!=&ready)
+		wheelEvents--;
+	e->list->remove(e);
+}
+
+void TimerThread::removeFromIndex(TimingEvent* e)
+{
+	auto range=jobEvents.equal_range(e->job);
+	for(auto it=range.first;it!=range.second;++it)
 	{
-		if((*it)->wakeUpTime > e->wakeUpTime)
+		if(it->second==e)
 		{
-			pendingEvents.insert(it, e);
+			jobEvents.erase(it);
 			return;
 		}
 	}
-	//Event has to be inserted after all the others
-	pendingEvents.insert(pendingEvents.end(), e);
 }
 
-void TimerThread::insertNewEvent(TimingEvent* e)
+void TimerThread::cascade(uint32_t level)
+{
+	EventList& slot=wheel[level][(currentTick>>(SLOT_BITS*level))&(SLOTS-1)];
+	TimingEvent* e=slot.head;
+	slot.head=NULL;
+	slot.tail=NULL;
+	while(e)
+	{
+		TimingEvent* next=e->next;
+		wheelEvents--;
+		insertInWheel(e);
+		e=next;
+	}
+}
+
+void TimerThread::advance(uint64_t now)
+{
+	while(currentTick<=now)
+	{
+		if(wheelEvents==0)
+		{
+			currentTick=now+1;
+			return;
+		}
+		//Entering a slot of the upper levels, move its events down
+		for(uint32_t level=1;level<LEVELS;level++)
+		{
+			if(currentTick&((uint64_t(1)<<(SLOT_BITS*level))-1))
+				break;
+			cascade(level);
+		}
+		EventList& slot=wheel[0][currentTick&(SLOTS-1)];
+		while(!slot.empty())
+		{
+			TimingEvent* e=slot.head;
+			slot.remove(e);
+			wheelEvents--;
+			ready.append(e);
+		}
+		currentTick++;
+	}
+}
+
+uint64_t TimerThread::nextExpiration() const
+{
+	if(wheelEvents==0)
+		return UINT64_MAX;
+	uint64_t ret=UINT64_MAX;
+	for(uint32_t level=0;level<LEVELS;level++)
+	{
+		uint32_t shift=SLOT_BITS*level;
+		uint64_t base=currentTick>>shift;
+		//The current slot of an upper level has already been moved down, unless we are at its beginning
+		uint32_t first=(currentTick&((uint64_t(1)<<shift)-1))?1:0;
+		for(uint32_t i=first;i<first+SLOTS;i++)
+		{
+			if(!wheel[level][(base+i)&(SLOTS-1)].empty())
+			{
+				//For the upper levels this is when the slot is moved down, not later than its events
+				ret=std::min(ret,(base+i)<<shift);
+				break;
+			}
+		}
+	}
+	//Coalesce the wakeup with the events due shortly after
+	uint64_t last=ret;
+	for(uint64_t t=ret+1;t<=ret+TIMER_SLACK && t<currentTick+SLOTS;t++)
+	{
+		if(!wheel[0][t&(SLOTS-1)].empty())
+			last=t;
+	}
+	return last;
+}
+
+void TimerThread::insertNewEvent(TimingEvent* e, uint32_t delay)
 {
 	Mutex::Lock l(mutex);
-	insertNewEvent_nolock(e);
+	e->due=getTime()+delay;
+	//On a virtual clock events added while the clock moves fire at its next step, whatever thread adds them
+	if(virtualClock && delay==0)
+		e->due++;
+	jobEvents.insert(std::make_pair(e->job,e));
+	insertInWheel(e);
+	//Wake up the worker only if it would sleep past this event
+	if(e->due<wakeUpTime)
+		newEvent.signal();
 }
 
 //Unsafe debugging routine
 void TimerThread::dumpJobs()
 {
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	//Find if the job is in the list
-	for(;it!=pendingEvents.end();++it)
-		LOG(LOG_INFO, (*it)->job );
+	auto it=jobEvents.begin();
+	for(;it!=jobEvents.end();++it)
+		LOG(LOG_INFO, it->first );
 }
 
 /*
@@ -107,125 +230,145 @@ void TimerThread::dumpJobs()
  *
  * It holds "mutex" all the time but
  *   1. when waiting for on newEvent or for the correct time to execute a job.
- *   2. while executing e->job->tick() (during this time inExectution == e->job)
- * The pendingEvents queue may be altered by another thread with "mutex"
- * An event may be deleted by another thread with "mutex" only if inExectution != jobToDelete
+ *   2. while executing e->job->tick()
+ * All the events due when it wakes up are moved to the ready list and fired in a row.
+ * The queues may be altered by another thread with "mutex"
  */
 void TimerThread::worker()
 {
 	setTLSSys(m_sys);
+	ProfilerThreadScope profilerThread("timers");
 
 	Mutex::Lock l(mutex);
-	while(1)
+	while(!stopped)
 	{
-		/* Wait until the first event appears */
-		while(pendingEvents.empty())
+		if(virtualClock)
 		{
 			newEvent.wait(mutex);
-			if(stopped)
-				return;
+			continue;
 		}
 
-		/* Get expiration of first event */
-		CondTime timing=pendingEvents.front()->wakeUpTime;
-		/* Wait for the absolute time or a newEvent signal
-		 * this unlocks the mutex and relocks it before returing
-		 */
-		timing.wait(mutex,newEvent);
-
-		if(stopped)
-			return;
+		advance(compat_msectiming());
 
-		if(pendingEvents.empty())
+		if(ready.empty())
+		{
+			wakeUpTime=nextExpiration();
+			if(wakeUpTime==UINT64_MAX)
+				newEvent.wait(mutex);
+			else
+			{
+				uint64_t now=compat_msectiming();
+				/* Wait for the absolute time or a newEvent signal
+				 * this unlocks the mutex and relocks it before returing
+				 */
+				if(wakeUpTime>now)
+					CondTime(wakeUpTime-now).wait(mutex,newEvent);
+			}
+			wakeUpTime=0;
 			continue;
+		}
 
-		TimingEvent* e=pendingEvents.front();
-
-		/* check if the top event is due now. It could be have been removed/inserted
-		 * while we slept */
-		if(e->wakeUpTime.isInTheFuture())
-			continue;
+		fireReady(l);
+	}
+}
 
-		pendingEvents.pop_front();
+void TimerThread::fireReady(Mutex::Lock& l)
+{
+	TimingEvent* e=ready.head;
+	ready.remove(e);
 
-		if(e->job->stopMe)
-		{
-			e->job->tickFence();
-			delete e;
-			continue;
-		}
+	if(e->job->stopMe)
+	{
+		removeFromIndex(e);
+		e->job->tickFence();
+		delete e;
+		return;
+	}
 
-		if(e->isTick)
-		{
-			/* re-enqueue*/
-			e->wakeUpTime.addMilliseconds(e->tickTime);
-			insertNewEvent_nolock(e);
-		}
+	if(e->isTick)
+	{
+		/* re-enqueue, don't allow that next expiration will be in the past */
+		uint64_t now=getTime();
+		e->due+=e->tickTime;
+		if(e->due<now)
+			e->due=now+e->tickTime;
+		insertInWheel(e);
+	}
+	else
+		removeFromIndex(e);
 
-		/* If e->isTick == false, e is not in pendingQueue anymore and this function has the only reference to it.
-		 * If e->isTick == true, we just enqueued e another time. If removeJob() is called on e->job from
-		 * job->tick() or another thread, then this will remove e from pendingQueue and delete e after we release the mutex.
-		 * In that case we may not access e after 'l.release()'.
-		 */
-		ITickJob* job = e->job;
-		bool isTick = e->isTick;
-		l.release();
+	/* If e->isTick == false, e is not queued anymore and this function has the only reference to it.
+	 * If e->isTick == true, we just enqueued e another time. If removeJob() is called on e->job from
+	 * job->tick() or another thread, then this will remove e from the wheel and delete e after we release the mutex.
+	 * In that case we may not access e after 'l.release()'.
+	 */
+	ITickJob* job = e->job;
+	bool isTick = e->isTick;
+	l.release();
 
-		job->tick();
+	job->tick();
 
-		l.acquire();
+	l.acquire();
 
-		/* Cleanup */
-		if(!isTick)
-		{
-			e->job->tickFence();
-			delete e;
-		}
+	/* Cleanup */
+	if(!isTick)
+	{
+		job->tickFence();
+		delete e;
 	}
 }
 
 void TimerThread::addTick(uint32_t tickTime, ITickJob* job)
 {
 	TimingEvent* e=new TimingEvent(job, true, tickTime, 0);
-	insertNewEvent(e);
+	insertNewEvent(e, tickTime);
 }
 
 void TimerThread::addWait(uint32_t waitTime, ITickJob* job)
 {
-	TimingEvent* e=new TimingEvent(job, false, 0, waitTime);
-	insertNewEvent(e);
+	TimingEvent* e=new TimingEvent(job, false, 0, 0);
+	insertNewEvent(e, waitTime);
 }
 
 /*
  * removeJob()
  *
- * Removes the given job from the pendingEvents queue
+ * Removes the given job from the pending events
  */
 void TimerThread::removeJob(ITickJob* job)
 {
 	Mutex::Lock l(mutex);
 
-	/* See if that job is currently pending */
-	list<TimingEvent*>::iterator it=pendingEvents.begin();
-	bool first=true;
-	//Find if the job is in the list
-	for(;it!=pendingEvents.end();++it)
-	{
-		if((*it)->job==job)
-			break;
-		first=false;
-	}
-
-	if(it==pendingEvents.end())
+	auto it=jobEvents.find(job);
+	if(it==jobEvents.end())
 		return;
 
-	TimingEvent* e=*it;
-	pendingEvents.erase(it);
+	TimingEvent* e=it->second;
+	jobEvents.erase(it);
+	unlinkEvent(e);
+	/* If the worker is sleeping until this event it will just find nothing to do */
 	delete e;
+}
 
-	/* the worker is waiting on this job, wake him up */
-	if(first)
-		newEvent.signal();
+void TimerThread::enableVirtualClock(uint64_t start)
+{
+	Mutex::Lock l(mutex);
+	virtualClock=true;
+	virtualTime=start;
+	//Nothing is scheduled yet, so the wheel can be rewound to the virtual time
+	if(wheelEvents==0 && ready.empty())
+		currentTick=start;
+	newEvent.signal();
+}
+
+void TimerThread::advanceVirtualClock(uint64_t now)
+{
+	Mutex::Lock l(mutex);
+	assert(virtualClock);
+	virtualTime=now;
+	advance(now);
+	while(!ready.empty() && !stopped)
+		fireReady(l);
 }
 
 Chronometer::Chronometer()
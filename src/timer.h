@@ -21,7 +21,7 @@
 #define TIMER_H 1
 
 #include "compat.h"
-#include <list>
+#include <unordered_map>
 #include <ctime>
 #include "threading.h"
 
@@ -52,26 +52,77 @@ public:
 class TimerThread
 {
 private:
+	class TimingEvent;
+	/* Intrusive list of events, in insertion order */
+	class EventList
+	{
+	public:
+		TimingEvent* head;
+		TimingEvent* tail;
+		EventList():head(NULL),tail(NULL){}
+		bool empty() const { return head==NULL; }
+		void append(TimingEvent* e);
+		void remove(TimingEvent* e);
+	};
 	class TimingEvent
 	{
 	public:
-		TimingEvent(ITickJob* _job, bool _isTick, uint32_t _tickTime, uint32_t _waitTime) 
-			: job(_job),wakeUpTime(_isTick ? _tickTime : _waitTime),tickTime(_tickTime),isTick(_isTick) {};
+		TimingEvent(ITickJob* _job, bool _isTick, uint32_t _tickTime, uint64_t _due)
+			: job(_job),due(_due),tickTime(_tickTime),isTick(_isTick),prev(NULL),next(NULL),list(NULL) {};
 		ITickJob* job;
-		CondTime wakeUpTime;
+		//Absolute expiration time, in the milliseconds of compat_msectiming
+		uint64_t due;
 		uint32_t tickTime;
 		bool isTick;
+		//Links in the list currently holding the event
+		TimingEvent* prev;
+		TimingEvent* next;
+		EventList* list;
 	};
+	/*
+	 * Hierarchical timing wheel with a resolution of one millisecond.
+	 * Every slot of level l spans SLOTS^l milliseconds. An event is stored in the lowest
+	 * level whose range covers its expiration and is moved down when the wheel reaches
+	 * the beginning of its slot, so inserting and removing events are O(1).
+	 */
+	static const uint32_t LEVELS=4;
+	static const uint32_t SLOT_BITS=8;
+	static const uint32_t SLOTS=1<<SLOT_BITS;
+	/* Events due up to this many milliseconds after the first one are fired in the same wakeup */
+	static const uint32_t TIMER_SLACK=2;
+	EventList wheel[LEVELS][SLOTS];
+	uint32_t wheelEvents;
+	//Events that are due, they are fired in order
+	EventList ready;
+	//The ticks before this one have already been moved to ready
+	uint64_t currentTick;
+	//Every pending event by job, used to remove them
+	std::unordered_multimap<ITickJob*,TimingEvent*> jobEvents;
+	//When the worker is going to wake up, 0 if it is running and UINT64_MAX if it waits for events
+	uint64_t wakeUpTime;
+	//If set, time only moves with advanceVirtualClock and the worker does not fire any event
+	bool virtualClock;
+	uint64_t virtualTime;
 	Mutex mutex;
 	Cond newEvent;
 	Thread* t;
-	std::list<TimingEvent*> pendingEvents;
 	SystemState* m_sys;
 	volatile bool stopped;
 	bool joined;
 	void worker();
-	void insertNewEvent(TimingEvent* e);
-	void insertNewEvent_nolock(TimingEvent* e);
+	uint64_t getTime() const { return virtualClock?virtualTime:compat_msectiming(); }
+	/* Schedules e delay milliseconds from now */
+	void insertNewEvent(TimingEvent* e, uint32_t delay);
+	void insertInWheel(TimingEvent* e);
+	void unlinkEvent(TimingEvent* e);
+	void removeFromIndex(TimingEvent* e);
+	void cascade(uint32_t level);
+	/* Moves the events due up to now to the ready list */
+	void advance(uint64_t now);
+	/* The earliest time the worker has to wake up, UINT64_MAX if there are no events */
+	uint64_t nextExpiration() const;
+	/* Fires the first ready event, the mutex is released while the job runs */
+	void fireReady(Mutex::Lock& l);
 	void dumpJobs();
 public:
 	TimerThread(SystemState* s);
@@ -90,6 +141,13 @@ public:
 	 * wait until it is done.
 	 */
 	void removeJob(ITickJob* job);
+	/*
+	 * Switches to a virtual clock starting at the given time, in the milliseconds
+	 * of compat_msectiming. Events are then only fired by advanceVirtualClock
+	 */
+	void enableVirtualClock(uint64_t start);
+	/* Moves the virtual clock to now and fires the due events in the calling thread */
+	void advanceVirtualClock(uint64_t now);
 };
 
 class Chronometer
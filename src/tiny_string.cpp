@@ -432,6 +432,18 @@ void tiny_string::init()
 	}
 }
 
+tiny_string tiny_string::fromBytes(const char* s, uint32_t len)
+{
+	tiny_string ret;
+	if(len+1 > STATIC_SIZE)
+		ret.createBuffer(len+1);
+	memcpy(ret.buf,s,len);
+	ret.buf[len]=0;
+	ret.stringSize=len+1;
+	ret.init();
+	return ret;
+}
+
 tiny_string tiny_string::fromChar(uint32_t c)
 {
 	tiny_string ret;
@@ -649,9 +661,3 @@ int tiny_string::compare(const tiny_string& r) const
 	return res;
 }
 
-#ifdef MEMORY_USAGE_PROFILING
-void tiny_string::reportMemoryChange(int32_t change) const
-{
-	getSys()->stringMemory->addBytes(change);
-}
-#endif
@@ -24,6 +24,7 @@
 #include <cstdint>
 #include <ostream>
 #include <list>
+#include <functional>
 /* for utf8 handling */
 #include <glib.h>
 #include <glibmm/ustring.h>
@@ -99,13 +100,8 @@ private:
 	uint32_t stringSize;
 	uint32_t numchars;
 	TYPE type;
-#ifdef MEMORY_USAGE_PROFILING
 	//Implemented in memory_support.cpp
 	DLL_PUBLIC void reportMemoryChange(int32_t change) const;
-#else
-	//NOP
-	void reportMemoryChange(int32_t change) const {}
-#endif
 	//TODO: use static buffer again if reassigning to short string
 	void makePrivateCopy(const char* s);
 	void createBuffer(uint32_t s);
@@ -120,6 +116,8 @@ public:
 	tiny_string():_buf_static(),buf(_buf_static),stringSize(1),numchars(0),type(STATIC),isASCII(true),hasNull(false){buf[0]=0;}
 	/* construct from utf character */
 	static tiny_string fromChar(uint32_t c);
+	/* construct from a buffer that may contain '\0's and is not terminated */
+	static tiny_string fromBytes(const char* s, uint32_t len);
 	tiny_string(const char* s,bool copy=false);
 	tiny_string(const tiny_string& r);
 	tiny_string(const std::string& r);
@@ -176,6 +174,11 @@ public:
 	{
 		return numchars;
 	}
+	/* if true character indices are the same as byte indices */
+	inline bool isAscii() const
+	{
+		return isASCII;
+	}
 	
 	/* start and len are indices of utf8-characters */
 	tiny_string substr(uint32_t start, uint32_t len) const;
@@ -217,7 +220,30 @@ public:
 	CharIterator end();
 	CharIterator end() const;
 	int compare(const tiny_string& r) const;
+	/* FNV-1a hash of the bytes */
+	size_t hash() const
+	{
+		size_t ret=2166136261u;
+		for(uint32_t i=0;i<stringSize-1;i++)
+		{
+			ret^=(unsigned char)buf[i];
+			ret*=16777619u;
+		}
+		return ret;
+	}
+};
+
 };
 
+namespace std
+{
+template<>
+struct hash<lightspark::tiny_string>
+{
+	size_t operator()(const lightspark::tiny_string& s) const
+	{
+		return s.hash();
+	}
 };
+}
 #endif /* TINY_STRING_H */
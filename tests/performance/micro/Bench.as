@@ -0,0 +1,46 @@
+/*
+ * Harness of the micro-benchmarks, compiled in front of every benchmark by run-micro.
+ *
+ * bench(name, body) calls body(n), which must run n operations of the benchmark.
+ * n is calibrated so that a sample lasts about BENCH_SAMPLE_MS, the calibration also
+ * warms up the code. Every sample is traced as
+ * BENCH <name> <operations> <milliseconds>
+ * Date is used instead of getTimer because lightspark-bench freezes getTimer during
+ * a frame.
+ */
+
+const BENCH_SAMPLES:int = 10;
+const BENCH_SAMPLE_MS:Number = 200;
+const BENCH_CALIBRATION_MS:Number = 20;
+
+//Results are stored here, so that no benchmark computes something unused
+var benchSink:*;
+
+function benchNow():Number
+{
+	return new Date().getTime();
+}
+
+function bench(name:String, body:Function):void
+{
+	var n:int = 1;
+	var start:Number;
+	var elapsed:Number;
+	while(true)
+	{
+		start = benchNow();
+		body(n);
+		elapsed = benchNow() - start;
+		if(elapsed >= BENCH_CALIBRATION_MS || n >= 0x20000000)
+			break;
+		n *= 2;
+	}
+	n = Math.max(1, Math.min(0x7fffffff, Math.round(n * BENCH_SAMPLE_MS / Math.max(elapsed, 1))));
+	for(var i:int = 0; i < BENCH_SAMPLES; i++)
+	{
+		start = benchNow();
+		body(n);
+		elapsed = benchNow() - start;
+		trace("BENCH " + name + " " + n + " " + elapsed);
+	}
+}
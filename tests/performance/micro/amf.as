@@ -0,0 +1,49 @@
+/* AMF3 serialization through ByteArray.writeObject and readObject */
+
+//Only builtin.abc is imported, the player classes are looked up at runtime
+namespace benchutils = "flash.utils";
+
+function benchAMFValue():Object
+{
+	return { id: 1234, name: "lightspark", tags: ["flash", "player", "free"],
+		version: { major: 0, minor: 7, micro: 2 }, active: true, ratio: 0.75 };
+}
+
+bench("amf.write_object", function(n:int):void
+{
+	var o:Object = benchAMFValue();
+	var b:* = new benchutils::ByteArray();
+	for(var i:int = 0; i < n; i++)
+	{
+		b.position = 0;
+		b.writeObject(o);
+	}
+	benchSink = b;
+});
+
+bench("amf.read_object", function(n:int):void
+{
+	var b:* = new benchutils::ByteArray();
+	b.writeObject(benchAMFValue());
+	var o:Object;
+	for(var i:int = 0; i < n; i++)
+	{
+		b.position = 0;
+		o = b.readObject();
+	}
+	benchSink = o;
+});
+
+bench("amf.write_int_array", function(n:int):void
+{
+	var a:Array = [];
+	for(var j:int = 0; j < 64; j++)
+		a.push(j);
+	var b:* = new benchutils::ByteArray();
+	for(var i:int = 0; i < n; i++)
+	{
+		b.position = 0;
+		b.writeObject(a);
+	}
+	benchSink = b;
+});
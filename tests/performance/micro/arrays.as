@@ -0,0 +1,84 @@
+/* Array and Vector operations */
+
+const BENCH_ARRAY_SIZE:int = 1024;
+
+bench("arrays.array_read_write", function(n:int):void
+{
+	var arr:Array = new Array(BENCH_ARRAY_SIZE);
+	for(var j:int = 0; j < BENCH_ARRAY_SIZE; j++)
+		arr[j] = j;
+	for(var i:int = 0; i < n; i++)
+	{
+		var k:int = i & (BENCH_ARRAY_SIZE - 1);
+		arr[k] = arr[k] + 1;
+	}
+	benchSink = arr;
+});
+
+bench("arrays.array_push_pop", function(n:int):void
+{
+	var arr:Array = [];
+	for(var i:int = 0; i < n; i++)
+	{
+		arr.push(i);
+		if(arr.length == BENCH_ARRAY_SIZE)
+			arr.length = 0;
+	}
+	benchSink = arr;
+});
+
+bench("arrays.array_literal", function(n:int):void
+{
+	var arr:Array;
+	for(var i:int = 0; i < n; i++)
+		arr = [i, i, i, i];
+	benchSink = arr;
+});
+
+bench("arrays.array_sort", function(n:int):void
+{
+	var arr:Array = new Array(BENCH_ARRAY_SIZE);
+	//Every sort counts as BENCH_ARRAY_SIZE operations
+	for(var i:int = 0; i < n; i += BENCH_ARRAY_SIZE)
+	{
+		for(var j:int = 0; j < BENCH_ARRAY_SIZE; j++)
+			arr[j] = (j * 7919) & 4095;
+		arr.sort(Array.NUMERIC);
+	}
+	benchSink = arr;
+});
+
+bench("arrays.vector_int_read_write", function(n:int):void
+{
+	var v:Vector.<int> = new Vector.<int>(BENCH_ARRAY_SIZE, true);
+	for(var i:int = 0; i < n; i++)
+	{
+		var k:int = i & (BENCH_ARRAY_SIZE - 1);
+		v[k] = v[k] + 1;
+	}
+	benchSink = v;
+});
+
+bench("arrays.vector_number_read_write", function(n:int):void
+{
+	var v:Vector.<Number> = new Vector.<Number>(BENCH_ARRAY_SIZE, true);
+	for(var i:int = 0; i < n; i++)
+	{
+		var k:int = i & (BENCH_ARRAY_SIZE - 1);
+		v[k] = v[k] * 0.5 + 1;
+	}
+	benchSink = v;
+});
+
+bench("arrays.vector_object_push", function(n:int):void
+{
+	var v:Vector.<Object> = new Vector.<Object>();
+	var o:Object = {};
+	for(var i:int = 0; i < n; i++)
+	{
+		v.push(o);
+		if(v.length == BENCH_ARRAY_SIZE)
+			v.length = 0;
+	}
+	benchSink = v;
+});
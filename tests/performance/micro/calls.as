@@ -0,0 +1,105 @@
+/* Method calls: static, final, virtual, interface and through Function objects */
+
+interface BenchShape
+{
+	function area():int;
+}
+
+class BenchBase implements BenchShape
+{
+	public function area():int { return 1; }
+	public final function finalArea():int { return 2; }
+	public static function staticArea(a:int):int { return a + 1; }
+}
+
+class BenchDerived extends BenchBase
+{
+	override public function area():int { return 3; }
+}
+
+function benchGlobalFunction(a:int, b:int):int
+{
+	return a + b;
+}
+
+function benchRest(... args):int
+{
+	return args.length;
+}
+
+bench("calls.global_function", function(n:int):void
+{
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a = benchGlobalFunction(a, i);
+	benchSink = a;
+});
+
+bench("calls.static_method", function(n:int):void
+{
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a = BenchBase.staticArea(a);
+	benchSink = a;
+});
+
+bench("calls.final_method", function(n:int):void
+{
+	var o:BenchBase = new BenchBase();
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a += o.finalArea();
+	benchSink = a;
+});
+
+bench("calls.virtual_method", function(n:int):void
+{
+	var o:BenchBase = new BenchDerived();
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a += o.area();
+	benchSink = a;
+});
+
+bench("calls.interface_method", function(n:int):void
+{
+	var o:BenchShape = new BenchDerived();
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a += o.area();
+	benchSink = a;
+});
+
+bench("calls.untyped_receiver", function(n:int):void
+{
+	var o:* = new BenchDerived();
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a += o.area();
+	benchSink = a;
+});
+
+bench("calls.function_call", function(n:int):void
+{
+	var f:Function = benchGlobalFunction;
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a = f.call(null, a, 1);
+	benchSink = a;
+});
+
+bench("calls.rest_arguments", function(n:int):void
+{
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a += benchRest(i, i, i);
+	benchSink = a;
+});
+
+bench("calls.constructor", function(n:int):void
+{
+	var o:BenchBase;
+	for(var i:int = 0; i < n; i++)
+		o = new BenchDerived();
+	benchSink = o;
+});
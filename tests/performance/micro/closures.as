@@ -0,0 +1,54 @@
+/* Closures: creation, calls and access to captured variables */
+
+bench("closures.call", function(n:int):void
+{
+	var k:int = 3;
+	var f:Function = function(a:int):int { return a + k; };
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a = f(a);
+	benchSink = a;
+});
+
+bench("closures.create", function(n:int):void
+{
+	var f:Function;
+	for(var i:int = 0; i < n; i++)
+		f = function():int { return i; };
+	benchSink = f;
+});
+
+bench("closures.captured_write", function(n:int):void
+{
+	var counter:int = 0;
+	var inc:Function = function():void { counter++; };
+	for(var i:int = 0; i < n; i++)
+		inc();
+	benchSink = counter;
+});
+
+bench("closures.nested_scope", function(n:int):void
+{
+	var outer:int = 1;
+	var make:Function = function():Function
+	{
+		var middle:int = 2;
+		return function(a:int):int { return a + outer + middle; };
+	};
+	var f:Function = make();
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a = f(a);
+	benchSink = a;
+});
+
+bench("closures.array_foreach", function(n:int):void
+{
+	var arr:Array = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10];
+	var sum:int = 0;
+	var add:Function = function(item:*, index:int, array:Array):void { sum += item; };
+	//Every call of forEach runs 10 operations
+	for(var i:int = 0; i < n; i += 10)
+		arr.forEach(add);
+	benchSink = sum;
+});
@@ -0,0 +1,68 @@
+/* flash.utils.Dictionary with string, integer and object keys */
+
+//Only builtin.abc is imported, the player classes are looked up at runtime
+namespace benchutils = "flash.utils";
+
+const BENCH_KEYS:int = 1024;
+
+bench("dictionary.string_keys", function(n:int):void
+{
+	var d:* = new benchutils::Dictionary();
+	var keys:Array = [];
+	for(var j:int = 0; j < BENCH_KEYS; j++)
+		keys.push("key" + j);
+	for(var i:int = 0; i < n; i++)
+	{
+		var k:String = keys[i & (BENCH_KEYS - 1)];
+		d[k] = i;
+	}
+	benchSink = d;
+});
+
+bench("dictionary.int_keys", function(n:int):void
+{
+	var d:* = new benchutils::Dictionary();
+	for(var i:int = 0; i < n; i++)
+		d[i & (BENCH_KEYS - 1)] = i;
+	benchSink = d;
+});
+
+bench("dictionary.object_keys", function(n:int):void
+{
+	var d:* = new benchutils::Dictionary();
+	var keys:Array = [];
+	for(var j:int = 0; j < BENCH_KEYS; j++)
+		keys.push({});
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+	{
+		var k:Object = keys[i & (BENCH_KEYS - 1)];
+		d[k] = i;
+		a += d[k];
+	}
+	benchSink = a;
+});
+
+bench("dictionary.iterate", function(n:int):void
+{
+	var d:* = new benchutils::Dictionary();
+	for(var j:int = 0; j < BENCH_KEYS; j++)
+		d["key" + j] = j;
+	var a:int = 0;
+	//Every iteration over the dictionary counts as BENCH_KEYS operations
+	for(var i:int = 0; i < n; i += BENCH_KEYS)
+		for each(var v:int in d)
+			a += v;
+	benchSink = a;
+});
+
+bench("dictionary.delete", function(n:int):void
+{
+	var d:* = new benchutils::Dictionary();
+	for(var i:int = 0; i < n; i++)
+	{
+		d[i] = i;
+		delete d[i];
+	}
+	benchSink = d;
+});
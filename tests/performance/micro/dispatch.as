@@ -0,0 +1,57 @@
+/* Opcode dispatch: tight loops over local registers */
+
+bench("dispatch.int_arith", function(n:int):void
+{
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a = (a + i) ^ (i << 1);
+	benchSink = a;
+});
+
+bench("dispatch.number_arith", function(n:int):void
+{
+	var a:Number = 0;
+	for(var i:int = 0; i < n; i++)
+		a = a * 0.5 + i;
+	benchSink = a;
+});
+
+bench("dispatch.untyped_arith", function(n:int):void
+{
+	var a:* = 0;
+	for(var i:* = 0; i < n; i++)
+		a = a + i - 1;
+	benchSink = a;
+});
+
+bench("dispatch.branches", function(n:int):void
+{
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+	{
+		if(i & 1)
+			a++;
+		else if(i & 2)
+			a--;
+		else
+			a += 2;
+	}
+	benchSink = a;
+});
+
+bench("dispatch.switch", function(n:int):void
+{
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+	{
+		switch(i & 7)
+		{
+			case 0: a += 1; break;
+			case 1: a -= 2; break;
+			case 2: a ^= 3; break;
+			case 3: a |= 4; break;
+			default: a++;
+		}
+	}
+	benchSink = a;
+});
@@ -0,0 +1,30 @@
+/* JSON parsing and serialization */
+
+const BENCH_JSON:String = '{"id":1234,"name":"lightspark","tags":["flash","player","free"],' +
+	'"version":{"major":0,"minor":7,"micro":2},"active":true,"ratio":0.75,"owner":null}';
+
+bench("json.parse", function(n:int):void
+{
+	var o:Object;
+	for(var i:int = 0; i < n; i++)
+		o = JSON.parse(BENCH_JSON);
+	benchSink = o;
+});
+
+bench("json.stringify", function(n:int):void
+{
+	var o:Object = JSON.parse(BENCH_JSON);
+	var s:String;
+	for(var i:int = 0; i < n; i++)
+		s = JSON.stringify(o);
+	benchSink = s;
+});
+
+bench("json.parse_array", function(n:int):void
+{
+	var s:String = "[" + new Array(65).join("1,") + "1]";
+	var a:Array;
+	for(var i:int = 0; i < n; i++)
+		a = JSON.parse(s) as Array;
+	benchSink = a;
+});
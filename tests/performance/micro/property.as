@@ -0,0 +1,65 @@
+/* Property access on sealed classes, dynamic objects and through the prototype chain */
+
+class BenchPoint
+{
+	public var x:int;
+	public var y:int;
+	private var _z:int;
+	public function get z():int { return _z; }
+	public function set z(v:int):void { _z = v; }
+}
+
+dynamic class BenchDynamic
+{
+}
+
+bench("property.slot_read_write", function(n:int):void
+{
+	var p:BenchPoint = new BenchPoint();
+	for(var i:int = 0; i < n; i++)
+		p.x = p.y + i;
+	benchSink = p.x;
+});
+
+bench("property.untyped_slot", function(n:int):void
+{
+	var p:* = new BenchPoint();
+	for(var i:int = 0; i < n; i++)
+		p.x = p.y + i;
+	benchSink = p.x;
+});
+
+bench("property.accessor", function(n:int):void
+{
+	var p:BenchPoint = new BenchPoint();
+	for(var i:int = 0; i < n; i++)
+		p.z = p.z + 1;
+	benchSink = p.z;
+});
+
+bench("property.dynamic", function(n:int):void
+{
+	var o:Object = { a: 1, b: 2, c: 3 };
+	for(var i:int = 0; i < n; i++)
+		o.a = o.b + o.c;
+	benchSink = o.a;
+});
+
+bench("property.dynamic_class", function(n:int):void
+{
+	var o:BenchDynamic = new BenchDynamic();
+	o.value = 0;
+	for(var i:int = 0; i < n; i++)
+		o.value = o.value + 1;
+	benchSink = o.value;
+});
+
+bench("property.prototype_chain", function(n:int):void
+{
+	var o:Object = new Object();
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		if(o.hasOwnProperty)
+			a++;
+	benchSink = a;
+});
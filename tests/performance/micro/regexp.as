@@ -0,0 +1,48 @@
+/* Regular expressions */
+
+const BENCH_TEXT:String = "From: someone@example.com Date: 2013-04-01 Subject: lightspark 0.7.2 released";
+
+bench("regexp.test", function(n:int):void
+{
+	var re:RegExp = /\d{4}-\d{2}-\d{2}/;
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		if(re.test(BENCH_TEXT))
+			a++;
+	benchSink = a;
+});
+
+bench("regexp.exec_groups", function(n:int):void
+{
+	var re:RegExp = /(\w+)@(\w+)\.(\w+)/;
+	var r:Object;
+	for(var i:int = 0; i < n; i++)
+		r = re.exec(BENCH_TEXT);
+	benchSink = r;
+});
+
+bench("regexp.global_match", function(n:int):void
+{
+	var re:RegExp = /\d+/g;
+	var r:Array;
+	for(var i:int = 0; i < n; i++)
+		r = BENCH_TEXT.match(re);
+	benchSink = r;
+});
+
+bench("regexp.replace", function(n:int):void
+{
+	var re:RegExp = /\s+/g;
+	var r:String;
+	for(var i:int = 0; i < n; i++)
+		r = BENCH_TEXT.replace(re, "_");
+	benchSink = r;
+});
+
+bench("regexp.compile", function(n:int):void
+{
+	var re:RegExp;
+	for(var i:int = 0; i < n; i++)
+		re = new RegExp("[a-z]+" + (i & 15), "g");
+	benchSink = re;
+});
@@ -0,0 +1,77 @@
+/* String operations */
+
+bench("strings.concat", function(n:int):void
+{
+	var s:String;
+	for(var i:int = 0; i < n; i++)
+		s = "item" + i;
+	benchSink = s;
+});
+
+bench("strings.append", function(n:int):void
+{
+	var s:String = "";
+	for(var i:int = 0; i < n; i++)
+	{
+		if((i & 1023) == 0)
+			s = "";
+		s += "x";
+	}
+	benchSink = s;
+});
+
+bench("strings.charCodeAt", function(n:int):void
+{
+	var s:String = "The quick brown fox jumps over the lazy dog";
+	var len:int = s.length;
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a += s.charCodeAt(i % len);
+	benchSink = a;
+});
+
+bench("strings.indexOf", function(n:int):void
+{
+	var s:String = "The quick brown fox jumps over the lazy dog";
+	var a:int = 0;
+	for(var i:int = 0; i < n; i++)
+		a += s.indexOf("lazy");
+	benchSink = a;
+});
+
+bench("strings.substr", function(n:int):void
+{
+	var s:String = "The quick brown fox jumps over the lazy dog";
+	var r:String;
+	for(var i:int = 0; i < n; i++)
+		r = s.substr(i & 31, 8);
+	benchSink = r;
+});
+
+bench("strings.split_join", function(n:int):void
+{
+	var s:String = "a,b,c,d,e,f,g,h";
+	var r:String;
+	for(var i:int = 0; i < n; i++)
+		r = s.split(",").join(";");
+	benchSink = r;
+});
+
+bench("strings.compare", function(n:int):void
+{
+	var a:String = "abcdefgh" + "ijkl";
+	var b:String = "abcdefghijkl";
+	var c:int = 0;
+	for(var i:int = 0; i < n; i++)
+		if(a == b)
+			c++;
+	benchSink = c;
+});
+
+bench("strings.number_to_string", function(n:int):void
+{
+	var r:String;
+	for(var i:int = 0; i < n; i++)
+		r = String(i * 0.5);
+	benchSink = r;
+});
@@ -0,0 +1,51 @@
+/* XML parsing and E4X access */
+
+const BENCH_XML:String = '<catalog>' +
+	'<book id="1"><title>First</title><price>10</price></book>' +
+	'<book id="2"><title>Second</title><price>20</price></book>' +
+	'<book id="3"><title>Third</title><price>30</price></book>' +
+	'</catalog>';
+
+bench("xml.parse", function(n:int):void
+{
+	var x:XML;
+	for(var i:int = 0; i < n; i++)
+		x = new XML(BENCH_XML);
+	benchSink = x;
+});
+
+bench("xml.child_access", function(n:int):void
+{
+	var x:XML = new XML(BENCH_XML);
+	var s:String;
+	for(var i:int = 0; i < n; i++)
+		s = x.book[1].title;
+	benchSink = s;
+});
+
+bench("xml.attribute_filter", function(n:int):void
+{
+	var x:XML = new XML(BENCH_XML);
+	var l:XMLList;
+	for(var i:int = 0; i < n; i++)
+		l = x.book.(@id == "2");
+	benchSink = l;
+});
+
+bench("xml.descendants", function(n:int):void
+{
+	var x:XML = new XML(BENCH_XML);
+	var l:XMLList;
+	for(var i:int = 0; i < n; i++)
+		l = x..price;
+	benchSink = l;
+});
+
+bench("xml.to_xml_string", function(n:int):void
+{
+	var x:XML = new XML(BENCH_XML);
+	var s:String;
+	for(var i:int = 0; i < n; i++)
+		s = x.toXMLString();
+	benchSink = s;
+});